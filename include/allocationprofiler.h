@@ -0,0 +1,150 @@
+#ifndef allocationprofiler_h
+#define allocationprofiler_h
+
+#include "tipos.h"
+
+#include <map>
+#include <string>
+#include <mutex>
+#include <atomic>
+
+using namespace std;
+
+class Frame;
+
+/**
+ * Quantidade de linhas de cada tabela do relatório de alocações.
+ */
+#define ALLOCATION_PROFILER_REPORT_LINES 20
+
+/**
+ * Profiler de alocação: contabiliza os objetos criados pelas instruções Java (new, newarray, anewarray,
+ * multianewarray e as constantes string de ldc e ldc_w) por local de alocação, i.e. o método e o índice da instrução,
+ * e por classe.
+ *
+ * O profiler é ativado com \c -XX:+AllocationProfiling, e o relatório, ordenado pela quantidade de bytes, é impresso
+ * quando a JVM termina. Com \c -XX:AllocationSampleInterval=N, somente uma alocação a cada N KB alocados por uma
+ * thread é registrada (amostragem), e os bytes de cada local são estimados pela quantidade de amostras.
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class AllocationProfiler {
+public:
+    /**
+     * @brief Obter a única instância do AllocationProfiler.
+     * @return A instância do AllocationProfiler.
+     */
+    static AllocationProfiler& getInstance() {
+        static AllocationProfiler instance;
+        return instance;
+    }
+
+    /**
+     * @brief Destrutor padrão.
+     */
+    ~AllocationProfiler();
+
+    /**
+     * @brief Ativa o profiler. Deve ser chamado antes da execução das threads Java.
+     * @param sampleInterval A quantidade de bytes alocados por uma thread entre duas amostras, ou 0 para registrar
+     * todas as alocações.
+     */
+    void enable(size_t sampleInterval);
+
+    /**
+     * @brief Verifica se o profiler está ativo (consultado em cada alocação, sem nenhum lock).
+     */
+    static bool isEnabled() {
+        return _enabled.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief Registra uma alocação feita pela instrução atual de um frame. O tipo dos objetos é obtido da instrução.
+     * @param frame O frame que executa a instrução de alocação.
+     * @param bytes A quantidade de bytes ocupados na heap pelos objetos criados.
+     * @param objects A quantidade de objetos criados (e.g. os arrays de um multianewarray).
+     */
+    void record(Frame *frame, size_t bytes, size_t objects = 1);
+
+    /**
+     * @brief Retira os locais de alocação dos métodos de uma classe que será descarregada. As suas alocações continuam
+     * no relatório, identificadas pelo nome, pois o endereço dos métodos pode ser reutilizado por outra classe.
+     * @param classFile A classe descarregada.
+     */
+    void unloadClass(ClassFile *classFile);
+
+    /**
+     * @brief Imprime o relatório de alocações (por local de alocação e por classe) e desativa o profiler.
+     */
+    void printReport();
+
+private:
+    /**
+     * @brief Construtor padrão.
+     */
+    AllocationProfiler();
+
+    AllocationProfiler(AllocationProfiler const&); // não permitir implementação do construtor de cópia
+    void operator=(AllocationProfiler const&); // não permitir implementação do operador de igual
+
+    /**
+     * Um local de alocação e as alocações registradas nele. Os nomes são copiados no primeiro registro, pois o relatório
+     * é impresso no fim da JVM, quando as classes podem já ter sido liberadas.
+     */
+    struct AllocationSite {
+        string method;
+        u4 pc;
+        string type;
+        size_t objects;
+        size_t bytes;
+    };
+
+    /**
+     * @brief Obtém o nome qualificado do método de um frame (e.g. Main.main([Ljava/lang/String;)V).
+     */
+    static string methodName(Frame *frame);
+
+    /**
+     * @brief Obtém o tipo dos objetos criados pela instrução atual de um frame (e.g. [I para um newarray de int).
+     */
+    static string typeName(Frame *frame);
+
+    /**
+     * @brief Obtém o nome de um local de alocação no relatório (e.g. Main.main([Ljava/lang/String;)V @ 3 ([I)).
+     */
+    static string siteName(const AllocationSite &site);
+
+    /**
+     * @brief Soma as alocações de um local às de mesmo nome no mapa dado.
+     */
+    static void addSite(map<string, AllocationSite> &sites, const AllocationSite &site);
+
+    /**
+     * Os locais de alocação, identificados pelo método (method_info) e pelo índice da instrução.
+     */
+    map<pair<method_info*, u4>, AllocationSite> _sites;
+
+    /**
+     * Os locais de alocação de classes já descarregadas, identificados pelo nome do local.
+     */
+    map<string, AllocationSite> _unloadedSites;
+
+    /**
+     * Serializa o acesso a \c _sites e a \c _unloadedSites.
+     */
+    mutex _sitesMutex;
+
+    /**
+     * A quantidade de bytes entre duas amostras (0 caso todas as alocações sejam registradas).
+     */
+    size_t _sampleInterval;
+
+    static atomic<bool> _enabled;
+
+    /**
+     * A quantidade de bytes que a thread atual ainda aloca até a próxima amostra.
+     */
+    static thread_local size_t _bytesUntilSample;
+};
+
+#endif // allocationprofiler_h
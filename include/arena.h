@@ -0,0 +1,92 @@
+#ifndef arena_h
+#define arena_h
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Memória obtida fora de uma arena (e.g. o conteúdo de um arquivo .class), cuja posse pode ser transferida a ela.
+ */
+struct AdoptedMemory {
+    void *address; // NULL caso não haja memória a ser liberada (e.g. uma entrada de um JAR sem compressão)
+    size_t length;
+    bool mapped; // true para um mapeamento (liberado com munmap), e false para um bloco de malloc (liberado com free)
+};
+
+/**
+ * Região de alocação (arena) para os metadados de uma classe.
+ *
+ * As alocações são feitas avançando um ponteiro dentro de blocos de memória, e não podem ser liberadas
+ * individualmente: toda a memória é liberada de uma só vez quando a arena é destruída.
+ */
+class Arena {
+
+public:
+    /**
+     * @brief Cria uma arena.
+     * @param capacity O tamanho do primeiro bloco. Blocos adicionais são criados caso ele não seja suficiente.
+     */
+    Arena(size_t capacity);
+
+    /**
+     * @brief Destrutor padrão. Libera todos os blocos da arena.
+     */
+    ~Arena();
+
+    /**
+     * @brief Aloca memória na arena, alinhada em 8 bytes.
+     * @param size A quantidade de bytes.
+     * @return O ponteiro para a memória alocada.
+     */
+    void* allocate(size_t size);
+
+    /**
+     * @brief Transfere à arena a posse de memória obtida fora dela, que passa a ser liberada junto com a arena (e.g. o
+     * arquivo .class, para o qual as estruturas da classe apontam).
+     * @param memory A memória, ignorada caso \c address seja \c NULL.
+     */
+    void adopt(const AdoptedMemory &memory);
+
+    /**
+     * @brief Obtém a quantidade total de bytes reservados pela arena.
+     * @return A soma dos tamanhos dos blocos.
+     */
+    size_t reservedBytes();
+
+private:
+    Arena(Arena const&); // não permitir implementação do construtor de cópia
+    void operator=(Arena const&); // não permitir implementação do operador de igual
+
+    /**
+     * @brief Cria um novo bloco, que passa a ser o bloco atual.
+     * @param size O tamanho do bloco.
+     */
+    void addChunk(size_t size);
+
+    /**
+     * Os blocos de memória da arena.
+     */
+    vector<char*> _chunks;
+
+    /**
+     * A próxima posição livre e o fim do bloco atual.
+     */
+    char *_current;
+    char *_end;
+
+    /**
+     * O tamanho padrão dos blocos adicionais.
+     */
+    size_t _chunkSize;
+
+    size_t _reservedBytes;
+
+    /**
+     * A memória obtida fora da arena e adotada por ela.
+     */
+    vector<AdoptedMemory> _adopted;
+};
+
+#endif /* arena_h */
@@ -3,95 +3,103 @@
 
 #include "tipos.h"
 #include "object.h"
-
-#include <vector>
+#include "heap.h"
 
 using namespace std;
 
 /**
  * Representa um objeto do tipo array.
+ *
+ * Os elementos ficam logo após o cabeçalho, na mesma alocação, cada um com o tamanho natural do seu tipo (e.g. 1 byte
+ * para boolean e byte, 2 bytes para char e short), e são convertidos de/para \c Value no acesso. Com referências
+ * comprimidas (ver \c Heap::compress), os elementos de um array de referências ocupam 32 bits cada.
  */
 class ArrayObject : public Object {
     
 public:
     /**
-     * @brief Construtor padrão.
+     * @brief Cria (na heap) um array com todos os elementos com o valor inicial (zero ou \c NULL).
      * @param type O tipo de dado que o array irá armazenar.
+     * @param length A quantidade de elementos do array.
+     * @param limited \c true caso a criação deva falhar ao exceder o tamanho máximo da heap (ver \c Heap::allocate).
+     * @return O array criado, ou \c NULL caso a heap tenha se esgotado.
      */
-    ArrayObject(ValueType type);
+    static ArrayObject* create(ValueType type, uint32_t length, bool limited = false);
     
     /**
      * @brief Destrutor padrão.
      */
     ~ArrayObject();
     
-    /**
-     * @brief Representa o tipo de objeto (ObjectType::ARRAY).
-     * @return O tipo de objeto.
-     */
-    ObjectType objectType();
-    
     /**
      * @brief Obtém o tipo de conteúdo do array.
      * @return O tipo que o array armazena.
      */
-    ValueType arrayContentType();
+    ValueType arrayContentType() {
+        return (ValueType) (getPayload() >> 3);
+    }
     
     /**
-     * @brief Realiza a adição de um valor no array.
-     * @param value O valor que será inserido no array.
+     * @brief Obtém o tamanho do array.
+     * @return O tamanho do array.
      */
-    void pushValue(Value value);
-    
+    uint32_t getSize() {
+        return _length;
+    }
+
     /**
-     * @brief Remove um elemento do array dado o seu índice.
-     * @param O índice do elemento que será removido.
-     * @return O valor removido.
+     * @brief Obtém o elemento dado o seu índice.
+     * @param index O índice do elemento.
+     * @return O elemento do array de índice index.
      */
-    Value removeAt(uint32_t index);
+    Value getValue(uint32_t index);
     
     /**
-     * @brief Remove o último elemento do array.
-     * @return O valor removido.
+     * @brief Substitui um elemento do array.
+     * @param index O índice do elemento que será substituído.
+     * @param value O novo valor que será colocado.
      */
-    Value removeLast();
+    void changeValueAt(uint32_t index, Value value);
     
     /**
-     * @brief Remove o primeiro elemento do array.
-     * @return O valor removido.
+     * @brief Obtém um elemento de um array de referências, sem verificar o índice (usado pela coleta de lixo).
      */
-    Value removeFirst();
+    Object* getReference(uint32_t index) {
+        if (Heap::usesCompressedReferences()) {
+            return Heap::decompress(((u4 *) getElements())[index]);
+        }
+        return ((Object **) getElements())[index];
+    }
     
     /**
-     * @brief Obtém o tamanho atual do array.
-     * @return O tamanho atual do array.
+     * @brief Obtém o tamanho de cada elemento de um array do tipo dado, em bytes.
      */
-    uint32_t getSize();
-
+    static size_t elementSize(ValueType type);
+    
     /**
-     * @brief Obtém o elemento dado o seu índice.
-     * @param index O índice do elemento.
-     * @return O elemento do array de índice index.
+     * @brief Obtém o tamanho de um array (cabeçalho e elementos), em bytes.
      */
-    Value getValue(uint32_t index);
+    static size_t instanceSize(ValueType type, uint32_t length) {
+        return sizeof(ArrayObject) + elementSize(type) * length;
+    }
     
+private:
     /**
-     * @brief Substitui um elemento do array.
-     * @param index O índice do elemento que será substituído.
-     * @param value O novo valor que será colocado.
+     * @brief Construtor padrão. A memória do objeto deve ter o tamanho dado por \c instanceSize.
      */
-    void changeValueAt(uint32_t index, Value value);
+    ArrayObject(ValueType type, uint32_t length);
     
-private:
     /**
-     * O tipo de valor que o array armazena.
+     * @brief Obtém o endereço do primeiro elemento.
      */
-    ValueType _arrayType;
+    u1* getElements() {
+        return (u1 *) (this + 1);
+    }
     
     /**
-     * O vetor interno que armazena os elementos.
+     * A quantidade de elementos do array.
      */
-    vector<Value> _elements;
+    uint32_t _length;
 };
 
 #endif /* arrayobject_h */
@@ -4,76 +4,94 @@
 #include "tipos.h"
 #include "object.h"
 #include "classruntime.h"
+#include "heap.h"
 
-#include <map>
 #include <string>
 
 using namespace std;
 
 /**
  * Representa uma instância de classe.
+ *
+ * Os fields do objeto ficam logo após o cabeçalho, nas posições definidas pela disposição da classe (ver
+ * \c ClassRuntime::prepareInstanceLayout), cada um com o tamanho natural do seu tipo, e são convertidos de/para
+ * \c Value no acesso. A classe do objeto é obtida da sua palavra de classe.
  */
 class ClassInstance : public Object {
     
 public:
     /**
-     * @brief Construtor padrão.
+     * @brief Cria (na heap) uma instância da classe dada, com todos os fields com o valor inicial.
+     *
+     * Caso a classe seja abstrata, um erro será emitido.
      * @param classRuntime A classe correspondente ao objeto.
+     * @param limited \c true caso a criação deva falhar ao exceder o tamanho máximo da heap (ver \c Heap::allocate).
+     * @return A instância criada, ou \c NULL caso a heap tenha se esgotado.
      */
-    ClassInstance(ClassRuntime *classRuntime);
+    static ClassInstance* create(ClassRuntime *classRuntime, bool limited = false);
     
     /**
      * @brief Destrutor padrão.
      */
     ~ClassInstance();
     
-    /**
-     * @brief Método utilizado para declaração do tipo de objeto.
-     * @return O tipo de objeto.
-     */
-    ObjectType objectType();
-    
     /**
      * @brief Obtém a classe correspondente ao objeto.
      * @return Retorna a classe do objeto.
      */
-    ClassRuntime* getClassRuntime();
+    ClassRuntime* getClassRuntime() {
+        return (ClassRuntime *) getPayload();
+    }
     
     /**
-     * @brief Adiciona um valor no field de índice informado.
+     * @brief Adiciona um valor no field de nome informado.
      *
-     * Caso o índice do field (i.e. não exista na CP da classe atual seja inválido), um erro será emitido.
+     * Caso o nome do field seja inválido, um erro será emitido.
      * @param value O valor que será inserido no field.
      * @param fieldName O nome do field que será alterado.
      */
-    void putValueIntoField(Value value, string fieldName);
+    void putValueIntoField(Value value, Symbol fieldName);
     
     /**
      * @brief Obtém o valor contido em um field informado.
      *
      * Caso o nome do field seja inválido, um erro será emitido.
-     * @param index O índice do field.
+     * @param fieldName O nome do field.
      * @return O valor correspondente ao field.
      */
-    Value getValueFromField(string fieldName);
+    Value getValueFromField(Symbol fieldName);
     
     /**
      * @brief Verifica se existe um field com o nome dado.
-     * @param string O nome do field.
+     * @param fieldName O nome do field.
      * @return Retorna \c true caso o field existir, e \c false caso contrário.
      */
-    bool fieldExists(string fieldName);
+    bool fieldExists(Symbol fieldName);
+    
+    /**
+     * @brief Obtém a referência armazenada em um field do tipo referência (ver \c ClassRuntime::getReferenceOffsets).
+     * @param offset O deslocamento do field.
+     * @return O objeto referenciado (ou \c NULL).
+     */
+    Object* getReferenceAt(u4 offset) {
+        u1 *field = ((u1 *) this) + offset;
+        if (Heap::usesCompressedReferences()) {
+            return Heap::decompress(*((u4 *) field));
+        }
+        return *((Object **) field);
+    }
     
 private:
     /**
-     * Armazena a classe correspondente ao objeto.
+     * @brief Construtor padrão. A memória do objeto deve ter o tamanho das instâncias da classe.
+     * @param classRuntime A classe correspondente ao objeto.
      */
-    ClassRuntime *_classRuntime;
+    ClassInstance(ClassRuntime *classRuntime);
     
     /**
-     * Armazena os fields do objeto (de instância).
+     * @brief Obtém a posição de um field, ou emite um erro caso o field não exista.
      */
-    map<string, Value> _fields;
+    const InstanceField* getField(Symbol fieldName);
     
 };
 
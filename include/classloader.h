@@ -2,9 +2,40 @@
 #define CLASSLOADER_H
 
 #include "tipos.h"
+#include "arena.h"
+
+#include <mutex>
 
 using namespace std;
 
+/**
+ * Cursor de leitura sobre os bytes de um arquivo .class já presente em memória (e.g. mapeado com mmap).
+ *
+ * Todas as leituras verificam se o cursor não ultrapassa \c length.
+ */
+struct ClassFileBuffer {
+    /**
+     * Início dos bytes do arquivo .class.
+     */
+    const u1 *bytes;
+    
+    /**
+     * Quantidade de bytes do arquivo .class.
+     */
+    u4 length;
+    
+    /**
+     * Posição atual de leitura.
+     */
+    u4 offset;
+    
+    /**
+     * Arena de onde as estruturas da classe são alocadas.
+     */
+    Arena *arena;
+};
+typedef struct ClassFileBuffer ClassFileBuffer;
+
 /**
  * Carregador de classes (.class)
  *
@@ -29,9 +60,44 @@ public:
 
 /**
  * Lê o arquivo .class, verifica seus campos magic e version e carrega todas as estruturas descritas por este arquivo.
- * @param *fp Ponteiro para o arquivo .class a ser carregado.
+ *
+ * Os bytes das constantes Utf8 e os códigos dos métodos apontam diretamente para \c bytes, portanto a memória deve permanecer válida enquanto a classe estiver carregada.
+ * @param *bytes Ponteiro para os bytes do arquivo .class a ser carregado.
+ * @param length Quantidade de bytes do arquivo .class.
+ */
+ClassFile* readClassFile(const u1 *bytes, u4 length);
+
+/**
+ * Processa os atributos de um método, caso ainda não tenham sido processados.
+ *
+ * \c readClassFile somente registra a posição dos atributos de cada método no arquivo .class. Esta função os processa
+ * (e preenche os campos \c code e \c exceptions do método) na primeira vez em que o método é usado. Pode ser chamada
+ * por várias threads: o processamento (e a verificação) de cada método é feito uma única vez.
+ * @param *classFile A classe que contém o método.
+ * @param *method O método.
+ */
+void parseMethodAttributes(ClassFile *classFile, method_info *method);
+
+/**
+ * Processa os atributos de todos os métodos da classe que ainda não foram processados.
+ * @param *classFile A classe.
+ */
+void parseAllMethodAttributes(ClassFile *classFile);
+
+/**
+ * Define se os atributos de depuração (LineNumberTable, LocalVariableTable, SourceFile, InnerClasses e Deprecated)
+ * são mantidos. Por padrão, eles são descartados durante a leitura, pois o interpretador não os utiliza; a
+ * visualização do .class (ou ferramentas que precisem dos números de linha) deve mantê-los.
+ * @param keep \c true para manter os atributos.
  */
-ClassFile* readClassFile(FILE *file);
+void setKeepDebugAttributes(bool keep);
+
+/**
+ * Define se os métodos das classes a partir da versão 50 são verificados (com o StackMapTable) quando seus atributos
+ * são processados. Por padrão, a verificação é feita.
+ * @param verify \c false para não verificar os métodos (-Xverify:none).
+ */
+void setVerify(bool verify);
     
 private:
     /**
@@ -43,43 +109,71 @@ private:
     void operator=(ClassLoader const&); // não permitir implementação do operador de igual
     
     /**
-     * @brief Armazena \c true caso o computador seja little endian, e \c false caso contrário
+     * Verifica se ainda existem ao menos \c size bytes a serem lidos. Caso não existam, o arquivo .class está truncado e é emitido um erro.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @param size Quantidade de bytes que serão lidos.
+     */
+    void checkBounds(ClassFileBuffer *buffer, u4 size);
+
+    /**
+     * Caso os atributos de depuração não devam ser mantidos e o próximo atributo seja um deles, avança o cursor
+     * para depois do atributo.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
+     * @return \c true caso o atributo tenha sido descartado, e \c false caso contrário (o cursor não é alterado).
+     */
+    bool skipDebugAttribute(ClassFileBuffer *buffer, ClassFile *classFile);
+    
+    /**
+     * Indica se os atributos de depuração são mantidos.
      */
-    bool isLittleEndian;
+    bool _keepDebugAttributes;
     
     /**
-     * retorna TRUE se o sistema é Little Endian e FALSE caso contrario.
-     * obtido de: http://stackoverflow.com/a/4181991/351527
+     * Indica se os métodos são verificados.
      */
-    bool testEndianess();
-
+    bool _verify;
+    
+    /**
+     * Serializa o processamento dos atributos dos métodos, que ocorre na primeira chamada de cada método.
+     */
+    mutex _attributesMutex;
+    
     /**
      * Lê 1 byte do arquivo .class.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return O byte lido.
      */
-    u1 readU1(FILE *file);
+    u1 readU1(ClassFileBuffer *buffer);
 
     /**
-     * Lê 2 bytes do arquivo .class, verificando se o sistema é Big Endian ou Little Endian para armazenamento adequado.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * Lê 2 bytes (big endian) do arquivo .class.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Os 2 bytes lidos.
      */
-    u2 readU2(FILE *file);
+    u2 readU2(ClassFileBuffer *buffer);
 
     /**
-     * Lê 4 bytes do arquivo .class, verificando se o sistema é Big Endian ou Little Endian para armazenamento adequado.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * Lê 4 bytes (big endian) do arquivo .class.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Os 4 bytes lidos.
      */
-    u4 readU4(FILE *file);
+    u4 readU4(ClassFileBuffer *buffer);
+    
+    /**
+     * Avança o cursor \c length bytes, sem copiá-los.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @param length Quantidade de bytes.
+     * @return Um ponteiro para o primeiro dos bytes, dentro da memória do arquivo .class.
+     */
+    u1* readBytes(ClassFileBuffer *buffer, u4 length);
 
     /**
      * Lê o campo magic no arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setMagic(FILE *fp, ClassFile *classFile);
+    void setMagic(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Avalia se campo magic de uma struct ClassFile é válido.
@@ -90,10 +184,10 @@ private:
 
     /**
      * Lê a versão de um arquivo .class e a armazena em uma estrutura ClassFile. A versão é dada por major_version.minor_version.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setVersion(FILE *fp, ClassFile *classFile);
+    void setVersion(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Verifica a validade da versão de uma estrutura ClassFile; devendo esta ser igual ou anterior à versão explicitada em major.
@@ -106,242 +200,284 @@ private:
 
     /**
      * Lê o tamanho da pool de constantes de um arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setConstantPoolSize(FILE *fp, ClassFile *classFile);
+    void setConstantPoolSize(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Preenche a pool de constantes de uma estrutura ClassFile a partir de um arquivo .class.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setConstantPool(FILE *fp, ClassFile *classFile);
+    void setConstantPool(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Lê 2 bytes de um arquivo .class e os atribui a uma estrutura CONSTANT_Class_info.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Class_info preenchida com os 2 bytes lidos.
     */
-    CONSTANT_Class_info getConstantClassInfo(FILE *fp);
+    CONSTANT_Class_info getConstantClassInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_Fieldref_info, preenchendo seus campos class_index e name_and_type_index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Fieldref_info preenchida.
      */
-    CONSTANT_Fieldref_info getConstantFieldRefInfo(FILE *fp);
+    CONSTANT_Fieldref_info getConstantFieldRefInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_Methodref_info, preenchendo seus campos class_index e name_and_type_index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Methodref_info preenchida.
      */
-    CONSTANT_Methodref_info getConstantMethodRefInfo(FILE *fp);
+    CONSTANT_Methodref_info getConstantMethodRefInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_InterfaceMethodref_info, preenchendo seus campos class_index e name_and_type_index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_InterfaceMethodref_info preenchida.
      */
-    CONSTANT_InterfaceMethodref_info getConstantInterfaceMethodRefInfo(FILE *fp);
+    CONSTANT_InterfaceMethodref_info getConstantInterfaceMethodRefInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_String_info, preenchendo seu campo string_index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_String_info preenchida.
      */
-    CONSTANT_String_info getConstantStringInfo(FILE *fp);
+    CONSTANT_String_info getConstantStringInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_Integer_info, preenchendo seu campo bytes.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Integer_info preenchida.
      */
-    CONSTANT_Integer_info getConstantIntegerInfo(FILE *fp);
+    CONSTANT_Integer_info getConstantIntegerInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_Float_info, preenchendo seu campo bytes.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Float_info preenchida.
      */
-    CONSTANT_Float_info getConstantFloatInfo(FILE *fp);
+    CONSTANT_Float_info getConstantFloatInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_Long_info, preenchendo seus campos high_bytes e low_bytes.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Long_info preenchida.
      */
-    CONSTANT_Long_info getConstantLongInfo(FILE *fp);
+    CONSTANT_Long_info getConstantLongInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_Double_info, preenchendo seus campos high_bytes e low_bytes.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Double_info preenchida.
      */
-    CONSTANT_Double_info getConstantDoubleInfo(FILE *fp);
+    CONSTANT_Double_info getConstantDoubleInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_NameAndType_info, preenchendo seus campos name_index e descriptor_index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_NameAndType_info preenchida.
      */
-    CONSTANT_NameAndType_info getConstantNameAndTypeInfo(FILE *fp);
+    CONSTANT_NameAndType_info getConstantNameAndTypeInfo(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_Utf8_info, preenchendo seus campos length e bytes.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura CONSTANT_Utf8_info preenchida.
      */
-    CONSTANT_Utf8_info getConstantUtf8Info(FILE *fp);
+    CONSTANT_Utf8_info getConstantUtf8Info(ClassFileBuffer *buffer);
+
+    /**
+     * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_MethodHandle_info, preenchendo seus campos reference_kind e reference_index.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @return Uma estrutura CONSTANT_MethodHandle_info preenchida.
+     */
+    CONSTANT_MethodHandle_info getConstantMethodHandleInfo(ClassFileBuffer *buffer);
+
+    /**
+     * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_MethodType_info, preenchendo seu campo descriptor_index.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @return Uma estrutura CONSTANT_MethodType_info preenchida.
+     */
+    CONSTANT_MethodType_info getConstantMethodTypeInfo(ClassFileBuffer *buffer);
+
+    /**
+     * Extrai de um arquivo .class informações relativas a uma estrutura CONSTANT_InvokeDynamic_info, preenchendo seus campos bootstrap_method_attr_index e name_and_type_index.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @return Uma estrutura CONSTANT_InvokeDynamic_info preenchida.
+     */
+    CONSTANT_InvokeDynamic_info getConstantInvokeDynamicInfo(ClassFileBuffer *buffer);
 
     /**
      * Lê as flags de acesso de um arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setAccessFlags(FILE *fp, ClassFile *classFile);
+    void setAccessFlags(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Lê o índice this_class de um arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setThisClass(FILE *fp, ClassFile *classFile);
+    void setThisClass(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Lê o índice super_class de um arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setSuperClass(FILE *fp, ClassFile *classFile);
+    void setSuperClass(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Lê o índice interfaces_count de um arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setInterfacesCount(FILE *fp, ClassFile *classFile);
+    void setInterfacesCount(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Aloca em ClassFile um vetor de interfaces, referenciado pelo ponteiro interfaces, e o preenche com os dados de um arquivo .class.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setInterfaces(FILE *fp, ClassFile *classFile);
+    void setInterfaces(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Lê o índice fields_count de um arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setFieldsCount(FILE *fp, ClassFile *classFile);
+    void setFieldsCount(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Aloca em ClassFile um vetor de estruturas field_info, o qual é referenciado pelo ponteiro fields, e o preenche com os dados de um arquivo .class.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setFields(FILE *fp, ClassFile *classFile);
+    void setFields(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura attribute_info, preenchendo seus campos attribute_name_index, attribute_length e info.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      * @return Uma estrutura attribute_info preenchida.
      */
-    attribute_info getAttributeInfo(FILE *fp, ClassFile *classFile);
+    attribute_info getAttributeInfo(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura ConstantValue_attribute, preenchendo seu campo index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura ConstantValue_attribute preenchida.
      */
-    ConstantValue_attribute getAttributeConstantValue(FILE *fp);
+    ConstantValue_attribute getAttributeConstantValue(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura ExceptionTable, preenchendo seus campos start_pc, end_pc, handler_pc e catch_type.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura ExceptionTable preenchida.
      */
-    ExceptionTable getExceptionTable(FILE *fp);
+    ExceptionTable getExceptionTable(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura Code_attribute, preenchendo seus campos max_stack, max_locals, code_length, code, exception_table_length, exception_table, attributes_count e attributes.
-    * @param *fp Ponteiro para o arquivo .class a ser carregado.
+    * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
     * @return Uma estrutura Code_attribute preenchida.
     */
-    Code_attribute getAttributeCode(FILE *fp, ClassFile *classFile);
+    Code_attribute getAttributeCode(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura Exceptions_attribute, preenchendo seus campos number_of_exceptions e exception_index_table.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura Exceptions_attribute preenchida.
      */
-    Exceptions_attribute getAttributeExceptions(FILE *fp);
+    Exceptions_attribute getAttributeExceptions(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura Class, preenchendo seus campos inner_class_info_index, outer_class_info_index, inner_name_index e inner_class_access_flags.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura Exceptions_attribute preenchida.
     */
-    Class getClass(FILE *fp);
+    Class getClass(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura InnerClasses_attribute, preenchendo seus campos number_of_classes e classes.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura InnerClasses_attribute preenchida.
      */
-    InnerClasses_attribute getAttributeInnerClasses(FILE *fp);
+    InnerClasses_attribute getAttributeInnerClasses(ClassFileBuffer *buffer);
 
     /**
      * Fornece uma estrutura Synthetic_attribute.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura Synthetic_attribute.
      */
-    Synthetic_attribute getAttributeSynthetic(FILE *fp);
+    Synthetic_attribute getAttributeSynthetic(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura SourceFile_attribute, preenchendo seu campo sourcefile_index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura SourceFile_attribute preenchida.
      */
-    SourceFile_attribute getAttributeSourceFile(FILE *fp);
+    SourceFile_attribute getAttributeSourceFile(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura LineNumberTable, preenchendo seus campos start_pc e line_number.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura LineNumberTable preenchida.
      */
-    LineNumberTable getLineNumberTable(FILE *fp);
+    LineNumberTable getLineNumberTable(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura LineNumberTable_attribute, preenchendo seus campos line_number_table_length e line_number_table.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura LineNumberTable_attribute preenchida.
      */
-    LineNumberTable_attribute getAttributeLineNumberTable(FILE *fp);
+    LineNumberTable_attribute getAttributeLineNumberTable(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura LocalVariableTable, preenchendo seus campos start_pc, length, name_index, descriptor_index e index.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura LocalVariableTable preenchida.
      */
-    LocalVariableTable getLocalVariableTable(FILE *fp);
+    LocalVariableTable getLocalVariableTable(ClassFileBuffer *buffer);
 
     /**
      * Extrai de um arquivo .class informações relativas a uma estrutura LocalVariableTable_attribute, preenchendo seus campos local_variable_table_length e local_variable_table.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura LocalVariableTable_attribute preenchida.
      */
-    LocalVariableTable_attribute getAttributeLocalVariable(FILE *fp);
+    LocalVariableTable_attribute getAttributeLocalVariable(ClassFileBuffer *buffer);
 
     /**
      * Fornece uma estrutura Deprecated_attribute.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @return Uma estrutura Deprecated_attribute.
      */
-    Deprecated_attribute getAttributeDeprecated(FILE *fp);
+    Deprecated_attribute getAttributeDeprecated(ClassFileBuffer *buffer);
+
+    /**
+     * Extrai de um arquivo .class uma estrutura verification_type_info, preenchendo seu campo tag e, conforme o tipo, cpool_index ou offset.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @return Uma estrutura verification_type_info preenchida.
+     */
+    verification_type_info getVerificationTypeInfo(ClassFileBuffer *buffer);
+
+    /**
+     * Extrai de um arquivo .class uma estrutura stack_map_frame, preenchendo os campos usados pelo seu frame_type.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @return Uma estrutura stack_map_frame preenchida.
+     */
+    stack_map_frame getStackMapFrame(ClassFileBuffer *buffer);
+
+    /**
+     * Extrai de um arquivo .class informações relativas a uma estrutura StackMapTable_attribute, preenchendo seus campos number_of_entries e entries.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
+     * @return Uma estrutura StackMapTable_attribute preenchida.
+     */
+    StackMapTable_attribute getAttributeStackMapTable(ClassFileBuffer *buffer);
 
     /**
      * Fornece a estrutura CONSTANT_Utf8_info contida no índice index da pool de constantes de uma estrutura ClassFile.
@@ -353,31 +489,33 @@ private:
 
     /**
      * Lê o campo methods_count no arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setMethodsCount(FILE *fp, ClassFile *classFile);
+    void setMethodsCount(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Aloca em ClassFile um vetor de métodos, referenciado pelo ponteiro methods, e o preenche com os dados de um arquivo .class.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     *
+     * Os atributos dos métodos não são processados, somente a posição deles no arquivo é registrada.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setMethods(FILE *fp, ClassFile *classFile);
+    void setMethods(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Lê o campo attributes_count no arquivo .class e o armazena em uma estrutura ClassFile.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setAttributesCount(FILE *fp, ClassFile *classFile);
+    void setAttributesCount(ClassFileBuffer *buffer, ClassFile *classFile);
 
     /**
      * Aloca em ClassFile um vetor de atributos, referenciado pelo ponteiro attributes, e o preenche com os dados de um arquivo .class.
-     * @param *fp Ponteiro para o arquivo .class a ser carregado.
+     * @param *buffer Cursor sobre os bytes do arquivo .class a ser carregado.
      * @param *classFile Ponteiro para uma instância de struct ClassFile, que descreve a estrutura (parcial, no momento) de um arquivo .class.
      */
-    void setAttributes(FILE *fp, ClassFile *classFile);
+    void setAttributes(ClassFileBuffer *buffer, ClassFile *classFile);
 };
 
 #endif
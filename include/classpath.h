@@ -0,0 +1,143 @@
+#ifndef classpath_h
+#define classpath_h
+
+#include "tipos.h"
+#include "ziparchive.h"
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * Identificação de um arquivo .class do class path, usada para detectar arquivos alterados (e.g. depois da geração
+ * do arquivo de compartilhamento de classes).
+ */
+struct ClassFileStamp {
+    u4 entryIndex; // a entrada do class path em que o arquivo foi encontrado
+    u4 length;
+    int64_t modificationTime; // em nanossegundos (ou a data e a hora do MS-DOS, para entradas de um JAR/ZIP)
+};
+
+/**
+ * Caminho de busca de classes (class path), composto por diretórios e arquivos JAR/ZIP.
+ *
+ * As entradas são consultadas na ordem em que foram informadas. O diretório atual é sempre consultado por último
+ * (caso não faça parte do class path), pois é onde ficam as classes de \c java/.
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class ClassPath {
+
+public:
+    /**
+     * @brief Obter a única instância do ClassPath.
+     * @return A instância do ClassPath.
+     */
+    static ClassPath& getInstance() {
+        static ClassPath instance;
+        return instance;
+    }
+
+    /**
+     * @brief Destrutor padrão.
+     */
+    ~ClassPath();
+
+    /**
+     * @brief Define as entradas do class path.
+     *
+     * Entradas terminadas em .jar ou .zip são abertas como arquivos, e as demais são tratadas como diretórios.
+     * @param classPath As entradas separadas por ':' (e.g. classes:lib/util.jar).
+     */
+    void setClassPath(const string &classPath);
+
+    /**
+     * @brief Busca o arquivo .class no class path e obtém o seu conteúdo.
+     *
+     * Buscas que falharam são guardadas, e uma nova busca pelo mesmo arquivo falha sem consultar o sistema de arquivos.
+     * @param fileName O caminho do arquivo relativo à raiz do class path (e.g. java/lang/Object.class).
+     * @param bytes Destino do ponteiro para o conteúdo do arquivo.
+     * @param length Destino do tamanho do conteúdo do arquivo.
+     * @param memory Destino da memória que contém o conteúdo, que deve ser liberada quando ele deixar de ser usado
+     * (em geral adotada pela arena da classe, com \c Arena::adopt).
+     * @return \c true caso o arquivo tenha sido encontrado, e \c false caso contrário.
+     */
+    bool findClass(const string &fileName, const u1 **bytes, u4 *length, AdoptedMemory *memory);
+
+    /**
+     * @brief Busca o arquivo .class no class path, assim como \c findClass, e obtém a sua identificação sem lê-lo.
+     * @param fileName O caminho do arquivo relativo à raiz do class path (e.g. java/lang/Object.class).
+     * @param stamp Destino da identificação do arquivo.
+     * @return \c true caso o arquivo tenha sido encontrado, e \c false caso contrário.
+     */
+    bool getClassStamp(const string &fileName, ClassFileStamp *stamp);
+
+    /**
+     * @brief Obtém o class path como foi definido (ou "." caso ele não tenha sido definido).
+     */
+    const string& getClassPath();
+
+private:
+    /**
+     * @brief Construtor padrão. O class path inicial contém somente o diretório atual.
+     */
+    ClassPath();
+
+    ClassPath(ClassPath const&); // não permitir implementação do construtor de cópia
+    void operator=(ClassPath const&); // não permitir implementação do operador de igual
+
+    /**
+     * Uma entrada do class path: um diretório (\c archive é \c NULL) ou um arquivo JAR/ZIP.
+     */
+    struct ClassPathEntry {
+        string directory;
+        ZipArchive *archive;
+    };
+
+    /**
+     * @brief Adiciona uma entrada ao final do class path.
+     * @param path O caminho do diretório ou do arquivo JAR/ZIP.
+     */
+    void addEntry(const string &path);
+
+    /**
+     * @brief Remove todas as entradas e as buscas que falharam.
+     */
+    void clear();
+
+    /**
+     * @brief Mapeia em memória um arquivo .class de um diretório.
+     * @param path O caminho do arquivo.
+     * @param bytes Destino do ponteiro para o mapeamento.
+     * @param length Destino do tamanho do arquivo.
+     * @param memory Destino do mapeamento, que deve ser desfeito quando o conteúdo deixar de ser usado.
+     * @return \c true caso o arquivo exista, e \c false caso contrário.
+     */
+    bool mapFile(const string &path, const u1 **bytes, u4 *length, AdoptedMemory *memory);
+
+    /**
+     * O class path informado em \c setClassPath.
+     */
+    string _classPath;
+
+    /**
+     * As entradas do class path, na ordem de busca.
+     */
+    vector<ClassPathEntry> _entries;
+
+    /**
+     * Os arquivos que não foram encontrados em nenhuma entrada.
+     */
+    unordered_set<string> _missingClasses;
+    
+    /**
+     * Protege \c _missingClasses, pois as buscas podem ser feitas por várias threads (e.g. pelo \c ClassPreloader).
+     * As entradas não mudam durante a execução, portanto não precisam de proteção.
+     */
+    mutex _missingClassesMutex;
+};
+
+#endif /* classpath_h */
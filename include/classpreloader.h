@@ -0,0 +1,128 @@
+#ifndef classpreloader_h
+#define classpreloader_h
+
+#include "tipos.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * Pré-carregador de classes, que lê e processa em threads auxiliares as classes referenciadas pelas classes já carregadas.
+ *
+ * Sempre que uma classe é carregada, as classes referenciadas pelas constantes CONSTANT_Class do seu pool são
+ * agendadas, e as threads auxiliares buscam e processam (\c ClassLoader::readClassFile) cada uma delas, agendando
+ * também as suas referências. A \c MethodArea obtém as classes já processadas com \c takeClass; a criação do
+ * \c ClassRuntime e a execução do <clinit> continuam na thread de execução.
+ *
+ * O pré-carregador é opcional (\c -XX:PreloadThreads=N) e fica desativado enquanto \c start não for chamado.
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class ClassPreloader {
+
+public:
+    /**
+     * @brief Obter a única instância do ClassPreloader.
+     * @return A instância do ClassPreloader.
+     */
+    static ClassPreloader& getInstance() {
+        static ClassPreloader instance;
+        return instance;
+    }
+
+    /**
+     * @brief Destrutor padrão. Encerra as threads auxiliares e libera as classes pré-carregadas que nunca foram obtidas.
+     */
+    ~ClassPreloader();
+
+    /**
+     * @brief Inicia as threads auxiliares.
+     * @param threadsCount A quantidade de threads.
+     */
+    void start(unsigned int threadsCount);
+
+    /**
+     * @brief Agenda o pré-carregamento das classes referenciadas pela classe dada.
+     * @param classFile A classe que acabou de ser carregada.
+     */
+    void scheduleReferences(ClassFile *classFile);
+
+    /**
+     * @brief Obtém uma classe já processada pelas threads auxiliares.
+     *
+     * Caso a classe esteja sendo processada, aguarda o fim do processamento. Caso a classe ainda não tenha sido
+     * iniciada, ela é retirada do agendamento e \c NULL é retornado, para que a thread de execução a carregue.
+     * @param className O nome qualificado da classe (e.g. java/lang/Object).
+     * @return A classe processada, ou \c NULL caso ela deva ser carregada pela thread de execução.
+     */
+    ClassFile* takeClass(const string &className);
+
+private:
+    /**
+     * @brief Construtor padrão.
+     */
+    ClassPreloader();
+
+    ClassPreloader(ClassPreloader const&); // não permitir implementação do construtor de cópia
+    void operator=(ClassPreloader const&); // não permitir implementação do operador de igual
+
+    /**
+     * Estado de uma classe no pré-carregador.
+     */
+    enum PreloadState {
+        PRELOAD_QUEUED, // aguardando uma thread auxiliar
+        PRELOAD_LOADING, // sendo processada por uma thread auxiliar
+        PRELOAD_DONE, // processada (ou não encontrada), aguardando \c takeClass
+        PRELOAD_CLAIMED // entregue à (ou carregada pela) thread de execução
+    };
+
+    /**
+     * @brief Agenda as referências da classe dada. Deve ser chamado com \c _mutex adquirido.
+     */
+    void scheduleReferencesLocked(ClassFile *classFile);
+
+    /**
+     * @brief Laço de cada thread auxiliar.
+     */
+    void workerLoop();
+
+    mutex _mutex;
+
+    /**
+     * Sinalizada quando uma classe é agendada ou quando as threads devem ser encerradas.
+     */
+    condition_variable _workAvailable;
+
+    /**
+     * Sinalizada quando uma thread auxiliar termina de processar uma classe.
+     */
+    condition_variable _classDone;
+
+    /**
+     * As classes agendadas, na ordem em que serão processadas.
+     */
+    deque<string> _queue;
+
+    /**
+     * O estado de todas as classes conhecidas pelo pré-carregador.
+     */
+    unordered_map<string, PreloadState> _states;
+
+    /**
+     * As classes processadas que ainda não foram obtidas pela thread de execução (\c NULL para classes não encontradas).
+     */
+    unordered_map<string, ClassFile*> _preloadedClasses;
+
+    vector<thread> _workers;
+
+    bool _stopping;
+};
+
+#endif /* classpreloader_h */
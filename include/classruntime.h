@@ -5,9 +5,24 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
 
 using namespace std;
 
+class StringObject;
+class LoaderScope;
+
+/**
+ * A posição de um field de instância dentro dos objetos de uma classe (ver \c ClassRuntime::prepareInstanceLayout).
+ */
+struct InstanceField {
+    u4 offset; // deslocamento a partir do início do objeto
+    ValueType type;
+};
+
 /**
  * Representação de uma classe carregada durante o runtime.
  */
@@ -17,45 +32,193 @@ public:
     /**
      * @brief Construtor padrão.
      * @param classFile A \c ClassFile correspondente à classe.
+     * @param scope O escopo de carregamento ao qual a classe pertence.
      */
-    ClassRuntime(ClassFile *classFile);
+    ClassRuntime(ClassFile *classFile, LoaderScope *scope);
     
     /**
-     * @brief Destrutor padrão.
+     * @brief Destrutor padrão. Libera todos os metadados da classe, que foram alocados na arena do \c ClassFile.
+     */
+    ~ClassRuntime();
+    
+    /**
+     * @brief Obtém a \c ClassFile correspondente à classe.
+     * @return O ponteiro para a \c ClassFile.
      */
     ClassFile* getClassFile();
     
+    /**
+     * @brief Obtém o escopo de carregamento ao qual a classe pertence.
+     * @return O escopo da classe.
+     */
+    LoaderScope* getScope();
+    
     /**
      * @brief Insere um valor no field estático informado.
      * @param value O valor que será inserido.
      * @param fieldName O nome do field estático.
      */
-    void putValueIntoField(Value value, string fieldName);
+    void putValueIntoField(Value value, Symbol fieldName);
     
     /**
      * @brief Obtém o valor de um field estático.
      * @param fieldName O valor do field que será obtido.
      * @return Retorna o valor correspondente ao field estático.
      */
-    Value getValueFromField(string fieldName);
+    Value getValueFromField(Symbol fieldName);
     
     /**
      * @brief Verifica se o field informado existe.
      * @param fieldName O nome do field que será verificado a existência.
      * @return Retorna \c true caso o field exista, e \c false caso contrário.
      */
-    bool fieldExists(string fieldName);
+    bool fieldExists(Symbol fieldName);
+    
+    /**
+     * @brief Obtém todos os fields estáticos da classe (usado para percorrer as referências a partir das classes).
+     * @return Os fields estáticos, indexados pelo nome.
+     */
+    const map<Symbol, Value>& getStaticFields();
+    
+    /**
+     * @brief Calcula a disposição dos fields de instância nos objetos da classe, caso ainda não tenha sido calculada.
+     *
+     * Os fields da superclasse (que é carregada, caso necessário) ocupam o início do objeto, seguidos pelos fields da
+     * própria classe, portanto um field herdado possui a mesma posição nas instâncias de todas as subclasses. Cada field
+     * ocupa somente o tamanho do seu tipo (e.g. 1 byte para boolean e byte), e os fields da classe são dispostos por
+     * tamanho, preenchendo os espaços de alinhamento deixados pelos fields anteriores. Deve ser chamado antes da
+     * criação da primeira instância da classe.
+     */
+    void prepareInstanceLayout();
+
+    /**
+     * @brief Obtém a posição de um field de instância (herdado ou não).
+     * @param fieldName O nome do field.
+     * @return A posição do field, ou \c NULL caso a classe não possua o field.
+     */
+    const InstanceField* getInstanceField(Symbol fieldName);
+
+    /**
+     * @brief Obtém os deslocamentos dos fields de instância do tipo referência (usado para percorrer as referências dos
+     * objetos da classe).
+     */
+    const vector<u4>& getReferenceOffsets();
+
+    /**
+     * @brief Obtém o tamanho das instâncias da classe (cabeçalho e fields), em bytes.
+     */
+    u4 getInstanceSize();
+
+    /**
+     * @brief Obtém o tamanho de um field de instância do tipo dado, em bytes.
+     */
+    static u4 fieldSize(ValueType type);
+
+    /**
+     * @brief Obtém a string referente a uma constante CONSTANT_String da pool de constantes.
+     *
+     * A constante é resolvida somente na primeira chamada, e a instância obtida é a canônica (interned), ou seja,
+     * strings de mesmo conteúdo compartilham o mesmo objeto, inclusive entre classes diferentes.
+     * @param index O índice da constante CONSTANT_String na pool de constantes.
+     * @return A instância canônica da string.
+     */
+    StringObject* getStringConstant(u2 index);
+    
+    /**
+     * @brief Indica se uma constante CONSTANT_String já foi resolvida por \c getStringConstant.
+     * @param index O índice da constante CONSTANT_String na pool de constantes.
+     */
+    bool isStringConstantResolved(u2 index);
+    
+    /**
+     * @brief Indica se a inicialização da classe (<clinit>) já terminou. Pode ser consultado sem nenhum lock.
+     */
+    bool isInitialized();
+    
+    /**
+     * @brief Marca a classe como inicializada (ou não inicializada). Deve ser chamado com o lock da \c MethodArea.
+     */
+    void setInitialized(bool initialized);
+    
+    /**
+     * @brief Obtém o identificador da thread Java (ver \c VMStack::getThreadId) que está executando o <clinit> da classe.
+     */
+    uintptr_t getInitializingThread();
+    
+    /**
+     * @brief Define a thread que está executando o <clinit> da classe. Deve ser chamado com o lock da \c MethodArea.
+     */
+    void setInitializingThread(uintptr_t initializingThread);
+    
+    /**
+     * @brief Obtém a palavra de lock da classe, usada pelos métodos estáticos sincronizados (ver \c Monitor).
+     * @return A palavra de lock.
+     */
+    atomic<uintptr_t>& getLockWord();
     
 private:
+    /**
+     * @brief Obtém o valor inicial (zero) de um field dado o seu descritor.
+     */
+    static Value defaultFieldValue(Symbol fieldDescriptor);
+
+    /**
+     * @brief Remove de \c gaps um espaço alinhado para um field do tamanho dado.
+     * @return O deslocamento do field, ou 0 caso nenhum espaço seja suficiente.
+     */
+    static u4 takeGap(vector<pair<u4, u4> > &gaps, u4 size);
+
     /**
      * A \c ClassFile correspondente à classe.
      */
     ClassFile *_classFile;
     
+    /**
+     * O escopo de carregamento ao qual a classe pertence.
+     */
+    LoaderScope *_scope;
+    
     /**
      * Os fields estáticos da classe.
      */
-    map<string, Value> _staticFields;
+    map<Symbol, Value> _staticFields;
+    
+    /**
+     * A disposição dos fields de instância, calculada por \c prepareInstanceLayout e publicada com \c _layoutMutex
+     * adquirido.
+     */
+    map<Symbol, InstanceField> _instanceFields;
+
+    vector<u4> _referenceOffsets;
+
+    vector<pair<u4, u4> > _layoutGaps; // espaços de alinhamento ainda livres, no intervalo [first, second)
+
+    u4 _instanceSize;
+
+    atomic<bool> _layoutReady;
+
+    mutex _layoutMutex;
+
+    /**
+     * As strings já resolvidas da pool de constantes, indexadas pelo índice da constante (\c NULL caso ainda não
+     * resolvida). Cada posição é publicada uma única vez (compare-and-swap), portanto todas as threads obtêm o mesmo objeto.
+     */
+    vector<atomic<StringObject*> > _stringConstants;
+    
+    /**
+     * Indica se o <clinit> da classe já terminou (ou se a classe não possui <clinit>).
+     */
+    atomic<bool> _initialized;
+    
+    /**
+     * A thread que executa o <clinit> da classe. As demais threads que usam a classe aguardam o fim da inicialização.
+     */
+    uintptr_t _initializingThread;
+    
+    /**
+     * A palavra de lock da classe.
+     */
+    atomic<uintptr_t> _lockWord;
     
 };
 
@@ -303,7 +303,7 @@ static const char* instructions[] = {
     "invokespecial",
     "invokestatic",
     "invokeinterface",
-    "UNUSED",
+    "invokedynamic",
     "new",
     "newarray",
     "anewarray",
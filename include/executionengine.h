@@ -13,6 +13,7 @@
 using namespace std;
 
 class ExecutionEngine;
+class Frame;
 typedef void (ExecutionEngine::*FunctionPointer)();
 
 /**
@@ -39,11 +40,25 @@ public:
     /**
      * @brief Inicia a Execution Engine com a classe passada.
      *
-     * Esse método irá iniciar execução através do método estático main.
+     * Esse método irá iniciar execução através do método estático main. Ao fim do main, aguarda o fim de todas as
+     * threads Java iniciadas.
      * @param
      */
     void startExecutionEngine(ClassRuntime *classRuntime);
     
+    /**
+     * @brief Executa as instruções dos frames da pilha da thread atual, até que a pilha esteja vazia.
+     */
+    void executeFrames();
+    
+    /**
+     * @brief Executa as instruções da thread verde atual (ver \c Scheduler) por, no máximo, a quantidade de instruções
+     * dada. A execução também é interrompida quando a thread verde é estacionada ou cede a thread trabalhadora.
+     * @param instructions A quantidade máxima de instruções.
+     * @return \c true caso a pilha da thread tenha ficado vazia (a thread terminou), ou \c false caso contrário.
+     */
+    bool executeSlice(uint32_t instructions);
+    
     /**
      * @brief Verifica se o método informado existe na classe atual.
      * @param classRuntime A classe que a pesquisa irá ser realizada.
@@ -51,15 +66,50 @@ public:
      * @param descriptor O descritor do método.
      * @return Retorna \c true caso o método exista, ou \c false caso contrário.
      */
-    bool doesMethodExist(ClassRuntime *classRuntime, string name, string descriptor);
+    bool doesMethodExist(ClassRuntime *classRuntime, Symbol name, Symbol descriptor);
 
     /**
      * @brief Popula os vetores de um multiarray
      * @param array Cada array que representa uma dimansão
      * @param value Referência à uma classe 
      * @param count Número de elementos em um array
+     * @return \c false caso a heap tenha se esgotado (ver \c ArrayObject::create).
+     */
+    bool populateMultiarray(ArrayObject *array, ValueType value, stack<int> count);
+    
+    /**
+     * @brief Indica se a classe é simulada pela JVM, ou seja, é do pacote java/ mas não possui um arquivo .class no
+     * diretório java/ (e.g. java/lang/String e java/io/PrintStream). Seus métodos são tratados como casos especiais.
+     * @param className O nome qualificado da classe.
+     */
+    bool isSimulatedClass(Symbol className);
+    
+    /**
+     * @brief Verifica se uma classe é a classe dada ou uma de suas subclasses.
+     * @param classRuntime A classe verificada.
+     * @param className O nome qualificado da (super)classe.
+     */
+    bool isSubclassOf(ClassRuntime *classRuntime, Symbol className);
+    
+    /**
+     * @brief Cria uma exceção lançada pela própria JVM (e.g. java/lang/OutOfMemoryError). O construtor da exceção não
+     * é executado: somente a sua mensagem é preenchida.
+     * @param className O nome qualificado da classe da exceção (uma subclasse de java/lang/Throwable).
+     * @param message A mensagem da exceção.
+     * @return A exceção criada.
+     */
+    ClassInstance* createThrowable(const string &className, const string &message);
+    
+    /**
+     * @brief Lança uma exceção na thread atual.
+     *
+     * Os frames são percorridos a partir do topo: o primeiro tratador (na tabela de exceções do método) cujo intervalo
+     * contém a instrução atual do frame e cujo tipo é a classe da exceção ou uma de suas superclasses recebe a exceção
+     * na pilha de operandos. Os frames sem tratador são removidos. Caso nenhum tratador exista, a exceção é impressa e
+     * a JVM termina.
+     * @param exception A exceção lançada.
      */
-    void populateMultiarray(ArrayObject *array, ValueType value, stack<int> count);
+    void throwException(ClassInstance *exception);
     
 private:
     /**
@@ -71,9 +121,45 @@ private:
     void operator=(ExecutionEngine const&); // não permitir implementação do operador de igual
     
     /**
-     * Armazena \c true se a última instrução foi um wide, e \c false caso contrário.
+     * Armazena \c true se a última instrução (da thread atual) foi um wide, e \c false caso contrário.
+     */
+    static thread_local bool _isWide;
+    
+    /**
+     * @brief Trata a falha de uma alocação feita por uma instrução, que não altera o frame e é repetida após uma coleta
+     * de lixo. Caso a alocação já tenha falhado após uma coleta iniciada depois da primeira falha, um
+     * java/lang/OutOfMemoryError é lançado.
+     */
+    void retryAllocation();
+    
+    /**
+     * @brief Adquire um lock. Em uma thread verde, caso o lock pertença a outra thread, a thread é estacionada.
+     * @param lockWord A palavra de lock do objeto.
+     * @return \c true caso o lock tenha sido adquirido, ou \c false caso a thread verde tenha sido estacionada.
+     */
+    bool enterMonitor(atomic<uintptr_t> &lockWord);
+    
+    /**
+     * @brief Executa um método nativo (ACC_NATIVE), empilhando o seu retorno (caso exista) no frame atual.
+     * @param classRuntime A classe que declara o método.
+     * @param methodName O nome do método.
+     * @param methodDescriptor O descritor do método.
+     * @param arguments Os argumentos do método (incluindo o objeto, caso não seja estático).
+     * @return \c true caso o método tenha terminado, ou \c false caso a thread verde atual tenha sido estacionada (a
+     * instrução de invocação não é concluída e será repetida).
+     */
+    bool invokeNativeMethod(ClassRuntime *classRuntime, Symbol methodName, Symbol methodDescriptor, vector<Value> &arguments);
+    
+    /**
+     * @brief Verifica se o método de um frame é executado por \c invokeNativeMethod: os métodos nativos e os métodos de
+     * java/lang/Object que dependem de classes simuladas (toString).
+     */
+    bool isNativeMethod(Frame *frame);
+    
+    /**
+     * @brief Obtém o hashCode de identidade de um objeto (Object.hashCode), derivado do seu endereço.
      */
-    bool _isWide;
+    static int32_t identityHashCode(Object *object);
     
     /**
      * @brief Implementa a funcionalidade da instrução nop.
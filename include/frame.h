@@ -22,7 +22,7 @@ public:
      * @param methodDescriptor O descritor do método referente ao frame atual.
      * @param arguments Os argumentos do método.
      */
-    Frame(ClassInstance *object, ClassRuntime *classRuntime, string methodName, string methodDescriptor, vector<Value> arguments);
+    Frame(ClassInstance *object, ClassRuntime *classRuntime, Symbol methodName, Symbol methodDescriptor, vector<Value> arguments);
     
     /**
      * @brief Construtor utilizado quando o frame está associado a um método estático.
@@ -31,7 +31,7 @@ public:
      * @param methodDescriptor O descritor do método referente ao frame atual.
      * @param arguments Os argumentos do método.
      */
-    Frame(ClassRuntime *classRuntime, string methodName, string methodDescriptor, vector<Value> arguments = vector<Value>());
+    Frame(ClassRuntime *classRuntime, Symbol methodName, Symbol methodDescriptor, vector<Value> arguments = vector<Value>());
     
     /**
      * @brief Destrutor padrão.
@@ -44,6 +44,18 @@ public:
      */
     cp_info** getConstantPool();
     
+    /**
+     * @brief Obtém a classe que contém o método referente ao frame atual.
+     * @return Retorna um ponteiro para a classe.
+     */
+    ClassRuntime* getClassRuntime();
+    
+    /**
+     * @brief Obtém o método referente ao frame atual.
+     * @return Retorna um ponteiro para o method_info do método.
+     */
+    method_info* getMethod();
+    
     /**
      * @brief Obtém o valor de uma variável local localizada no índice dado.
      *
@@ -94,6 +106,12 @@ public:
      */
     ClassInstance* getObject();
     
+    /**
+     * @brief Adiciona as referências mantidas pelo frame (variáveis locais, operandos e o objeto do frame) no vetor
+     * dado. Usado pela coleta de lixo.
+     */
+    void getReferences(vector<Object*> &references);
+    
     /**
      * @brief Obtém o código do método a partir de um offset.
      * @param address O offset.
@@ -118,6 +136,51 @@ public:
 	*/
 	u4 sizeCode();
 
+    /**
+     * @brief Retorna o comprimento da tabela de exceções do método em execução.
+     * @return O conteúdo de _codeAttribute->exception_table_length
+     */
+    u2 sizeExceptionTable();
+
+    /**
+     * @brief Obtém uma entrada da tabela de exceções do método em execução.
+     * @param index O índice da entrada.
+     * @return A entrada (o intervalo protegido, o tratador e o tipo da exceção tratada).
+     */
+    ExceptionTable getExceptionTableEntry(u2 index);
+
+    /**
+     * @brief Indica se o método do frame é nativo (ACC_NATIVE), ou seja, não possui código e é implementado pela JVM.
+     */
+    bool isNative();
+
+    /**
+     * @brief Indica se o método do frame é o <clinit> da classe.
+     */
+    bool isClassInitializer();
+
+    /**
+     * @brief Indica se o método do frame é sincronizado (ACC_SYNCHRONIZED).
+     */
+    bool isSynchronized();
+
+    /**
+     * @brief Obtém a palavra de lock usada por um método sincronizado: a do objeto, ou a da classe para métodos estáticos.
+     */
+    atomic<uintptr_t>& getLockWord();
+
+    /**
+     * @brief Indica se o lock de um método sincronizado ainda deve ser adquirido antes da primeira instrução do frame.
+     *
+     * Usado pelas threads verdes, que não podem bloquear a thread do sistema operacional ao empilhar o frame.
+     */
+    bool isMonitorPending();
+
+    /**
+     * @brief Define se o lock do método sincronizado ainda deve ser adquirido.
+     */
+    void setMonitorPending(bool monitorPending);
+
 private:
     /**
      * @brief Obtém um método a partir da classe informada ou de alguma super classe.
@@ -128,10 +191,10 @@ private:
      * @param descriptor O descritor do método.
      * @return Um ponteiro para o método encontrado, ou \c NULL caso o método não exista.
      */
-    method_info* getMethodNamed(ClassRuntime *classRuntime, string name, string descriptor);
+    method_info* getMethodNamed(ClassRuntime *classRuntime, Symbol name, Symbol descriptor);
     
     /**
-     * @brief Encontra os atributos Code e Exceptions do método associado ao frame.
+     * @brief Encontra os atributos Code e Exceptions do método associado ao frame, processando os atributos do método caso seja a primeira chamada.
      *
      * O atributo Code será armazenado em \c _codeAttribute.
      * O atributo Exceptions, caso exista, será armazenado em \c _exceptionsAttribute, caso não existir, seu valor será setado para \c NULL.
@@ -149,10 +212,15 @@ private:
      */
     ClassInstance *_object;
     
+    /**
+     * \c true enquanto o lock de um método sincronizado não tiver sido adquirido (somente em threads verdes).
+     */
+    bool _monitorPending;
+    
     /**
      * Ponteiro para o método referente a este frame.
      */
-    method_info _method;
+    method_info *_method;
     
     /**
      * Ponteiro para o atributo Code referente ao método.
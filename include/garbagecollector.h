@@ -0,0 +1,570 @@
+#ifndef garbagecollector_h
+#define garbagecollector_h
+
+#include "object.h"
+#include "tipos.h"
+
+#include <vector>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+using namespace std;
+
+/**
+ * Quantidade de referências registradas pela barreira de escrita de uma thread antes de serem entregues à marcação.
+ */
+#define GC_SATB_BUFFER_SIZE 256
+
+/**
+ * Quantidade de pausas finais limitadas por \c -XX:MaxPauseMillis em uma coleta concorrente. Caso a marcação não
+ * termine dentro desse limite, a pausa seguinte dura até o fim da marcação.
+ */
+#define GC_REMARK_ATTEMPTS 8
+
+/**
+ * Duração máxima padrão das pausas da coleta concorrente, em milissegundos.
+ */
+#define GC_DEFAULT_MAX_PAUSE_MILLIS 10
+
+/**
+ * Capacidade inicial de cada pilha de marcação (potência de 2). A capacidade dobra sempre que a pilha fica cheia.
+ */
+#define GC_MARK_STACK_INITIAL_CAPACITY 1024
+
+class VMStack;
+class ClassRuntime;
+
+/**
+ * Coletor de lixo paralelo (mark-sweep) da \c Heap.
+ *
+ * A coleta é feita com todas as threads Java paradas em um safepoint: entre duas instruções (\c safepoint, verificado
+ * pelo interpretador a cada instrução) ou em uma espera que não altera a pilha da thread (entre \c enterSafeRegion e
+ * \c leaveSafeRegion, e.g. aguardando um lock ou o fim de outra thread). Enquanto alguma thread aguarda o <clinit> de
+ * outra thread (\c enterUnsafeWait), a coleta é adiada, pois essa espera ocorre no meio de uma instrução, com
+ * referências que ainda não estão na pilha.
+ *
+ * A coleta usa N threads (\c -XX:ParallelGCThreads=N, por padrão a quantidade de processadores), incluindo a thread
+ * que a iniciou:
+ *
+ * - marcação: as fontes de raízes (as pilhas de cada thread Java, os fields estáticos de cada classe, a tabela de
+ *   strings e os objetos das threads) são distribuídas entre as threads, e cada thread marca os objetos alcançáveis a
+ *   partir das suas raízes usando a sua própria pilha de marcação. Uma thread sem trabalho rouba até metade da pilha
+ *   de outra thread; a marcação termina quando todas as threads estão sem trabalho;
+ * - varredura: as regiões da heap são distribuídas entre as threads, que destroem os objetos não marcados. As regiões
+ *   que ficam vazias são reaproveitadas.
+ *
+ * Com \c -XX:+ConcurrentMarking (ou \c -XX:MaxPauseMillis=N), a coleta é conduzida por uma thread própria e a maior
+ * parte dela ocorre enquanto as threads Java executam (snapshot-at-the-beginning):
+ *
+ * - pausa inicial: somente as pilhas das threads são percorridas. A partir dela, os novos objetos já são marcados e a
+ *   barreira de escrita (\c writeBarrier, em putfield, putstatic e aastore) registra cada referência sobrescrita,
+ *   portanto todo objeto alcançável no início da pausa é marcado;
+ * - marcação concorrente: as demais raízes e os objetos alcançáveis, incluindo as referências registradas;
+ * - pausa final: as referências registradas restantes são marcadas. Caso a marcação não termine em N milissegundos
+ *   (por padrão \c GC_DEFAULT_MAX_PAUSE_MILLIS), as threads Java voltam a executar e a marcação continua concorrente
+ *   até uma nova pausa;
+ * - varredura concorrente: as regiões existentes na pausa final são varridas, enquanto as threads Java alocam em
+ *   novos espaços.
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class GarbageCollector {
+
+public:
+    /**
+     * @brief Obter a única instância do GarbageCollector.
+     * @return A instância do GarbageCollector.
+     */
+    static GarbageCollector& getInstance() {
+        static GarbageCollector instance;
+        return instance;
+    }
+
+    /**
+     * @brief Destrutor padrão. Encerra as threads auxiliares da coleta.
+     */
+    ~GarbageCollector();
+
+    /**
+     * @brief Define a quantidade de threads usadas em cada coleta (incluindo a thread que a inicia).
+     */
+    void setParallelThreads(unsigned int threadsCount);
+
+    /**
+     * @brief Define se cada coleta deve ser informada na saída padrão.
+     */
+    void setVerbose(bool verbose);
+
+    /**
+     * @brief Ativa a coleta com marcação concorrente, iniciando a thread que a conduz. Deve ser chamado antes da
+     * execução das threads Java.
+     */
+    void setConcurrent();
+
+    /**
+     * @brief Define a duração máxima das pausas da coleta concorrente (e ativa a coleta concorrente).
+     */
+    void setMaxPauseMillis(unsigned int maxPauseMillis);
+
+    /**
+     * @brief Solicita uma coleta de lixo, que é feita no próximo safepoint de uma thread Java (ou iniciada pela thread
+     * da coleta concorrente).
+     */
+    void requestCollection();
+
+    /**
+     * @brief Aguarda o fim da coleta concorrente em andamento, caso exista (e.g. antes de percorrer a heap).
+     */
+    void waitForCollection();
+
+    /**
+     * @brief Aguarda o fim da coleta concorrente em andamento, ou até que ela seja adiada por threads que aguardam um
+     * <clinit> (e.g. a thread que executa o <clinit> aguardado, que precisa voltar a executar para terminá-lo).
+     */
+    void waitForCollectionAttempt();
+
+    /**
+     * @brief Verifica se a marcação concorrente está em andamento (i.e. se a barreira de escrita está ativa).
+     */
+    static bool isMarking() {
+        return _marking.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief Barreira de escrita, chamada pelo interpretador antes de sobrescrever uma referência em um objeto, array
+     * ou field estático durante a marcação concorrente: a referência anterior é registrada, para que o objeto continue
+     * sendo marcado mesmo que deixe de ser alcançável a partir da heap.
+     * @param previous O valor sobrescrito.
+     */
+    static void writeBarrier(const Value &previous) {
+        if (previous.type == ValueType::REFERENCE && previous.data.object != NULL && isMarking()) {
+            getInstance().logOverwritten(previous.data.object);
+        }
+    }
+
+    /**
+     * @brief Verificação feita pelo interpretador entre duas instruções: caso uma coleta tenha sido solicitada, a
+     * thread a executa ou aguarda o seu fim.
+     */
+    static void safepoint() {
+        if (_pollRequested.load(memory_order_relaxed)) {
+            getInstance().safepointSlow();
+        }
+    }
+
+    /**
+     * @brief Indica que a thread atual deixa de executar código Java (ou passa a aguardar sem alterar a sua pilha). A
+     * coleta pode ocorrer enquanto a thread estiver nesse estado.
+     *
+     * Toda thread começa fora do código Java.
+     */
+    void enterSafeRegion();
+
+    /**
+     * @brief Indica que a thread atual volta a executar código Java, aguardando o fim da coleta em andamento, caso exista.
+     */
+    void leaveSafeRegion();
+
+    /**
+     * @brief Indica que a thread atual aguarda no meio de uma instrução (o <clinit> de outra thread). A coleta é
+     * adiada até o fim da espera.
+     */
+    void enterUnsafeWait();
+
+    /**
+     * @brief Indica o fim da espera iniciada com \c enterUnsafeWait.
+     */
+    void leaveUnsafeWait();
+
+    /**
+     * @brief Registra a pilha de uma thread Java, cujos frames são raízes da coleta.
+     */
+    void registerStack(VMStack *stack);
+
+    /**
+     * @brief Remove o registro da pilha de uma thread Java.
+     */
+    void unregisterStack(VMStack *stack);
+
+private:
+    /**
+     * @brief Construtor padrão.
+     */
+    GarbageCollector();
+
+    GarbageCollector(GarbageCollector const&); // não permitir implementação do construtor de cópia
+    void operator=(GarbageCollector const&); // não permitir implementação do operador de igual
+
+    /**
+     * A pilha de marcação de uma thread da coleta (deque de Chase-Lev). A dona empilha e desempilha no fim sem nenhum
+     * lock, e as demais threads roubam do início com um compare-and-swap, competindo com a dona somente pelo último
+     * objeto.
+     */
+    class MarkStack {
+    public:
+        MarkStack();
+
+        ~MarkStack();
+
+        /**
+         * @brief Empilha um objeto. Somente a thread dona da pilha pode chamá-lo.
+         */
+        void push(Object *object);
+
+        /**
+         * @brief Desempilha o último objeto empilhado. Somente a thread dona da pilha pode chamá-lo.
+         * @return \c false caso a pilha esteja vazia.
+         */
+        bool pop(Object *&object);
+
+        /**
+         * @brief Rouba o objeto mais antigo da pilha (chamado pelas demais threads).
+         * @return \c false caso a pilha esteja vazia ou o objeto tenha sido obtido por outra thread.
+         */
+        bool steal(Object *&object);
+
+        /**
+         * @brief Obtém a quantidade aproximada de objetos na pilha.
+         */
+        size_t size();
+
+        /**
+         * @brief Libera os buffers substituídos ao aumentar a capacidade. Deve ser chamado quando nenhuma thread
+         * estiver roubando da pilha.
+         */
+        void releaseRetired();
+
+    private:
+        MarkStack(MarkStack const&); // não permitir implementação do construtor de cópia
+        void operator=(MarkStack const&); // não permitir implementação do operador de igual
+
+        /**
+         * Os objetos da pilha, em um buffer circular (o objeto de índice i fica na posição i & (capacity - 1)).
+         */
+        struct Buffer {
+            long capacity;
+            atomic<Object*> *objects;
+        };
+
+        /**
+         * @brief Cria um buffer com a capacidade dada.
+         */
+        static Buffer* newBuffer(long capacity);
+
+        static void deleteBuffer(Buffer *buffer);
+
+        /**
+         * Índices do objeto mais antigo (incrementado por quem rouba) e da próxima posição livre (alterado somente
+         * pela dona).
+         */
+        atomic<long> _top;
+
+        atomic<long> _bottom;
+
+        atomic<Buffer*> _buffer;
+
+        /**
+         * Os buffers substituídos, que podem ainda estar sendo lidos por uma thread que rouba.
+         */
+        vector<Buffer*> _retired;
+    };
+
+    /**
+     * Fases de uma coleta, executadas por todas as threads da coleta.
+     */
+    enum CollectionPhase {
+        PHASE_IDLE,
+        PHASE_MARK,
+        PHASE_SWEEP
+    };
+
+    /**
+     * @brief Caminho lento de \c safepoint.
+     */
+    void safepointSlow();
+
+    /**
+     * @brief Executa a coleta, com todas as threads Java paradas.
+     */
+    void collect();
+
+    /**
+     * @brief Cria as pilhas de marcação e as threads auxiliares da coleta, caso ainda não existam.
+     */
+    void startWorkers();
+
+    /**
+     * @brief Laço da thread da coleta concorrente: aguarda as solicitações de coleta e as executa.
+     */
+    void concurrentLoop();
+
+    /**
+     * @brief Executa uma coleta concorrente.
+     * @return \c false caso a pausa inicial não tenha sido possível (uma thread aguarda o <clinit> de outra thread).
+     */
+    bool concurrentCycle();
+
+    /**
+     * @brief Adia a coleta concorrente por um instante, pois uma thread aguarda o <clinit> de outra thread, liberando as
+     * threads em \c waitForCollectionAttempt.
+     */
+    void deferCycle();
+
+    /**
+     * @brief Executa a fase de marcação enquanto as threads Java executam, até que não haja mais trabalho.
+     */
+    void concurrentMark();
+
+    /**
+     * @brief Para todas as threads Java (usado pela thread da coleta concorrente, que não é uma thread Java).
+     * @return \c false caso não tenha sido possível parar as threads, que continuam executando.
+     */
+    bool stopTheWorld();
+
+    /**
+     * @brief Permite que as threads Java paradas por \c stopTheWorld voltem a executar.
+     */
+    void resumeTheWorld();
+
+    /**
+     * @brief Caminho lento de \c writeBarrier: registra a referência no buffer da thread atual, entregando o buffer à
+     * marcação quando ele está cheio.
+     */
+    void logOverwritten(Object *object);
+
+    /**
+     * @brief Entrega as referências do buffer dado à marcação e esvazia o buffer.
+     */
+    void flushSatbBuffer(vector<Object*> &buffer);
+
+    /**
+     * @brief Obtém as referências entregues à marcação para a pilha de marcação da thread dada.
+     * @return \c true caso alguma referência tenha sido obtida.
+     */
+    bool takeSatbWork(unsigned int index);
+
+    /**
+     * @brief Informa uma pausa da coleta concorrente, caso \c -verbose:gc tenha sido informado.
+     */
+    void reportPause(const char *name, chrono::steady_clock::time_point start);
+
+    /**
+     * @brief Executa uma fase em todas as threads da coleta e aguarda o seu fim.
+     */
+    void runPhase(CollectionPhase phase);
+
+    /**
+     * @brief Laço de cada thread auxiliar da coleta.
+     */
+    void workerLoop(unsigned int index);
+
+    /**
+     * @brief Marcação feita por uma thread: obtém fontes de raízes até que elas terminem e então marca os objetos
+     * alcançáveis, roubando trabalho das demais threads.
+     */
+    void markWorker(unsigned int index);
+
+    /**
+     * @brief Varredura feita por uma thread: obtém e varre regiões até que elas terminem.
+     */
+    void sweepWorker();
+
+    /**
+     * @brief Marca o objeto e, caso ele ainda não estivesse marcado, o empilha na pilha de marcação dada.
+     */
+    void markAndPush(Object *object, MarkStack *markStack);
+
+    /**
+     * @brief Rouba até metade dos objetos da pilha de outra thread para a pilha da thread dada.
+     * @return \c true caso algum objeto tenha sido roubado.
+     */
+    bool steal(unsigned int index);
+
+    /**
+     * Protege o estado das threads Java (\c _runningMutators, \c _unsafeWaiters e \c _collecting).
+     */
+    mutex _safepointMutex;
+
+    /**
+     * Sinalizada quando uma thread Java para (entra em uma região segura ou em uma espera no meio de uma instrução).
+     */
+    condition_variable _mutatorStopped;
+
+    /**
+     * Sinalizada quando a coleta em andamento termina.
+     */
+    condition_variable _collectionFinished;
+
+    /**
+     * Quantidade de threads que executam código Java (fora de uma região segura).
+     */
+    int _runningMutators;
+
+    /**
+     * Quantidade de threads que aguardam o <clinit> de outra thread.
+     */
+    int _unsafeWaiters;
+
+    /**
+     * \c true enquanto uma coleta está em andamento (as threads Java não podem voltar a executar).
+     */
+    bool _collecting;
+
+    /**
+     * \c true caso uma coleta tenha sido solicitada.
+     */
+    atomic<bool> _collectionRequested;
+
+    /**
+     * \c true caso as threads Java devam executar o caminho lento de \c safepoint.
+     */
+    static atomic<bool> _pollRequested;
+
+    /**
+     * As pilhas das threads Java.
+     */
+    set<VMStack*> _stacks;
+
+    mutex _stacksMutex;
+
+    unsigned int _threadsCount;
+
+    bool _verbose;
+
+    /**
+     * \c true com a coleta concorrente ativa.
+     */
+    bool _concurrent;
+
+    unsigned int _maxPauseMillis;
+
+    /**
+     * A thread que conduz a coleta concorrente.
+     */
+    thread _concurrentThread;
+
+    /**
+     * Protege o início e o fim das coletas concorrentes (\c _cycleActive).
+     */
+    mutex _cycleMutex;
+
+    condition_variable _cycleRequested;
+
+    condition_variable _cycleFinished;
+
+    bool _cycleActive;
+
+    /**
+     * \c true quando a coleta concorrente em andamento foi adiada por threads que aguardam um <clinit> (ver
+     * \c waitForCollectionAttempt).
+     */
+    bool _cycleDeferred;
+
+    /**
+     * \c true quando a JVM termina: a coleta concorrente em andamento é abandonada.
+     */
+    atomic<bool> _shutdown;
+
+    /**
+     * \c true durante a marcação concorrente (i.e. com a barreira de escrita ativa).
+     */
+    static atomic<bool> _marking;
+
+    /**
+     * As referências registradas pela barreira de escrita e entregues à marcação.
+     */
+    vector<Object*> _satbQueue;
+
+    mutex _satbMutex;
+
+    /**
+     * Limite da fase de marcação atual, caso \c _hasDeadline. A marcação é interrompida (\c _markAborted) ao atingi-lo.
+     */
+    chrono::steady_clock::time_point _deadline;
+
+    bool _hasDeadline;
+
+    atomic<bool> _markAborted;
+
+    /**
+     * \c false caso a fase de marcação atual não percorra os fields estáticos, a tabela de strings e os objetos das
+     * threads (já percorridos em uma fase anterior da coleta concorrente).
+     */
+    bool _scanGlobalRoots;
+
+    /**
+     * Soma da duração das pausas e duração da maior pausa da coleta concorrente atual, em milissegundos.
+     */
+    double _pausesMillis;
+
+    double _maxPauseObserved;
+
+    /**
+     * As threads auxiliares da coleta (criadas na primeira coleta).
+     */
+    vector<thread> _workers;
+
+    /**
+     * Protege o início e o fim das fases.
+     */
+    mutex _phaseMutex;
+
+    condition_variable _phaseStarted;
+
+    condition_variable _phaseFinished;
+
+    CollectionPhase _phase;
+
+    /**
+     * Incrementado a cada fase iniciada, para que cada thread auxiliar execute cada fase uma única vez.
+     */
+    unsigned int _phaseSequence;
+
+    /**
+     * Quantidade de threads que ainda não terminaram a fase atual.
+     */
+    unsigned int _pendingWorkers;
+
+    bool _stopping;
+
+    /**
+     * As pilhas de marcação (uma por thread da coleta).
+     */
+    vector<MarkStack*> _markStacks;
+
+    /**
+     * Quantidade de threads da coleta sem trabalho de marcação.
+     */
+    atomic<unsigned int> _idleMarkers;
+
+    /**
+     * As fontes de raízes da coleta atual: as pilhas das threads e as classes carregadas, seguidas da tabela de strings
+     * e dos objetos das threads (ver \c _scanGlobalRoots).
+     */
+    vector<VMStack*> _rootStacks;
+
+    vector<ClassRuntime*> _rootClasses;
+
+    /**
+     * Próxima fonte de raízes (ou região, na varredura) a ser obtida por uma thread.
+     */
+    atomic<size_t> _nextWork;
+
+    /**
+     * Quantidade de regiões da heap a serem varridas.
+     */
+    size_t _regionsCount;
+
+    /**
+     * Totais da varredura.
+     */
+    atomic<size_t> _liveBytes;
+
+    atomic<size_t> _freedObjects;
+};
+
+#endif /* garbagecollector_h */
@@ -2,13 +2,96 @@
 #define Heap_h
 
 #include <vector>
+#include <map>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 
 #include "object.h"
+#include "stringobject.h"
 
 using namespace std;
 
+class LoaderScope;
+
+/**
+ * Tamanho de cada buffer de alocação local de uma thread (TLAB), em bytes.
+ */
+#define TLAB_SIZE (64 * 1024)
+
 /**
- * Heap (i.e. vetor de objetos).
+ * Quantidade mínima padrão de bytes alocados (em TLABs e regiões de objetos grandes) entre duas coletas de lixo (ver
+ * \c Heap::setInitialSize).
+ */
+#define HEAP_COLLECTION_THRESHOLD (16 * 1024 * 1024)
+
+/**
+ * Limites da fração do tempo gasta com a coleta de lixo: acima de \c HEAP_MAX_GC_OVERHEAD, a quantidade de bytes
+ * alocados entre duas coletas é dobrada; abaixo de \c HEAP_MIN_GC_OVERHEAD, ela é reduzida à metade.
+ */
+#define HEAP_MAX_GC_OVERHEAD 0.10
+#define HEAP_MIN_GC_OVERHEAD 0.02
+
+/**
+ * Quantidade máxima de bytes alocados entre duas coletas, em relação aos bytes dos objetos vivos (acima do tamanho
+ * inicial). Uma heap maior reduz somente o custo da marcação, proporcional aos objetos vivos: o custo da varredura é
+ * proporcional aos objetos alocados, independentemente da frequência das coletas.
+ */
+#define HEAP_MAX_LIVE_RATIO 4
+
+/**
+ * Tamanho padrão a partir do qual um objeto é alocado no espaço de objetos grandes (ver \c Heap::setLargeObjectThreshold).
+ */
+#define HEAP_LARGE_OBJECT_THRESHOLD (TLAB_SIZE / 2)
+
+/**
+ * Tamanho mínimo de um espaço livre (entre objetos vivos) reaproveitado como TLAB após a coleta de lixo, em bytes.
+ */
+#define HEAP_MIN_FREE_CHUNK 1024
+
+/**
+ * Tamanho do intervalo de endereços reservado para a heap com referências comprimidas: 2^32 referências de 8 bytes.
+ */
+#define HEAP_RESERVED_SIZE ((size_t) 32 * 1024 * 1024 * 1024)
+
+/**
+ * Tamanho mínimo aceito para o intervalo reservado, caso o sistema não permita reservar \c HEAP_RESERVED_SIZE.
+ */
+#define HEAP_MIN_RESERVED_SIZE ((size_t) 256 * 1024 * 1024)
+
+/**
+ * Granularidade das regiões dentro do intervalo reservado (uma página).
+ */
+#define HEAP_PAGE_SIZE 4096
+
+/**
+ * Heap (i.e. regiões de memória que contêm os objetos). Pode ser usada por várias threads.
+ *
+ * Cada thread aloca os seus objetos incrementando um ponteiro dentro de um espaço próprio (TLAB, thread-local
+ * allocation buffer), sem nenhuma sincronização. Somente quando a TLAB da thread se esgota um novo espaço é obtido da
+ * heap, com \c _regionsMutex adquirido. O espaço ainda não usado de uma TLAB é coberto por uma palavra com
+ * \c OBJECT_FREE, e o tamanho de cada objeto é obtido do seu cabeçalho (\c Object::getHeapSize), portanto as regiões
+ * sempre podem ser percorridas.
+ *
+ * Os objetos inalcançáveis são destruídos pela coleta de lixo (ver \c GarbageCollector), solicitada quando a
+ * quantidade de bytes obtidos para novas TLABs excede \c _collectionThreshold. A varredura une os espaços livres
+ * consecutivos de cada região: as regiões sem objetos vivos são reaproveitadas por inteiro, e os espaços livres
+ * maiores que \c HEAP_MIN_FREE_CHUNK entre objetos vivos são reaproveitados como TLABs.
+ *
+ * O limite \c _collectionThreshold é ajustado ao fim de cada coleta pela fração do tempo gasta com a coleta de lixo:
+ * a heap cresce (até \c HEAP_MAX_LIVE_RATIO vezes os objetos vivos) quando as coletas são frequentes demais e diminui (devolvendo as regiões livres excedentes ao sistema)
+ * quando são raras, sem ficar abaixo do tamanho inicial (\c -Xms) nem exceder o tamanho máximo (\c -Xmx). As
+ * alocações feitas pelas instruções Java falham ao exceder o tamanho máximo (ver \c allocate); as alocações internas
+ * da JVM (e.g. strings e o próprio \c OutOfMemoryError) podem excedê-lo.
+ *
+ * Os objetos maiores que \c _largeObjectThreshold (e.g. arrays grandes) não são alocados em TLABs: cada um ocupa uma
+ * região própria, alinhada a páginas, no espaço de objetos grandes (\c _largeRegions). Essas regiões não são divididas
+ * em TLABs, nem reaproveitadas: a memória de um objeto grande inalcançável é devolvida ao sistema ao fim da coleta.
+ *
+ * Com referências comprimidas (o padrão, desativado com \c -XX:-UseCompressedOops), todas as regiões ficam dentro de
+ * um único intervalo de endereços reservado antes da primeira alocação, e as referências armazenadas nos arrays ocupam 32
+ * bits: o deslocamento do objeto a partir do início do intervalo, dividido por 8 (\c compress e \c decompress).
  *
  * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
  */
@@ -22,30 +105,420 @@ public:
         static Heap instance;
         return instance;
     }
-    
+
     /**
      * @brief Destrutor padrão.
      */
     ~Heap();
-    
+
+    /**
+     * @brief Aloca a memória de um objeto na TLAB da thread atual (usado pelo \c operator \c new de \c Object).
+     *
+     * O cabeçalho do objeto deve ser escrito pelo seu construtor antes que a região seja percorrida novamente.
+     * @param size O tamanho do objeto, incluindo os seus dados.
+     * @param limited \c true caso a alocação deva falhar ao exceder o tamanho máximo da heap.
+     * @return A memória do objeto, ou \c NULL caso a alocação tenha falhado.
+     */
+    void* allocate(size_t size, bool limited = false);
+
+    /**
+     * @brief Obtém a quantidade de bytes ocupados na heap por um objeto de tamanho dado (múltiplo de 8).
+     */
+    static size_t allocationSize(size_t size) {
+        return (size + 7) & ~((size_t) 7);
+    }
+
+    /**
+     * @brief Cobre o espaço dado com uma única palavra com \c OBJECT_FREE (e.g. a memória de um objeto cuja
+     * construção falhou).
+     */
+    static void markFree(u1 *start, u1 *end);
+
+    /**
+     * @brief Obtém os bits da coleta de lixo dos novos objetos: a marca atual durante uma coleta com marcação
+     * concorrente, ou 0.
+     */
+    static uintptr_t getAllocationFlags() {
+        return _allocationFlags.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief Define se as referências devem ser comprimidas. Deve ser chamado antes de \c reserve.
+     */
+    void setCompressedReferences(bool compressedReferences);
+
+    /**
+     * @brief Define o tamanho a partir do qual os objetos são alocados no espaço de objetos grandes.
+     * @param threshold O tamanho, em bytes, no máximo \c TLAB_SIZE (o maior objeto que cabe em uma TLAB).
+     */
+    void setLargeObjectThreshold(size_t threshold);
+
+    /**
+     * @brief Define o tamanho inicial da heap: a quantidade mínima de bytes alocados entre duas coletas de lixo.
+     * @param size O tamanho, em bytes.
+     */
+    void setInitialSize(size_t size);
+
     /**
-     * @brief Adiciona um objeto à heap.
+     * @brief Define o tamanho máximo da heap (a memória obtida para as regiões). Por padrão, não há limite.
+     * @param size O tamanho, em bytes.
      */
-    void addObject(Object *object);
-    
+    void setMaxSize(size_t size);
+
+    /**
+     * @brief Obtém a quantidade de coletas de lixo iniciadas (ver \c beginMarking).
+     */
+    u4 getStartedCollections() {
+        return _startedCollections.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief Obtém a quantidade de coletas de lixo terminadas (ver \c finishCollection).
+     */
+    u4 getFinishedCollections() {
+        return _finishedCollections.load(memory_order_relaxed);
+    }
+
+    /**
+     * @brief Reserva o intervalo de endereços da heap (com referências comprimidas). Caso não seja possível reservar
+     * nem \c HEAP_MIN_RESERVED_SIZE, as referências deixam de ser comprimidas.
+     *
+     * Deve ser chamado antes da primeira alocação, pois o tamanho dos arrays de referências depende da compressão.
+     */
+    void reserve();
+
+    /**
+     * @brief Verifica se as referências são comprimidas (i.e. se o intervalo de endereços da heap foi reservado).
+     */
+    static bool usesCompressedReferences() {
+        return _base != NULL;
+    }
+
+    /**
+     * @brief Comprime uma referência para 32 bits. Somente válido com \c usesCompressedReferences.
+     * @param object O objeto (ou \c NULL, representado por 0).
+     * @return A referência comprimida.
+     */
+    static u4 compress(Object *object) {
+        return (object == NULL) ? 0 : (u4) ((((u1 *) object) - _base) >> 3);
+    }
+
+    /**
+     * @brief Obtém o objeto de uma referência comprimida com \c compress.
+     */
+    static Object* decompress(u4 reference) {
+        return (reference == 0) ? NULL : (Object *) (_base + (((size_t) reference) << 3));
+    }
+
+    /**
+     * @brief Obtém a instância canônica (interned) de uma string.
+     *
+     * Caso ainda não exista uma string com o mesmo conteúdo na tabela de strings, ela é criada e adicionada.
+     * @param s O conteúdo da string.
+     * @return A instância canônica da string.
+     */
+    StringObject* internString(const string &s);
+
+    /**
+     * @brief Remove da heap (e libera) todos os objetos cujas classes pertencem ao escopo dado.
+     *
+     * Usado no descarregamento de um escopo, quando nenhum desses objetos é alcançável.
+     * @param scope O escopo que está sendo descarregado.
+     * @return A quantidade de objetos liberados.
+     */
+    size_t removeInstancesOfScope(LoaderScope *scope);
+
+    /**
+     * @brief Marca um objeto como alcançável na coleta de lixo em andamento. Pode ser chamado por várias threads.
+     * @param object O objeto.
+     * @return \c true caso o objeto ainda não estivesse marcado.
+     */
+    static bool mark(Object *object) {
+        uintptr_t markBit = _markBit.load(memory_order_relaxed);
+        return (object->getClassWord().fetch_or(markBit, memory_order_relaxed) & markBit) == 0;
+    }
+
+    /**
+     * @brief Verifica se um objeto já foi marcado pela coleta de lixo em andamento.
+     */
+    static bool isMarked(Object *object) {
+        return (object->getClassWord().load(memory_order_relaxed) & _markBit.load(memory_order_relaxed)) != 0;
+    }
+
+    /**
+     * @brief Inicia a marcação de uma coleta de lixo, com todas as threads Java paradas: a marca usada é alternada.
+     * @param allocateMarked \c true caso os objetos alocados a partir de agora (até \c finishCollection) já devam ser
+     * marcados, pois a marcação ocorre enquanto as threads Java executam.
+     */
+    void beginMarking(bool allocateMarked);
+
+    /**
+     * @brief Adiciona as raízes mantidas pela heap (as strings da tabela de strings) no vetor dado.
+     */
+    void collectRoots(vector<Object*> &roots);
+
+    /**
+     * @brief Obtém a quantidade aproximada de bytes ocupados na heap: os objetos vivos após a última coleta e as TLABs
+     * obtidas desde então.
+     */
+    size_t getUsedBytes();
+
+    /**
+     * @brief Inicia a varredura da coleta de lixo, com todas as threads Java paradas. As regiões atuais são as regiões
+     * varridas, os espaços livres conhecidos são descartados, pois a varredura os encontra novamente, e as TLABs de
+     * todas as threads são descartadas. A varredura pode ocorrer enquanto as threads Java executam, pois elas passam a
+     * alocar somente em novos espaços.
+     * @return A quantidade de regiões a serem varridas.
+     */
+    size_t beginSweep();
+
+    /**
+     * @brief Varre uma região após a marcação: os objetos não marcados são destruídos, as marcas são apagadas e os
+     * espaços livres consecutivos são unidos. Os espaços livres encontrados já podem ser usados como TLABs.
+     *
+     * Regiões diferentes podem ser varridas ao mesmo tempo por threads diferentes.
+     * @param index O índice da região.
+     * @param freedObjects Incrementado com a quantidade de objetos destruídos.
+     * @return A quantidade de bytes dos objetos que continuam vivos na região.
+     */
+    size_t sweepRegion(size_t index, size_t &freedObjects);
+
+    /**
+     * @brief Termina uma coleta de lixo: as regiões sem objetos vivos são reaproveitadas (ou devolvidas ao sistema, no
+     * caso das regiões de objetos grandes), os novos objetos deixam de ser marcados e o limite para a próxima coleta é calculado.
+     * @param liveBytes A quantidade de bytes dos objetos vivos.
+     * @param collectionMillis A duração da coleta, em milissegundos.
+     */
+    void finishCollection(size_t liveBytes, double collectionMillis);
+
 private:
     /**
      * Construtor padrão.
      */
     Heap();
-    
+
     Heap(Heap const&); // não permitir implementação do construtor de cópia
     void operator=(Heap const&); // não permitir implementação do operador de igual
-    
+
+    /**
+     * Uma região contígua da heap, coberta por objetos e espaços livres, cada um iniciado pela sua palavra de classe.
+     */
+    struct HeapRegion {
+        u1 *start;
+        u1 *end;
+        bool empty; // nenhum objeto vivo após a última varredura
+        bool large; // região de um único objeto grande (em _largeRegions)
+    };
+
+    /**
+     * Um espaço livre dentro de uma região, no intervalo [start, end).
+     */
+    struct FreeChunk {
+        u1 *start;
+        u1 *end;
+    };
+
+    /**
+     * @brief Obtém um espaço livre para uma nova TLAB: um espaço livre entre objetos vivos ou uma região inteira.
+     * @param minimumSize O tamanho mínimo do espaço.
+     * @param limited \c true caso uma nova região não possa exceder o tamanho máximo da heap.
+     * @return O espaço obtido, coberto por uma única palavra com \c OBJECT_FREE (com \c start \c NULL caso não exista).
+     */
+    FreeChunk newTlab(size_t minimumSize, bool limited);
+
+    /**
+     * @brief Cria uma região e a adiciona na heap. Deve ser chamado com \c _regionsMutex adquirido.
+     *
+     * Sem referências comprimidas, a memória de uma região de objeto grande é obtida diretamente com \c mmap.
+     * @param size O tamanho da região.
+     * @param large \c true caso a região seja de um objeto grande.
+     * @param limited \c true caso a região não possa exceder o tamanho máximo da heap.
+     * @return A região, ou \c NULL caso \c limited e o tamanho máximo tenha sido atingido.
+     */
+    HeapRegion* newRegion(size_t size, bool large, bool limited);
+
+    /**
+     * @brief Devolve a memória de uma região que não é mais usada. Deve ser chamado com \c _regionsMutex adquirido.
+     */
+    void deleteRegion(HeapRegion *region);
+
+    /**
+     * @brief Obtém memória para uma região dentro do intervalo reservado.
+     * @param size O tamanho da região, múltiplo de \c HEAP_PAGE_SIZE.
+     * @return O início da memória, ou \c NULL caso o intervalo reservado tenha se esgotado.
+     */
+    u1* commit(size_t size);
+
+    /**
+     * @brief Devolve o intervalo de uma região liberada, juntando-o aos intervalos livres vizinhos (e a \c _reservedTop,
+     * caso seja o último intervalo usado).
+     */
+    void release(u1 *start, u1 *end);
+
+    /**
+     * @brief Contabiliza os bytes obtidos para novas alocações, solicitando uma coleta de lixo ao atingir o limite.
+     * Deve ser chamado com \c _regionsMutex adquirido.
+     */
+    void countAllocation(size_t size);
+
+    /**
+     * @brief Obtém o tamanho do objeto ou do espaço livre que inicia na posição dada de uma região.
+     */
+    static size_t sizeAt(u1 *position);
+
+    /**
+     * @brief Destrói um objeto pelo seu tipo concreto, pois \c Object não possui destrutor virtual.
+     */
+    static void destroy(Object *object);
+
+    /**
+     * As regiões da heap, na ordem em que foram criadas.
+     */
+    vector<HeapRegion*> _regions;
+
+    /**
+     * As regiões do espaço de objetos grandes, cada uma com um único objeto.
+     */
+    vector<HeapRegion*> _largeRegions;
+
+    /**
+     * Tamanho a partir do qual um objeto é alocado no espaço de objetos grandes.
+     */
+    size_t _largeObjectThreshold;
+
+    /**
+     * As regiões de tamanho \c TLAB_SIZE esvaziadas pela coleta de lixo, que são reaproveitadas como novas TLABs.
+     */
+    vector<HeapRegion*> _freeRegions;
+
+    /**
+     * Os espaços livres entre objetos vivos encontrados pela última varredura, reaproveitados como novas TLABs.
+     */
+    vector<FreeChunk> _freeChunks;
+
+    /**
+     * \c true caso as referências devam ser comprimidas, e \c false após \c reserve.
+     */
+    bool _compressedReferences;
+
+    /**
+     * O intervalo de endereços reservado para a heap (\c NULL sem referências comprimidas). As regiões são obtidas a
+     * partir de \c _reservedTop, ou de um intervalo devolvido em \c _freeRanges.
+     */
+    static u1 *_base;
+
+    /**
+     * O início da parte do intervalo reservado que ainda não foi usada por nenhuma região.
+     */
+    u1 *_reservedTop;
+
+    /**
+     * O fim do intervalo reservado.
+     */
+    u1 *_reservedEnd;
+
+    /**
+     * Os intervalos abaixo de \c _reservedTop devolvidos pelas regiões liberadas, ordenados pelo endereço e sem
+     * intervalos adjacentes (ver \c release).
+     */
+    vector<FreeChunk> _freeRanges;
+
+    /**
+     * As regiões sendo varridas pela coleta atual (as regiões existentes em \c beginSweep).
+     */
+    vector<HeapRegion*> _sweepRegions;
+
+    /**
+     * Serializa a criação de regiões (e a varredura das regiões).
+     */
+    mutex _regionsMutex;
+
+    /**
+     * Bytes obtidos para novas alocações desde a última coleta de lixo.
+     */
+    size_t _allocatedSinceCollection;
+
+    /**
+     * O valor de \c _allocatedSinceCollection em \c beginSweep (as alocações seguintes não são varridas).
+     */
+    size_t _allocatedBeforeSweep;
+
+    /**
+     * Bytes dos objetos vivos após a última coleta de lixo.
+     */
+    size_t _liveBytes;
+
+    /**
+     * Quantidade de bytes a partir da qual uma coleta de lixo é solicitada.
+     */
+    size_t _collectionThreshold;
+
+    /**
+     * Valor mínimo de \c _collectionThreshold (\c -Xms).
+     */
+    size_t _initialSize;
+
+    /**
+     * Bytes de memória obtidos para as regiões (incluindo as regiões livres), limitados por \c _maxSize (0 caso não
+     * exista limite) nas alocações feitas pelas instruções Java.
+     */
+    size_t _committedBytes;
+
+    /**
+     * O tamanho máximo da heap (\c -Xmx), ou 0 caso não exista limite.
+     */
+    size_t _maxSize;
+
+    /**
+     * O fim da última coleta de lixo, usado para calcular a fração do tempo gasta com a coleta.
+     */
+    chrono::steady_clock::time_point _lastCollectionEnd;
+
+    /**
+     * Quantidade de coletas de lixo iniciadas (ver \c getStartedCollections).
+     */
+    atomic<u4> _startedCollections;
+
+    /**
+     * Quantidade de coletas de lixo terminadas (ver \c getFinishedCollections).
+     */
+    atomic<u4> _finishedCollections;
+
+    /**
+     * O espaço em que a thread atual aloca os seus objetos, no intervalo [_tlabTop, _tlabEnd) (\c NULL até a primeira
+     * alocação).
+     */
+    static thread_local u1 *_tlabTop;
+
+    static thread_local u1 *_tlabEnd;
+
+    /**
+     * A época em que a TLAB da thread atual foi obtida. Cada coleta de lixo inicia uma nova época (\c _epoch), e as
+     * TLABs de épocas anteriores não são mais usadas, pois o seu espaço pode ter sido reaproveitado.
+     */
+    static thread_local u4 _tlabEpoch;
+
+    static atomic<u4> _epoch;
+
+    /**
+     * A marca usada pela coleta atual (\c OBJECT_MARK_EVEN ou \c OBJECT_MARK_ODD).
+     */
+    static atomic<u4> _markBit;
+
+    /**
+     * Os bits da coleta de lixo dos novos objetos (ver \c getAllocationFlags).
+     */
+    static atomic<u4> _allocationFlags;
+
+    /**
+     * Tabela de strings (interned) da JVM. A chave é o conteúdo da string e o valor é a sua instância canônica.
+     */
+    map<string, StringObject*> _internedStrings;
+
     /**
-     * Vetor interno que armazena todos os objetos.
+     * Serializa o acesso à tabela de strings.
      */
-    vector<Object*> _objectVector;
+    mutex _stringsMutex;
 };
 
 #endif // Heap_h
@@ -0,0 +1,123 @@
+#ifndef inflater_h
+#define inflater_h
+
+#include "tipos.h"
+
+#define INFLATER_MAXBITS 15 // tamanho máximo de um código de Huffman
+#define INFLATER_MAXLCODES 286 // quantidade máxima de códigos de literal/tamanho
+#define INFLATER_MAXDCODES 30 // quantidade máxima de códigos de distância
+#define INFLATER_FIXLCODES 288 // quantidade de códigos de literal/tamanho no bloco fixo
+
+/**
+ * Descompactador do formato DEFLATE (RFC 1951), utilizado pelas entradas comprimidas de arquivos JAR/ZIP.
+ *
+ * A implementação segue a estrutura do decodificador de referência \c puff, da zlib: os códigos de Huffman são
+ * decodificados bit a bit a partir da contagem de códigos por tamanho (códigos canônicos).
+ */
+class Inflater {
+
+public:
+    /**
+     * @brief Descompacta um fluxo DEFLATE (sem cabeçalho zlib/gzip).
+     * @param source Os bytes compactados.
+     * @param sourceLength A quantidade de bytes compactados.
+     * @param dest O destino dos bytes descompactados.
+     * @param destLength O tamanho esperado dos dados descompactados.
+     * @return \c true caso o fluxo seja válido e produza exatamente \c destLength bytes, e \c false caso contrário.
+     */
+    static bool inflate(const u1 *source, u4 sourceLength, u1 *dest, u4 destLength);
+
+private:
+    /**
+     * Código de Huffman canônico: quantidade de códigos de cada tamanho e os símbolos ordenados pelo código.
+     */
+    struct Huffman {
+        short count[INFLATER_MAXBITS + 1];
+        short symbol[INFLATER_FIXLCODES];
+    };
+
+    /**
+     * @brief Construtor utilizado por \c inflate.
+     */
+    Inflater(const u1 *source, u4 sourceLength, u1 *dest, u4 destLength);
+
+    /**
+     * @brief Lê \c need bits do fluxo de entrada (o bit menos significativo primeiro).
+     *
+     * Caso a entrada termine, \c _error é marcado e é retornado 0.
+     * @param need A quantidade de bits.
+     * @return Os bits lidos.
+     */
+    int bits(int need);
+
+    /**
+     * @brief Copia um bloco não comprimido para a saída.
+     * @return \c true caso o bloco seja válido.
+     */
+    bool stored();
+
+    /**
+     * @brief Decodifica um símbolo da entrada com o código de Huffman dado.
+     * @param h O código de Huffman.
+     * @return O símbolo decodificado, ou um valor negativo em caso de erro.
+     */
+    int decode(const Huffman *h);
+
+    /**
+     * @brief Monta um código de Huffman canônico a partir do tamanho do código de cada símbolo.
+     * @param h O código que será montado.
+     * @param length O tamanho do código de cada símbolo.
+     * @param n A quantidade de símbolos.
+     * @return 0 para um código completo, negativo caso o código seja inválido e positivo caso esteja incompleto.
+     */
+    static int construct(Huffman *h, const short *length, int n);
+
+    /**
+     * @brief Decodifica os literais e pares tamanho/distância de um bloco comprimido até o símbolo de fim de bloco.
+     * @return \c true caso o bloco seja válido.
+     */
+    bool codes(const Huffman *lencode, const Huffman *distcode);
+
+    /**
+     * @brief Monta os códigos de Huffman fixos (usados pelos blocos do tipo 1).
+     * @return Sempre \c true.
+     */
+    static bool buildFixedCodes(Huffman *lencode, Huffman *distcode);
+
+    /**
+     * @brief Descompacta um bloco com os códigos de Huffman fixos.
+     * @return \c true caso o bloco seja válido.
+     */
+    bool fixed();
+
+    /**
+     * @brief Descompacta um bloco com códigos de Huffman dinâmicos (descritos no próprio bloco).
+     * @return \c true caso o bloco seja válido.
+     */
+    bool dynamic();
+
+    const u1 *_source;
+    u4 _sourceLength;
+    u4 _sourceOffset;
+
+    u1 *_dest;
+    u4 _destLength;
+    u4 _destOffset;
+
+    /**
+     * Bits lidos da entrada que ainda não foram consumidos.
+     */
+    int _bitBuffer;
+
+    /**
+     * Quantidade de bits em \c _bitBuffer.
+     */
+    int _bitCount;
+
+    /**
+     * \c true caso a entrada tenha terminado antes do esperado.
+     */
+    bool _error;
+};
+
+#endif /* inflater_h */
@@ -0,0 +1,74 @@
+#ifndef loaderscope_h
+#define loaderscope_h
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class ClassRuntime;
+
+/**
+ * Escopo de carregamento: o conjunto das classes carregadas durante um job.
+ *
+ * As classes de um escopo são descarregadas juntas, quando nenhuma delas é mais alcançável (ver
+ * \c MethodArea::unloadUnreachableScopes). O escopo de boot contém as classes do pacote java/ e as carregadas fora
+ * de um job, e nunca é descarregado.
+ */
+class LoaderScope {
+
+public:
+    /**
+     * @brief Construtor padrão.
+     * @param name O nome do escopo (e.g. a classe de entrada do job).
+     * @param permanent \c true para o escopo de boot, que nunca é descarregado.
+     */
+    LoaderScope(const string &name, bool permanent);
+
+    /**
+     * @brief Destrutor padrão. As classes não são liberadas (isso é feito pela \c MethodArea).
+     */
+    ~LoaderScope();
+
+    /**
+     * @brief Obtém o nome do escopo.
+     */
+    const string& getName();
+
+    /**
+     * @brief Indica se o escopo é o escopo de boot.
+     */
+    bool isPermanent();
+
+    /**
+     * @brief Adiciona uma classe carregada ao escopo.
+     * @param classRuntime A classe.
+     */
+    void addClass(ClassRuntime *classRuntime);
+
+    /**
+     * @brief Obtém as classes do escopo.
+     */
+    const vector<ClassRuntime*>& getClasses();
+
+private:
+    LoaderScope(LoaderScope const&); // não permitir implementação do construtor de cópia
+    void operator=(LoaderScope const&); // não permitir implementação do operador de igual
+
+    /**
+     * O nome do escopo.
+     */
+    string _name;
+
+    /**
+     * Indica se o escopo nunca é descarregado.
+     */
+    bool _permanent;
+
+    /**
+     * As classes carregadas no escopo.
+     */
+    vector<ClassRuntime*> _classes;
+};
+
+#endif /* loaderscope_h */
@@ -3,9 +3,13 @@
 
 #include "tipos.h"
 #include "classruntime.h"
+#include "loaderscope.h"
 
-#include <map>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 
@@ -31,6 +35,16 @@ public:
      */
     ~MethodArea();
     
+    /**
+     * @brief Carrega a classe com o nome dado e a adiciona na área de métodos.
+     *
+     * Caso a classe já tenha sido carregada, o custo é o de uma consulta em \c getClassNamed. Caso a classe esteja
+     * sendo inicializada por outra thread, aguarda o fim do seu <clinit>.
+     * @param className O nome qualificado da classe (e.g. java/lang/Object).
+     * @result O ponteiro para \c ClassFile da classe carregada.
+     */
+    ClassRuntime* loadClassNamed(Symbol className);
+    
     /**
      * @brief Carrega a classe com o nome dado e a adiciona na área de métodos.
      * @param className O nome da classe (contendo o sufixo .class ou não).
@@ -40,10 +54,68 @@ public:
     
     /**
      * @brief Busca por uma classe com o nome qualificado passado (e.g. java/lang/Object).
+     *
+     * A busca não adquire nenhum lock, e pode ser feita em paralelo com o carregamento de outras classes.
      * @param className O nome qualificado da classe que será buscado.
      * @return Um ponteiro para a classe será retornado caso ela exista, e \c NULL caso contrário.
      */
-    ClassRuntime* getClassNamed(const string &className);
+    ClassRuntime* getClassNamed(Symbol className);
+    
+    /**
+     * @brief Inicia um novo escopo de carregamento: as classes carregadas a partir de então (exceto as do pacote java/)
+     * pertencem a ele, até a chamada de \c endScope.
+     * @param name O nome do escopo (e.g. a classe de entrada do job).
+     * @return O escopo criado.
+     */
+    LoaderScope* beginScope(const string &name);
+    
+    /**
+     * @brief Encerra o escopo atual; as classes carregadas a partir de então pertencem ao escopo de boot.
+     */
+    void endScope();
+    
+    /**
+     * @brief Descarrega os escopos que não são mais alcançáveis.
+     *
+     * Partindo dos fields estáticos das classes do escopo de boot (e do escopo atual), são percorridos todos os objetos
+     * alcançáveis; um escopo é alcançável se algum objeto alcançável é instância de uma de suas classes, e nesse caso
+     * os fields estáticos das classes do escopo também passam a ser percorridos. Os escopos restantes são
+     * descarregados: as suas instâncias são removidas da heap e as suas classes (metadados, código e fields estáticos)
+     * são liberadas, podendo ser carregadas novamente depois.
+     *
+     * Somente pode ser chamado quando não há código em execução (a pilha da JVM está vazia), e.g. entre dois jobs.
+     * @return A quantidade de classes descarregadas.
+     */
+    size_t unloadUnreachableScopes();
+    
+    /**
+     * @brief Adiciona todas as classes carregadas (de todos os escopos) no vetor dado. Usado pela coleta de lixo, cujas
+     * raízes incluem os fields estáticos das classes.
+     */
+    void getLoadedClasses(vector<ClassRuntime*> &classes);
+    
+    /**
+     * @brief Define se o carregamento e o descarregamento de classes são informados na saída padrão (-verbose:class).
+     * @param verbose \c true para informar.
+     */
+    void setVerbose(bool verbose);
+    
+    /**
+     * @brief Marca a inicialização da classe como terminada, liberando as threads que aguardam o seu <clinit>.
+     *
+     * Chamado quando o frame do <clinit> é removido da pilha.
+     * @param classRuntime A classe inicializada.
+     */
+    void finishInitialization(ClassRuntime *classRuntime);
+    
+    /**
+     * @brief Informa se alguma thread aguarda o fim do <clinit> de uma classe inicializada pela thread dada.
+     *
+     * Essa espera adia a coleta de lixo até o fim do <clinit> (ver \c GarbageCollector::enterUnsafeWait), portanto
+     * nenhuma coleta pode liberar memória para a thread dada até lá.
+     * @param threadId O identificador da thread Java que inicializa as classes.
+     */
+    bool hasInitializationWaiters(uintptr_t threadId);
     
 private:
     /**
@@ -54,6 +126,24 @@ private:
     MethodArea(MethodArea const&); // não permitir implementação do construtor de cópia
     void operator=(MethodArea const&); // não permitir implementação do operador de igual
     
+    /**
+     * Uma posição da tabela de classes. \c classRuntime é gravado antes de \c name, portanto quem encontra o nome
+     * sempre encontra a classe.
+     */
+    struct ClassTableSlot {
+        atomic<Symbol> name;
+        atomic<ClassRuntime*> classRuntime;
+    };
+    
+    /**
+     * Tabela hash de endereçamento aberto (sondagem linear). A capacidade é sempre uma potência de 2.
+     */
+    struct ClassTable {
+        size_t capacity;
+        size_t count;
+        ClassTableSlot *slots;
+    };
+    
     /**
      * @brief Adiciona uma classe à área de métodos.
      * @param classFile A classe que será adicionada.
@@ -62,11 +152,77 @@ private:
     bool addClass(ClassRuntime *classFile);
     
     /**
-     * Um \c map contendo todas as classes presentes na área de métodos.
-     *
-     * A chave do map é o nome qualificado da classe, e o valor é um ponteiro para o \c ClassFile correspondente.
+     * @brief Obtém a classe associada ao nome na tabela, ou \c NULL caso ela não exista.
+     */
+    ClassRuntime* lookup(Symbol className);
+    
+    /**
+     * @brief Associa um valor ao nome na tabela, aumentando a tabela caso necessário. Deve ser chamado com \c _mutex adquirido.
+     */
+    void insert(Symbol className, ClassRuntime *classRuntime);
+    
+    /**
+     * @brief Cria uma tabela vazia com a capacidade dada.
+     */
+    static ClassTable* newTable(size_t capacity);
+    
+    /**
+     * @brief Aguarda o fim da inicialização de uma classe, caso ela esteja sendo inicializada por outra thread.
+     */
+    void waitForInitialization(ClassRuntime *classRuntime);
+    
+    /**
+     * A tabela de classes presentes na área de métodos, cuja chave é o símbolo do nome qualificado da classe.
+     */
+    atomic<ClassTable*> _table;
+    
+    /**
+     * Tabelas substituídas por tabelas maiores. Não são liberadas enquanto a JVM executa, pois leituras sem lock podem
+     * estar em andamento nelas.
+     */
+    vector<ClassTable*> _retiredTables;
+    
+    /**
+     * Serializa as inserções na tabela.
+     */
+    mutex _mutex;
+    
+    /**
+     * Serializa o carregamento de classes que ainda não estão na tabela, para que cada classe seja carregada (e
+     * inicializada) por uma única thread.
+     */
+    mutex _loadMutex;
+    
+    /**
+     * Sinalizada (com \c _mutex) quando a inicialização de uma classe termina.
+     */
+    condition_variable _classInitialized;
+    
+    /**
+     * As classes cuja inicialização é aguardada por outras threads (uma entrada por thread em espera), protegidas por
+     * \c _mutex.
+     */
+    vector<ClassRuntime*> _awaitedClasses;
+    
+    /**
+     * O escopo de boot, que nunca é descarregado.
+     */
+    LoaderScope *_bootScope;
+    
+    /**
+     * O escopo ao qual as classes carregadas no momento pertencem.
+     */
+    LoaderScope *_currentScope;
+    
+    /**
+     * Os escopos de jobs ainda carregados.
+     */
+    vector<LoaderScope*> _scopes;
+    
+    /**
+     * Indica se o carregamento e o descarregamento de classes são informados.
      */
-    map<string, ClassRuntime*> _classes;
+    bool _verbose;
 };
 
 #endif /* methodarea_h */
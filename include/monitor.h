@@ -0,0 +1,127 @@
+#ifndef monitor_h
+#define monitor_h
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Monitores dos objetos (monitorenter/monitorexit, métodos ACC_SYNCHRONIZED e Object.wait/notify/notifyAll).
+ *
+ * Cada objeto (e cada classe, para os métodos estáticos sincronizados) possui uma palavra de lock, que pode estar em
+ * um de três estados, indicados pelos 2 bits menos significativos:
+ *
+ * - 00 (livre): a palavra vale 0;
+ * - 01 (thin lock): os bits a partir do 10º guardam o identificador da thread dona e os bits 2 a 9 a quantidade de
+ *   reentradas. Adquirir um lock livre custa um único CAS, e as reentradas e a liberação são feitas somente pela
+ *   thread dona, com escritas simples;
+ * - 10 (inflado): a palavra aponta para um monitor completo (\c FatMonitor), com mutex e variáveis de condição.
+ *
+ * Quando uma thread encontra o lock com outra dona, ela aguarda (girando e depois cedendo o processador) até que o lock
+ * seja liberado, o adquire e então o infla, pois a contenção indica que ele voltará a ser disputado; a partir daí as
+ * threads que o disputam são bloqueadas no monitor completo. O lock também é inflado pela dona quando ela chama
+ * wait/notify ou excede o limite de reentradas. Um lock inflado nunca volta a ser thin.
+ *
+ * A dona de um lock é a thread Java (identificada pela sua \c VMStack), e não a thread do sistema operacional. As
+ * threads verdes (ver \c Scheduler) não bloqueiam: elas usam \c tryEnter e \c waitOrPark, e são estacionadas no
+ * endereço da palavra de lock (ou do monitor completo, em Object.wait) até que \c exit ou \c notify as acordem.
+ */
+class Monitor {
+
+public:
+    /**
+     * @brief Adquire o lock (monitorenter), bloqueando a thread enquanto ele pertencer a outra thread.
+     * @param lockWord A palavra de lock do objeto.
+     */
+    static void enter(atomic<uintptr_t> &lockWord);
+
+    /**
+     * @brief Tenta adquirir o lock sem bloquear a thread.
+     * @param lockWord A palavra de lock do objeto.
+     * @return \c true caso o lock tenha sido adquirido, ou \c false caso ele pertença a outra thread.
+     */
+    static bool tryEnter(atomic<uintptr_t> &lockWord);
+
+    /**
+     * @brief Libera o lock (monitorexit). Caso a thread atual não seja a dona, é emitido um IllegalMonitorStateException.
+     * @param lockWord A palavra de lock do objeto.
+     */
+    static void exit(atomic<uintptr_t> &lockWord);
+
+    /**
+     * @brief Libera o lock e aguarda uma notificação (Object.wait), adquirindo o lock novamente em seguida.
+     * @param lockWord A palavra de lock do objeto.
+     * @param millis O tempo máximo de espera, em milissegundos (0 para esperar indefinidamente).
+     */
+    static void wait(atomic<uintptr_t> &lockWord, int64_t millis);
+
+    /**
+     * @brief Object.wait em uma thread verde. Na primeira chamada o lock é liberado e a thread é estacionada; nas
+     * chamadas seguintes (após a notificação, o fim do prazo ou um despertar espúrio) o lock é readquirido.
+     * @param lockWord A palavra de lock do objeto.
+     * @param millis O tempo máximo de espera, em milissegundos (0 para esperar indefinidamente).
+     * @return \c true quando o lock foi readquirido, ou \c false caso a thread tenha sido estacionada (a instrução é repetida).
+     */
+    static bool waitOrPark(atomic<uintptr_t> &lockWord, int64_t millis);
+
+    /**
+     * @brief Acorda uma (Object.notify) ou todas (Object.notifyAll) as threads que aguardam no objeto.
+     * @param lockWord A palavra de lock do objeto.
+     * @param all \c true para acordar todas as threads.
+     */
+    static void notify(atomic<uintptr_t> &lockWord, bool all);
+
+    /**
+     * @brief Libera o monitor completo associado à palavra de lock, caso exista. Chamado quando o objeto é destruído.
+     * @param lockWord A palavra de lock do objeto.
+     */
+    static void release(atomic<uintptr_t> &lockWord);
+
+private:
+    Monitor(); // não permitir instâncias
+
+    /**
+     * Monitor completo, usado após a inflação do lock.
+     */
+    struct FatMonitor {
+        mutex monitorMutex;
+        condition_variable entryCondition; // threads aguardando o lock
+        condition_variable waitCondition; // threads em Object.wait
+        uintptr_t owner; // identificador da thread dona (0 caso livre)
+        uintptr_t recursions; // quantidade de aquisições pela dona
+    };
+
+    /**
+     * @brief Obtém o identificador (diferente de 0) da thread Java atual.
+     */
+    static uintptr_t currentThreadId();
+
+    /**
+     * @brief Aquisição com contenção ou com o lock inflado.
+     */
+    static void enterSlow(atomic<uintptr_t> &lockWord);
+
+    /**
+     * @brief Infla o lock thin pertencente à thread atual, preservando a quantidade de reentradas.
+     * @return O monitor completo criado.
+     */
+    static FatMonitor* inflate(atomic<uintptr_t> &lockWord, uintptr_t word);
+
+    /**
+     * @brief Obtém o monitor completo de um lock que pertence à thread atual, inflando-o caso seja thin. Caso a thread
+     * atual não seja a dona, é emitido um IllegalMonitorStateException.
+     */
+    static FatMonitor* ownedFatMonitor(atomic<uintptr_t> &lockWord);
+
+    /**
+     * @brief Acorda as threads verdes estacionadas aguardando o lock, após a sua liberação.
+     */
+    static void unparkEntrants(atomic<uintptr_t> &lockWord);
+
+    static void illegalMonitorState();
+};
+
+#endif /* monitor_h */
@@ -3,16 +3,115 @@
 
 #include "tipos.h"
 
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * Bits da palavra de classe de um objeto (ver \c Object::getClassWord) usados pela heap e pela coleta de lixo.
+ *
+ * Um espaço livre da heap é coberto por uma única palavra com \c OBJECT_FREE, contendo o tamanho do espaço.
+ */
+#define OBJECT_FREE 0x1
+
+/**
+ * As marcas de objeto alcançável, alternadas a cada coleta (ver \c Heap::beginMarking): com a marcação concorrente, os
+ * objetos alocados durante a varredura recebem a marca da coleta atual, que não é confundida com a marca da coleta
+ * seguinte.
+ */
+#define OBJECT_MARK_EVEN 0x2
+#define OBJECT_MARK_ODD 0x4
+#define OBJECT_MARKS (OBJECT_MARK_EVEN | OBJECT_MARK_ODD)
+
+/**
+ * O tipo do objeto (\c ObjectType) ocupa os bits a partir de \c OBJECT_KIND_SHIFT da palavra de classe. Os bits entre
+ * os bits da coleta de lixo e o tipo contêm a \c ClassRuntime de uma instância, ou o tipo dos elementos de um array.
+ */
+#define OBJECT_KIND_SHIFT 56
+#define OBJECT_PAYLOAD_MASK (((((uintptr_t) 1) << OBJECT_KIND_SHIFT) - 1) & ~((uintptr_t) 7))
+
 /**
  * Interface utilizada para todos elementos que se caracterizam como objetos, como: instância de classe e arrays.
+ *
+ * O cabeçalho de um objeto possui somente duas palavras: a palavra de classe (o tipo do objeto, a sua classe e os bits
+ * da coleta de lixo) e a palavra de lock. Não há métodos virtuais: o tipo do objeto é lido da palavra de classe, e os
+ * dados do objeto (os fields de uma instância, os elementos de um array) ficam logo após o cabeçalho, na mesma
+ * alocação.
+ *
+ * Os objetos são sempre alocados na \c Heap (na TLAB da thread que os cria).
  */
 class Object {
 public:
     /**
-     * @brief Método utilizado para declaração do tipo de objeto.
+     * @brief Construtor padrão. O objeto é criado com o lock livre.
+     * @param type O tipo do objeto.
+     * @param payload A classe da instância, ou o tipo dos elementos do array (deslocado de 3 bits).
+     */
+    Object(ObjectType type, uintptr_t payload);
+
+    /**
+     * @brief Destrutor padrão. Libera o monitor do objeto, caso o seu lock tenha sido inflado.
+     */
+    ~Object();
+
+    /**
+     * @brief Aloca o objeto na TLAB da thread atual.
+     */
+    static void* operator new(size_t size);
+
+    /**
+     * @brief Par do \c operator \c new, usado somente caso o construtor do objeto lance uma exceção: a memória é
+     * coberta por uma palavra com \c OBJECT_FREE, e é reaproveitada pela próxima varredura.
+     */
+    static void operator delete(void *memory, size_t size);
+
+    /**
+     * @brief Obtém o tipo do objeto.
      * @return O tipo de objeto.
      */
-    virtual ObjectType objectType() = 0;
+    ObjectType objectType() {
+        return (ObjectType) (_classWord.load(memory_order_relaxed) >> OBJECT_KIND_SHIFT);
+    }
+
+    /**
+     * @brief Obtém a quantidade de bytes que o objeto ocupa na heap (cabeçalho e dados).
+     */
+    size_t getHeapSize();
+
+    /**
+     * @brief Obtém a palavra de classe do objeto, cujos bits \c OBJECT_MARKS são alterados pela coleta de lixo.
+     * @return A palavra de classe.
+     */
+    atomic<uintptr_t>& getClassWord() {
+        return _classWord;
+    }
+
+    /**
+     * @brief Obtém a palavra de lock do objeto, usada pelo \c Monitor.
+     * @return A palavra de lock.
+     */
+    atomic<uintptr_t>& getLockWord();
+
+protected:
+    /**
+     * @brief Obtém os bits da palavra de classe entre os bits da coleta de lixo e o tipo do objeto.
+     */
+    uintptr_t getPayload() {
+        return _classWord.load(memory_order_relaxed) & OBJECT_PAYLOAD_MASK;
+    }
+
+private:
+    /**
+     * A palavra de classe do objeto.
+     */
+    atomic<uintptr_t> _classWord;
+
+    /**
+     * A palavra de lock do objeto (ver \c Monitor).
+     */
+    atomic<uintptr_t> _lockWord;
 };
 
 #endif // object_h
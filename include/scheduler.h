@@ -0,0 +1,320 @@
+#ifndef scheduler_h
+#define scheduler_h
+
+#include "classinstance.h"
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+using namespace std;
+
+class VMStack;
+
+/**
+ * Quantidade máxima de instruções executadas por uma thread verde antes de ceder a thread do sistema operacional.
+ */
+#define GREEN_TIME_SLICE 10000
+
+/**
+ * Estado de uma thread verde.
+ */
+enum GreenThreadState {
+    GREEN_RUNNABLE, // na fila de uma thread trabalhadora
+    GREEN_RUNNING, // em execução em uma thread trabalhadora
+    GREEN_PARKING, // em execução, mas já registrada como estacionada: deixará a thread trabalhadora ao fim da instrução
+    GREEN_PARKED // estacionada, aguardando \c unpark ou o fim do prazo
+};
+
+/**
+ * Uma thread Java executada como thread verde: a sua pilha (frames alocados na heap) é uma continuação que pode ser
+ * suspensa entre duas instruções e retomada em qualquer thread trabalhadora.
+ */
+struct GreenThread {
+    ClassInstance *threadObject;
+    VMStack *stack;
+    atomic<int> state; // GreenThreadState
+    bool yieldRequested; // Thread.yield(): a thread cede a thread trabalhadora ao fim da instrução
+
+    const void *parkKey; // o endereço em que a thread está estacionada (\c NULL caso aguarde somente o prazo)
+    bool hasDeadline;
+    chrono::steady_clock::time_point deadline;
+
+    // Thread.sleep em andamento
+    bool sleeping;
+    chrono::steady_clock::time_point sleepDeadline;
+
+    // Object.wait em andamento: a thread aguarda a notificação ou readquire o lock
+    bool waiting;
+    uintptr_t savedRecursions;
+};
+
+/**
+ * Escalonador das threads verdes (M:N), ativado com \c -XX:GreenThreads=N.
+ *
+ * As threads Java iniciadas com \c Thread.start() deixam de ter uma thread do sistema operacional própria: cada uma
+ * possui somente a sua \c VMStack, e N threads trabalhadoras executam as threads verdes, até \c GREEN_TIME_SLICE
+ * instruções por vez. Cada thread trabalhadora possui a sua própria fila, da qual retira as threads na ordem em que
+ * foram adicionadas; quando a sua fila está vazia, ela rouba a thread adicionada mais recentemente na fila de outra
+ * thread trabalhadora (work stealing). Uma thread verde criada por outra é adicionada na fila da thread trabalhadora
+ * atual.
+ *
+ * Uma operação que bloquearia a thread (disputa de um lock, Object.wait, Thread.join e Thread.sleep) estaciona a
+ * thread verde (\c park) sem concluir a instrução, que é repetida quando a thread é acordada (\c unpark, de forma
+ * semelhante a um futex) ou quando o prazo termina; assim a thread trabalhadora passa a executar outra thread verde.
+ * As esperas internas da JVM que não podem ser interrompidas no meio da instrução (o <clinit> de uma classe executado
+ * por outra thread) bloqueiam a thread trabalhadora, e uma thread trabalhadora extra é criada enquanto isso
+ * (\c enterBlocking e \c leaveBlocking).
+ *
+ * A thread do método main continua sendo executada na thread principal do sistema operacional.
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class Scheduler {
+
+public:
+    /**
+     * @brief Obter a única instância do Scheduler.
+     * @return A instância do Scheduler.
+     */
+    static Scheduler& getInstance() {
+        static Scheduler instance;
+        return instance;
+    }
+
+    /**
+     * @brief Destrutor padrão. Encerra as threads trabalhadoras.
+     */
+    ~Scheduler();
+
+    /**
+     * @brief Inicia as threads trabalhadoras. Enquanto não for chamado, as threads Java usam threads do sistema operacional.
+     * @param workersCount A quantidade de threads trabalhadoras.
+     */
+    void start(unsigned int workersCount);
+
+    /**
+     * @brief Indica se as threads Java iniciadas são executadas como threads verdes.
+     */
+    bool isEnabled();
+
+    /**
+     * @brief Obtém a thread verde em execução na thread do sistema operacional atual.
+     * @return A thread verde, ou \c NULL caso a thread atual não esteja executando uma thread verde.
+     */
+    static GreenThread* currentGreenThread() {
+        return _currentGreenThread;
+    }
+
+    /**
+     * @brief Indica se existe alguma thread verde estacionada (verificação rápida antes de \c unparkAll).
+     */
+    static bool hasParkedThreads() {
+        return _parkedCount.load(memory_order_acquire) > 0;
+    }
+
+    /**
+     * @brief Cria uma thread verde que executa o método run() do objeto e a adiciona em uma fila.
+     * @param threadObject O objeto da thread.
+     */
+    void spawn(ClassInstance *threadObject);
+
+    /**
+     * @brief Estaciona a thread verde atual no endereço dado. A instrução atual não deve ser concluída, e será repetida
+     * quando a thread for acordada.
+     *
+     * Para que nenhuma notificação seja perdida, a condição aguardada deve ser verificada novamente após esta chamada,
+     * e \c cancelPark deve ser chamado caso ela já esteja satisfeita.
+     * @param key O endereço em que a thread aguarda.
+     */
+    void park(const void *key);
+
+    /**
+     * @brief Estaciona a thread verde atual no endereço dado (que pode ser \c NULL) até, no máximo, o prazo dado.
+     * @param key O endereço em que a thread aguarda.
+     * @param deadline O prazo.
+     */
+    void parkUntil(const void *key, chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Desfaz o \c park da thread verde atual, cuja condição já está satisfeita.
+     */
+    void cancelPark();
+
+    /**
+     * @brief Acorda uma das threads verdes estacionadas no endereço dado.
+     * @return \c true caso alguma thread tenha sido acordada.
+     */
+    bool unparkOne(const void *key);
+
+    /**
+     * @brief Acorda todas as threads verdes estacionadas no endereço dado.
+     */
+    void unparkAll(const void *key);
+
+    /**
+     * @brief Thread.sleep em uma thread verde.
+     * @param millis O tempo, em milissegundos.
+     * @return \c true quando o tempo terminou, ou \c false caso a thread tenha sido estacionada (a instrução é repetida).
+     */
+    bool sleep(int64_t millis);
+
+    /**
+     * @brief Thread.yield em uma thread verde: a thread volta para o fim da fila ao fim da instrução.
+     */
+    void yield();
+
+    /**
+     * @brief Indica que a thread trabalhadora atual será bloqueada (e.g. aguardando o <clinit> de outra thread),
+     * criando uma thread trabalhadora extra enquanto isso.
+     */
+    void enterBlocking();
+
+    /**
+     * @brief Indica o fim do bloqueio iniciado com \c enterBlocking.
+     */
+    void leaveBlocking();
+
+private:
+    /**
+     * @brief Construtor padrão.
+     */
+    Scheduler();
+
+    Scheduler(Scheduler const&); // não permitir implementação do construtor de cópia
+    void operator=(Scheduler const&); // não permitir implementação do operador de igual
+
+    /**
+     * A fila de uma thread trabalhadora. A dona retira as threads do início, e as demais roubam do fim.
+     */
+    struct WorkerQueue {
+        mutex queueMutex;
+        deque<GreenThread*> threads;
+    };
+
+    /**
+     * @brief Laço de cada thread trabalhadora.
+     * @param index O índice da fila da thread trabalhadora.
+     * @param extra \c true para uma thread criada por \c enterBlocking, que termina quando o bloqueio termina.
+     */
+    void workerLoop(unsigned int index, bool extra);
+
+    /**
+     * @brief Executa uma thread verde por uma fatia de tempo e a recoloca em uma fila, estaciona ou a finaliza.
+     */
+    void run(GreenThread *greenThread, unsigned int index);
+
+    /**
+     * @brief Obtém a próxima thread verde: da fila dada ou, caso ela esteja vazia, roubando de outra fila.
+     * @return A thread, ou \c NULL caso todas as filas estejam vazias.
+     */
+    GreenThread* takeWork(unsigned int index);
+
+    /**
+     * @brief Adiciona a thread na fila dada e acorda uma thread trabalhadora ociosa. Deve ser chamado sem \c _mutex.
+     */
+    void enqueue(GreenThread *greenThread, unsigned int index);
+
+    /**
+     * @brief Adiciona a thread na fila dada. Deve ser chamado com \c _mutex adquirido.
+     */
+    void enqueueLocked(GreenThread *greenThread, unsigned int index);
+
+    /**
+     * @brief Escolhe a fila de uma thread que se torna executável: a da thread trabalhadora atual ou, fora das threads
+     * trabalhadoras, uma fila em rodízio.
+     */
+    unsigned int chooseQueue();
+
+    /**
+     * @brief Estaciona a thread verde atual. Deve ser chamado com \c _mutex adquirido.
+     */
+    void parkLocked(const void *key, bool hasDeadline, chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Remove a thread dos registros de threads estacionadas. Deve ser chamado com \c _mutex adquirido.
+     */
+    void removeParkedLocked(GreenThread *greenThread);
+
+    /**
+     * @brief Acorda uma thread estacionada (ou em vias de estacionar). Deve ser chamado com \c _mutex adquirido.
+     */
+    void unparkLocked(GreenThread *greenThread);
+
+    /**
+     * @brief Acorda as threads cujo prazo terminou. Deve ser chamado com \c _mutex adquirido.
+     */
+    void wakeExpiredLocked();
+
+    /**
+     * Protege as threads estacionadas, as threads trabalhadoras extras e a espera das threads trabalhadoras ociosas.
+     */
+    mutex _mutex;
+
+    /**
+     * Sinalizada quando uma thread verde é adicionada em uma fila ou quando as threads trabalhadoras devem ser encerradas.
+     */
+    condition_variable _workAvailable;
+
+    /**
+     * As filas das threads trabalhadoras (uma por thread trabalhadora criada em \c start).
+     */
+    vector<WorkerQueue*> _queues;
+
+    /**
+     * Quantidade de threads verdes nas filas.
+     */
+    atomic<int> _queuedCount;
+
+    /**
+     * Fila usada para as threads verdes criadas fora das threads trabalhadoras (distribuídas em rodízio).
+     */
+    atomic<unsigned int> _nextQueue;
+
+    /**
+     * As threads estacionadas em um endereço.
+     */
+    multimap<const void*, GreenThread*> _parkedByKey;
+
+    /**
+     * As threads estacionadas com prazo, ordenadas pelo prazo.
+     */
+    multimap<chrono::steady_clock::time_point, GreenThread*> _parkedByDeadline;
+
+    /**
+     * Quantidade de threads verdes estacionadas.
+     */
+    static atomic<int> _parkedCount;
+
+    vector<thread> _workers;
+
+    /**
+     * Quantidade de threads trabalhadoras bloqueadas (entre \c enterBlocking e \c leaveBlocking).
+     */
+    unsigned int _blockedWorkers;
+
+    /**
+     * Quantidade de threads trabalhadoras extras em execução.
+     */
+    unsigned int _runningExtraWorkers;
+
+    atomic<bool> _stopping;
+
+    /**
+     * A thread verde em execução na thread do sistema operacional atual.
+     */
+    static thread_local GreenThread *_currentGreenThread;
+
+    /**
+     * O índice da fila da thread trabalhadora atual (-1 caso a thread atual não seja uma thread trabalhadora).
+     */
+    static thread_local int _currentQueue;
+};
+
+#endif /* scheduler_h */
@@ -0,0 +1,177 @@
+#ifndef sharedarchive_h
+#define sharedarchive_h
+
+#include "tipos.h"
+#include "classpath.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+#define SHARED_ARCHIVE_MAGIC 0x4A534121 // "JSA!"
+#define SHARED_ARCHIVE_VERSION 6
+#define SHARED_ARCHIVE_DEFAULT_FILE "classes.jsa"
+
+/**
+ * Cabeçalho do arquivo de compartilhamento de classes (class data sharing).
+ *
+ * Todas as posições são relativas ao início do arquivo. Os ponteiros das estruturas arquivadas são gravados como
+ * posições no arquivo e corrigidos (relocados) quando ele é mapeado, e os campos \c symbol das constantes UTF-8 são
+ * gravados vazios e preenchidos com os símbolos da \c SymbolTable.
+ *
+ * O class path usado na geração e a identificação (\c ClassFileStamp) do arquivo .class de cada classe são gravados
+ * para que o arquivo não seja usado com classes diferentes das arquivadas.
+ */
+struct SharedArchiveHeader {
+    u4 magic;
+    u4 version;
+    u4 pointerSize; // sizeof(void*) de quem gerou o arquivo
+    u4 archiveLength;
+    u4 classesCount;
+    u4 classesOffset; // vetor de ponteiros para ClassFile
+    u4 stampsOffset; // vetor de ClassFileStamp, na mesma ordem das classes
+    u4 classPathLength;
+    u4 classPathOffset; // bytes do class path usado na geração
+    u4 relocationsCount;
+    u4 relocationsOffset; // vetor de u4 com a posição de cada ponteiro
+    u4 symbolsCount;
+    u4 symbolsOffset; // sequência de (u4 tamanho, bytes) de cada símbolo
+    u4 symbolFixupsCount;
+    u4 symbolFixupsOffset; // vetor de pares de u4 (posição do campo, índice do símbolo)
+};
+
+/**
+ * Arquivo de compartilhamento de classes, que guarda as estruturas \c ClassFile já processadas de um conjunto de classes.
+ *
+ * Com \c -Xshare:dump, as classes dadas (e as classes referenciadas por elas que forem encontradas no class path)
+ * são lidas e gravadas em um único arquivo relocável. Com \c -Xshare:on, o arquivo é mapeado em memória, os ponteiros
+ * são corrigidos para o endereço do mapeamento e as classes passam a ser obtidas dele, sem leitura dos arquivos .class.
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class SharedArchive {
+
+public:
+    /**
+     * @brief Obter a única instância do SharedArchive.
+     * @return A instância do SharedArchive.
+     */
+    static SharedArchive& getInstance() {
+        static SharedArchive instance;
+        return instance;
+    }
+
+    /**
+     * @brief Destrutor padrão.
+     */
+    ~SharedArchive();
+
+    /**
+     * @brief Lê as classes dadas e as classes referenciadas por elas, e grava o arquivo de compartilhamento.
+     * @param classNames Os nomes das classes (contendo o sufixo .class ou não).
+     * @param path O caminho do arquivo que será gerado.
+     */
+    void dump(const vector<string> &classNames, const string &path);
+
+    /**
+     * @brief Mapeia o arquivo de compartilhamento e registra as classes contidas nele.
+     *
+     * Caso o arquivo não exista, seja incompatível ou esteja corrompido (uma tabela fora do arquivo), o programa é
+     * encerrado. Caso ele tenha sido gerado com outro
+     * class path, ele é ignorado, e as classes cujo arquivo .class foi alterado desde a geração não são registradas:
+     * essas classes são lidas do class path normalmente.
+     * @param path O caminho do arquivo.
+     */
+    void load(const string &path);
+
+    /**
+     * @brief Busca uma classe no arquivo de compartilhamento carregado.
+     * @param className O nome qualificado da classe (e.g. java/lang/Object).
+     * @return A classe, ou \c NULL caso ela não esteja no arquivo (ou nenhum arquivo tenha sido carregado).
+     */
+    ClassFile* getSharedClass(const string &className);
+
+private:
+    /**
+     * @brief Construtor padrão.
+     */
+    SharedArchive();
+
+    SharedArchive(SharedArchive const&); // não permitir implementação do construtor de cópia
+    void operator=(SharedArchive const&); // não permitir implementação do operador de igual
+
+    /**
+     * @brief Reserva espaço (zerado e alinhado) no final da imagem sendo gravada.
+     * @param size A quantidade de bytes.
+     * @return A posição do espaço reservado.
+     */
+    u4 allocate(size_t size);
+
+    /**
+     * @brief Copia bytes para o final da imagem sendo gravada.
+     * @return A posição dos bytes copiados.
+     */
+    u4 copy(const void *source, size_t size);
+
+    /**
+     * @brief Grava um ponteiro na imagem e registra a sua posição para a relocação.
+     * @param at A posição do campo do ponteiro.
+     * @param target A posição apontada.
+     */
+    void setPointer(u4 at, u4 target);
+
+    /**
+     * @brief Registra que o campo na posição dada deve receber o símbolo correspondente na carga do arquivo.
+     */
+    void setSymbol(u4 at, Symbol symbol);
+
+    /**
+     * @brief Verifica se as tabelas do arquivo mapeado (class path, relocações, símbolos, classes e carimbos) estão
+     * contidas no arquivo, assim como as posições e os alvos das relocações e dos símbolos.
+     * @param base O início do mapeamento, cujo tamanho é \c header->archiveLength.
+     * @return \c true caso o arquivo possa ser usado, e \c false caso contrário (arquivo corrompido ou truncado).
+     */
+    bool isValid(const u1 *base, const SharedArchiveHeader *header);
+
+    /**
+     * @brief Grava um \c ClassFile e todas as estruturas apontadas por ele.
+     * @return A posição do \c ClassFile gravado.
+     */
+    u4 writeClassFile(ClassFile *classFile);
+
+    /**
+     * @brief Grava um vetor de atributos e as estruturas apontadas por eles.
+     * @return A posição do vetor gravado, ou 0 caso o vetor seja vazio.
+     */
+    u4 writeAttributes(ClassFile *classFile, attribute_info *attributes, u2 count);
+
+    /**
+     * A imagem do arquivo sendo gravado.
+     */
+    vector<u1> _image;
+
+    /**
+     * As posições dos ponteiros da imagem sendo gravada.
+     */
+    vector<u4> _relocations;
+
+    /**
+     * Os símbolos referenciados pela imagem sendo gravada, e o índice de cada um.
+     */
+    vector<Symbol> _symbols;
+    unordered_map<Symbol, u4> _symbolIndexes;
+
+    /**
+     * Pares (posição do campo, índice do símbolo) da imagem sendo gravada.
+     */
+    vector<u4> _symbolFixups;
+
+    /**
+     * As classes do arquivo carregado. A chave é o nome qualificado da classe.
+     */
+    unordered_map<string, ClassFile*> _sharedClasses;
+};
+
+#endif /* sharedarchive_h */
@@ -24,12 +24,6 @@ public:
      */
     ~StringObject();
     
-    /**
-     * @brief Obtém o tipo do objeto (string).
-     * @return O tipo do objeto.
-     */
-    ObjectType objectType();
-    
     /**
      * @brief Obtém a sequência de caracteres presente na string.
      * @return Retorna a string como uma std::string.
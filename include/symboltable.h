@@ -0,0 +1,72 @@
+#ifndef symboltable_h
+#define symboltable_h
+
+#include "tipos.h"
+
+#include <string>
+#include <unordered_set>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * Tabela de símbolos da JVM, que armazena uma única cópia de cada string UTF-8 (nomes, descritores, etc.).
+ *
+ * Como cada conteúdo é armazenado somente uma vez, dois símbolos são iguais se, e somente se, seus ponteiros forem iguais.
+ * Os símbolos nunca são removidos da tabela, e podem ser obtidos por várias threads (e.g. pelo \c ClassPreloader).
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class SymbolTable {
+
+public:
+    /**
+     * @brief Obter a única instância da SymbolTable.
+     * @return A instância da SymbolTable.
+     */
+    static SymbolTable& getInstance() {
+        static SymbolTable instance;
+        return instance;
+    }
+    
+    /**
+     * @brief Destrutor padrão.
+     */
+    ~SymbolTable();
+    
+    /**
+     * @brief Obtém o símbolo correspondente à string dada, adicionando-o à tabela caso ainda não exista.
+     * @param s O conteúdo do símbolo.
+     * @return O símbolo canônico.
+     */
+    Symbol intern(const string &s);
+    
+    /**
+     * @brief Obtém o símbolo correspondente aos bytes UTF-8 dados, adicionando-o à tabela caso ainda não exista.
+     * @param bytes Os bytes do símbolo.
+     * @param length A quantidade de bytes.
+     * @return O símbolo canônico.
+     */
+    Symbol intern(const u1 *bytes, u2 length);
+    
+private:
+    /**
+     * @brief Construtor padrão.
+     */
+    SymbolTable();
+    
+    SymbolTable(SymbolTable const&); // não permitir implementação do construtor de cópia
+    void operator=(SymbolTable const&); // não permitir implementação do operador de igual
+    
+    /**
+     * Conjunto que armazena o conteúdo de todos os símbolos. Os elementos de um \c unordered_set não mudam de endereço, portanto seus ponteiros podem ser usados como símbolos.
+     */
+    unordered_set<string> _symbols;
+    
+    /**
+     * Protege as inserções em \c _symbols.
+     */
+    mutex _mutex;
+};
+
+#endif /* symboltable_h */
@@ -0,0 +1,122 @@
+#ifndef threadmanager_h
+#define threadmanager_h
+
+#include "classinstance.h"
+
+#include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * Gerencia as threads Java (instâncias de java/lang/Thread ou de suas subclasses).
+ *
+ * Cada thread Java iniciada com \c Thread.start() é executada em uma thread do sistema operacional, com a sua própria
+ * pilha da JVM (\c VMStack), a partir do método run() do objeto. Com \c -XX:GreenThreads=N, as threads são executadas
+ * como threads verdes pelo \c Scheduler. A thread de execução do método main também é uma thread Java, cujo objeto é
+ * criado somente quando \c Thread.currentThread() é chamado nela.
+ *
+ * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ */
+class ThreadManager {
+
+public:
+    /**
+     * @brief Obter a única instância do ThreadManager.
+     * @return A instância do ThreadManager.
+     */
+    static ThreadManager& getInstance() {
+        static ThreadManager instance;
+        return instance;
+    }
+
+    /**
+     * @brief Destrutor padrão.
+     */
+    ~ThreadManager();
+
+    /**
+     * @brief Inicia a execução de uma thread Java (Thread.start()).
+     *
+     * Caso a thread já tenha sido iniciada, é emitido um IllegalThreadStateException.
+     * @param threadObject O objeto da thread.
+     */
+    void startThread(ClassInstance *threadObject);
+
+    /**
+     * @brief Aguarda o fim de uma thread Java (Thread.join()). Retorna imediatamente caso a thread não tenha sido iniciada.
+     *
+     * Em uma thread verde a espera não bloqueia: a thread é estacionada até o fim da thread aguardada.
+     * @param threadObject O objeto da thread.
+     * @return \c true caso a thread tenha terminado, ou \c false caso a thread verde atual tenha sido estacionada (a
+     * instrução é repetida).
+     */
+    bool joinThread(ClassInstance *threadObject);
+
+    /**
+     * @brief Marca a thread Java como terminada, liberando as threads que aguardam o seu fim.
+     * @param threadObject O objeto da thread.
+     */
+    void threadFinished(ClassInstance *threadObject);
+
+    /**
+     * @brief Indica se a thread Java foi iniciada e ainda não terminou (Thread.isAlive()).
+     * @param threadObject O objeto da thread.
+     */
+    bool isAlive(ClassInstance *threadObject);
+
+    /**
+     * @brief Obtém o objeto da thread Java atual (Thread.currentThread()).
+     * @return O objeto da thread.
+     */
+    ClassInstance* currentThread();
+
+    /**
+     * @brief Aguarda o fim de todas as threads Java iniciadas. Chamado quando o método main termina.
+     */
+    void joinAllThreads();
+
+    /**
+     * @brief Adiciona os objetos das threads Java iniciadas no vetor dado. Usado pela coleta de lixo.
+     */
+    void collectRoots(vector<Object*> &roots);
+
+private:
+    /**
+     * @brief Construtor padrão.
+     */
+    ThreadManager();
+
+    ThreadManager(ThreadManager const&); // não permitir implementação do construtor de cópia
+    void operator=(ThreadManager const&); // não permitir implementação do operador de igual
+
+    /**
+     * Uma thread Java iniciada.
+     */
+    struct JavaThread {
+        thread osThread; // não utilizada pelas threads verdes
+        bool finished;
+    };
+
+    /**
+     * @brief Executa o método run() de uma thread Java, na thread do sistema operacional criada por \c startThread.
+     */
+    void runThread(ClassInstance *threadObject);
+
+    mutex _mutex;
+
+    /**
+     * Sinalizada quando uma thread Java termina.
+     */
+    condition_variable _threadFinished;
+
+    /**
+     * As threads Java iniciadas, indexadas pelo objeto da thread.
+     */
+    map<ClassInstance*, JavaThread*> _threads;
+};
+
+#endif /* threadmanager_h */
@@ -2,6 +2,8 @@
 #define TIPOS_H
 
 #include <stdint.h>
+#include <string>
+#include <atomic>
 
 // Tipos de representação de dados da classe
 typedef uint8_t u1;
@@ -31,6 +33,7 @@ enum ValueType {
 typedef enum ValueType ValueType;
 
 class Object;
+class Arena;
 
 struct Value {
     ValueType printType; // usado para printar o valor de maneira correta (somente para int, short, byte, boolean)
@@ -50,6 +53,9 @@ struct Value {
 };
 typedef struct Value Value;
 
+// Símbolo: string UTF-8 canônica armazenada na SymbolTable (dois símbolos iguais possuem o mesmo ponteiro)
+typedef const std::string* Symbol;
+
 // Typedefs das estruturas de classe
 
 // ClassFile
@@ -68,6 +74,9 @@ typedef struct CONSTANT_Long_info CONSTANT_Long_info;
 typedef struct CONSTANT_Double_info CONSTANT_Double_info;
 typedef struct CONSTANT_NameAndType_info CONSTANT_NameAndType_info;
 typedef struct CONSTANT_Utf8_info CONSTANT_Utf8_info;
+typedef struct CONSTANT_MethodHandle_info CONSTANT_MethodHandle_info;
+typedef struct CONSTANT_MethodType_info CONSTANT_MethodType_info;
+typedef struct CONSTANT_InvokeDynamic_info CONSTANT_InvokeDynamic_info;
 
 // field_info
 typedef struct field_info field_info;
@@ -87,6 +96,9 @@ typedef struct LineNumberTable_attribute LineNumberTable_attribute;
 typedef struct LocalVariableTable LocalVariableTable;
 typedef struct LocalVariableTable_attribute LocalVariableTable_attribute;
 typedef struct Deprecated_attribute Deprecated_attribute;
+typedef struct verification_type_info verification_type_info;
+typedef struct stack_map_frame stack_map_frame;
+typedef struct StackMapTable_attribute StackMapTable_attribute;
 
 // method_info
 typedef struct method_info method_info;
@@ -110,6 +122,7 @@ struct ClassFile {
     method_info *methods;
     u2 attributes_count; 
     attribute_info *attributes;
+    Arena *arena; // arena de onde todas as estruturas da classe foram alocadas (NULL para classes do arquivo de compartilhamento)
 };
 
 struct field_info {
@@ -126,6 +139,22 @@ struct method_info {
     u2 descriptor_index;
     u2 attributes_count;
     attribute_info *attributes;
+    
+    // Os atributos do método só são processados quando o método é usado pela primeira vez (ver ClassLoader::parseMethodAttributes).
+    // Enquanto isso não acontece, attributes é NULL e attributes_bytes aponta para os bytes dos atributos no arquivo .class.
+    const u1 *attributes_bytes;
+    u4 attributes_length;
+    
+    // true depois que os atributos foram processados (publicado com release, para que os campos preenchidos sejam
+    // visíveis à thread que o lê com acquire).
+    std::atomic<bool> attributes_parsed;
+    
+    // Atributos Code e Exceptions do método (ou NULL), preenchidos junto com attributes.
+    Code_attribute *code;
+    Exceptions_attribute *exceptions;
+    
+    // Atributo StackMapTable do Code (ou NULL), usado pelo Verifier.
+    StackMapTable_attribute *stackMapTable;
 };
 
 typedef enum CONSTANT_Type {
@@ -140,6 +169,9 @@ typedef enum CONSTANT_Type {
     CONSTANT_Double = 6,
     CONSTANT_NameAndType = 12,
     CONSTANT_Utf8 = 1,
+    CONSTANT_MethodHandle = 15,
+    CONSTANT_MethodType = 16,
+    CONSTANT_InvokeDynamic = 18,
     CONSTANT_NULL = 0
 } CONSTANT_Type;
 
@@ -168,20 +200,24 @@ struct CONSTANT_String_info {
 
 struct CONSTANT_Integer_info {
     u4 bytes;
+    int32_t value; // valor já decodificado no carregamento da classe
 };
 
 struct CONSTANT_Float_info {
     u4 bytes;
+    float value; // valor já decodificado (reinterpretação dos bits IEEE 754) no carregamento da classe
 };
 
 struct CONSTANT_Long_info {
     u4 high_bytes;
     u4 low_bytes;
+    int64_t value; // valor já decodificado no carregamento da classe
 };
 
 struct CONSTANT_Double_info {
     u4 high_bytes;
     u4 low_bytes;
+    double value; // valor já decodificado (reinterpretação dos bits IEEE 754) no carregamento da classe
 };
 
 struct CONSTANT_NameAndType_info {
@@ -192,6 +228,21 @@ struct CONSTANT_NameAndType_info {
 struct CONSTANT_Utf8_info {
     u2 length;
     u1 *bytes;
+    Symbol symbol; // símbolo correspondente aos bytes, obtido no carregamento da classe
+};
+
+struct CONSTANT_MethodHandle_info {
+    u1 reference_kind;
+    u2 reference_index;
+};
+
+struct CONSTANT_MethodType_info {
+    u2 descriptor_index;
+};
+
+struct CONSTANT_InvokeDynamic_info {
+    u2 bootstrap_method_attr_index;
+    u2 name_and_type_index;
 };
 
 struct cp_info {
@@ -208,6 +259,9 @@ struct cp_info {
         CONSTANT_Double_info double_info;
         CONSTANT_NameAndType_info nameAndType_info;
         CONSTANT_Utf8_info utf8_info;
+        CONSTANT_MethodHandle_info methodHandle_info;
+        CONSTANT_MethodType_info methodType_info;
+        CONSTANT_InvokeDynamic_info invokeDynamic_info;
     } info;
 };
 
@@ -285,6 +339,41 @@ struct Deprecated_attribute {
     // vazio
 };
 
+typedef enum VERIFICATION_Type {
+    ITEM_Top = 0,
+    ITEM_Integer = 1,
+    ITEM_Float = 2,
+    ITEM_Double = 3,
+    ITEM_Long = 4,
+    ITEM_Null = 5,
+    ITEM_UninitializedThis = 6,
+    ITEM_Object = 7,
+    ITEM_Uninitialized = 8
+} VERIFICATION_Type;
+
+struct verification_type_info {
+    u1 tag;
+    u2 cpool_index; // ITEM_Object: índice da classe no pool de constantes
+    u2 offset; // ITEM_Uninitialized: posição da instrução new que criou o objeto
+};
+
+// Os frames são guardados no formato do arquivo .class (relativos ao frame anterior): frame_type identifica o tipo
+// do frame e somente os campos usados por este tipo são preenchidos (chop_frame guarda em number_of_locals a
+// quantidade de variáveis locais removidas).
+struct stack_map_frame {
+    u1 frame_type;
+    u2 offset_delta;
+    u2 number_of_locals;
+    verification_type_info *locals;
+    u2 number_of_stack_items;
+    verification_type_info *stack;
+};
+
+struct StackMapTable_attribute {
+    u2 number_of_entries;
+    stack_map_frame *entries;
+};
+
 struct attribute_info {
     u2 attribute_name_index;
     u4 attribute_length;
@@ -298,6 +387,7 @@ struct attribute_info {
         LineNumberTable_attribute lineNumberTable_info;
         LocalVariableTable_attribute localVariableTable_info;
         Deprecated_attribute deprecated_info;
+        StackMapTable_attribute stackMapTable_info;
     } info;
 };
 
@@ -39,6 +39,16 @@ public:
      * @return É retornado \c true caso a igualdade seja verdadeira, e \c false caso contrário.
      */
     static bool compareUtf8WithString(CONSTANT_Utf8_info constant, const char *str);
+    
+    /**
+     * Obtém o símbolo referenciado por um índice da pool de constantes.
+     *
+     * O índice pode referenciar diretamente uma \c CONSTANT_Utf8_info, ou então uma \c CONSTANT_Class_info ou \c CONSTANT_String_info, caso em que é retornado o símbolo do nome da classe ou do conteúdo da string.
+     * @param *constantPool A pool de constantes.
+     * @param index O índice na pool de constantes.
+     * @return O símbolo referenciado.
+     */
+    static Symbol getSymbol(cp_info *constantPool, u2 index);
 
     /**
      * Imprime uma dada quantidade de tabs.
@@ -0,0 +1,219 @@
+#ifndef verifier_h
+#define verifier_h
+
+#include "tipos.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Verificador de bytecode por checagem de tipos (JVMS §4.10.1), usado nas classes a partir da versão 50.
+ *
+ * O código do método é percorrido uma única vez, em ordem, simulando os tipos das variáveis locais e da pilha de
+ * operandos. Os frames do atributo StackMapTable dão o estado esperado em cada destino de desvio, início de tratador
+ * de exceção e instrução após um desvio incondicional, portanto não há iteração até um ponto fixo: em cada um desses
+ * pontos o estado atual somente é comparado com o frame declarado, que passa a ser o estado corrente.
+ *
+ * A relação de subtipos entre classes é conferida somente quando as classes envolvidas já estão carregadas na
+ * MethodArea (tipos de interface e classes ainda não carregadas são aceitos, e checados na execução).
+ */
+class Verifier {
+
+public:
+    /**
+     * @brief Verifica o código de um método cujos atributos já foram processados. Em caso de erro, é emitido um
+     * VerifyError e a execução é encerrada.
+     * @param *classFile A classe que contém o método.
+     * @param *method O método.
+     */
+    static void verifyMethod(ClassFile *classFile, method_info *method);
+
+private:
+    /**
+     * Tipo de verificação de uma variável local ou de um item da pilha de operandos.
+     *
+     * Valores long e double ocupam duas posições: o tipo ITEM_Long/ITEM_Double seguido de ITEM_Top.
+     */
+    struct Type {
+        u1 tag; // VERIFICATION_Type
+        Symbol className; // ITEM_Object: nome da classe (ou o descritor, para arrays)
+        u2 offset; // ITEM_Uninitialized: posição da instrução new
+
+        bool operator==(const Type &other) const {
+            return tag == other.tag && className == other.className && offset == other.offset;
+        }
+        bool operator!=(const Type &other) const {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * Estado declarado por um frame do StackMapTable, já expandido (uma posição por variável local).
+     */
+    struct StackMapState {
+        u4 offset;
+        vector<Type> locals;
+        vector<Type> stack;
+    };
+
+    /**
+     * @brief Construtor utilizado por \c verifyMethod.
+     */
+    Verifier(ClassFile *classFile, method_info *method);
+
+    /**
+     * @brief Percorre o código do método, verificando cada instrução.
+     */
+    void verify();
+
+    /**
+     * @brief Emite um VerifyError para o método sendo verificado e encerra a execução.
+     * @param pc A posição da instrução com erro.
+     * @param message A descrição do erro.
+     */
+    void fail(u4 pc, const string &message);
+
+    static Type makeType(u1 tag);
+    static Type makeObjectType(Symbol className);
+    static Type makeUninitializedType(u2 offset);
+
+    /**
+     * @brief Indica se o tipo ocupa duas posições (long e double).
+     */
+    static bool isCategory2(const Type &type);
+
+    /**
+     * @brief Indica se o tipo é uma referência (objeto, array, null ou objeto não inicializado).
+     */
+    static bool isReference(const Type &type);
+
+    /**
+     * @brief Converte um descritor de campo (ou um tipo de parâmetro de um descritor de método) em um tipo de verificação.
+     * @param descriptor O descritor.
+     * @param *position Posição do tipo no descritor; ao final, aponta para o caractere seguinte ao tipo.
+     * @return O tipo correspondente (byte, char, short e boolean são ITEM_Integer).
+     */
+    Type typeFromDescriptor(u4 pc, const string &descriptor, size_t *position);
+
+    /**
+     * @brief Converte uma estrutura verification_type_info do StackMapTable em um tipo de verificação.
+     */
+    Type typeFromVerificationInfo(u4 pc, const verification_type_info &info);
+
+    /**
+     * @brief Obtém o tipo dos elementos de um array (ou ITEM_Null, caso o array seja null).
+     */
+    Type componentType(u4 pc, const Type &arrayType);
+
+    /**
+     * @brief Verifica se um valor do tipo \c from pode ser usado onde é esperado o tipo \c to.
+     */
+    bool isAssignable(const Type &from, const Type &to);
+
+    /**
+     * @brief Verifica se a classe (ou array) \c from é subtipo de \c to.
+     */
+    bool isSubclass(Symbol from, Symbol to);
+
+    /**
+     * @brief Expande os frames do StackMapTable (relativos ao frame anterior) em estados completos.
+     */
+    void buildStackMapStates(const vector<Type> &initialLocals);
+
+    /**
+     * @brief Expande uma lista de tipos declarados (long e double contados uma vez) em uma posição por variável local.
+     */
+    vector<Type> expandLocals(u4 pc, const vector<Type> &declared);
+
+    /**
+     * @brief Verifica se o estado atual pode ser usado onde o frame declarado é esperado.
+     * @param pc A posição da instrução que desvia para o frame.
+     * @param target A posição do frame.
+     * @param stack A pilha de operandos no momento do desvio.
+     */
+    void checkTarget(u4 pc, u4 target, const vector<Type> &stack);
+
+    /**
+     * @brief Verifica, para cada tratador de exceção que cobre a instrução, se as variáveis locais atuais são
+     * compatíveis com o frame do tratador.
+     */
+    void checkHandlers(u4 pc);
+
+    Type pop(u4 pc);
+    Type pop(u4 pc, const Type &expected);
+    Type popReference(u4 pc);
+    void push(u4 pc, const Type &type);
+    Type getLocal(u4 pc, u4 index, const Type &expected);
+    void setLocal(u4 pc, u4 index, const Type &type);
+
+    /**
+     * @brief Verifica que a posição \c index da pilha (a partir da base) não separa as duas metades de um long/double.
+     */
+    void checkStackBoundary(u4 pc, size_t index);
+
+    /**
+     * @brief Substitui, nas variáveis locais e na pilha, um tipo não inicializado pelo tipo inicializado.
+     */
+    void initializeObject(const Type &uninitialized, const Type &initialized);
+
+    /**
+     * @brief Obtém o nome da classe referenciada por uma constante CONSTANT_Class.
+     */
+    Symbol getClassName(u4 pc, u2 index);
+
+    /**
+     * @brief Obtém a classe, o nome e o descritor referenciados por uma constante Fieldref/Methodref/InterfaceMethodref/InvokeDynamic.
+     * @param acceptedTags Máscara com os bits (1 << tag) das constantes aceitas no índice.
+     * @param *className A classe do membro (NULL para InvokeDynamic).
+     */
+    void getMemberReference(u4 pc, u2 index, u4 acceptedTags, Symbol *className, Symbol *name, Symbol *descriptor);
+
+    /**
+     * @brief Verifica se o tipo é um array cujos elementos são do tipo dado pelo descritor \c element ('L' para
+     * referências; 'B' aceita também arrays de boolean).
+     */
+    void checkArrayType(u4 pc, const Type &arrayType, char element);
+
+    /**
+     * @brief Verifica as instruções de acesso a campos (getstatic, putstatic, getfield e putfield).
+     */
+    void verifyFieldAccess(u4 pc, u1 opcode, u2 index);
+
+    /**
+     * @brief Verifica as instruções de invocação de métodos.
+     */
+    void verifyInvoke(u4 pc, u1 opcode, u2 index);
+
+    /**
+     * @brief Verifica as instruções de retorno.
+     */
+    void verifyReturn(u4 pc, u1 opcode);
+
+    u1 readU1(u4 pc, u4 position);
+    u2 readU2(u4 pc, u4 position);
+    int32_t readS4(u4 pc, u4 position);
+
+    ClassFile *_classFile;
+    method_info *_method;
+    Code_attribute *_code;
+
+    Symbol _thisClass;
+    Symbol _methodName;
+    Symbol _methodDescriptor;
+
+    /**
+     * Estados declarados pelo StackMapTable e, para cada posição do código, o índice do estado (ou -1).
+     */
+    vector<StackMapState> _states;
+    vector<int> _stateAt;
+
+    /**
+     * Estado atual: variáveis locais e pilha de operandos.
+     */
+    vector<Type> _locals;
+    vector<Type> _stack;
+};
+
+#endif
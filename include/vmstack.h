@@ -1,7 +1,8 @@
 #ifndef vmstack_h
 #define vmstack_h
 
-#include <stack>
+#include <vector>
+#include <cstdint>
 
 #include "frame.h"
 
@@ -12,19 +13,27 @@ using namespace std;
 /**
  * Classe para representar a pilha da JVM. Uma pilha é responsável por conter frames. O seu limite é dado por \c FRAME_MAX_SIZE
  *
- * Essa classe é um singleton, ou seja, somente existe no máximo 1 instância dela para cada instância da JVM.
+ * Cada thread Java possui a sua própria pilha: \c getInstance retorna a pilha da thread que o chama. Uma thread do
+ * sistema operacional usa a sua própria pilha, exceto quando executa uma thread verde (ver \c Scheduler), cuja pilha
+ * é definida com \c setCurrent. A pilha também identifica a thread Java (e.g. a dona de um lock).
  */
 class VMStack {
     
 public:
     /**
-     * @brief Obter a única instância da pilha.
-     * @return A instância da pilha.
+     * @brief Obter a pilha da thread atual.
+     * @return A instância da pilha da thread atual.
      */
     static VMStack& getInstance() {
-        static VMStack instance;
-        return instance;
+        static thread_local VMStack instance;
+        return (_current != NULL) ? *_current : instance;
     }
+    
+    /**
+     * @brief Define a pilha usada pela thread do sistema operacional atual.
+     * @param stack A pilha da thread verde a ser executada, ou \c NULL para voltar à pilha própria da thread.
+     */
+    static void setCurrent(VMStack *stack);
 
     /**
      * @brief Destrutor padrão.
@@ -32,7 +41,7 @@ public:
     ~VMStack();
     
     /**
-     * @brief Adiciona um frame na pilha da JVM.
+     * @brief Adiciona um frame na pilha da JVM. Caso o método do frame seja sincronizado, o seu lock é adquirido.
      * @param frame Um ponteiro para o frame que será adicionado na pilha.
      */
     void addFrame(Frame *frame);
@@ -45,6 +54,9 @@ public:
     
     /**
      * @brief Remove o frame do topo da pilha e o libera da memória.
+     *
+     * Caso o método do frame seja sincronizado, o seu lock é liberado. Caso o frame seja de um <clinit>, a
+     * inicialização da classe é marcada como terminada.
      * @return Retorna \c true caso o frame foi deletado, e \c false caso contrário.
      */
     bool destroyTopFrame();
@@ -55,7 +67,65 @@ public:
      */
     uint32_t size();
     
+    /**
+     * @brief Obtém o identificador (diferente de 0) da thread Java dona da pilha.
+     */
+    uintptr_t getThreadId();
+    
+    /**
+     * @brief Obtém o objeto java/lang/Thread da thread Java dona da pilha (\c NULL caso ainda não tenha sido criado).
+     */
+    ClassInstance* getThreadObject();
+    
+    /**
+     * @brief Define o objeto java/lang/Thread da thread Java dona da pilha.
+     */
+    void setThreadObject(ClassInstance *threadObject);
+    
+    /**
+     * @brief Define os argumentos do método nativo em execução, que deixaram a pilha de operandos mas continuam
+     * alcançáveis durante a chamada (e.g. o objeto de um Object.wait).
+     * @param arguments Os argumentos, ou \c NULL ao fim da chamada.
+     */
+    void setNativeArguments(vector<Value> *arguments);
+    
+    /**
+     * @brief Adiciona as referências mantidas pela pilha (variáveis locais e operandos dos frames, o objeto da thread e
+     * os argumentos do método nativo em execução) no vetor dado. Usado pela coleta de lixo, com a thread parada.
+     */
+    void getReferences(vector<Object*> &references);
+    
+    /**
+     * @brief Obtém o buffer em que a barreira de escrita da coleta de lixo registra as referências sobrescritas pela
+     * thread durante a marcação concorrente (ver \c GarbageCollector::writeBarrier).
+     */
+    vector<Object*>& getSatbBuffer();
+    
+    /**
+     * @brief Informa se uma alocação feita por uma instrução da thread falhou e a instrução aguarda a coleta de lixo
+     * para ser repetida (ver \c ExecutionEngine::retryAllocation).
+     */
+    bool hasAllocationFailed();
+    
+    /**
+     * @brief Obtém a quantidade de coletas de lixo iniciadas quando a alocação falhou.
+     */
+    u4 getAllocationFailedCollections();
+    
+    /**
+     * @brief Marca a falha de uma alocação da thread.
+     * @param startedCollections A quantidade de coletas de lixo iniciadas no momento da falha.
+     */
+    void setAllocationFailed(u4 startedCollections);
+    
+    /**
+     * @brief Desmarca a falha de alocação da thread (a alocação foi feita ou a exceção foi lançada).
+     */
+    void clearAllocationFailed();
+    
 private:
+    friend class Scheduler; // cria as pilhas das threads verdes
+    
     /**
      * @brief Construtor padrão.
      */
@@ -65,9 +135,44 @@ private:
     void operator=(VMStack const&); // não permitir implementação do operador de igual
     
     /**
-     * Armazena a pilha da JVM, que contém frames.
+     * Armazena a pilha da JVM, que contém frames (o topo é o último elemento).
+     */
+    vector<Frame*> _frameStack;
+    
+    /**
+     * O identificador da thread Java dona da pilha.
+     */
+    uintptr_t _threadId;
+    
+    /**
+     * O objeto java/lang/Thread da thread Java dona da pilha.
+     */
+    ClassInstance *_threadObject;
+    
+    /**
+     * Os argumentos do método nativo em execução (\c NULL caso não haja).
+     */
+    vector<Value> *_nativeArguments;
+    
+    /**
+     * As referências sobrescritas pela thread ainda não entregues à coleta de lixo.
+     */
+    vector<Object*> _satbBuffer;
+    
+    /**
+     * Armazena \c true se uma alocação feita por uma instrução da thread falhou e a instrução aguarda a coleta de lixo.
+     */
+    bool _allocationFailed;
+    
+    /**
+     * A quantidade de coletas de lixo iniciadas quando a alocação falhou.
+     */
+    u4 _allocationFailedCollections;
+    
+    /**
+     * A pilha da thread verde em execução na thread do sistema operacional atual (\c NULL caso não haja).
      */
-    stack<Frame*> _frameStack;
+    static thread_local VMStack *_current;
 };
 
 #endif /* vmstack_h */
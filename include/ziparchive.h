@@ -0,0 +1,107 @@
+#ifndef ziparchive_h
+#define ziparchive_h
+
+#include "tipos.h"
+#include "arena.h"
+
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * Arquivo JAR/ZIP aberto para leitura.
+ *
+ * O arquivo inteiro é mapeado em memória, e o diretório central é lido uma única vez na abertura para um índice
+ * (tabela hash) do nome de cada entrada para a sua posição no arquivo. As entradas são lidas sob demanda: entradas
+ * armazenadas sem compressão apontam diretamente para o mapeamento, e entradas comprimidas com DEFLATE são
+ * descompactadas pelo \c Inflater.
+ */
+class ZipArchive {
+
+public:
+    /**
+     * @brief Abre o arquivo no caminho dado e indexa o seu diretório central.
+     *
+     * Caso o arquivo não exista ou não seja um ZIP válido, \c isOpen retornará \c false.
+     * @param path O caminho do arquivo.
+     */
+    ZipArchive(const string &path);
+
+    /**
+     * @brief Destrutor padrão.
+     */
+    ~ZipArchive();
+
+    /**
+     * @brief Informa se o arquivo foi aberto e indexado com sucesso.
+     * @return \c true caso o arquivo esteja aberto, e \c false caso contrário.
+     */
+    bool isOpen();
+
+    /**
+     * @brief Lê o conteúdo de uma entrada do arquivo.
+     *
+     * Caso a entrada exista mas esteja corrompida, o programa é encerrado com \c ClassFormatError.
+     * @param name O nome da entrada (e.g. java/lang/Object.class).
+     * @param bytes Destino do ponteiro para o conteúdo da entrada.
+     * @param length Destino do tamanho do conteúdo da entrada.
+     * @param memory Destino da memória que deve ser liberada quando o conteúdo deixar de ser usado: o conteúdo
+     * descompactado de uma entrada comprimida, ou nenhuma (entradas sem compressão apontam para o mapeamento do
+     * arquivo, que nunca é desfeito).
+     * @return \c true caso a entrada exista, e \c false caso contrário.
+     */
+    bool readEntry(const string &name, const u1 **bytes, u4 *length, AdoptedMemory *memory);
+
+    /**
+     * @brief Obtém o tamanho e a data de modificação de uma entrada, conforme o diretório central, sem lê-la.
+     * @param name O nome da entrada.
+     * @param length Destino do tamanho do conteúdo da entrada.
+     * @param modificationTime Destino da data e da hora de modificação da entrada (no formato do MS-DOS).
+     * @return \c true caso a entrada exista, e \c false caso contrário.
+     */
+    bool getEntryStamp(const string &name, u4 *length, u4 *modificationTime);
+
+private:
+    ZipArchive(ZipArchive const&); // não permitir implementação do construtor de cópia
+    void operator=(ZipArchive const&); // não permitir implementação do operador de igual
+
+    /**
+     * Posição e tamanho de uma entrada, conforme o diretório central.
+     */
+    struct ZipEntry {
+        u2 method;
+        u4 compressedSize;
+        u4 uncompressedSize;
+        u4 localHeaderOffset;
+        u4 modificationTime;
+    };
+
+    /**
+     * @brief Localiza o registro de fim do diretório central e indexa todas as entradas.
+     * @return \c true caso o diretório central seja válido, e \c false caso contrário.
+     */
+    bool readCentralDirectory();
+
+    /**
+     * O caminho do arquivo, utilizado nas mensagens de erro.
+     */
+    string _path;
+
+    /**
+     * O arquivo mapeado em memória, ou \c NULL caso ele não tenha sido aberto.
+     */
+    const u1 *_bytes;
+
+    /**
+     * O tamanho do arquivo.
+     */
+    size_t _length;
+
+    /**
+     * Índice das entradas do arquivo: a chave é o nome da entrada.
+     */
+    unordered_map<string, ZipEntry> _entries;
+};
+
+#endif /* ziparchive_h */
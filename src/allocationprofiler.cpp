@@ -0,0 +1,170 @@
+#include "allocationprofiler.h"
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#include "frame.h"
+#include "utils.h"
+
+using namespace std;
+
+atomic<bool> AllocationProfiler::_enabled(false);
+thread_local size_t AllocationProfiler::_bytesUntilSample = 0;
+
+AllocationProfiler::AllocationProfiler() : _sampleInterval(0) {
+
+}
+
+AllocationProfiler::~AllocationProfiler() {
+
+}
+
+void AllocationProfiler::enable(size_t sampleInterval) {
+    _sampleInterval = sampleInterval;
+    _enabled.store(true, memory_order_relaxed);
+}
+
+string AllocationProfiler::methodName(Frame *frame) {
+    ClassFile *classFile = frame->getClassRuntime()->getClassFile();
+    method_info *method = frame->getMethod();
+
+    Symbol className = Utils::getSymbol(classFile->constant_pool, classFile->this_class);
+    Symbol name = Utils::getSymbol(classFile->constant_pool, method->name_index);
+    Symbol descriptor = Utils::getSymbol(classFile->constant_pool, method->descriptor_index);
+    return *className + "." + *name + *descriptor;
+}
+
+string AllocationProfiler::typeName(Frame *frame) {
+    u1 *code = frame->getCode(frame->pc);
+    cp_info *constantPool = *(frame->getConstantPool());
+
+    switch (code[0]) {
+        case 0xbb: // new
+        case 0xc5: // multianewarray
+            return *Utils::getSymbol(constantPool, (code[1] << 8) | code[2]);
+        case 0xbc: { // newarray
+            static const char *arrayTypes[] = {"[Z", "[C", "[F", "[D", "[B", "[S", "[I", "[J"};
+            return (code[1] >= 4 && code[1] <= 11) ? arrayTypes[code[1] - 4] : "?";
+        }
+        case 0xbd: { // anewarray
+            string componentName = *Utils::getSymbol(constantPool, (code[1] << 8) | code[2]);
+            return (componentName[0] == '[') ? "[" + componentName : "[L" + componentName + ";";
+        }
+        default: // ldc e ldc_w
+            return "java/lang/String";
+    }
+}
+
+void AllocationProfiler::record(Frame *frame, size_t bytes, size_t objects) {
+    if (_sampleInterval != 0) {
+        if (bytes < _bytesUntilSample) {
+            _bytesUntilSample -= bytes;
+            return;
+        }
+
+        // a amostra representa cada intervalo completado pela alocação
+        size_t excess = bytes - _bytesUntilSample;
+        size_t samples = 1 + excess / _sampleInterval;
+        _bytesUntilSample = _sampleInterval - excess % _sampleInterval;
+        bytes = samples * _sampleInterval;
+        objects = 1;
+    }
+
+    lock_guard<mutex> lock(_sitesMutex);
+    pair<method_info*, u4> key(frame->getMethod(), frame->pc);
+    map<pair<method_info*, u4>, AllocationSite>::iterator it = _sites.find(key);
+    if (it == _sites.end()) {
+        AllocationSite site;
+        site.method = methodName(frame);
+        site.pc = frame->pc;
+        site.type = typeName(frame);
+        site.objects = 0;
+        site.bytes = 0;
+        it = _sites.insert(make_pair(key, site)).first;
+    }
+    it->second.objects += objects;
+    it->second.bytes += bytes;
+}
+
+string AllocationProfiler::siteName(const AllocationSite &site) {
+    char position[32];
+    snprintf(position, sizeof(position), " @ %u (", site.pc);
+    return site.method + position + site.type + ")";
+}
+
+void AllocationProfiler::addSite(map<string, AllocationSite> &sites, const AllocationSite &site) {
+    string name = siteName(site);
+    map<string, AllocationSite>::iterator it = sites.find(name);
+    if (it == sites.end()) {
+        sites.insert(make_pair(name, site));
+        return;
+    }
+    it->second.objects += site.objects;
+    it->second.bytes += site.bytes;
+}
+
+void AllocationProfiler::unloadClass(ClassFile *classFile) {
+    lock_guard<mutex> lock(_sitesMutex);
+    method_info *methodsBegin = classFile->methods;
+    method_info *methodsEnd = classFile->methods + classFile->methods_count;
+
+    // os locais de cada método são contíguos no mapa, pois a chave é ordenada pelo method_info
+    for (method_info *method = methodsBegin; method != methodsEnd; method++) {
+        map<pair<method_info*, u4>, AllocationSite>::iterator it = _sites.lower_bound(make_pair(method, (u4) 0));
+        while (it != _sites.end() && it->first.first == method) {
+            addSite(_unloadedSites, it->second);
+            _sites.erase(it++);
+        }
+    }
+}
+
+static bool compareBytes(const pair<string, pair<size_t, size_t> > &a, const pair<string, pair<size_t, size_t> > &b) {
+    return a.second.first > b.second.first;
+}
+
+void AllocationProfiler::printReport() {
+    lock_guard<mutex> lock(_sitesMutex);
+    _enabled.store(false, memory_order_relaxed);
+
+    // cada linha do relatório contém o nome do local (ou da classe) e as quantidades de bytes e de objetos; os locais
+    // de uma classe carregada novamente (e.g. por outro job) são somados aos da classe descarregada
+    map<string, AllocationSite> allSites(_unloadedSites);
+    for (map<pair<method_info*, u4>, AllocationSite>::iterator it = _sites.begin(); it != _sites.end(); it++) {
+        addSite(allSites, it->second);
+    }
+
+    vector<pair<string, pair<size_t, size_t> > > sites;
+    map<string, pair<size_t, size_t> > classes;
+    size_t totalBytes = 0;
+    size_t totalObjects = 0;
+    for (map<string, AllocationSite>::iterator it = allSites.begin(); it != allSites.end(); it++) {
+        AllocationSite &site = it->second;
+        sites.push_back(make_pair(it->first, make_pair(site.bytes, site.objects)));
+        classes[site.type].first += site.bytes;
+        classes[site.type].second += site.objects;
+        totalBytes += site.bytes;
+        totalObjects += site.objects;
+    }
+    vector<pair<string, pair<size_t, size_t> > > sortedClasses(classes.begin(), classes.end());
+    sort(sites.begin(), sites.end(), compareBytes);
+    sort(sortedClasses.begin(), sortedClasses.end(), compareBytes);
+
+    const char *objectsLabel = (_sampleInterval != 0) ? "amostras" : "objetos";
+    if (_sampleInterval != 0) {
+        printf("[Alocações: %zu amostras, %zuK estimados (uma amostra a cada %zuK)]\n", totalObjects, totalBytes / 1024, _sampleInterval / 1024);
+    } else {
+        printf("[Alocações: %zu objetos, %zuK]\n", totalObjects, totalBytes / 1024);
+    }
+
+    printf("%14s %10s  %s\n", "bytes", objectsLabel, "local de alocação");
+    for (size_t i = 0; i < sites.size() && i < ALLOCATION_PROFILER_REPORT_LINES; i++) {
+        printf("%14zu %10zu  %s\n", sites[i].second.first, sites[i].second.second, sites[i].first.c_str());
+    }
+
+    printf("%14s %10s  %s\n", "bytes", objectsLabel, "classe");
+    for (size_t i = 0; i < sortedClasses.size() && i < ALLOCATION_PROFILER_REPORT_LINES; i++) {
+        printf("%14zu %10zu  %s\n", sortedClasses[i].second.first, sortedClasses[i].second.second, sortedClasses[i].first.c_str());
+    }
+    fflush(stdout);
+}
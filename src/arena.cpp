@@ -0,0 +1,64 @@
+#include "arena.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+
+#include <sys/mman.h>
+
+#define ARENA_ALIGNMENT 8
+#define ARENA_MIN_CHUNK_SIZE 1024
+
+Arena::Arena(size_t capacity) : _current(NULL), _end(NULL), _reservedBytes(0) {
+    _chunkSize = (capacity < ARENA_MIN_CHUNK_SIZE) ? ARENA_MIN_CHUNK_SIZE : capacity;
+    addChunk(_chunkSize);
+}
+
+Arena::~Arena() {
+    for (size_t i = 0; i < _chunks.size(); i++) {
+        free(_chunks[i]);
+    }
+    for (size_t i = 0; i < _adopted.size(); i++) {
+        if (_adopted[i].mapped) {
+            munmap(_adopted[i].address, _adopted[i].length);
+        } else {
+            free(_adopted[i].address);
+        }
+    }
+}
+
+void Arena::addChunk(size_t size) {
+    char *chunk = (char *) malloc(size);
+    if (chunk == NULL) {
+        cerr << "OutOfMemoryError: não foi possível alocar os metadados da classe" << endl;
+        exit(1);
+    }
+
+    _chunks.push_back(chunk);
+    _current = chunk;
+    _end = chunk + size;
+    _reservedBytes += size;
+}
+
+void* Arena::allocate(size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+
+    if ((size_t) (_end - _current) < size) {
+        // alocações maiores que o tamanho padrão recebem um bloco exclusivo
+        addChunk(size > _chunkSize ? size : _chunkSize);
+    }
+
+    void *result = _current;
+    _current += size;
+    return result;
+}
+
+void Arena::adopt(const AdoptedMemory &memory) {
+    if (memory.address != NULL) {
+        _adopted.push_back(memory);
+    }
+}
+
+size_t Arena::reservedBytes() {
+    return _reservedBytes;
+}
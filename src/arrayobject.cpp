@@ -1,72 +1,120 @@
 #include "arrayobject.h"
 
-#include <cassert>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <new>
 
-ArrayObject::ArrayObject(ValueType type) : _arrayType(type) {
-    
+ArrayObject::ArrayObject(ValueType type, uint32_t length) : Object(ARRAY, ((uintptr_t) type) << 3), _length(length) {
+    memset(getElements(), 0, elementSize(type) * length);
 }
 
 ArrayObject::~ArrayObject() {
     
 }
 
-ObjectType ArrayObject::objectType() {
-    return ObjectType::ARRAY;
-}
-
-ValueType ArrayObject::arrayContentType() {
-    return _arrayType;
+ArrayObject* ArrayObject::create(ValueType type, uint32_t length, bool limited) {
+    void *memory = Heap::getInstance().allocate(instanceSize(type, length), limited);
+    if (memory == NULL) {
+        return NULL;
+    }
+    return ::new (memory) ArrayObject(type, length);
 }
 
-void ArrayObject::pushValue(Value value) {
-    assert(value.type == _arrayType);
-    
-    _elements.push_back(value);
+size_t ArrayObject::elementSize(ValueType type) {
+    switch (type) {
+        case ValueType::BOOLEAN:
+        case ValueType::BYTE:
+            return 1;
+        case ValueType::CHAR:
+        case ValueType::SHORT:
+            return 2;
+        case ValueType::INT:
+        case ValueType::FLOAT:
+            return 4;
+        case ValueType::REFERENCE:
+            return Heap::usesCompressedReferences() ? 4 : sizeof(Object *);
+        default:
+            return 8;
+    }
 }
 
-Value ArrayObject::removeAt(uint32_t index) {
-    assert(_elements.size() > 0);
-    assert(index < _elements.size());
+Value ArrayObject::getValue(uint32_t index) {
+    if (index >= _length) {
+        cerr << "ArrayIndexOutOfBoundsException" << endl;
+        exit(1);
+    }
     
-    Value value = _elements[index];
-    _elements.erase(_elements.begin() + index);
-    return value;
-}
-
-Value ArrayObject::removeLast() {
-    assert(_elements.size() > 0);
+    ValueType type = arrayContentType();
+    Value value;
+    value.type = type;
+    value.printType = type;
+    value.data.longValue = 0;
     
-    Value value = _elements.back();
-    _elements.pop_back();
-    return value;
-}
-
-Value ArrayObject::removeFirst() {
-    assert(_elements.size() > 0);
+    u1 *elements = getElements();
+    switch (type) {
+        case ValueType::BOOLEAN:
+            value.data.booleanValue = elements[index] != 0;
+            break;
+        case ValueType::BYTE:
+            value.data.byteValue = (int8_t) elements[index];
+            break;
+        case ValueType::CHAR:
+            value.data.charValue = (uint8_t) ((uint16_t *) elements)[index];
+            break;
+        case ValueType::SHORT:
+            value.data.shortValue = ((int16_t *) elements)[index];
+            break;
+        case ValueType::INT:
+            value.data.intValue = ((int32_t *) elements)[index];
+            break;
+        case ValueType::FLOAT:
+            value.data.floatValue = ((float *) elements)[index];
+            break;
+        case ValueType::REFERENCE:
+            value.data.object = getReference(index);
+            break;
+        default:
+            value.data.longValue = ((int64_t *) elements)[index];
+    }
     
-    Value value = _elements.front();
-    _elements.erase(_elements.begin());
     return value;
 }
 
-uint32_t ArrayObject::getSize() {
-    return _elements.size();
-}
-
-Value ArrayObject::getValue(uint32_t index) {
-    assert(_elements.size() > 0);
-//    assert(index < _elements.size());
-    
-    if (index >= _elements.size()) {
+void ArrayObject::changeValueAt(uint32_t index, Value value) {
+    if (index >= _length) {
         cerr << "ArrayIndexOutOfBoundsException" << endl;
         exit(1);
     }
     
-    return _elements[index];
-}
-
-void ArrayObject::changeValueAt(uint32_t index, Value value) {
-    _elements[index] = value;
+    u1 *elements = getElements();
+    switch (arrayContentType()) {
+        case ValueType::BOOLEAN:
+            elements[index] = value.data.booleanValue ? 1 : 0;
+            break;
+        case ValueType::BYTE:
+            elements[index] = (u1) value.data.byteValue;
+            break;
+        case ValueType::CHAR:
+            ((uint16_t *) elements)[index] = value.data.charValue;
+            break;
+        case ValueType::SHORT:
+            ((int16_t *) elements)[index] = value.data.shortValue;
+            break;
+        case ValueType::INT:
+            ((int32_t *) elements)[index] = value.data.intValue;
+            break;
+        case ValueType::FLOAT:
+            ((float *) elements)[index] = value.data.floatValue;
+            break;
+        case ValueType::REFERENCE:
+            if (Heap::usesCompressedReferences()) {
+                ((u4 *) elements)[index] = Heap::compress(value.data.object);
+            } else {
+                ((Object **) elements)[index] = value.data.object;
+            }
+            break;
+        default:
+            ((int64_t *) elements)[index] = value.data.longValue;
+    }
 }
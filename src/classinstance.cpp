@@ -1,16 +1,22 @@
 #include "classinstance.h"
-#include "classviewer.h"
-#include "methodarea.h"
 #include "heap.h"
-#include "stringobject.h"
-#include "arrayobject.h"
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <new>
 
-ClassInstance::ClassInstance(ClassRuntime *classRuntime) : _classRuntime(classRuntime) {
+ClassInstance::ClassInstance(ClassRuntime *classRuntime) : Object(CLASS_INSTANCE, (uintptr_t) classRuntime) {
+    // o valor inicial de todos os tipos (0, 0.0, false e NULL) é representado somente por zeros
+    memset((void *) (this + 1), 0, classRuntime->getInstanceSize() - sizeof(ClassInstance));
+}
+
+ClassInstance::~ClassInstance() {
+    
+}
+
+ClassInstance* ClassInstance::create(ClassRuntime *classRuntime, bool limited) {
     ClassFile *classFile = classRuntime->getClassFile();
-    field_info *fields = classFile->fields;
     u2 abstractFlag = 0x0400;
     
     if ((classFile->access_flags & abstractFlag) != 0) {
@@ -19,89 +25,96 @@ ClassInstance::ClassInstance(ClassRuntime *classRuntime) : _classRuntime(classRu
         exit(1);
     }
     
-    for (int i = 0; i < classFile->fields_count; i++) {
-        field_info field = fields[i];
-        u2 staticAndFinalFlag = 0x0008 | 0x0010;
-        
-        if ((field.access_flags & staticAndFinalFlag) == 0) { // não estática e não final
-            string fieldName = getFormattedConstant(classFile->constant_pool, field.name_index);
-            string fieldDescriptor = getFormattedConstant(classFile->constant_pool, field.descriptor_index);
-            
-            char fieldType = fieldDescriptor[0];
-            Value value;
-            
-            switch (fieldType) {
-                case 'B':
-                    value.type = ValueType::BYTE;
-                    value.data.byteValue = 0;
-                    break;
-                case 'C':
-                    value.type = ValueType::CHAR;
-                    value.data.charValue = 0;
-                    break;
-                case 'D':
-                    value.type = ValueType::DOUBLE;
-                    value.data.doubleValue = 0;
-                    break;
-                case 'F':
-                    value.type = ValueType::FLOAT;
-                    value.data.floatValue = 0;
-                    break;
-                case 'I':
-                    value.type = ValueType::INT;
-                    value.data.intValue = 0;
-                    break;
-                case 'J':
-                    value.type = ValueType::LONG;
-                    value.data.longValue = 0;
-                    break;
-                case 'S':
-                    value.type = ValueType::SHORT;
-                    value.data.shortValue = 0;
-                    break;
-                case 'Z':
-                    value.type = ValueType::BOOLEAN;
-                    value.data.charValue = false;
-                    break;
-                default:
-                    value.type = ValueType::REFERENCE;
-                    value.data.object = NULL;
-            }
-            
-            putValueIntoField(value, fieldName);
-        }
+    classRuntime->prepareInstanceLayout();
+    void *memory = Heap::getInstance().allocate(classRuntime->getInstanceSize(), limited);
+    if (memory == NULL) {
+        return NULL;
     }
-    
-    // quando um objeto é criado, ele precisa ser armazenado na Heap
-    Heap &heap = Heap::getInstance();
-    heap.addObject(this);
+    return ::new (memory) ClassInstance(classRuntime);
 }
 
-ClassInstance::~ClassInstance() {
+const InstanceField* ClassInstance::getField(Symbol fieldName) {
+    const InstanceField *field = getClassRuntime()->getInstanceField(fieldName);
+    if (field == NULL) {
+        cerr << "NoSuchFieldError" << endl;
+        exit(1);
+    }
     
+    return field;
 }
 
-ObjectType ClassInstance::objectType() {
-    return ObjectType::CLASS_INSTANCE;
-}
-
-ClassRuntime* ClassInstance::getClassRuntime() {
-    return _classRuntime;
-}
-
-void ClassInstance::putValueIntoField(Value value, string fieldName) {
-    _fields[fieldName] = value;
+void ClassInstance::putValueIntoField(Value value, Symbol fieldName) {
+    const InstanceField *field = getField(fieldName);
+    u1 *address = ((u1 *) this) + field->offset;
+    
+    switch (field->type) {
+        case ValueType::BOOLEAN:
+        case ValueType::BYTE:
+            *address = (u1) value.data.intValue;
+            break;
+        case ValueType::CHAR:
+            *((uint16_t *) address) = (uint16_t) value.data.intValue;
+            break;
+        case ValueType::SHORT:
+            *((int16_t *) address) = (int16_t) value.data.intValue;
+            break;
+        case ValueType::INT:
+            *((int32_t *) address) = value.data.intValue;
+            break;
+        case ValueType::FLOAT:
+            *((float *) address) = value.data.floatValue;
+            break;
+        case ValueType::REFERENCE:
+            if (Heap::usesCompressedReferences()) {
+                *((u4 *) address) = Heap::compress(value.data.object);
+            } else {
+                *((Object **) address) = value.data.object;
+            }
+            break;
+        default:
+            *((int64_t *) address) = value.data.longValue;
+    }
 }
 
-Value ClassInstance::getValueFromField(string fieldName) {
-    if (_fields.count(fieldName) ==  0) {
-        cerr << "NoSuchFieldError" << endl;
-        exit(1);
+Value ClassInstance::getValueFromField(Symbol fieldName) {
+    const InstanceField *field = getField(fieldName);
+    u1 *address = ((u1 *) this) + field->offset;
+    
+    Value value;
+    value.type = field->type;
+    value.printType = field->type;
+    value.data.longValue = 0;
+    
+    // os tipos menores que int são estendidos para int, como na pilha de operandos
+    switch (field->type) {
+        case ValueType::BOOLEAN:
+            value.data.intValue = *address;
+            break;
+        case ValueType::BYTE:
+            value.data.intValue = (int8_t) *address;
+            break;
+        case ValueType::CHAR:
+            value.data.intValue = *((uint16_t *) address);
+            break;
+        case ValueType::SHORT:
+            value.data.intValue = *((int16_t *) address);
+            break;
+        case ValueType::INT:
+            value.data.intValue = *((int32_t *) address);
+            break;
+        case ValueType::FLOAT:
+            value.data.floatValue = *((float *) address);
+            break;
+        case ValueType::REFERENCE:
+            value.data.object = getReferenceAt(field->offset);
+            break;
+        default:
+            value.data.longValue = *((int64_t *) address);
     }
     
-    return _fields[fieldName];
+    return value;
 }
 
-bool ClassInstance::fieldExists(string fieldName) {
-    return _fields.count(fieldName) > 0;
-}
\ No newline at end of file
+bool ClassInstance::fieldExists(Symbol fieldName) {
+    return getClassRuntime()->getInstanceField(fieldName) != NULL;
+}
@@ -6,38 +6,47 @@
 #include <cstdlib>
 
 #include <iostream>
+#include <new>
 
 #include "classloader.h"
 #include "utils.h"
+#include "symboltable.h"
+#include "verifier.h"
 
 using namespace std;
 
-ClassLoader::ClassLoader() {
-    isLittleEndian = testEndianess();
+ClassLoader::ClassLoader() : _keepDebugAttributes(false), _verify(true) {
+    
 };
 
 ClassLoader::~ClassLoader() {
     
 }
 
-bool ClassLoader::testEndianess() {
-    int n = 1;
-    return (*(char*)&n == 1);
-}
-
-ClassFile* ClassLoader::readClassFile(FILE *fp) {    
-    ClassFile *classFile = (ClassFile*) malloc(sizeof(ClassFile));
+ClassFile* ClassLoader::readClassFile(const u1 *bytes, u4 length) {
+    ClassFileBuffer classFileBuffer;
+    classFileBuffer.bytes = bytes;
+    classFileBuffer.length = length;
+    classFileBuffer.offset = 0;
+    ClassFileBuffer *buffer = &classFileBuffer;
+    
+    // todos os metadados da classe são alocados em uma única arena, estimada a partir do tamanho do arquivo
+    // (as estruturas em memória ocupam aproximadamente o dobro dos bytes correspondentes no arquivo).
+    classFileBuffer.arena = new Arena(2 * (size_t) length);
+    
+    ClassFile *classFile = (ClassFile*) buffer->arena->allocate(sizeof(ClassFile));
+    classFile->arena = buffer->arena;
     
     // magic
-    setMagic(fp, classFile);
+    setMagic(buffer, classFile);
     if (isMagicValid(classFile) == false) {
         printf("ClassFormatError\n");
         exit(3);
     }
     
     // version
-    setVersion(fp, classFile);
-    if (isVersionValid(classFile, 46) == false) {
+    setVersion(buffer, classFile);
+    if (isVersionValid(classFile, 52) == false) {
         double friendlyVersion = Utils::generateFriendlyVersionNumber(classFile);
         if (friendlyVersion == 0) {
             printf("UnsupportedClassVersionError\n");
@@ -48,136 +57,147 @@ ClassFile* ClassLoader::readClassFile(FILE *fp) {
     }
     
     // pool de constantes
-    setConstantPoolSize(fp, classFile);
-    setConstantPool(fp, classFile);
+    setConstantPoolSize(buffer, classFile);
+    setConstantPool(buffer, classFile);
     
     // access flags
-    setAccessFlags(fp, classFile);
+    setAccessFlags(buffer, classFile);
     
     // this class
-    setThisClass(fp, classFile);
+    setThisClass(buffer, classFile);
     
     // superclass
-    setSuperClass(fp, classFile);
+    setSuperClass(buffer, classFile);
     
     // interfaces
-    setInterfacesCount(fp, classFile);
-    setInterfaces(fp, classFile);
+    setInterfacesCount(buffer, classFile);
+    setInterfaces(buffer, classFile);
     
     // fields
-    setFieldsCount(fp, classFile);
-    setFields(fp, classFile);
+    setFieldsCount(buffer, classFile);
+    setFields(buffer, classFile);
     
     // methods
-    setMethodsCount(fp, classFile);
-    setMethods(fp, classFile);
+    setMethodsCount(buffer, classFile);
+    setMethods(buffer, classFile);
     
     // attributes
-    setAttributesCount(fp, classFile);
-    setAttributes(fp, classFile);
+    setAttributesCount(buffer, classFile);
+    setAttributes(buffer, classFile);
     
     return classFile;
 }
 
-u1 ClassLoader::readU1(FILE *fp) {
-    u1 result = 0;
-    fread(&result, sizeof(u1), 1, fp);
-    return result;
+void ClassLoader::checkBounds(ClassFileBuffer *buffer, u4 size) {
+    if (size > buffer->length - buffer->offset) {
+        printf("ClassFormatError: arquivo .class truncado\n");
+        exit(3);
+    }
 }
 
-u2 ClassLoader::readU2(FILE *fp) {
-    u2 result = 0;
-    
-    if (isLittleEndian) {
-        for (int i = 0; i < 2; i++) {
-            result += readU1(fp) << (8 - 8*i);
-        }
-    } else {
-        fread(&result, sizeof(u2), 1, fp);
-    }
+u1 ClassLoader::readU1(ClassFileBuffer *buffer) {
+    checkBounds(buffer, 1);
+    return buffer->bytes[buffer->offset++];
+}
+
+u2 ClassLoader::readU2(ClassFileBuffer *buffer) {
+    checkBounds(buffer, 2);
+    const u1 *bytes = buffer->bytes + buffer->offset;
+    buffer->offset += 2;
     
-    return result;
+    return (bytes[0] << 8) | bytes[1];
 }
 
-u4 ClassLoader::readU4(FILE *fp) {
-    u4 result = 0;
+u4 ClassLoader::readU4(ClassFileBuffer *buffer) {
+    checkBounds(buffer, 4);
+    const u1 *bytes = buffer->bytes + buffer->offset;
+    buffer->offset += 4;
     
-    if (isLittleEndian) {
-        for (int i = 0; i < 4; i++) {
-            result += readU1(fp) << (24 - 8*i);
-        }
-    } else {
-        fread(&result, sizeof(u4), 1, fp);
-    }
+    return ((u4) bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+u1* ClassLoader::readBytes(ClassFileBuffer *buffer, u4 length) {
+    checkBounds(buffer, length);
+    u1 *bytes = (u1*) buffer->bytes + buffer->offset;
+    buffer->offset += length;
     
-    return result;
+    return bytes;
 }
 
-void ClassLoader::setMagic(FILE *fp, ClassFile *classFile) {
-    classFile->magic = readU4(fp);
+void ClassLoader::setMagic(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->magic = readU4(buffer);
 }
 
 bool ClassLoader::isMagicValid(ClassFile *classFile) {
     return classFile->magic == 0xCAFEBABE ? true : false;
 }
 
-void ClassLoader::setVersion(FILE *fp, ClassFile *classFile) {
-    classFile->minor_version = readU2(fp);
-    classFile->major_version = readU2(fp);
+void ClassLoader::setVersion(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->minor_version = readU2(buffer);
+    classFile->major_version = readU2(buffer);
 }
 
 bool ClassLoader::isVersionValid(ClassFile *classFile, uint16_t major) {
     return classFile->major_version <= major;
 }
 
-void ClassLoader::setConstantPoolSize(FILE *fp, ClassFile *classFile) {
-    classFile->constant_pool_count = readU2(fp);
+void ClassLoader::setConstantPoolSize(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->constant_pool_count = readU2(buffer);
 }
 
-void ClassLoader::setConstantPool(FILE *fp, ClassFile *classFile) {
+void ClassLoader::setConstantPool(ClassFileBuffer *buffer, ClassFile *classFile) {
     u2 poolSize = classFile->constant_pool_count - 1;
-    classFile->constant_pool = (cp_info*) malloc(sizeof(cp_info) * poolSize);
+    classFile->constant_pool = (cp_info*) buffer->arena->allocate(sizeof(cp_info) * poolSize);
     
     cp_info *constant_pool = classFile->constant_pool;
     for (u2 i = 0; i < poolSize; i++) {
-        u1 tag = readU1(fp);
+        u1 tag = readU1(buffer);
         constant_pool[i].tag = tag;
         
         switch (tag) {
             case CONSTANT_Class:
-                constant_pool[i].info.class_info = getConstantClassInfo(fp);
+                constant_pool[i].info.class_info = getConstantClassInfo(buffer);
             break;
             case CONSTANT_Fieldref:
-                constant_pool[i].info.fieldref_info = getConstantFieldRefInfo(fp);
+                constant_pool[i].info.fieldref_info = getConstantFieldRefInfo(buffer);
             break;
             case CONSTANT_Methodref:
-                constant_pool[i].info.methodref_info = getConstantMethodRefInfo(fp);
+                constant_pool[i].info.methodref_info = getConstantMethodRefInfo(buffer);
             break;
             case CONSTANT_InterfaceMethodref:
-                constant_pool[i].info.interfaceMethodref_info = getConstantInterfaceMethodRefInfo(fp);
+                constant_pool[i].info.interfaceMethodref_info = getConstantInterfaceMethodRefInfo(buffer);
             break;
             case CONSTANT_String:
-                constant_pool[i].info.string_info = getConstantStringInfo(fp);
+                constant_pool[i].info.string_info = getConstantStringInfo(buffer);
             break;
             case CONSTANT_Integer:
-                constant_pool[i].info.integer_info = getConstantIntegerInfo(fp);
+                constant_pool[i].info.integer_info = getConstantIntegerInfo(buffer);
             break;
             case CONSTANT_Float:
-                constant_pool[i].info.float_info = getConstantFloatInfo(fp);
+                constant_pool[i].info.float_info = getConstantFloatInfo(buffer);
             break;
             case CONSTANT_Long:
-                constant_pool[i].info.long_info = getConstantLongInfo(fp);
+                constant_pool[i].info.long_info = getConstantLongInfo(buffer);
                 constant_pool[++i].tag = CONSTANT_NULL;
             break;
             case CONSTANT_Double:
-                constant_pool[i].info.double_info = getConstantDoubleInfo(fp);
+                constant_pool[i].info.double_info = getConstantDoubleInfo(buffer);
                 constant_pool[++i].tag = CONSTANT_NULL;
             break;
             case CONSTANT_NameAndType:
-                constant_pool[i].info.nameAndType_info = getConstantNameAndTypeInfo(fp);
+                constant_pool[i].info.nameAndType_info = getConstantNameAndTypeInfo(buffer);
             break;
             case CONSTANT_Utf8:
-                constant_pool[i].info.utf8_info = getConstantUtf8Info(fp);
+                constant_pool[i].info.utf8_info = getConstantUtf8Info(buffer);
+            break;
+            case CONSTANT_MethodHandle:
+                constant_pool[i].info.methodHandle_info = getConstantMethodHandleInfo(buffer);
+            break;
+            case CONSTANT_MethodType:
+                constant_pool[i].info.methodType_info = getConstantMethodTypeInfo(buffer);
+            break;
+            case CONSTANT_InvokeDynamic:
+                constant_pool[i].info.invokeDynamic_info = getConstantInvokeDynamicInfo(buffer);
             break;
             default:
                 cerr << "Arquivo .class possui uma tag invalida no pool de constantes";
@@ -186,127 +206,154 @@ void ClassLoader::setConstantPool(FILE *fp, ClassFile *classFile) {
     }
 }
 
-CONSTANT_Class_info ClassLoader::getConstantClassInfo(FILE *fp) {
+CONSTANT_Class_info ClassLoader::getConstantClassInfo(ClassFileBuffer *buffer) {
     CONSTANT_Class_info result;
-    result.name_index = readU2(fp);
+    result.name_index = readU2(buffer);
     return result;
 }
 
-CONSTANT_Fieldref_info ClassLoader::getConstantFieldRefInfo(FILE *fp) {
+CONSTANT_Fieldref_info ClassLoader::getConstantFieldRefInfo(ClassFileBuffer *buffer) {
     CONSTANT_Fieldref_info result;
-    result.class_index = readU2(fp);
-    result.name_and_type_index = readU2(fp);
+    result.class_index = readU2(buffer);
+    result.name_and_type_index = readU2(buffer);
     return result;
 }
 
-CONSTANT_Methodref_info ClassLoader::getConstantMethodRefInfo(FILE *fp) {
+CONSTANT_Methodref_info ClassLoader::getConstantMethodRefInfo(ClassFileBuffer *buffer) {
     CONSTANT_Methodref_info result;
-    result.class_index = readU2(fp);
-    result.name_and_type_index = readU2(fp);
+    result.class_index = readU2(buffer);
+    result.name_and_type_index = readU2(buffer);
     return result;
 }
 
-CONSTANT_InterfaceMethodref_info ClassLoader::getConstantInterfaceMethodRefInfo(FILE *fp) {
+CONSTANT_InterfaceMethodref_info ClassLoader::getConstantInterfaceMethodRefInfo(ClassFileBuffer *buffer) {
     CONSTANT_InterfaceMethodref_info result;
-    result.class_index = readU2(fp);
-    result.name_and_type_index = readU2(fp);
+    result.class_index = readU2(buffer);
+    result.name_and_type_index = readU2(buffer);
     return result;
 }
 
-CONSTANT_String_info ClassLoader::getConstantStringInfo(FILE *fp) {
+CONSTANT_String_info ClassLoader::getConstantStringInfo(ClassFileBuffer *buffer) {
     CONSTANT_String_info result;
-    result.string_index = readU2(fp);
+    result.string_index = readU2(buffer);
     return result;
 }
 
-CONSTANT_Integer_info ClassLoader::getConstantIntegerInfo(FILE *fp) {
+CONSTANT_Integer_info ClassLoader::getConstantIntegerInfo(ClassFileBuffer *buffer) {
     CONSTANT_Integer_info result;
-    result.bytes = readU4(fp);
+    result.bytes = readU4(buffer);
+    result.value = (int32_t) result.bytes;
     return result;
 }
 
-CONSTANT_Float_info ClassLoader::getConstantFloatInfo(FILE *fp) {
+CONSTANT_Float_info ClassLoader::getConstantFloatInfo(ClassFileBuffer *buffer) {
     CONSTANT_Float_info result;
-    result.bytes = readU4(fp);
+    result.bytes = readU4(buffer);
+    memcpy(&result.value, &result.bytes, sizeof(float));
     return result;
 }
 
-CONSTANT_Long_info ClassLoader::getConstantLongInfo(FILE *fp) {
+CONSTANT_Long_info ClassLoader::getConstantLongInfo(ClassFileBuffer *buffer) {
     CONSTANT_Long_info result;
-    result.high_bytes = readU4(fp);
-    result.low_bytes = readU4(fp);
+    result.high_bytes = readU4(buffer);
+    result.low_bytes = readU4(buffer);
+    result.value = (int64_t) (((uint64_t) result.high_bytes << 32) | result.low_bytes);
     return result;
 }
 
-CONSTANT_Double_info ClassLoader::getConstantDoubleInfo(FILE *fp) {
+CONSTANT_Double_info ClassLoader::getConstantDoubleInfo(ClassFileBuffer *buffer) {
     CONSTANT_Double_info result;
-    result.high_bytes = readU4(fp);
-    result.low_bytes = readU4(fp);
+    result.high_bytes = readU4(buffer);
+    result.low_bytes = readU4(buffer);
+    uint64_t bits = ((uint64_t) result.high_bytes << 32) | result.low_bytes;
+    memcpy(&result.value, &bits, sizeof(double));
     return result;
 }
 
-CONSTANT_NameAndType_info ClassLoader::getConstantNameAndTypeInfo(FILE *fp) {
+CONSTANT_NameAndType_info ClassLoader::getConstantNameAndTypeInfo(ClassFileBuffer *buffer) {
     CONSTANT_NameAndType_info result;
-    result.name_index = readU2(fp);
-    result.descriptor_index = readU2(fp);
+    result.name_index = readU2(buffer);
+    result.descriptor_index = readU2(buffer);
     
     return result;
 }
 
-CONSTANT_Utf8_info ClassLoader::getConstantUtf8Info(FILE *fp) {
+CONSTANT_Utf8_info ClassLoader::getConstantUtf8Info(ClassFileBuffer *buffer) {
     CONSTANT_Utf8_info result;
-    result.length = readU2(fp);
-    result.bytes = (u1*) malloc(sizeof(u1) * result.length);
+    result.length = readU2(buffer);
+    result.bytes = readBytes(buffer, result.length);
     
-    for (u2 i = 0; i < result.length; i++) {
-        result.bytes[i] = readU1(fp);
-    }
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    result.symbol = symbolTable.intern(result.bytes, result.length);
     
     return result;
 }
 
-void ClassLoader::setAccessFlags(FILE *fp, ClassFile *classFile) {
-    classFile->access_flags = readU2(fp);
+CONSTANT_MethodHandle_info ClassLoader::getConstantMethodHandleInfo(ClassFileBuffer *buffer) {
+    CONSTANT_MethodHandle_info result;
+    result.reference_kind = readU1(buffer);
+    result.reference_index = readU2(buffer);
+    return result;
+}
+
+CONSTANT_MethodType_info ClassLoader::getConstantMethodTypeInfo(ClassFileBuffer *buffer) {
+    CONSTANT_MethodType_info result;
+    result.descriptor_index = readU2(buffer);
+    return result;
+}
+
+CONSTANT_InvokeDynamic_info ClassLoader::getConstantInvokeDynamicInfo(ClassFileBuffer *buffer) {
+    CONSTANT_InvokeDynamic_info result;
+    result.bootstrap_method_attr_index = readU2(buffer);
+    result.name_and_type_index = readU2(buffer);
+    return result;
+}
+
+void ClassLoader::setAccessFlags(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->access_flags = readU2(buffer);
 }
 
-void ClassLoader::setThisClass(FILE *fp, ClassFile *classFile) {
-    classFile->this_class = readU2(fp);
+void ClassLoader::setThisClass(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->this_class = readU2(buffer);
 }
 
-void ClassLoader::setSuperClass(FILE *fp, ClassFile *classFile) {
-    classFile->super_class = readU2(fp);
+void ClassLoader::setSuperClass(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->super_class = readU2(buffer);
 }
 
-void ClassLoader::setInterfacesCount(FILE *fp, ClassFile *classFile) {
-    classFile->interfaces_count = readU2(fp);
+void ClassLoader::setInterfacesCount(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->interfaces_count = readU2(buffer);
 }
 
-void ClassLoader::setInterfaces(FILE *fp, ClassFile *classFile) {
-    classFile->interfaces = (u2*) malloc(sizeof(u2) * classFile->interfaces_count);
+void ClassLoader::setInterfaces(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->interfaces = (u2*) buffer->arena->allocate(sizeof(u2) * classFile->interfaces_count);
     for (u2 i = 0; i < classFile->interfaces_count; i++) {
-        classFile->interfaces[i] = readU2(fp);
+        classFile->interfaces[i] = readU2(buffer);
     }
 }
 
-void ClassLoader::setFieldsCount(FILE *fp, ClassFile *classFile) {
-    classFile->fields_count = readU2(fp);
+void ClassLoader::setFieldsCount(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->fields_count = readU2(buffer);
 }
 
-void ClassLoader::setFields(FILE *fp, ClassFile *classFile) {
-    classFile->fields = (field_info*) malloc(sizeof(field_info) * classFile->fields_count);
+void ClassLoader::setFields(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->fields = (field_info*) buffer->arena->allocate(sizeof(field_info) * classFile->fields_count);
     for (u2 i = 0; i < classFile->fields_count; i++) {
         field_info field;
         
-        field.access_flags = readU2(fp);
-        field.name_index = readU2(fp);
-        field.descriptor_index = readU2(fp);
-        field.attributes_count = readU2(fp);
+        field.access_flags = readU2(buffer);
+        field.name_index = readU2(buffer);
+        field.descriptor_index = readU2(buffer);
+        field.attributes_count = readU2(buffer);
         
-        field.attributes = (attribute_info*) malloc(sizeof(attribute_info) * field.attributes_count);
+        field.attributes = (attribute_info*) buffer->arena->allocate(sizeof(attribute_info) * field.attributes_count);
         
+        u2 keptAttributes = 0;
         for (u2 j = 0; j < field.attributes_count; j++) {
-            field.attributes[j] = getAttributeInfo(fp, classFile);
+            if (skipDebugAttribute(buffer, classFile)) continue;
+            field.attributes[keptAttributes++] = getAttributeInfo(buffer, classFile);
         }
+        field.attributes_count = keptAttributes;
         
         classFile->fields[i] = field;
     }
@@ -318,188 +365,390 @@ CONSTANT_Utf8_info ClassLoader::getUtf8FromConstantPool(u2 index, ClassFile *cla
     return constant.info.utf8_info;
 }
 
-ConstantValue_attribute ClassLoader::getAttributeConstantValue(FILE *fp) {
+ConstantValue_attribute ClassLoader::getAttributeConstantValue(ClassFileBuffer *buffer) {
     ConstantValue_attribute result;
-    result.constantvalue_index = readU2(fp);
+    result.constantvalue_index = readU2(buffer);
     return result;
 }
 
-ExceptionTable ClassLoader::getExceptionTable(FILE *fp) {
+ExceptionTable ClassLoader::getExceptionTable(ClassFileBuffer *buffer) {
     ExceptionTable result;
-    result.start_pc = readU2(fp);
-    result.end_pc = readU2(fp);
-    result.handler_pc = readU2(fp);
-    result.catch_type = readU2(fp);
+    result.start_pc = readU2(buffer);
+    result.end_pc = readU2(buffer);
+    result.handler_pc = readU2(buffer);
+    result.catch_type = readU2(buffer);
     return result;
 }
 
-Code_attribute ClassLoader::getAttributeCode(FILE *fp, ClassFile *classFile) {
+Code_attribute ClassLoader::getAttributeCode(ClassFileBuffer *buffer, ClassFile *classFile) {
     Code_attribute result;
-    result.max_stack = readU2(fp);
-    result.max_locals = readU2(fp);
+    result.max_stack = readU2(buffer);
+    result.max_locals = readU2(buffer);
     
-    result.code_length = readU4(fp);
+    result.code_length = readU4(buffer);
     
-    result.code = (u1*) malloc(sizeof(u1) * result.code_length);
-    for (u4 i = 0; i < result.code_length; i++) {
-        result.code[i] = readU1(fp);
-    }
+    result.code = readBytes(buffer, result.code_length);
     
-    result.exception_table_length = readU2(fp);
-    result.exception_table = (ExceptionTable*) malloc(sizeof(ExceptionTable) * result.exception_table_length);
+    result.exception_table_length = readU2(buffer);
+    result.exception_table = (ExceptionTable*) buffer->arena->allocate(sizeof(ExceptionTable) * result.exception_table_length);
     for (u2 i = 0; i < result.exception_table_length; i++) {
-        result.exception_table[i] = getExceptionTable(fp);
+        result.exception_table[i] = getExceptionTable(buffer);
     }
     
-    result.attributes_count = readU2(fp);
-    result.attributes = (attribute_info*) malloc(sizeof(attribute_info) * result.attributes_count);
+    result.attributes_count = readU2(buffer);
+    result.attributes = (attribute_info*) buffer->arena->allocate(sizeof(attribute_info) * result.attributes_count);
+    u2 keptAttributes = 0;
     for (u2 i = 0; i < result.attributes_count; i++) {
-        result.attributes[i] = getAttributeInfo(fp, classFile);
+        if (skipDebugAttribute(buffer, classFile)) continue;
+        result.attributes[keptAttributes++] = getAttributeInfo(buffer, classFile);
     }
+    result.attributes_count = keptAttributes;
     
     return result;
 }
 
-Exceptions_attribute ClassLoader::getAttributeExceptions(FILE *fp) {
+Exceptions_attribute ClassLoader::getAttributeExceptions(ClassFileBuffer *buffer) {
     Exceptions_attribute result;
-    result.number_of_exceptions = readU2(fp);
-    result.exception_index_table = (u2*) malloc(sizeof(u2) * result.number_of_exceptions);
+    result.number_of_exceptions = readU2(buffer);
+    result.exception_index_table = (u2*) buffer->arena->allocate(sizeof(u2) * result.number_of_exceptions);
     for (u2 i = 0; i < result.number_of_exceptions; i++) {
-        result.exception_index_table[i] = readU2(fp);
+        result.exception_index_table[i] = readU2(buffer);
     }
     return result;
 }
 
-Class ClassLoader::getClass(FILE *fp) {
+Class ClassLoader::getClass(ClassFileBuffer *buffer) {
     Class result;
-    result.inner_class_info_index = readU2(fp);
-    result.outer_class_info_index = readU2(fp);
-    result.inner_name_index = readU2(fp);
-    result.inner_class_access_flags = readU2(fp);
+    result.inner_class_info_index = readU2(buffer);
+    result.outer_class_info_index = readU2(buffer);
+    result.inner_name_index = readU2(buffer);
+    result.inner_class_access_flags = readU2(buffer);
     return result;
 }
 
-InnerClasses_attribute ClassLoader::getAttributeInnerClasses(FILE *fp) {
+InnerClasses_attribute ClassLoader::getAttributeInnerClasses(ClassFileBuffer *buffer) {
     InnerClasses_attribute result;
-    result.number_of_classes = readU2(fp);
-    result.classes = (Class*) malloc(sizeof(Class) * result.number_of_classes);
+    result.number_of_classes = readU2(buffer);
+    result.classes = (Class*) buffer->arena->allocate(sizeof(Class) * result.number_of_classes);
     for (u2 i = 0; i < result.number_of_classes; i++) {
-        result.classes[i] = getClass(fp);
+        result.classes[i] = getClass(buffer);
     }
     return result;
 }
 
-Synthetic_attribute ClassLoader::getAttributeSynthetic(FILE *fp) {
+Synthetic_attribute ClassLoader::getAttributeSynthetic(ClassFileBuffer *) {
+    // o atributo não possui conteúdo (attribute_length é 0)
     Synthetic_attribute result;
     return result;
 }
 
-SourceFile_attribute ClassLoader::getAttributeSourceFile(FILE *fp) {
+SourceFile_attribute ClassLoader::getAttributeSourceFile(ClassFileBuffer *buffer) {
     SourceFile_attribute result;
-    result.sourcefile_index = readU2(fp);
+    result.sourcefile_index = readU2(buffer);
     return result;
 }
 
-LineNumberTable ClassLoader::getLineNumberTable(FILE *fp) {
+LineNumberTable ClassLoader::getLineNumberTable(ClassFileBuffer *buffer) {
     LineNumberTable result;
-    result.start_pc = readU2(fp);
-    result.line_number = readU2(fp);
+    result.start_pc = readU2(buffer);
+    result.line_number = readU2(buffer);
     return result;
 }
 
-LineNumberTable_attribute ClassLoader::getAttributeLineNumberTable(FILE *fp) {
+LineNumberTable_attribute ClassLoader::getAttributeLineNumberTable(ClassFileBuffer *buffer) {
     LineNumberTable_attribute result;
-    result.line_number_table_length = readU2(fp);
-    result.line_number_table = (LineNumberTable*) malloc(sizeof(LineNumberTable) * result.line_number_table_length);
+    result.line_number_table_length = readU2(buffer);
+    result.line_number_table = (LineNumberTable*) buffer->arena->allocate(sizeof(LineNumberTable) * result.line_number_table_length);
     for (u2 i = 0; i < result.line_number_table_length; i++) {
-        result.line_number_table[i] = getLineNumberTable(fp);
+        result.line_number_table[i] = getLineNumberTable(buffer);
     }
     return result;
 }
 
-LocalVariableTable ClassLoader::getLocalVariableTable(FILE *fp) {
+LocalVariableTable ClassLoader::getLocalVariableTable(ClassFileBuffer *buffer) {
     LocalVariableTable result;
-    result.start_pc = readU2(fp);
-    result.length = readU2(fp);
-    result.name_index = readU2(fp);
-    result.descriptor_index = readU2(fp);
-    result.index = readU2(fp);
+    result.start_pc = readU2(buffer);
+    result.length = readU2(buffer);
+    result.name_index = readU2(buffer);
+    result.descriptor_index = readU2(buffer);
+    result.index = readU2(buffer);
     return result;
 }
 
-LocalVariableTable_attribute ClassLoader::getAttributeLocalVariable(FILE *fp) {
+LocalVariableTable_attribute ClassLoader::getAttributeLocalVariable(ClassFileBuffer *buffer) {
     LocalVariableTable_attribute result;
-    result.local_variable_table_length = readU2(fp);
-    result.localVariableTable = (LocalVariableTable*) malloc(sizeof(LocalVariableTable) * result.local_variable_table_length);
+    result.local_variable_table_length = readU2(buffer);
+    result.localVariableTable = (LocalVariableTable*) buffer->arena->allocate(sizeof(LocalVariableTable) * result.local_variable_table_length);
     for (u2 i = 0; i < result.local_variable_table_length; i++) {
-        result.localVariableTable[i] = getLocalVariableTable(fp);
+        result.localVariableTable[i] = getLocalVariableTable(buffer);
     }
     return result;
 }
 
-Deprecated_attribute ClassLoader::getAttributeDeprecated(FILE *fp) {
+Deprecated_attribute ClassLoader::getAttributeDeprecated(ClassFileBuffer *) {
+    // o atributo não possui conteúdo (attribute_length é 0)
     Deprecated_attribute result;
     return result;
 }
 
-attribute_info ClassLoader::getAttributeInfo(FILE *fp, ClassFile *classFile) {
+verification_type_info ClassLoader::getVerificationTypeInfo(ClassFileBuffer *buffer) {
+    verification_type_info result;
+    result.tag = readU1(buffer);
+    result.cpool_index = 0;
+    result.offset = 0;
+    
+    if (result.tag == ITEM_Object) {
+        result.cpool_index = readU2(buffer);
+    } else if (result.tag == ITEM_Uninitialized) {
+        result.offset = readU2(buffer);
+    } else if (result.tag > ITEM_Uninitialized) {
+        printf("ClassFormatError: tipo %d invalido no atributo StackMapTable\n", result.tag);
+        exit(3);
+    }
+    
+    return result;
+}
+
+stack_map_frame ClassLoader::getStackMapFrame(ClassFileBuffer *buffer) {
+    stack_map_frame result;
+    result.frame_type = readU1(buffer);
+    result.number_of_locals = 0;
+    result.locals = NULL;
+    result.number_of_stack_items = 0;
+    result.stack = NULL;
+    
+    u1 frameType = result.frame_type;
+    if (frameType <= 63) { // same_frame
+        result.offset_delta = frameType;
+    } else if (frameType <= 127) { // same_locals_1_stack_item_frame
+        result.offset_delta = frameType - 64;
+        result.number_of_stack_items = 1;
+    } else if (frameType < 247) {
+        printf("ClassFormatError: frame %d invalido no atributo StackMapTable\n", frameType);
+        exit(3);
+    } else if (frameType == 247) { // same_locals_1_stack_item_frame_extended
+        result.offset_delta = readU2(buffer);
+        result.number_of_stack_items = 1;
+    } else if (frameType <= 250) { // chop_frame
+        result.offset_delta = readU2(buffer);
+        result.number_of_locals = 251 - frameType;
+        return result;
+    } else if (frameType == 251) { // same_frame_extended
+        result.offset_delta = readU2(buffer);
+    } else if (frameType <= 254) { // append_frame
+        result.offset_delta = readU2(buffer);
+        result.number_of_locals = frameType - 251;
+    } else { // full_frame
+        result.offset_delta = readU2(buffer);
+        result.number_of_locals = readU2(buffer);
+    }
+    
+    if (result.number_of_locals > 0) {
+        result.locals = (verification_type_info*) buffer->arena->allocate(sizeof(verification_type_info) * result.number_of_locals);
+        for (u2 i = 0; i < result.number_of_locals; i++) {
+            result.locals[i] = getVerificationTypeInfo(buffer);
+        }
+    }
+    
+    if (frameType == 255) {
+        result.number_of_stack_items = readU2(buffer);
+    }
+    if (result.number_of_stack_items > 0) {
+        result.stack = (verification_type_info*) buffer->arena->allocate(sizeof(verification_type_info) * result.number_of_stack_items);
+        for (u2 i = 0; i < result.number_of_stack_items; i++) {
+            result.stack[i] = getVerificationTypeInfo(buffer);
+        }
+    }
+    
+    return result;
+}
+
+StackMapTable_attribute ClassLoader::getAttributeStackMapTable(ClassFileBuffer *buffer) {
+    StackMapTable_attribute result;
+    result.number_of_entries = readU2(buffer);
+    result.entries = (stack_map_frame*) buffer->arena->allocate(sizeof(stack_map_frame) * result.number_of_entries);
+    for (u2 i = 0; i < result.number_of_entries; i++) {
+        result.entries[i] = getStackMapFrame(buffer);
+    }
+    return result;
+}
+
+void ClassLoader::setKeepDebugAttributes(bool keep) {
+    _keepDebugAttributes = keep;
+}
+
+void ClassLoader::setVerify(bool verify) {
+    _verify = verify;
+}
+
+bool ClassLoader::skipDebugAttribute(ClassFileBuffer *buffer, ClassFile *classFile) {
+    if (_keepDebugAttributes) {
+        return false;
+    }
+    
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol lineNumberTableName = symbolTable.intern("LineNumberTable");
+    static Symbol localVariableTableName = symbolTable.intern("LocalVariableTable");
+    static Symbol sourceFileName = symbolTable.intern("SourceFile");
+    static Symbol innerClassesName = symbolTable.intern("InnerClasses");
+    static Symbol deprecatedName = symbolTable.intern("Deprecated");
+    
+    u4 start = buffer->offset;
+    u2 nameIndex = readU2(buffer);
+    u4 length = readU4(buffer);
+    
+    Symbol name = getUtf8FromConstantPool(nameIndex, classFile).symbol;
+    if (name == lineNumberTableName || name == localVariableTableName || name == sourceFileName || name == innerClassesName || name == deprecatedName) {
+        readBytes(buffer, length);
+        return true;
+    }
+    
+    buffer->offset = start;
+    return false;
+}
+
+attribute_info ClassLoader::getAttributeInfo(ClassFileBuffer *buffer, ClassFile *classFile) {
     attribute_info result;
-    result.attribute_name_index = readU2(fp);
-    result.attribute_length = readU4(fp);
+    result.attribute_name_index = readU2(buffer);
+    result.attribute_length = readU4(buffer);
     
     CONSTANT_Utf8_info name = getUtf8FromConstantPool(result.attribute_name_index, classFile);
     if (Utils::compareUtf8WithString(name, "ConstantValue")) {
-        result.info.constantValue_info = getAttributeConstantValue(fp);
+        result.info.constantValue_info = getAttributeConstantValue(buffer);
     } else if (Utils::compareUtf8WithString(name, "Code")) {
-        result.info.code_info = getAttributeCode(fp, classFile);
+        result.info.code_info = getAttributeCode(buffer, classFile);
     } else if (Utils::compareUtf8WithString(name, "Exceptions")) {
-        result.info.exceptions_info = getAttributeExceptions(fp);
+        result.info.exceptions_info = getAttributeExceptions(buffer);
     } else if (Utils::compareUtf8WithString(name, "InnerClasses")) {
-        result.info.innerClasses_info = getAttributeInnerClasses(fp);
+        result.info.innerClasses_info = getAttributeInnerClasses(buffer);
     } else if(Utils::compareUtf8WithString(name, "Synthetic")) {
-        result.info.synthetic_info = getAttributeSynthetic(fp);
+        result.info.synthetic_info = getAttributeSynthetic(buffer);
     } else if (Utils::compareUtf8WithString(name, "SourceFile")) {
-        result.info.sourceFile_info = getAttributeSourceFile(fp);
+        result.info.sourceFile_info = getAttributeSourceFile(buffer);
     } else if (Utils::compareUtf8WithString(name, "LineNumberTable")) {
-        result.info.lineNumberTable_info = getAttributeLineNumberTable(fp);
+        result.info.lineNumberTable_info = getAttributeLineNumberTable(buffer);
     } else if (Utils::compareUtf8WithString(name, "LocalVariableTable")) {
-        result.info.localVariableTable_info = getAttributeLocalVariable(fp);
+        result.info.localVariableTable_info = getAttributeLocalVariable(buffer);
     } else if(Utils::compareUtf8WithString(name, "Deprecated")) {
-        result.info.deprecated_info = getAttributeDeprecated(fp);
+        result.info.deprecated_info = getAttributeDeprecated(buffer);
+    } else if (Utils::compareUtf8WithString(name, "StackMapTable")) {
+        result.info.stackMapTable_info = getAttributeStackMapTable(buffer);
     } else {
-        cerr << "Arquivo .class possui uma um atributo invalido." << endl;
-        exit(6);
+        // atributos desconhecidos devem ser ignorados (JVMS §4.7.1): somente o nome e o tamanho são mantidos
+        memset(&result.info, 0, sizeof(result.info));
+        readBytes(buffer, result.attribute_length);
     }
     
     return result;
 }
 
-void ClassLoader::setMethodsCount(FILE *fp, ClassFile *classFile) {
-    classFile->methods_count = readU2(fp);
+void ClassLoader::setMethodsCount(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->methods_count = readU2(buffer);
 }
 
-void ClassLoader::setMethods(FILE *fp, ClassFile *classFile) {
-    classFile->methods = (method_info*) malloc(sizeof(method_info) * classFile->methods_count);
+void ClassLoader::setMethods(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->methods = (method_info*) buffer->arena->allocate(sizeof(method_info) * classFile->methods_count);
     for (u2 i = 0; i < classFile->methods_count; i++) {
-        classFile->methods[i].access_flags = readU2(fp);
-        classFile->methods[i].name_index = readU2(fp);
-        classFile->methods[i].descriptor_index = readU2(fp);
-        classFile->methods[i].attributes_count = readU2(fp);
+        method_info *method = &classFile->methods[i];
+        method->access_flags = readU2(buffer);
+        method->name_index = readU2(buffer);
+        method->descriptor_index = readU2(buffer);
+        method->attributes_count = readU2(buffer);
+        
+        method->attributes = NULL;
+        method->code = NULL;
+        method->exceptions = NULL;
+        method->stackMapTable = NULL;
+        new (&method->attributes_parsed) atomic<bool>(false); // a memória da arena não é construída
         
-        classFile->methods[i].attributes = (attribute_info*) malloc(sizeof(attribute_info) * classFile->methods[i].attributes_count);
-        for (u2 j = 0; j < classFile->methods[i].attributes_count; j++) {
-            classFile->methods[i].attributes[j] = getAttributeInfo(fp, classFile);
+        // os atributos são somente percorridos (cabeçalho de 6 bytes + attribute_length)
+        u4 start = buffer->offset;
+        for (u2 j = 0; j < method->attributes_count; j++) {
+            readU2(buffer);
+            u4 attributeLength = readU4(buffer);
+            readBytes(buffer, attributeLength);
         }
+        
+        method->attributes_bytes = buffer->bytes + start;
+        method->attributes_length = buffer->offset - start;
+    }
+}
+
+void ClassLoader::parseMethodAttributes(ClassFile *classFile, method_info *method) {
+    // caminho rápido, sem lock: os atributos já foram processados
+    if (method->attributes_parsed.load(memory_order_acquire)) {
+        return;
+    }
+    
+    lock_guard<mutex> lock(_attributesMutex);
+    if (method->attributes_parsed.load(memory_order_relaxed)) {
+        return;
+    }
+    
+    ClassFileBuffer classFileBuffer;
+    classFileBuffer.bytes = method->attributes_bytes;
+    classFileBuffer.length = method->attributes_length;
+    classFileBuffer.offset = 0;
+    classFileBuffer.arena = classFile->arena;
+    ClassFileBuffer *buffer = &classFileBuffer;
+    
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol codeName = symbolTable.intern("Code");
+    static Symbol exceptionsName = symbolTable.intern("Exceptions");
+    static Symbol stackMapTableName = symbolTable.intern("StackMapTable");
+    
+    method->attributes = (attribute_info*) buffer->arena->allocate(sizeof(attribute_info) * method->attributes_count);
+    u2 keptAttributes = 0;
+    for (u2 j = 0; j < method->attributes_count; j++) {
+        if (skipDebugAttribute(buffer, classFile)) continue;
+        
+        attribute_info *attribute = &method->attributes[keptAttributes++];
+        *attribute = getAttributeInfo(buffer, classFile);
+        
+        Symbol attributeName = Utils::getSymbol(classFile->constant_pool, attribute->attribute_name_index);
+        if (attributeName == codeName) {
+            method->code = &attribute->info.code_info;
+        } else if (attributeName == exceptionsName) {
+            method->exceptions = &attribute->info.exceptions_info;
+        }
+    }
+    
+    method->attributes_count = keptAttributes;
+    method->attributes_bytes = NULL;
+    
+    if (method->code != NULL) {
+        for (u2 j = 0; j < method->code->attributes_count; j++) {
+            attribute_info *attribute = &method->code->attributes[j];
+            if (Utils::getSymbol(classFile->constant_pool, attribute->attribute_name_index) == stackMapTableName) {
+                method->stackMapTable = &attribute->info.stackMapTable_info;
+            }
+        }
+        
+        // classes a partir da versão 50 são verificadas com os frames do StackMapTable, uma única vez por método
+        if (_verify && classFile->major_version >= 50) {
+            Verifier::verifyMethod(classFile, method);
+        }
+    }
+    
+    method->attributes_parsed.store(true, memory_order_release);
+}
+
+void ClassLoader::parseAllMethodAttributes(ClassFile *classFile) {
+    for (u2 i = 0; i < classFile->methods_count; i++) {
+        parseMethodAttributes(classFile, &classFile->methods[i]);
     }
 }
 
-void ClassLoader::setAttributesCount(FILE *fp, ClassFile *classFile) {
-    classFile->attributes_count = readU2(fp);
+void ClassLoader::setAttributesCount(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->attributes_count = readU2(buffer);
 }
 
-void ClassLoader::setAttributes(FILE *fp, ClassFile *classFile) {
-    classFile->attributes = (attribute_info*) malloc(sizeof(attribute_info) * classFile->attributes_count);
+void ClassLoader::setAttributes(ClassFileBuffer *buffer, ClassFile *classFile) {
+    classFile->attributes = (attribute_info*) buffer->arena->allocate(sizeof(attribute_info) * classFile->attributes_count);
+    u2 keptAttributes = 0;
     for (u2 i = 0; i < classFile->attributes_count; i++) {
-        classFile->attributes[i] = getAttributeInfo(fp, classFile);
+        if (skipDebugAttribute(buffer, classFile)) continue;
+        classFile->attributes[keptAttributes++] = getAttributeInfo(buffer, classFile);
     }
+    classFile->attributes_count = keptAttributes;
 }
@@ -0,0 +1,155 @@
+#include "classpath.h"
+
+#include <iostream>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+ClassPath::ClassPath() : _classPath(".") {
+    addEntry(".");
+}
+
+ClassPath::~ClassPath() {
+    clear();
+}
+
+void ClassPath::clear() {
+    for (size_t i = 0; i < _entries.size(); i++) {
+        delete _entries[i].archive;
+    }
+    _entries.clear();
+    _missingClasses.clear();
+}
+
+void ClassPath::setClassPath(const string &classPath) {
+    clear();
+    _classPath = classPath;
+
+    bool hasCurrentDirectory = false;
+    size_t start = 0;
+    while (start <= classPath.size()) {
+        size_t end = classPath.find(':', start);
+        if (end == string::npos) {
+            end = classPath.size();
+        }
+
+        string path = classPath.substr(start, end - start);
+        if (path.empty() || path == "." || path == "./") {
+            path = ".";
+            hasCurrentDirectory = true;
+        }
+        addEntry(path);
+
+        start = end + 1;
+    }
+
+    if (!hasCurrentDirectory) {
+        addEntry(".");
+    }
+}
+
+void ClassPath::addEntry(const string &path) {
+    ClassPathEntry entry;
+    entry.archive = NULL;
+
+    string extension = (path.size() >= 4) ? path.substr(path.size() - 4) : "";
+    if (extension == ".jar" || extension == ".zip") {
+        entry.archive = new ZipArchive(path);
+        if (!entry.archive->isOpen()) {
+            cerr << "Aviso: arquivo " << path << " do class path não pôde ser aberto." << endl;
+        }
+    } else {
+        entry.directory = (path[path.size() - 1] == '/') ? path : path + "/";
+    }
+
+    _entries.push_back(entry);
+}
+
+bool ClassPath::findClass(const string &fileName, const u1 **bytes, u4 *length, AdoptedMemory *memory) {
+    {
+        lock_guard<mutex> lock(_missingClassesMutex);
+        if (_missingClasses.count(fileName) > 0) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < _entries.size(); i++) {
+        ClassPathEntry &entry = _entries[i];
+
+        if (entry.archive != NULL) {
+            if (entry.archive->readEntry(fileName, bytes, length, memory)) {
+                return true;
+            }
+        } else {
+            // o diretório atual não recebe prefixo, para manter o caminho relativo das mensagens de erro
+            string path = (entry.directory == "./") ? fileName : entry.directory + fileName;
+            if (mapFile(path, bytes, length, memory)) {
+                return true;
+            }
+        }
+    }
+
+    lock_guard<mutex> lock(_missingClassesMutex);
+    _missingClasses.insert(fileName);
+    return false;
+}
+
+bool ClassPath::getClassStamp(const string &fileName, ClassFileStamp *stamp) {
+    for (size_t i = 0; i < _entries.size(); i++) {
+        ClassPathEntry &entry = _entries[i];
+        stamp->entryIndex = i;
+
+        if (entry.archive != NULL) {
+            u4 modificationTime;
+            if (entry.archive->getEntryStamp(fileName, &stamp->length, &modificationTime)) {
+                stamp->modificationTime = modificationTime;
+                return true;
+            }
+        } else {
+            string path = (entry.directory == "./") ? fileName : entry.directory + fileName;
+            struct stat fileStat;
+            if (stat(path.c_str(), &fileStat) == 0) {
+                stamp->length = fileStat.st_size;
+                stamp->modificationTime = (int64_t) fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+const string& ClassPath::getClassPath() {
+    return _classPath;
+}
+
+bool ClassPath::mapFile(const string &path, const u1 **bytes, u4 *length, AdoptedMemory *memory) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    // o arquivo inteiro é mapeado em memória, e o mapeamento é desfeito somente quando a classe é descarregada, pois as
+    // estruturas da classe apontam para ele.
+    struct stat fileStat;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        cerr << "ClassFormatError: " << path << endl;
+        exit(3);
+    }
+
+    *bytes = (const u1 *) mapping;
+    *length = fileStat.st_size;
+    memory->address = mapping;
+    memory->length = fileStat.st_size;
+    memory->mapped = true;
+    return true;
+}
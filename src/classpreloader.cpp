@@ -0,0 +1,145 @@
+#include "classpreloader.h"
+#include "classloader.h"
+#include "classpath.h"
+#include "sharedarchive.h"
+#include "symboltable.h"
+#include "utils.h"
+
+ClassPreloader::ClassPreloader() : _stopping(false) {
+    // os singletons usados pelas threads auxiliares são criados antes, para que sejam destruídos depois deste
+    ClassPath::getInstance();
+    ClassLoader::getInstance();
+    SymbolTable::getInstance();
+    SharedArchive::getInstance();
+}
+
+ClassPreloader::~ClassPreloader() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+
+    for (size_t i = 0; i < _workers.size(); i++) {
+        if (_workers[i].get_id() == this_thread::get_id()) {
+            _workers[i].detach(); // o programa foi encerrado por uma thread auxiliar (e.g. ClassFormatError)
+        } else {
+            _workers[i].join();
+        }
+    }
+
+    // o ClassFile está na sua própria arena, que também libera o arquivo .class adotado
+    lock_guard<mutex> lock(_mutex);
+    for (unordered_map<string, ClassFile*>::iterator it = _preloadedClasses.begin(); it != _preloadedClasses.end(); it++) {
+        if (it->second != NULL) {
+            delete it->second->arena;
+        }
+    }
+    _preloadedClasses.clear();
+}
+
+void ClassPreloader::start(unsigned int threadsCount) {
+    for (unsigned int i = 0; i < threadsCount; i++) {
+        _workers.push_back(thread(&ClassPreloader::workerLoop, this));
+    }
+}
+
+void ClassPreloader::scheduleReferences(ClassFile *classFile) {
+    if (_workers.empty()) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        scheduleReferencesLocked(classFile);
+    }
+    _workAvailable.notify_all();
+}
+
+void ClassPreloader::scheduleReferencesLocked(ClassFile *classFile) {
+    SharedArchive &sharedArchive = SharedArchive::getInstance();
+
+    for (u2 i = 1; i < classFile->constant_pool_count; i++) {
+        if (classFile->constant_pool[i-1].tag != CONSTANT_Class) {
+            continue;
+        }
+
+        const string &className = *Utils::getSymbol(classFile->constant_pool, i);
+        if (className[0] == '[' || _states.count(className) > 0 || sharedArchive.getSharedClass(className) != NULL) {
+            continue;
+        }
+
+        _states[className] = PRELOAD_QUEUED;
+        _queue.push_back(className);
+    }
+}
+
+ClassFile* ClassPreloader::takeClass(const string &className) {
+    if (_workers.empty()) {
+        return NULL;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+
+    unordered_map<string, PreloadState>::iterator it = _states.find(className);
+    if (it == _states.end() || it->second == PRELOAD_QUEUED) {
+        // a thread de execução carrega a classe, e as threads auxiliares não a processarão mais
+        _states[className] = PRELOAD_CLAIMED;
+        return NULL;
+    }
+
+    while (it->second == PRELOAD_LOADING) {
+        _classDone.wait(lock);
+    }
+
+    if (it->second == PRELOAD_CLAIMED) {
+        return NULL;
+    }
+
+    it->second = PRELOAD_CLAIMED;
+    ClassFile *classFile = _preloadedClasses[className];
+    _preloadedClasses.erase(className);
+    return classFile;
+}
+
+void ClassPreloader::workerLoop() {
+    ClassPath &classPath = ClassPath::getInstance();
+    ClassLoader &classLoader = ClassLoader::getInstance();
+
+    unique_lock<mutex> lock(_mutex);
+    while (true) {
+        while (!_stopping && _queue.empty()) {
+            _workAvailable.wait(lock);
+        }
+        if (_stopping) {
+            return;
+        }
+
+        string className = _queue.front();
+        _queue.pop_front();
+
+        if (_states[className] != PRELOAD_QUEUED) { // já obtida pela thread de execução
+            continue;
+        }
+        _states[className] = PRELOAD_LOADING;
+
+        lock.unlock();
+        const u1 *bytes;
+        u4 length;
+        AdoptedMemory memory;
+        ClassFile *classFile = NULL;
+        if (classPath.findClass(className + ".class", &bytes, &length, &memory)) {
+            classFile = classLoader.readClassFile(bytes, length);
+            classFile->arena->adopt(memory);
+        }
+        lock.lock();
+
+        _states[className] = PRELOAD_DONE;
+        _preloadedClasses[className] = classFile;
+        if (classFile != NULL) {
+            scheduleReferencesLocked(classFile);
+            _workAvailable.notify_all();
+        }
+        _classDone.notify_all();
+    }
+}
@@ -1,10 +1,17 @@
 #include "classruntime.h"
-#include "classviewer.h"
+#include "utils.h"
+#include "heap.h"
+#include "arena.h"
+#include "monitor.h"
+#include "classinstance.h"
+#include "methodarea.h"
+#include "executionengine.h"
 
 #include <iostream>
 #include <cstdlib>
+#include <cassert>
 
-ClassRuntime::ClassRuntime(ClassFile *classFile) : _classFile(classFile) {
+ClassRuntime::ClassRuntime(ClassFile *classFile, LoaderScope *scope) : _classFile(classFile), _scope(scope), _instanceSize(sizeof(ClassInstance)), _layoutReady(false), _stringConstants(classFile->constant_pool_count), _initialized(false), _initializingThread(0), _lockWord(0) {
     field_info *fields = classFile->fields;
     for (int i = 0; i < classFile->fields_count; i++) {
         field_info field = fields[i];
@@ -12,64 +19,35 @@ ClassRuntime::ClassRuntime(ClassFile *classFile) : _classFile(classFile) {
         u2 finalFlag = 0x0010;
         
         if ((field.access_flags & staticFlag) != 0 && (field.access_flags & finalFlag) == 0) { // estática e não final
-            string fieldName = getFormattedConstant(classFile->constant_pool, field.name_index);
-            string fieldDescriptor = getFormattedConstant(classFile->constant_pool, field.descriptor_index);
+            Symbol fieldName = Utils::getSymbol(classFile->constant_pool, field.name_index);
+            Symbol fieldDescriptor = Utils::getSymbol(classFile->constant_pool, field.descriptor_index);
             
-            char fieldType = fieldDescriptor[0];
-            Value value;
-            
-            switch (fieldType) {
-                case 'B':
-                    value.type = ValueType::BYTE;
-                    value.data.byteValue = 0;
-                    break;
-                case 'C':
-                    value.type = ValueType::CHAR;
-                    value.data.charValue = 0;
-                    break;
-                case 'D':
-                    value.type = ValueType::DOUBLE;
-                    value.data.doubleValue = 0;
-                    break;
-                case 'F':
-                    value.type = ValueType::FLOAT;
-                    value.data.floatValue = 0;
-                    break;
-                case 'I':
-                    value.type = ValueType::INT;
-                    value.data.intValue = 0;
-                    break;
-                case 'J':
-                    value.type = ValueType::LONG;
-                    value.data.longValue = 0;
-                    break;
-                case 'S':
-                    value.type = ValueType::SHORT;
-                    value.data.shortValue = 0;
-                    break;
-                case 'Z':
-                    value.type = ValueType::BOOLEAN;
-                    value.data.charValue = false;
-                    break;
-                default:
-                    value.type = ValueType::REFERENCE;
-                    value.data.object = NULL;
-            }
-            
-            putValueIntoField(value, fieldName);
+            putValueIntoField(defaultFieldValue(fieldDescriptor), fieldName);
         }
     }
 }
 
+ClassRuntime::~ClassRuntime() {
+    // o próprio ClassFile está na arena, portanto nada dele pode ser acessado após a liberação
+    Arena *arena = _classFile->arena;
+    delete arena;
+    
+    Monitor::release(_lockWord);
+}
+
 ClassFile* ClassRuntime::getClassFile() {
     return _classFile;
 }
 
-void ClassRuntime::putValueIntoField(Value value, string fieldName) {
+LoaderScope* ClassRuntime::getScope() {
+    return _scope;
+}
+
+void ClassRuntime::putValueIntoField(Value value, Symbol fieldName) {
     _staticFields[fieldName] = value;
 }
 
-Value ClassRuntime::getValueFromField(string fieldName) {
+Value ClassRuntime::getValueFromField(Symbol fieldName) {
     if (_staticFields.count(fieldName) ==  0) {
         cerr << "NoSuchFieldError" << endl;
         exit(1);
@@ -79,6 +57,217 @@ Value ClassRuntime::getValueFromField(string fieldName) {
 }
 
 
-bool ClassRuntime::fieldExists(string fieldName) {
+bool ClassRuntime::fieldExists(Symbol fieldName) {
     return _staticFields.count(fieldName) > 0;
-}
\ No newline at end of file
+}
+
+const map<Symbol, Value>& ClassRuntime::getStaticFields() {
+    return _staticFields;
+}
+
+Value ClassRuntime::defaultFieldValue(Symbol fieldDescriptor) {
+    char fieldType = (*fieldDescriptor)[0];
+    Value value;
+    value.data.longValue = 0;
+    
+    switch (fieldType) {
+        case 'B':
+            value.type = ValueType::BYTE;
+            break;
+        case 'C':
+            value.type = ValueType::CHAR;
+            break;
+        case 'D':
+            value.type = ValueType::DOUBLE;
+            break;
+        case 'F':
+            value.type = ValueType::FLOAT;
+            break;
+        case 'I':
+            value.type = ValueType::INT;
+            break;
+        case 'J':
+            value.type = ValueType::LONG;
+            break;
+        case 'S':
+            value.type = ValueType::SHORT;
+            break;
+        case 'Z':
+            value.type = ValueType::BOOLEAN;
+            break;
+        default:
+            value.type = ValueType::REFERENCE;
+    }
+    value.printType = value.type;
+    
+    return value;
+}
+
+u4 ClassRuntime::fieldSize(ValueType type) {
+    switch (type) {
+        case ValueType::BOOLEAN:
+        case ValueType::BYTE:
+            return 1;
+        case ValueType::CHAR:
+        case ValueType::SHORT:
+            return 2;
+        case ValueType::INT:
+        case ValueType::FLOAT:
+            return 4;
+        case ValueType::REFERENCE:
+            return Heap::usesCompressedReferences() ? 4 : sizeof(Object *);
+        default:
+            return 8;
+    }
+}
+
+u4 ClassRuntime::takeGap(vector<pair<u4, u4> > &gaps, u4 size) {
+    for (size_t i = 0; i < gaps.size(); i++) {
+        u4 start = gaps[i].first;
+        u4 end = gaps[i].second;
+        u4 offset = (start + size - 1) & ~(size - 1);
+        if (offset + size > end) {
+            continue;
+        }
+        
+        // as sobras antes e depois do field continuam disponíveis para fields menores
+        gaps.erase(gaps.begin() + i);
+        if (start < offset) {
+            gaps.push_back(make_pair(start, offset));
+        }
+        if (offset + size < end) {
+            gaps.push_back(make_pair(offset + size, end));
+        }
+        return offset;
+    }
+    
+    return 0;
+}
+
+void ClassRuntime::prepareInstanceLayout() {
+    if (_layoutReady.load(memory_order_acquire)) {
+        return;
+    }
+    
+    map<Symbol, InstanceField> instanceFields;
+    vector<u4> referenceOffsets;
+    vector<pair<u4, u4> > gaps;
+    u4 instanceSize = sizeof(ClassInstance);
+    
+    // a superclasse é carregada sem nenhum lock, pois o carregamento pode aguardar a inicialização por outra thread
+    if (_classFile->super_class != 0) {
+        Symbol superClassName = Utils::getSymbol(_classFile->constant_pool, _classFile->super_class);
+        if (!ExecutionEngine::getInstance().isSimulatedClass(superClassName)) {
+            ClassRuntime *superClass = MethodArea::getInstance().loadClassNamed(superClassName);
+            superClass->prepareInstanceLayout();
+            instanceFields = superClass->_instanceFields;
+            referenceOffsets = superClass->_referenceOffsets;
+            gaps = superClass->_layoutGaps;
+            instanceSize = superClass->_instanceSize;
+        }
+    }
+    
+    // os fields são dispostos do maior para o menor, cada um alinhado ao seu tamanho, e os fields menores ocupam
+    // primeiro os espaços deixados pelo alinhamento (inclusive os da superclasse)
+    field_info *fields = _classFile->fields;
+    for (u4 size = 8; size >= 1; size /= 2) {
+        for (int i = 0; i < _classFile->fields_count; i++) {
+            field_info field = fields[i];
+            u2 staticFlag = 0x0008;
+            if ((field.access_flags & staticFlag) != 0) {
+                continue;
+            }
+            
+            Symbol fieldDescriptor = Utils::getSymbol(_classFile->constant_pool, field.descriptor_index);
+            InstanceField instanceField;
+            instanceField.type = defaultFieldValue(fieldDescriptor).type;
+            if (fieldSize(instanceField.type) != size) {
+                continue;
+            }
+            
+            instanceField.offset = takeGap(gaps, size);
+            if (instanceField.offset == 0) {
+                instanceField.offset = (instanceSize + size - 1) & ~(size - 1);
+                if (instanceSize < instanceField.offset) {
+                    gaps.push_back(make_pair(instanceSize, instanceField.offset));
+                }
+                instanceSize = instanceField.offset + size;
+            }
+            
+            if (instanceField.type == ValueType::REFERENCE) {
+                referenceOffsets.push_back(instanceField.offset);
+            }
+            instanceFields[Utils::getSymbol(_classFile->constant_pool, field.name_index)] = instanceField;
+        }
+    }
+    
+    // caso duas threads calculem a disposição ao mesmo tempo, somente a primeira é usada
+    lock_guard<mutex> lock(_layoutMutex);
+    if (!_layoutReady.load(memory_order_relaxed)) {
+        _instanceFields.swap(instanceFields);
+        _referenceOffsets.swap(referenceOffsets);
+        _layoutGaps.swap(gaps);
+        _instanceSize = instanceSize;
+        _layoutReady.store(true, memory_order_release);
+    }
+}
+
+const InstanceField* ClassRuntime::getInstanceField(Symbol fieldName) {
+    map<Symbol, InstanceField>::const_iterator it = _instanceFields.find(fieldName);
+    return (it != _instanceFields.end()) ? &it->second : NULL;
+}
+
+const vector<u4>& ClassRuntime::getReferenceOffsets() {
+    return _referenceOffsets;
+}
+
+u4 ClassRuntime::getInstanceSize() {
+    return _instanceSize;
+}
+
+StringObject* ClassRuntime::getStringConstant(u2 index) {
+    StringObject *stringObject = _stringConstants[index].load(memory_order_acquire);
+    if (stringObject != NULL) {
+        return stringObject;
+    }
+    
+    cp_info *constantPool = _classFile->constant_pool;
+    assert(constantPool[index-1].tag == CONSTANT_String);
+    
+    CONSTANT_Utf8_info utf8Info = constantPool[constantPool[index-1].info.string_info.string_index-1].info.utf8_info;
+    string s((const char *) utf8Info.bytes, utf8Info.length);
+    
+    Heap &heap = Heap::getInstance();
+    stringObject = heap.internString(s);
+    
+    // caso outra thread tenha resolvido a constante antes, o objeto publicado por ela é usado
+    StringObject *expected = NULL;
+    if (!_stringConstants[index].compare_exchange_strong(expected, stringObject, memory_order_acq_rel)) {
+        return expected;
+    }
+    return stringObject;
+}
+
+bool ClassRuntime::isStringConstantResolved(u2 index) {
+    return _stringConstants[index].load(memory_order_acquire) != NULL;
+}
+
+bool ClassRuntime::isInitialized() {
+    return _initialized.load(memory_order_acquire);
+}
+
+void ClassRuntime::setInitialized(bool initialized) {
+    _initialized.store(initialized, memory_order_release);
+}
+
+uintptr_t ClassRuntime::getInitializingThread() {
+    return _initializingThread;
+}
+
+void ClassRuntime::setInitializingThread(uintptr_t initializingThread) {
+    _initializingThread = initializingThread;
+}
+
+atomic<uintptr_t>& ClassRuntime::getLockWord() {
+    return _lockWord;
+}
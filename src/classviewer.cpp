@@ -10,6 +10,7 @@
 
 #include "classviewer.h"
 #include "utils.h"
+#include "classloader.h"
 
 using namespace std;
 
@@ -125,6 +126,20 @@ void print_ConstantPool(ClassFile *classFile) {
             fprintf(out,"\t\t Length of byte array: \t\t %hu\n", utf8Info.length);
             fprintf(out,"\t\t Length of string: \t\t %lu\n", strlen(str)); // MUDAR ISSO
             fprintf(out,"\t\t String: \t\t\t %s\n", str);
+        } else if (element.tag == CONSTANT_MethodHandle) {
+            CONSTANT_MethodHandle_info methodHandleInfo = element.info.methodHandle_info;
+            fprintf(out,"\t [%d] CONSTANT_MethodHandle_info\n", i+1);
+            fprintf(out,"\t\t Reference kind: \t\t %hhu\n", methodHandleInfo.reference_kind);
+            fprintf(out,"\t\t Reference: \t\t\t cp_info #%hu <%s>\n", methodHandleInfo.reference_index, getFormattedConstant(constantPool, methodHandleInfo.reference_index));
+        } else if (element.tag == CONSTANT_MethodType) {
+            CONSTANT_MethodType_info methodTypeInfo = element.info.methodType_info;
+            fprintf(out,"\t [%d] CONSTANT_MethodType_info\n", i+1);
+            fprintf(out,"\t\t Descriptor: \t\t\t cp_info #%hu <%s>\n", methodTypeInfo.descriptor_index, getFormattedConstant(constantPool, methodTypeInfo.descriptor_index));
+        } else if (element.tag == CONSTANT_InvokeDynamic) {
+            CONSTANT_InvokeDynamic_info invokeDynamicInfo = element.info.invokeDynamic_info;
+            fprintf(out,"\t [%d] CONSTANT_InvokeDynamic_info\n", i+1);
+            fprintf(out,"\t\t Bootstrap method: \t\t #%hu\n", invokeDynamicInfo.bootstrap_method_attr_index);
+            fprintf(out,"\t\t Name and type: \t\t cp_info #%hu <%s>\n", invokeDynamicInfo.name_and_type_index, getFormattedConstant(constantPool, invokeDynamicInfo.name_and_type_index));
         } else if (element.tag == CONSTANT_NULL) {
             fprintf(out,"\t [%d] (large numeric continued)\n", i+1);
         } else {
@@ -169,9 +184,11 @@ void print_Fields(ClassFile *classFile) {
 
 
 void print_Methods(ClassFile *classFile) {
+    // a visualização mostra os atributos de todos os métodos, inclusive os que não foram executados
+    ClassLoader::getInstance().parseAllMethodAttributes(classFile);
     
     for (int i = 0; i < classFile->methods_count; i++) {
-        method_info method = classFile->methods[i];
+        method_info &method = classFile->methods[i];
         const char *methodName = getFormattedConstant(classFile->constant_pool, method.name_index);
         const char *descriptor = getFormattedConstant(classFile->constant_pool, method.descriptor_index);
         const char *accessFlags = getAccessFlags(method.access_flags);
@@ -257,36 +274,27 @@ const char* getFormattedConstant(cp_info* constantPool, u2 index) {
         return getFormattedConstant(constantPool, stringInfo.string_index);
     } else if (constant.tag == CONSTANT_Integer) {
         CONSTANT_Integer_info intInfo = constant.info.integer_info;
-        int32_t number = intInfo.bytes;
+        int32_t number = intInfo.value;
         char *s = (char*) malloc(sizeof(char)*100);
         sprintf(s, "%d", number);
         return s;
     } else if (constant.tag == CONSTANT_Float) {
         CONSTANT_Float_info floatInfo = constant.info.float_info;
-        
-        int32_t s = ((floatInfo.bytes >> 31) == 0) ? 1 : -1;
-        int32_t e = ((floatInfo.bytes >> 23) & 0xff);
-        int32_t m = (e == 0) ? (floatInfo.bytes & 0x7fffff) << 1 : (floatInfo.bytes & 0x7fffff) | 0x800000;
-        float number = s * m * pow(2, e-150);
+        float number = floatInfo.value;
         
         char *str = (char*) malloc(sizeof(char)*100);
         sprintf(str, "%f", number);
         return str;
     } else if (constant.tag == CONSTANT_Long) {
         CONSTANT_Long_info longInfo = constant.info.long_info;
-        int64_t number = ((int64_t) longInfo.high_bytes << 32) + longInfo.low_bytes;
+        int64_t number = longInfo.value;
         
         char *str = (char*) malloc(sizeof(char)*100);
         sprintf(str, "%lld", number);
         return str;
     } else if (constant.tag == CONSTANT_Double) {
         CONSTANT_Double_info doubleInfo = constant.info.double_info;
-        int64_t bytes = ((int64_t) doubleInfo.high_bytes << 32) + doubleInfo.low_bytes;
-        
-        int32_t s = ((bytes >> 63) == 0) ? 1 : -1;
-        int32_t e = (int32_t)((bytes >> 52) & 0x7ffL);
-        int64_t m = (e == 0) ? (bytes & 0xfffffffffffffL) << 1 : (bytes & 0xfffffffffffffL) | 0x10000000000000L;
-        double number = s * m * pow(2, e-1075);
+        double number = doubleInfo.value;
         
         char *str = (char*) malloc(sizeof(char)*100);
         sprintf(str, "%f", number);
@@ -303,16 +311,20 @@ const char* getFormattedConstant(cp_info* constantPool, u2 index) {
         
         return result;
     } else if (constant.tag == CONSTANT_Utf8) {
-        CONSTANT_Utf8_info utf8_info = constant.info.utf8_info;
-        char *str = (char*) malloc((utf8_info.length + 1) * sizeof(char));
-        
-        uint16_t j = 0;
-        for (uint16_t i = 0; i < utf8_info.length; i++) {
-            if (isprint(utf8_info.bytes[i])) str[j++] = utf8_info.bytes[i];
-        }
-        str[j] = '\0';
+        return constant.info.utf8_info.symbol->c_str();
+    } else if (constant.tag == CONSTANT_MethodHandle) {
+        CONSTANT_MethodHandle_info methodHandleInfo = constant.info.methodHandle_info;
+        return getFormattedConstant(constantPool, methodHandleInfo.reference_index);
+    } else if (constant.tag == CONSTANT_MethodType) {
+        CONSTANT_MethodType_info methodTypeInfo = constant.info.methodType_info;
+        return getFormattedConstant(constantPool, methodTypeInfo.descriptor_index);
+    } else if (constant.tag == CONSTANT_InvokeDynamic) {
+        CONSTANT_InvokeDynamic_info invokeDynamicInfo = constant.info.invokeDynamic_info;
+        CONSTANT_NameAndType_info nameAndTypeInfo = constantPool[invokeDynamicInfo.name_and_type_index-1].info.nameAndType_info;
         
-        return str;
+        stringstream ss;
+        ss << "#" << invokeDynamicInfo.bootstrap_method_attr_index << ":" << getFormattedConstant(constantPool, nameAndTypeInfo.name_index);
+        return Utils::streamToCString(ss);
     } else {
         cerr << "Arquivo .class possui uma tag " << constant.tag << " invalida no pool de constantes." << endl;
         exit(5);
@@ -432,9 +444,25 @@ void print_AttributeInfo(attribute_info attributeInfo, uint32_t index, cp_info *
         }
     } else if (Utils::compareUtf8WithString(attributeUtf8, "Deprecated")) {
         // vazio
+    } else if (Utils::compareUtf8WithString(attributeUtf8, "StackMapTable")) {
+        StackMapTable_attribute stackMapTable = attributeInfo.info.stackMapTable_info;
+        Utils::printTabs(out, indentation+1);
+        fprintf(out,"Nr.\t frame_type\t offset_delta\t locals\t stack\n");
+        for (uint16_t i = 0; i < stackMapTable.number_of_entries; i++) {
+            stack_map_frame frame = stackMapTable.entries[i];
+            Utils::printTabs(out, indentation+1);
+            fprintf(out,"%d\t ", i);
+            fprintf(out,"%d\t ", frame.frame_type);
+            fprintf(out,"%d\t ", frame.offset_delta);
+            if (frame.frame_type >= 248 && frame.frame_type <= 250) {
+                fprintf(out,"-%d\t ", frame.number_of_locals); // chop_frame
+            } else {
+                fprintf(out,"%d\t ", frame.number_of_locals);
+            }
+            fprintf(out,"%d\n", frame.number_of_stack_items);
+        }
     } else {
-        cerr << "Arquivo .class possui uma um atributo invalido." << endl;
-        exit(6);
+        // atributo desconhecido: somente o nome e o tamanho são mostrados
     }
     fprintf(out, "\n");
 }
@@ -489,6 +517,10 @@ void printByteCode(Code_attribute codeAttribute, cp_info *constantPool, uint8_t
             fprintf(out," #%d <%s> count %d\n", number, getFormattedConstant(constantPool, number), code[i+3]);
             assert(code[i+4] == 0);
             i += 5;
+        } else if (code[i] == 0xba) { // invokedynamic - usa CP
+            u2 number = (code[i+1] << 8) | code[i+2];
+            fprintf(out," #%d <%s>\n", number, getFormattedConstant(constantPool, number));
+            i += 5;
         } else if (code[i] == 0xc8 || code[i] == 0xc9) { // goto_w e jsr_w
             int32_t number = (code[i+1] << 24) | (code[i+2] << 16) | (code[i+3] << 8) | code[i+4];
             fprintf(out," %d (%+d)\n", i+number, number);
@@ -3,21 +3,33 @@
 #include "vmstack.h"
 #include "frame.h"
 #include "arrayobject.h"
-#include "classviewer.h"
 #include "stringobject.h"
 #include "classruntime.h"
 #include "methodarea.h"
+#include "heap.h"
+#include "symboltable.h"
+#include "threadmanager.h"
+#include "scheduler.h"
+#include "monitor.h"
+#include "garbagecollector.h"
+#include "allocationprofiler.h"
+#include "utils.h"
 
 #include <iostream>
 #include <cassert>
 #include <queue>
+#include <algorithm>
 
 #include <cmath>
 #include <cfloat>
 #include <cstdlib>
 #include <cstdlib>
+#include <thread>
+#include <chrono>
 
-ExecutionEngine::ExecutionEngine() : _isWide(false) {
+thread_local bool ExecutionEngine::_isWide = false;
+
+ExecutionEngine::ExecutionEngine() {
     initInstructions();
 }
 
@@ -27,35 +39,374 @@ ExecutionEngine::~ExecutionEngine() {
 
 void ExecutionEngine::startExecutionEngine(ClassRuntime *classRuntime) {
     VMStack &stackFrame = VMStack::getInstance();
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.leaveSafeRegion();
 
     vector<Value> arguments;
     Value commandLineArgs;
     commandLineArgs.type = ValueType::REFERENCE;
-    commandLineArgs.data.object = new ArrayObject(ValueType::REFERENCE);
+    commandLineArgs.data.object = ArrayObject::create(ValueType::REFERENCE, 0);
     arguments.push_back(commandLineArgs);
 
-    stackFrame.addFrame(new Frame(classRuntime, "main", "([Ljava/lang/String;)V", arguments));
+    stackFrame.addFrame(new Frame(classRuntime, symbolTable.intern("main"), symbolTable.intern("([Ljava/lang/String;)V"), arguments));
 
-    if (doesMethodExist(classRuntime, "<clinit>", "()V")) {
-        stackFrame.addFrame(new Frame(classRuntime, "<clinit>", "()V", arguments));
+    Symbol clinitName = symbolTable.intern("<clinit>");
+    Symbol clinitDescriptor = symbolTable.intern("()V");
+    if (doesMethodExist(classRuntime, clinitName, clinitDescriptor)) {
+        stackFrame.addFrame(new Frame(classRuntime, clinitName, clinitDescriptor, arguments));
     }
 
+    executeFrames();
+    garbageCollector.enterSafeRegion();
+    
+    // a JVM termina somente quando todas as threads Java terminarem
+    ThreadManager::getInstance().joinAllThreads();
+}
+
+void ExecutionEngine::executeFrames() {
+    VMStack &stackFrame = VMStack::getInstance();
+    
     while (stackFrame.size() > 0) {
+        GarbageCollector::safepoint();
+        
+        Frame *topFrame = stackFrame.getTopFrame();
+        u1 *code = topFrame->getCode(topFrame->pc);
+        (*this.*_instructionFunctions[code[0]])();
+    }
+}
+
+bool ExecutionEngine::executeSlice(uint32_t instructions) {
+    VMStack &stackFrame = VMStack::getInstance();
+    GreenThread *greenThread = Scheduler::currentGreenThread();
+    
+    for (uint32_t i = 0; stackFrame.size() > 0; i++) {
+        // a thread não é suspensa entre um wide e a instrução modificada por ele
+        if ((i >= instructions || greenThread->yieldRequested) && !_isWide) {
+            greenThread->yieldRequested = false;
+            return false;
+        }
+        
+        GarbageCollector::safepoint();
+        
         Frame *topFrame = stackFrame.getTopFrame();
+        if (topFrame->isMonitorPending()) {
+            if (!enterMonitor(topFrame->getLockWord())) {
+                return false;
+            }
+            topFrame->setMonitorPending(false);
+        }
+        
         u1 *code = topFrame->getCode(topFrame->pc);
         (*this.*_instructionFunctions[code[0]])();
+        
+        if (greenThread->state.load(memory_order_relaxed) == GREEN_PARKING) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool ExecutionEngine::enterMonitor(atomic<uintptr_t> &lockWord) {
+    if (Scheduler::currentGreenThread() == NULL) {
+        Monitor::enter(lockWord);
+        return true;
+    }
+    
+    if (Monitor::tryEnter(lockWord)) {
+        return true;
+    }
+    
+    // o lock pode ter sido liberado antes de a thread ser estacionada
+    Scheduler &scheduler = Scheduler::getInstance();
+    scheduler.park(&lockWord);
+    if (Monitor::tryEnter(lockWord)) {
+        scheduler.cancelPark();
+        return true;
+    }
+    return false;
+}
+
+bool ExecutionEngine::isSimulatedClass(Symbol className) {
+    // as classes que possuem um arquivo .class no diretório java/
+    static const char *runtimeClasses[] = {
+        "java/lang/Object", "java/lang/Thread", "java/lang/Runnable", "java/lang/Throwable", "java/lang/Error",
+        "java/lang/VirtualMachineError", "java/lang/OutOfMemoryError"
+    };
+    
+    if (className->find("java/") == string::npos) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(runtimeClasses) / sizeof(runtimeClasses[0]); i++) {
+        if (*className == runtimeClasses[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ExecutionEngine::isSubclassOf(ClassRuntime *classRuntime, Symbol className) {
+    MethodArea &methodArea = MethodArea::getInstance();
+    
+    while (true) {
+        ClassFile *classFile = classRuntime->getClassFile();
+        if (Utils::getSymbol(classFile->constant_pool, classFile->this_class) == className) {
+            return true;
+        }
+        if (classFile->super_class == 0) {
+            return false;
+        }
+        Symbol superClassName = Utils::getSymbol(classFile->constant_pool, classFile->super_class);
+        if (isSimulatedClass(superClassName)) {
+            return false;
+        }
+        classRuntime = methodArea.loadClassNamed(superClassName);
+    }
+}
+
+ClassInstance* ExecutionEngine::createThrowable(const string &className, const string &message) {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    ClassRuntime *classRuntime = MethodArea::getInstance().loadClassNamed(symbolTable.intern(className));
+    
+    // a exceção pode exceder o tamanho máximo da heap (e.g. o próprio OutOfMemoryError)
+    ClassInstance *exception = ClassInstance::create(classRuntime);
+    
+    Value messageValue;
+    messageValue.type = ValueType::REFERENCE;
+    messageValue.data.object = Heap::getInstance().internString(message);
+    exception->putValueIntoField(messageValue, symbolTable.intern("detailMessage"));
+    return exception;
+}
+
+void ExecutionEngine::throwException(ClassInstance *exception) {
+    VMStack &stackFrame = VMStack::getInstance();
+    
+    // o pc dos frames abaixo do topo aponta para a instrução seguinte à invocação
+    bool invoker = false;
+    while (stackFrame.size() > 0) {
+        Frame *frame = stackFrame.getTopFrame();
+        u4 pc = invoker ? frame->pc - 1 : frame->pc;
+        
+        if (!frame->isNative()) {
+            cp_info *constantPool = *(frame->getConstantPool());
+            for (u2 i = 0; i < frame->sizeExceptionTable(); i++) {
+                ExceptionTable handler = frame->getExceptionTableEntry(i);
+                if (pc < handler.start_pc || pc >= handler.end_pc) {
+                    continue;
+                }
+                
+                if (handler.catch_type == 0 || isSubclassOf(exception->getClassRuntime(), Utils::getSymbol(constantPool, handler.catch_type))) {
+                    // o tratador inicia com somente a exceção na pilha de operandos
+                    Value exceptionValue;
+                    exceptionValue.type = ValueType::REFERENCE;
+                    exceptionValue.data.object = exception;
+                    stack<Value> operandStack;
+                    operandStack.push(exceptionValue);
+                    frame->setOperandStackFromBackup(operandStack);
+                    
+                    frame->pc = handler.handler_pc;
+                    return;
+                }
+            }
+        }
+        
+        stackFrame.destroyTopFrame();
+        invoker = true;
+    }
+    
+    // exceção não tratada: é impressa como Throwable.toString()
+    ClassFile *classFile = exception->getClassRuntime()->getClassFile();
+    string className = *Utils::getSymbol(classFile->constant_pool, classFile->this_class);
+    for (size_t i = 0; i < className.size(); i++) {
+        if (className[i] == '/') {
+            className[i] = '.';
+        }
+    }
+    cerr << className;
+    
+    Symbol messageField = SymbolTable::getInstance().intern("detailMessage");
+    if (exception->getClassRuntime()->getInstanceField(messageField) != NULL) {
+        Object *message = exception->getValueFromField(messageField).data.object;
+        if (message != NULL) {
+            cerr << ": " << ((StringObject *) message)->getString();
+        }
+    }
+    cerr << endl;
+    exit(1);
+}
+
+void ExecutionEngine::retryAllocation() {
+    Heap &heap = Heap::getInstance();
+    VMStack &stackFrame = VMStack::getInstance();
+    
+    if (MethodArea::getInstance().hasInitializationWaiters(stackFrame.getThreadId())) {
+        // threads que aguardam o <clinit> da thread atual adiam a coleta até o seu fim: nenhuma coleta pode liberar memória
+        stackFrame.clearAllocationFailed();
+        throwException(createThrowable("java/lang/OutOfMemoryError", "Java heap space"));
+        return;
+    }
+    
+    if (!stackFrame.hasAllocationFailed()) {
+        stackFrame.setAllocationFailed(heap.getStartedCollections());
+    } else if (heap.getFinishedCollections() > stackFrame.getAllocationFailedCollections()) {
+        // uma coleta iniciada após a primeira falha já terminou, e a alocação continua falhando
+        stackFrame.clearAllocationFailed();
+        throwException(createThrowable("java/lang/OutOfMemoryError", "Java heap space"));
+        return;
+    }
+    
+    // a coleta é feita no próximo safepoint (i.e. antes que a instrução seja repetida), ou aguardada na coleta concorrente
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.requestCollection();
+    garbageCollector.enterSafeRegion();
+    garbageCollector.waitForCollectionAttempt();
+    garbageCollector.leaveSafeRegion();
+}
+
+bool ExecutionEngine::isNativeMethod(Frame *frame) {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol objectClassName = symbolTable.intern("java/lang/Object");
+    static Symbol toStringName = symbolTable.intern("toString");
+    
+    if (frame->isNative()) {
+        return true;
+    }
+    
+    // Object.toString() usa StringBuilder, Integer e java/lang/Class, que são simuladas: o método é executado como nativo
+    ClassFile *classFile = frame->getClassRuntime()->getClassFile();
+    return Utils::getSymbol(classFile->constant_pool, classFile->this_class) == objectClassName && Utils::getSymbol(classFile->constant_pool, frame->getMethod()->name_index) == toStringName;
+}
+
+int32_t ExecutionEngine::identityHashCode(Object *object) {
+    // a coleta de lixo não move os objetos, portanto o endereço identifica o objeto durante toda a sua vida
+    uintptr_t address = (uintptr_t) object;
+    return (int32_t) ((address >> 3) ^ (address >> 35));
+}
+
+bool ExecutionEngine::invokeNativeMethod(ClassRuntime *classRuntime, Symbol methodName, Symbol methodDescriptor, vector<Value> &arguments) {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol objectClassName = symbolTable.intern("java/lang/Object");
+    static Symbol waitName = symbolTable.intern("wait");
+    static Symbol notifyName = symbolTable.intern("notify");
+    static Symbol notifyAllName = symbolTable.intern("notifyAll");
+    static Symbol hashCodeName = symbolTable.intern("hashCode");
+    static Symbol getClassName = symbolTable.intern("getClass");
+    static Symbol toStringName = symbolTable.intern("toString");
+    static Symbol threadClassName = symbolTable.intern("java/lang/Thread");
+    static Symbol startName = symbolTable.intern("start");
+    static Symbol joinName = symbolTable.intern("join");
+    static Symbol isAliveName = symbolTable.intern("isAlive");
+    static Symbol currentThreadName = symbolTable.intern("currentThread");
+    static Symbol sleepName = symbolTable.intern("sleep");
+    static Symbol yieldName = symbolTable.intern("yield");
+    
+    VMStack &stackFrame = VMStack::getInstance();
+    Frame *topFrame = stackFrame.getTopFrame();
+    bool green = Scheduler::currentGreenThread() != NULL;
+    
+    ClassFile *classFile = classRuntime->getClassFile();
+    Symbol className = Utils::getSymbol(classFile->constant_pool, classFile->this_class);
+    
+    // os argumentos já deixaram a pilha de operandos, mas devem continuar alcançáveis durante as esperas
+    stackFrame.setNativeArguments(&arguments);
+    bool completed = true;
+    
+    if (className == objectClassName) {
+        Object *object = arguments[0].data.object;
+        
+        if (methodName == waitName) {
+            if (green) {
+                completed = Monitor::waitOrPark(object->getLockWord(), arguments[1].data.longValue);
+            } else {
+                Monitor::wait(object->getLockWord(), arguments[1].data.longValue);
+            }
+        } else if (methodName == notifyName) {
+            Monitor::notify(object->getLockWord(), false);
+        } else if (methodName == notifyAllName) {
+            Monitor::notify(object->getLockWord(), true);
+        } else if (methodName == hashCodeName) {
+            Value result;
+            result.printType = ValueType::INT;
+            result.type = ValueType::INT;
+            result.data.intValue = identityHashCode(object);
+            topFrame->pushIntoOperandStack(result);
+        } else if (methodName == getClassName || methodName == toStringName) {
+            // java/lang/Class é simulada: o objeto Class é representado pelo nome da classe (ver Class.getName em
+            // i_invokevirtual), internado para que getClass() retorne sempre o mesmo objeto
+            ClassFile *objectClassFile = ((ClassInstance *) object)->getClassRuntime()->getClassFile();
+            string name = *Utils::getSymbol(objectClassFile->constant_pool, objectClassFile->this_class);
+            replace(name.begin(), name.end(), '/', '.');
+            
+            Value result;
+            result.type = ValueType::REFERENCE;
+            if (methodName == toStringName) {
+                // o hashCode usado é sempre o de identidade
+                char hashCode[16];
+                snprintf(hashCode, sizeof(hashCode), "@%x", (unsigned int) identityHashCode(object));
+                result.data.object = new StringObject(name + hashCode);
+            } else {
+                result.data.object = Heap::getInstance().internString(name);
+            }
+            topFrame->pushIntoOperandStack(result);
+        } else {
+            cerr << "UnsatisfiedLinkError: " << *className << "." << *methodName << *methodDescriptor << endl;
+            exit(1);
+        }
+    } else if (className == threadClassName) {
+        ThreadManager &threadManager = ThreadManager::getInstance();
+        
+        if (methodName == startName) {
+            threadManager.startThread((ClassInstance *) arguments[0].data.object);
+        } else if (methodName == joinName) {
+            completed = threadManager.joinThread((ClassInstance *) arguments[0].data.object);
+        } else if (methodName == isAliveName) {
+            Value result;
+            result.printType = ValueType::BOOLEAN;
+            result.type = ValueType::INT;
+            result.data.intValue = threadManager.isAlive((ClassInstance *) arguments[0].data.object) ? 1 : 0;
+            topFrame->pushIntoOperandStack(result);
+        } else if (methodName == currentThreadName) {
+            Value result;
+            result.type = ValueType::REFERENCE;
+            result.data.object = threadManager.currentThread();
+            topFrame->pushIntoOperandStack(result);
+        } else if (methodName == sleepName) {
+            if (green) {
+                completed = Scheduler::getInstance().sleep(arguments[0].data.longValue);
+            } else {
+                GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+                garbageCollector.enterSafeRegion();
+                this_thread::sleep_for(chrono::milliseconds(arguments[0].data.longValue));
+                garbageCollector.leaveSafeRegion();
+            }
+        } else if (methodName == yieldName) {
+            if (green) {
+                Scheduler::getInstance().yield();
+            } else {
+                this_thread::yield();
+            }
+        } else {
+            cerr << "UnsatisfiedLinkError: " << *className << "." << *methodName << *methodDescriptor << endl;
+            exit(1);
+        }
+    } else {
+        cerr << "UnsatisfiedLinkError: " << *className << "." << *methodName << *methodDescriptor << endl;
+        exit(1);
     }
+    
+    stackFrame.setNativeArguments(NULL);
+    return completed;
 }
 
-bool ExecutionEngine::doesMethodExist(ClassRuntime *classRuntime, string name, string descriptor) {
+bool ExecutionEngine::doesMethodExist(ClassRuntime *classRuntime, Symbol name, Symbol descriptor) {
     ClassFile *classFile = classRuntime->getClassFile();
 
     bool found = false;
-    method_info method;
     for (int i = 0; i < classFile->methods_count; i++) {
-        method = classFile->methods[i];
-        string methodName = getFormattedConstant(classFile->constant_pool, method.name_index);
-        string methodDesc = getFormattedConstant(classFile->constant_pool, method.descriptor_index);
+        method_info &method = classFile->methods[i];
+        Symbol methodName = Utils::getSymbol(classFile->constant_pool, method.name_index);
+        Symbol methodDesc = Utils::getSymbol(classFile->constant_pool, method.descriptor_index);
 
         if (methodName == name && methodDesc == descriptor) {
             found = true;
@@ -66,31 +417,28 @@ bool ExecutionEngine::doesMethodExist(ClassRuntime *classRuntime, string name, s
     return found;
 }
 
-void ExecutionEngine::populateMultiarray(ArrayObject *array, ValueType valueType, stack<int> count) {
+bool ExecutionEngine::populateMultiarray(ArrayObject *array, ValueType valueType, stack<int> count) {
     int currCount = count.top();
     count.pop();
     
-    ValueType arrayType = (count.size() > 1) ? ValueType::REFERENCE : valueType;
-    
+    // os elementos do último nível já são criados com o valor inicial
     if (count.size() == 0) {
-        for (int i = 0; i < currCount; i++) {
-            Value subarrayValue;
-            subarrayValue.type = valueType;
-            subarrayValue.printType = valueType;
-            subarrayValue.data.longValue = 0;
-            array->pushValue(subarrayValue);
-        }
-    } else {
-        for (int i = 0; i < currCount; i++) {
-            ArrayObject *subarray = new ArrayObject(arrayType);
-            populateMultiarray(subarray, valueType, count);
-            
-            Value subarrayValue;
-            subarrayValue.type = ValueType::REFERENCE;
-            subarrayValue.data.object = subarray;
-            array->pushValue(subarrayValue);
+        return true;
+    }
+    
+    ValueType arrayType = (count.size() > 1) ? ValueType::REFERENCE : valueType;
+    for (int i = 0; i < currCount; i++) {
+        ArrayObject *subarray = ArrayObject::create(arrayType, count.top(), true);
+        if (subarray == NULL || !populateMultiarray(subarray, valueType, count)) {
+            return false;
         }
+        
+        Value subarrayValue;
+        subarrayValue.type = ValueType::REFERENCE;
+        subarrayValue.data.object = subarray;
+        array->changeValueAt(i, subarrayValue);
     }
+    return true;
 }
 
 void ExecutionEngine::i_nop() {
@@ -361,37 +709,25 @@ void ExecutionEngine::i_ldc() {
     u1 index = code[1];
     
     cp_info *constantPool = *(topFrame->getConstantPool());
-    cp_info entry = constantPool[index-1];
+    const cp_info &entry = constantPool[index-1];
 
     Value value;
     
     if (entry.tag == CONSTANT_String) {
-        cp_info utf8Entry = constantPool[entry.info.string_info.string_index-1];
-        assert(utf8Entry.tag == CONSTANT_Utf8);
-        
-        u1* bytes = utf8Entry.info.utf8_info.bytes;
-        char utf8String[utf8Entry.info.utf8_info.length+1];
-        int i;
-        for (i = 0; i < utf8Entry.info.utf8_info.length; i++) {
-            utf8String[i] = bytes[i];
-        }
-        utf8String[i] = '\0';
-        
+        // a string é contabilizada pelo profiler somente na execução que resolve a constante
+        bool resolved = !AllocationProfiler::isEnabled() || topFrame->getClassRuntime()->isStringConstantResolved(index);
         value.type = ValueType::REFERENCE;
-        value.data.object = new StringObject(utf8String);
+        value.data.object = topFrame->getClassRuntime()->getStringConstant(index);
+        if (!resolved) {
+            AllocationProfiler::getInstance().record(topFrame, value.data.object->getHeapSize());
+        }
     } else if (entry.tag == CONSTANT_Integer) {
         value.printType = ValueType::INT;
         value.type = ValueType::INT;
-        value.data.intValue = (int32_t) entry.info.integer_info.bytes;
+        value.data.intValue = entry.info.integer_info.value;
     } else if (entry.tag == CONSTANT_Float) {
-        u4 floatBytes = entry.info.float_info.bytes;
-        int s = ((floatBytes >> 31) == 0) ? 1 : -1;
-        int e = ((floatBytes >> 23) & 0xff);
-        int m = (e == 0) ? (floatBytes & 0x7fffff) << 1 : (floatBytes & 0x7fffff) | 0x800000;
-        
-        float number = s*m*pow(2, e-150);
         value.type = ValueType::FLOAT;
-        value.data.floatValue = number;
+        value.data.floatValue = entry.info.float_info.value;
     } else {
         cerr << "ldc tentando acessar um elemento da CP invalido: " << entry.tag << endl;
         exit(1);
@@ -411,37 +747,25 @@ void ExecutionEngine::i_ldc_w() {
     u2 index = (byte1 << 8) | byte2;
     
     cp_info *constantPool = *(topFrame->getConstantPool());
-    cp_info entry = constantPool[index-1];
+    const cp_info &entry = constantPool[index-1];
     
     Value value;
     
     if (entry.tag == CONSTANT_String) {
-        cp_info utf8Entry = constantPool[entry.info.string_info.string_index-1];
-        assert(utf8Entry.tag == CONSTANT_Utf8);
-        
-        u1* bytes = utf8Entry.info.utf8_info.bytes;
-        char utf8String[utf8Entry.info.utf8_info.length+1];
-        int i;
-        for (i = 0; i < utf8Entry.info.utf8_info.length; i++) {
-            utf8String[i] = bytes[i];
-        }
-        utf8String[i] = '\0';
-        
+        // a string é contabilizada pelo profiler somente na execução que resolve a constante
+        bool resolved = !AllocationProfiler::isEnabled() || topFrame->getClassRuntime()->isStringConstantResolved(index);
         value.type = ValueType::REFERENCE;
-        value.data.object = new StringObject(utf8String);
+        value.data.object = topFrame->getClassRuntime()->getStringConstant(index);
+        if (!resolved) {
+            AllocationProfiler::getInstance().record(topFrame, value.data.object->getHeapSize());
+        }
     } else if (entry.tag == CONSTANT_Integer) {
         value.printType = ValueType::INT;
         value.type = ValueType::INT;
-        value.data.intValue = entry.info.integer_info.bytes;
+        value.data.intValue = entry.info.integer_info.value;
     } else if (entry.tag == CONSTANT_Float) {
-        u4 floatBytes = entry.info.float_info.bytes;
-        int s = ((floatBytes >> 31) == 0) ? 1 : -1;
-        int e = ((floatBytes >> 23) & 0xff);
-        int m = (e == 0) ? (floatBytes & 0x7fffff) << 1 : (floatBytes & 0x7fffff) | 0x800000;
-        
-        float number = s*m*pow(2, e-150);
         value.type = ValueType::FLOAT;
-        value.data.floatValue = number;
+        value.data.floatValue = entry.info.float_info.value;
     } else {
         cerr << "ldc_w tentando acessar um elemento da CP invalido: " << entry.tag << endl;
         exit(1);
@@ -461,35 +785,21 @@ void ExecutionEngine::i_ldc2_w() {
     u2 index = (byte1 << 8) | byte2;
     
     cp_info *classFile = *(topFrame->getConstantPool());
-    cp_info entry = classFile[index-1];
+    const cp_info &entry = classFile[index-1];
     
     Value value;
     
     if (entry.tag == CONSTANT_Long) {
-        u4 highBytes = entry.info.long_info.high_bytes;
-        u4 lowBytes = entry.info.long_info.low_bytes;
-        
-        int64_t longNumber = ((int64_t) highBytes << 32) + lowBytes;
         value.type = ValueType::LONG;
-        value.data.longValue = longNumber;
+        value.data.longValue = entry.info.long_info.value;
         
         Value padding;
         padding.type = ValueType::PADDING;
         
         topFrame->pushIntoOperandStack(padding);
     } else if (entry.tag == CONSTANT_Double) {
-        u4 highBytes = entry.info.double_info.high_bytes;
-        u4 lowBytes = entry.info.double_info.low_bytes;
-        
-        int64_t longNumber = ((int64_t) highBytes << 32) + lowBytes;
-        
-        int32_t s = ((longNumber >> 63) == 0) ? 1 : -1;
-        int32_t e = (int32_t)((longNumber >> 52) & 0x7ffL);
-        int64_t m = (e == 0) ? (longNumber & 0xfffffffffffffL) << 1 : (longNumber & 0xfffffffffffffL) | 0x10000000000000L;
-        
-        double doubleNumber = s*m*pow(2, e-1075);
         value.type = ValueType::DOUBLE;
-        value.data.doubleValue = doubleNumber;
+        value.data.doubleValue = entry.info.double_info.value;
         
         Value padding;
         padding.type = ValueType::PADDING;
@@ -1684,6 +1994,9 @@ void ExecutionEngine::i_aastore() {
         exit(2);
     }
 
+    if (GarbageCollector::isMarking()) {
+        GarbageCollector::writeBarrier(array->getValue(index.data.intValue));
+    }
 	array->changeValueAt(index.data.intValue, value);
     
     topFrame->pc += 1;
@@ -3519,6 +3832,10 @@ void ExecutionEngine::i_return() {
 }
 
 void ExecutionEngine::i_getstatic() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol systemClassName = symbolTable.intern("java/lang/System");
+    static Symbol printStreamDescriptor = symbolTable.intern("Ljava/io/PrintStream;");
+    
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
     cp_info *constantPool = *(topFrame->getConstantPool());
@@ -3533,18 +3850,18 @@ void ExecutionEngine::i_getstatic() {
 
     CONSTANT_Fieldref_info fieldRef = fieldCP.info.fieldref_info;
 
-    string className = getFormattedConstant(constantPool, fieldRef.class_index);
+    Symbol className = Utils::getSymbol(constantPool, fieldRef.class_index);
 
     cp_info nameAndTypeCP = constantPool[fieldRef.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info fieldNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string fieldName = getFormattedConstant(constantPool, fieldNameAndType.name_index);
-    string fieldDescriptor = getFormattedConstant(constantPool, fieldNameAndType.descriptor_index);
+    Symbol fieldName = Utils::getSymbol(constantPool, fieldNameAndType.name_index);
+    Symbol fieldDescriptor = Utils::getSymbol(constantPool, fieldNameAndType.descriptor_index);
 
     // caso especial
-    if (className == "java/lang/System" && fieldDescriptor == "Ljava/io/PrintStream;" ) {
+    if (className == systemClassName && fieldDescriptor == printStreamDescriptor) {
         topFrame->pc += 3;
         return;
     }
@@ -3558,7 +3875,7 @@ void ExecutionEngine::i_getstatic() {
             if (classRuntime->getClassFile()->super_class == 0) {
                 classRuntime = NULL;
             } else {
-                string superClassName = getFormattedConstant(classRuntime->getClassFile()->constant_pool, classRuntime->getClassFile()->super_class);
+                Symbol superClassName = Utils::getSymbol(classRuntime->getClassFile()->constant_pool, classRuntime->getClassFile()->super_class);
                 classRuntime = methodArea.loadClassNamed(superClassName);
             }
         } else {
@@ -3622,15 +3939,15 @@ void ExecutionEngine::i_putstatic() {
 
     CONSTANT_Fieldref_info fieldRef = fieldCP.info.fieldref_info;
 
-    string className = getFormattedConstant(constantPool, fieldRef.class_index);
+    Symbol className = Utils::getSymbol(constantPool, fieldRef.class_index);
 
     cp_info nameAndTypeCP = constantPool[fieldRef.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info fieldNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string fieldName = getFormattedConstant(constantPool, fieldNameAndType.name_index);
-    string fieldDescriptor = getFormattedConstant(constantPool, fieldNameAndType.descriptor_index);
+    Symbol fieldName = Utils::getSymbol(constantPool, fieldNameAndType.name_index);
+    Symbol fieldDescriptor = Utils::getSymbol(constantPool, fieldNameAndType.descriptor_index);
 
     MethodArea &methodArea = MethodArea::getInstance();
     ClassRuntime *classRuntime = methodArea.loadClassNamed(className);
@@ -3640,7 +3957,7 @@ void ExecutionEngine::i_putstatic() {
             if (classRuntime->getClassFile()->super_class == 0) {
                 classRuntime = NULL;
             } else {
-                string superClassName = getFormattedConstant(classRuntime->getClassFile()->constant_pool, classRuntime->getClassFile()->super_class);
+                Symbol superClassName = Utils::getSymbol(classRuntime->getClassFile()->constant_pool, classRuntime->getClassFile()->super_class);
                 classRuntime = methodArea.loadClassNamed(superClassName);
             }
         } else {
@@ -3660,7 +3977,7 @@ void ExecutionEngine::i_putstatic() {
     if (topValue.type == ValueType::DOUBLE || topValue.type == ValueType::LONG) {
         topFrame->popTopOfOperandStack(); // removendo padding
     } else {
-        switch (fieldDescriptor[0]) {
+        switch ((*fieldDescriptor)[0]) {
             case 'B':
                 topValue.type = ValueType::BYTE;
                 topValue.printType = ValueType::BYTE;
@@ -3680,6 +3997,9 @@ void ExecutionEngine::i_putstatic() {
         }
     }
 
+    if (topValue.type == ValueType::REFERENCE && GarbageCollector::isMarking()) {
+        GarbageCollector::writeBarrier(classRuntime->getValueFromField(fieldName));
+    }
     classRuntime->putValueIntoField(topValue, fieldName);
 
     topFrame->pc += 3;
@@ -3700,15 +4020,12 @@ void ExecutionEngine::i_getfield() {
 
     CONSTANT_Fieldref_info fieldRef = fieldCP.info.fieldref_info;
 
-    string className = getFormattedConstant(constantPool, fieldRef.class_index);
-
     cp_info nameAndTypeCP = constantPool[fieldRef.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info fieldNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string fieldName = getFormattedConstant(constantPool, fieldNameAndType.name_index);
-    string fieldDescriptor = getFormattedConstant(constantPool, fieldNameAndType.descriptor_index);
+    Symbol fieldName = Utils::getSymbol(constantPool, fieldNameAndType.name_index);
 
     Value objectValue = topFrame->popTopOfOperandStack();
     assert(objectValue.type == ValueType::REFERENCE);
@@ -3769,21 +4086,19 @@ void ExecutionEngine::i_putfield() {
 
     CONSTANT_Fieldref_info fieldRef = fieldCP.info.fieldref_info;
 
-    string className = getFormattedConstant(constantPool, fieldRef.class_index);
-
     cp_info nameAndTypeCP = constantPool[fieldRef.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info fieldNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string fieldName = getFormattedConstant(constantPool, fieldNameAndType.name_index);
-    string fieldDescriptor = getFormattedConstant(constantPool, fieldNameAndType.descriptor_index);
+    Symbol fieldName = Utils::getSymbol(constantPool, fieldNameAndType.name_index);
+    Symbol fieldDescriptor = Utils::getSymbol(constantPool, fieldNameAndType.descriptor_index);
 
     Value valueToBeInserted = topFrame->popTopOfOperandStack();
     if (valueToBeInserted.type == ValueType::DOUBLE || valueToBeInserted.type == ValueType::LONG) {
         topFrame->popTopOfOperandStack(); // removendo padding
     } else {
-        switch (fieldDescriptor[0]) {
+        switch ((*fieldDescriptor)[0]) {
             case 'B':
                 valueToBeInserted.type = ValueType::BYTE;
                 valueToBeInserted.printType = ValueType::BYTE;
@@ -3809,12 +4124,27 @@ void ExecutionEngine::i_putfield() {
     assert(object->objectType() == ObjectType::CLASS_INSTANCE);
     ClassInstance *classInstance = (ClassInstance *) object;
 
+    if (valueToBeInserted.type == ValueType::REFERENCE && GarbageCollector::isMarking() && classInstance->fieldExists(fieldName)) {
+        GarbageCollector::writeBarrier(classInstance->getValueFromField(fieldName));
+    }
     classInstance->putValueIntoField(valueToBeInserted, fieldName);
 
     topFrame->pc += 3;
 }
 
 void ExecutionEngine::i_invokevirtual() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol printStreamClassName = symbolTable.intern("java/io/PrintStream");
+    static Symbol printName = symbolTable.intern("print");
+    static Symbol printlnName = symbolTable.intern("println");
+    static Symbol voidDescriptor = symbolTable.intern("()V");
+    static Symbol stringClassName = symbolTable.intern("java/lang/String");
+    static Symbol equalsName = symbolTable.intern("equals");
+    static Symbol internName = symbolTable.intern("intern");
+    static Symbol lengthName = symbolTable.intern("length");
+    static Symbol classClassName = symbolTable.intern("java/lang/Class");
+    static Symbol getNameName = symbolTable.intern("getName");
+    
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
     
@@ -3832,20 +4162,20 @@ void ExecutionEngine::i_invokevirtual() {
 
     CONSTANT_Methodref_info methodInfo = methodCP.info.methodref_info;
 
-    string className = getFormattedConstant(constantPool, methodInfo.class_index);
+    Symbol className = Utils::getSymbol(constantPool, methodInfo.class_index);
 
     cp_info nameAndTypeCP = constantPool[methodInfo.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info methodNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string methodName = getFormattedConstant(constantPool, methodNameAndType.name_index);
-    string methodDescriptor = getFormattedConstant(constantPool, methodNameAndType.descriptor_index);
+    Symbol methodName = Utils::getSymbol(constantPool, methodNameAndType.name_index);
+    Symbol methodDescriptor = Utils::getSymbol(constantPool, methodNameAndType.descriptor_index);
 
-    if (className.find("java/") != string::npos) {
+    if (isSimulatedClass(className)) {
         // simulando println ou print
-        if (className == "java/io/PrintStream" && (methodName == "print" || methodName == "println")) {
-            if (methodDescriptor != "()V") {
+        if (className == printStreamClassName && (methodName == printName || methodName == printlnName)) {
+            if (methodDescriptor != voidDescriptor) {
                 Value printValue = topFrame->popTopOfOperandStack();
 
                 if (printValue.type == ValueType::INT) {
@@ -3903,8 +4233,8 @@ void ExecutionEngine::i_invokevirtual() {
                 }
             }
 
-            if (methodName == "println") printf("\n");
-        } else if (className == "java/lang/String" && methodName == "equals") {
+            if (methodName == printlnName) printf("\n");
+        } else if (className == stringClassName && methodName == equalsName) {
             Value strValue1 = topFrame->popTopOfOperandStack();
             Value strValue2 = topFrame->popTopOfOperandStack();
             assert(strValue1.type == ValueType::REFERENCE);
@@ -3924,7 +4254,19 @@ void ExecutionEngine::i_invokevirtual() {
                 result.data.intValue = 0;
             }
             topFrame->pushIntoOperandStack(result);
-        } else if (className == "java/lang/String" && methodName == "length") {	
+        } else if (className == stringClassName && methodName == internName) {
+            Value strValue = topFrame->popTopOfOperandStack();
+            assert(strValue.type == ValueType::REFERENCE);
+            assert(strValue.data.object->objectType() == ObjectType::STRING_INSTANCE);
+            
+            StringObject *str = (StringObject*) strValue.data.object;
+            
+            Heap &heap = Heap::getInstance();
+            Value result;
+            result.type = ValueType::REFERENCE;
+            result.data.object = heap.internString(str->getString());
+            topFrame->pushIntoOperandStack(result);
+        } else if (className == stringClassName && methodName == lengthName) {	
             Value strValue = topFrame->popTopOfOperandStack();
             assert(strValue.type == ValueType::REFERENCE);		
             assert(strValue.data.object->objectType() == ObjectType::STRING_INSTANCE);		
@@ -3936,24 +4278,26 @@ void ExecutionEngine::i_invokevirtual() {
             result.type = ValueType::INT;		
             result.data.intValue = (str->getString()).size();		
             topFrame->pushIntoOperandStack(result);
+        } else if (className == classClassName && methodName == getNameName) {
+            // o objeto Class já é o nome da classe (ver Object.getClass em invokeNativeMethod), que continua na pilha
         } else {
-            cerr << "Tentando invocar metodo de instancia invalido: " << methodName << endl;
+            cerr << "Tentando invocar metodo de instancia invalido: " << *methodName << endl;
             exit(1);
         }
     } else {
         uint16_t nargs = 0; // numero de argumentos contidos na pilha de operandos
         uint16_t i = 1; // pulando o primeiro '('
-        while (methodDescriptor[i] != ')') {
-            char baseType = methodDescriptor[i];
+        while ((*methodDescriptor)[i] != ')') {
+            char baseType = (*methodDescriptor)[i];
             if (baseType == 'D' || baseType == 'J') {
                 nargs += 2;
             } else if (baseType == 'L') {
                 nargs++;
-                while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] != ';');
             } else if (baseType == '[') {
                 nargs++;
-                while (methodDescriptor[++i] == '[');
-                if (methodDescriptor[i] == 'L') while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] == '[');
+                if ((*methodDescriptor)[i] == 'L') while ((*methodDescriptor)[++i] != ';');
             } else {
                 nargs++;
             }
@@ -3990,13 +4334,29 @@ void ExecutionEngine::i_invokevirtual() {
             return;
         }
 
-        stackFrame.addFrame(newFrame);
+        if (isNativeMethod(newFrame)) {
+            bool completed = invokeNativeMethod(newFrame->getClassRuntime(), methodName, methodDescriptor, args);
+            delete newFrame;
+            
+            // a thread verde foi estacionada: a instrução é repetida quando ela for acordada
+            if (!completed) {
+                topFrame->setOperandStackFromBackup(operandStackBackup);
+                return;
+            }
+        } else {
+            stackFrame.addFrame(newFrame);
+        }
     }
 
     topFrame->pc += 3;
 }
 
 void ExecutionEngine::i_invokespecial() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol objectClassName = symbolTable.intern("java/lang/Object");
+    static Symbol stringClassName = symbolTable.intern("java/lang/String");
+    static Symbol initName = symbolTable.intern("<init>");
+    
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
     
@@ -4014,19 +4374,19 @@ void ExecutionEngine::i_invokespecial() {
 
     CONSTANT_Methodref_info methodInfo = methodCP.info.methodref_info;
 
-    string className = getFormattedConstant(constantPool, methodInfo.class_index);
+    Symbol className = Utils::getSymbol(constantPool, methodInfo.class_index);
 
     cp_info nameAndTypeCP = constantPool[methodInfo.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info methodNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string methodName = getFormattedConstant(constantPool, methodNameAndType.name_index);
-    string methodDescriptor = getFormattedConstant(constantPool, methodNameAndType.descriptor_index);
+    Symbol methodName = Utils::getSymbol(constantPool, methodNameAndType.name_index);
+    Symbol methodDescriptor = Utils::getSymbol(constantPool, methodNameAndType.descriptor_index);
     
     // casos especiais
-    if ((className == "java/lang/Object" || className == "java/lang/String") && methodName == "<init>") {
-        if (className == "java/lang/String") {
+    if ((className == objectClassName || className == stringClassName) && methodName == initName) {
+        if (className == stringClassName) {
             topFrame->popTopOfOperandStack();
         }
         
@@ -4035,23 +4395,23 @@ void ExecutionEngine::i_invokespecial() {
     }
     // fim dos casos especiais
     
-    if (className.find("java/") != string::npos) {
-        cerr << "Tentando invocar metodo especial invalido: " << methodName << endl;
+    if (isSimulatedClass(className)) {
+        cerr << "Tentando invocar metodo especial invalido: " << *methodName << endl;
         exit(1);
     } else {
         uint16_t nargs = 0; // numero de argumentos contidos na pilha de operandos
         uint16_t i = 1; // pulando o primeiro '('
-        while (methodDescriptor[i] != ')') {
-            char baseType = methodDescriptor[i];
+        while ((*methodDescriptor)[i] != ')') {
+            char baseType = (*methodDescriptor)[i];
             if (baseType == 'D' || baseType == 'J') {
                 nargs += 2;
             } else if (baseType == 'L') {
                 nargs++;
-                while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] != ';');
             } else if (baseType == '[') {
                 nargs++;
-                while (methodDescriptor[++i] == '[');
-                if (methodDescriptor[i] == 'L') while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] == '[');
+                if ((*methodDescriptor)[i] == 'L') while ((*methodDescriptor)[++i] != ';');
             } else {
                 nargs++;
             }
@@ -4088,13 +4448,30 @@ void ExecutionEngine::i_invokespecial() {
             return;
         }
 
-        stackFrame.addFrame(newFrame);
+        if (isNativeMethod(newFrame)) {
+            bool completed = invokeNativeMethod(newFrame->getClassRuntime(), methodName, methodDescriptor, args);
+            delete newFrame;
+            
+            // a thread verde foi estacionada: a instrução é repetida quando ela for acordada
+            if (!completed) {
+                topFrame->setOperandStackFromBackup(operandStackBackup);
+                return;
+            }
+        } else {
+            stackFrame.addFrame(newFrame);
+        }
     }
 
     topFrame->pc += 3;
 }
 
 void ExecutionEngine::i_invokestatic() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol objectClassName = symbolTable.intern("java/lang/Object");
+    static Symbol registerNativesName = symbolTable.intern("registerNatives");
+    static Symbol systemClassName = symbolTable.intern("java/lang/System");
+    static Symbol gcName = symbolTable.intern("gc");
+    
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
     
@@ -4112,38 +4489,50 @@ void ExecutionEngine::i_invokestatic() {
 
     CONSTANT_Methodref_info methodInfo = methodCP.info.methodref_info;
 
-    string className = getFormattedConstant(constantPool, methodInfo.class_index);
+    Symbol className = Utils::getSymbol(constantPool, methodInfo.class_index);
 
     cp_info nameAndTypeCP = constantPool[methodInfo.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info methodNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string methodName = getFormattedConstant(constantPool, methodNameAndType.name_index);
-    string methodDescriptor = getFormattedConstant(constantPool, methodNameAndType.descriptor_index);
+    Symbol methodName = Utils::getSymbol(constantPool, methodNameAndType.name_index);
+    Symbol methodDescriptor = Utils::getSymbol(constantPool, methodNameAndType.descriptor_index);
 
-    if (className == "java/lang/Object" && methodName == "registerNatives") {
+    if (className == objectClassName && methodName == registerNativesName) {
         topFrame->pc += 3;
         return;
     }
     
-    if (className.find("java/") != string::npos) {
-        cerr << "Tentando invocar metodo estatico invalido: " << methodName << endl;
+    // System.gc(): a coleta é feita no próximo safepoint, i.e. antes da próxima instrução. Na coleta concorrente, a
+    // thread aguarda o fim da coleta fora do código Java.
+    if (className == systemClassName && methodName == gcName) {
+        GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+        garbageCollector.requestCollection();
+        garbageCollector.enterSafeRegion();
+        garbageCollector.waitForCollectionAttempt();
+        garbageCollector.leaveSafeRegion();
+        topFrame->pc += 3;
+        return;
+    }
+    
+    if (isSimulatedClass(className)) {
+        cerr << "Tentando invocar metodo estatico invalido: " << *methodName << endl;
         exit(1);
     } else {
         uint16_t nargs = 0; // numero de argumentos contidos na pilha de operandos
         uint16_t i = 1; // pulando o primeiro '('
-        while (methodDescriptor[i] != ')') {
-            char baseType = methodDescriptor[i];
+        while ((*methodDescriptor)[i] != ')') {
+            char baseType = (*methodDescriptor)[i];
             if (baseType == 'D' || baseType == 'J') {
                 nargs += 2;
             } else if (baseType == 'L') {
                 nargs++;
-                while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] != ';');
             } else if (baseType == '[') {
                 nargs++;
-                while (methodDescriptor[++i] == '[');
-                if (methodDescriptor[i] == 'L') while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] == '[');
+                if ((*methodDescriptor)[i] == 'L') while ((*methodDescriptor)[++i] != ';');
             } else {
                 nargs++;
             }
@@ -4171,7 +4560,18 @@ void ExecutionEngine::i_invokestatic() {
             return;
         }
 
-        stackFrame.addFrame(newFrame);
+        if (isNativeMethod(newFrame)) {
+            bool completed = invokeNativeMethod(newFrame->getClassRuntime(), methodName, methodDescriptor, args);
+            delete newFrame;
+            
+            // a thread verde foi estacionada: a instrução é repetida quando ela for acordada
+            if (!completed) {
+                topFrame->setOperandStackFromBackup(operandStackBackup);
+                return;
+            }
+        } else {
+            stackFrame.addFrame(newFrame);
+        }
     }
 
     topFrame->pc += 3;
@@ -4195,33 +4595,33 @@ void ExecutionEngine::i_invokeinterface() {
 
     CONSTANT_Methodref_info methodInfo = methodCP.info.methodref_info;
 
-    string className = getFormattedConstant(constantPool, methodInfo.class_index);
+    Symbol className = Utils::getSymbol(constantPool, methodInfo.class_index);
 
     cp_info nameAndTypeCP = constantPool[methodInfo.name_and_type_index-1];
     assert(nameAndTypeCP.tag == CONSTANT_NameAndType); // precisa ser um nameAndType
 
     CONSTANT_NameAndType_info methodNameAndType = nameAndTypeCP.info.nameAndType_info;
 
-    string methodName = getFormattedConstant(constantPool, methodNameAndType.name_index);
-    string methodDescriptor = getFormattedConstant(constantPool, methodNameAndType.descriptor_index);
+    Symbol methodName = Utils::getSymbol(constantPool, methodNameAndType.name_index);
+    Symbol methodDescriptor = Utils::getSymbol(constantPool, methodNameAndType.descriptor_index);
 
-    if (className.find("java/") != string::npos) {
-        cerr << "Tentando invocar metodo de interface invalido: " << methodName << endl;
+    if (isSimulatedClass(className)) {
+        cerr << "Tentando invocar metodo de interface invalido: " << *methodName << endl;
         exit(1);
     } else {
         uint16_t nargs = 0; // numero de argumentos contidos na pilha de operandos
         uint16_t i = 1; // pulando o primeiro '('
-        while (methodDescriptor[i] != ')') {
-            char baseType = methodDescriptor[i];
+        while ((*methodDescriptor)[i] != ')') {
+            char baseType = (*methodDescriptor)[i];
             if (baseType == 'D' || baseType == 'J') {
                 nargs += 2;
             } else if (baseType == 'L') {
                 nargs++;
-                while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] != ';');
             } else if (baseType == '[') {
                 nargs++;
-                while (methodDescriptor[++i] == '[');
-                if (methodDescriptor[i] == 'L') while (methodDescriptor[++i] != ';');
+                while ((*methodDescriptor)[++i] == '[');
+                if ((*methodDescriptor)[i] == 'L') while ((*methodDescriptor)[++i] != ';');
             } else {
                 nargs++;
             }
@@ -4258,13 +4658,27 @@ void ExecutionEngine::i_invokeinterface() {
             return;
         }
 
-        stackFrame.addFrame(newFrame);
+        if (isNativeMethod(newFrame)) {
+            bool completed = invokeNativeMethod(newFrame->getClassRuntime(), methodName, methodDescriptor, args);
+            delete newFrame;
+            
+            // a thread verde foi estacionada: a instrução é repetida quando ela for acordada
+            if (!completed) {
+                topFrame->setOperandStackFromBackup(operandStackBackup);
+                return;
+            }
+        } else {
+            stackFrame.addFrame(newFrame);
+        }
     }
 
     topFrame->pc += 5;
 }
 
 void ExecutionEngine::i_new() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol stringClassName = symbolTable.intern("java/lang/String");
+    
     VMStack &stackFrame = VMStack::getInstance();       
     Frame *topFrame = stackFrame.getTopFrame();     
     cp_info *constantPool = *(topFrame->getConstantPool());
@@ -4278,15 +4692,24 @@ void ExecutionEngine::i_new() {
     assert(classCP.tag == CONSTANT_Class);
     
     CONSTANT_Class_info classInfo = classCP.info.class_info; // Formata nome da classe
-    string className = getFormattedConstant(constantPool, classInfo.name_index);
+    Symbol className = Utils::getSymbol(constantPool, classInfo.name_index);
 
     Object *object;
-    if (className == "java/lang/String") {
+    if (className == stringClassName) {
         object = new StringObject();
     } else {
         MethodArea &methodArea = MethodArea::getInstance();
         ClassRuntime *classRuntime = methodArea.loadClassNamed(className);
-        object = new ClassInstance(classRuntime); // Cria instancia da classe e coloca na heap
+        object = ClassInstance::create(classRuntime, true); // Cria instancia da classe e coloca na heap
+        if (object == NULL) {
+            // a instrução é repetida após a coleta de lixo
+            retryAllocation();
+            return;
+        }
+    }
+    VMStack::getInstance().clearAllocationFailed();
+    if (AllocationProfiler::isEnabled()) {
+        AllocationProfiler::getInstance().record(topFrame, object->getHeapSize());
     }
     
     // Armazena referência na pilha
@@ -4310,76 +4733,49 @@ void ExecutionEngine::i_newarray() {
         exit(1);
     }
     
-    ArrayObject *array; // array que será criado
-    Value value; // elemento que irá popular o array
-    value.data.longValue = 0; // inicializando Value com 0s
-    
-    Value padding; // padding poderá ser usado
-    padding.type = ValueType::PADDING;
-    
+    ValueType arrayType; // tipo dos elementos do array que será criado
     u1 *code = topFrame->getCode(topFrame->pc);
     switch (code[1]) { // argumento representa tipo do array
         case 4:
-            array = new ArrayObject(ValueType::BOOLEAN);
-            value.type = ValueType::BOOLEAN;
-            value.printType = ValueType::BOOLEAN;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::BOOLEAN;
             break;
         case 5:
-            array = new ArrayObject(ValueType::CHAR);
-            value.type = ValueType::CHAR;
-            value.printType = ValueType::CHAR;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::CHAR;
             break;
         case 6:
-            array = new ArrayObject(ValueType::FLOAT);
-            value.type = ValueType::FLOAT;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::FLOAT;
             break;
         case 7:
-            array = new ArrayObject(ValueType::DOUBLE);
-            value.type = ValueType::DOUBLE;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::DOUBLE;
             break;
         case 8:
-            array = new ArrayObject(ValueType::BYTE);
-            value.type = ValueType::BYTE;
-            value.printType = ValueType::BYTE;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::BYTE;
             break;
         case 9:
-            array = new ArrayObject(ValueType::SHORT);
-            value.type = ValueType::SHORT;
-            value.printType = ValueType::SHORT;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::SHORT;
             break;
         case 10:
-            array = new ArrayObject(ValueType::INT);
-            value.type = ValueType::INT;
-            value.printType = ValueType::INT;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::INT;
             break;
         case 11:
-            array = new ArrayObject(ValueType::LONG);
-            value.type = ValueType::LONG;
-            for (int i = 0; i < count.data.intValue; i++) {
-                array->pushValue(value);
-            }
+            arrayType = ValueType::LONG;
             break;
+        default:
+            cerr << "Tipo invalido em newarray" << endl;
+            exit(1);
+    }
+    
+    // os elementos já são criados com o valor inicial
+    ArrayObject *array = ArrayObject::create(arrayType, count.data.intValue, true);
+    if (array == NULL) {
+        // a instrução é repetida após a coleta de lixo
+        topFrame->pushIntoOperandStack(count);
+        retryAllocation();
+        return;
+    }
+    VMStack::getInstance().clearAllocationFailed();
+    if (AllocationProfiler::isEnabled()) {
+        AllocationProfiler::getInstance().record(topFrame, array->getHeapSize());
     }
     
     Value arrayref; // Referencia pro array na pilha de operandos
@@ -4391,6 +4787,9 @@ void ExecutionEngine::i_newarray() {
 }
 
 void ExecutionEngine::i_anewarray() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol stringClassName = symbolTable.intern("java/lang/String");
+    
     VMStack &stackFrame = VMStack::getInstance();       
     Frame *topFrame = stackFrame.getTopFrame();
     
@@ -4411,28 +4810,30 @@ void ExecutionEngine::i_anewarray() {
     assert(classCP.tag == CONSTANT_Class);
     
     CONSTANT_Class_info classInfo = classCP.info.class_info; // Formata nome da classe
-    string className = getFormattedConstant(constantPool, classInfo.name_index);
+    Symbol className = Utils::getSymbol(constantPool, classInfo.name_index);
 
-    if (className != "java/lang/String") {
+    if (className != stringClassName) {
         int i = 0;
-        while (className[i] == '[') i++;
-        if (className[i] == 'L') {
+        while ((*className)[i] == '[') i++;
+        if ((*className)[i] == 'L') {
             MethodArea &methodArea = MethodArea::getInstance();
-            methodArea.loadClassNamed(className.substr(i+1, className.size()-i-2)); // carrega a classe de referência (se ainda não foi).
+            methodArea.loadClassNamed(className->substr(i+1, className->size()-i-2)); // carrega a classe de referência (se ainda não foi).
         }
     }
 
     // criando objeto da classe instanciada
     Value objectref;
     objectref.type = ValueType::REFERENCE;
-    objectref.data.object = new ArrayObject(ValueType::REFERENCE);
-    
-    // populando array com NULL
-    Value nullValue;
-    nullValue.type = ValueType::REFERENCE;
-    nullValue.data.object = NULL;
-    for (int i = 0; i < count.data.intValue; i++) {
-        ((ArrayObject *) objectref.data.object)->pushValue(nullValue);
+    objectref.data.object = ArrayObject::create(ValueType::REFERENCE, count.data.intValue, true); // populado com NULL
+    if (objectref.data.object == NULL) {
+        // a instrução é repetida após a coleta de lixo
+        topFrame->pushIntoOperandStack(count);
+        retryAllocation();
+        return;
+    }
+    VMStack::getInstance().clearAllocationFailed();
+    if (AllocationProfiler::isEnabled()) {
+        AllocationProfiler::getInstance().record(topFrame, objectref.data.object->getHeapSize());
     }
 
     topFrame->pushIntoOperandStack(objectref);
@@ -4462,10 +4863,22 @@ void ExecutionEngine::i_arraylength() {
 void ExecutionEngine::i_athrow() {
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
-    topFrame->pc += 1;
+    
+    Value objectref = topFrame->popTopOfOperandStack();
+    assert(objectref.type == ValueType::REFERENCE);
+    if (objectref.data.object == NULL) {
+        cerr << "NullPointerException" << endl;
+        exit(1);
+    }
+    
+    throwException((ClassInstance *) objectref.data.object);
 }
 
 void ExecutionEngine::i_checkcast() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol stringClassName = symbolTable.intern("java/lang/String");
+    static Symbol objectClassName = symbolTable.intern("java/lang/Object");
+    
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
     
@@ -4479,7 +4892,7 @@ void ExecutionEngine::i_checkcast() {
     cp_info *constantPool = *(topFrame->getConstantPool());
     cp_info cpElement = constantPool[cpIndex-1];
     assert(cpElement.tag == CONSTANT_Class);
-    string className = getFormattedConstant(constantPool, cpIndex);
+    Symbol className = Utils::getSymbol(constantPool, cpIndex);
     
     Value objectrefValue = topFrame->popTopOfOperandStack();
     assert(objectrefValue.type == ValueType::REFERENCE);
@@ -4500,7 +4913,7 @@ void ExecutionEngine::i_checkcast() {
             bool found = false;
             while (!found) {
                 ClassFile *classFile = classRuntime->getClassFile();
-                string currClassName = getFormattedConstant(classFile->constant_pool, classFile->this_class);
+                Symbol currClassName = Utils::getSymbol(classFile->constant_pool, classFile->this_class);
                 
                 if (currClassName == className) {
                     found = true;
@@ -4508,7 +4921,7 @@ void ExecutionEngine::i_checkcast() {
                     if (classFile->super_class == 0) {
                         break;
                     } else {
-                        string superClassName = getFormattedConstant(classFile->constant_pool, classFile->this_class);
+                        Symbol superClassName = Utils::getSymbol(classFile->constant_pool, classFile->super_class);
                         classRuntime = methodArea.loadClassNamed(superClassName);
                     }
                 }
@@ -4516,9 +4929,9 @@ void ExecutionEngine::i_checkcast() {
             
             resultValue.data.intValue = found ? 1 : 0;
         } else if (obj->objectType() == ObjectType::STRING_INSTANCE) {
-            resultValue.data.intValue = (className == "java/lang/String" || className == "java/lang/Object") ? 1 : 0;
+            resultValue.data.intValue = (className == stringClassName || className == objectClassName) ? 1 : 0;
         } else {
-            if (className == "java/lang/Object") {
+            if (className == objectClassName) {
                 resultValue.data.intValue = 1;
             } else {
                 resultValue.data.intValue = 0;
@@ -4532,6 +4945,10 @@ void ExecutionEngine::i_checkcast() {
 }
 
 void ExecutionEngine::i_instanceof() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol stringClassName = symbolTable.intern("java/lang/String");
+    static Symbol objectClassName = symbolTable.intern("java/lang/Object");
+    
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
     
@@ -4545,7 +4962,7 @@ void ExecutionEngine::i_instanceof() {
     cp_info *constantPool = *(topFrame->getConstantPool());
     cp_info cpElement = constantPool[cpIndex-1];
     assert(cpElement.tag == CONSTANT_Class);
-    string className = getFormattedConstant(constantPool, cpIndex);
+    Symbol className = Utils::getSymbol(constantPool, cpIndex);
     
     Value objectrefValue = topFrame->popTopOfOperandStack();
     assert(objectrefValue.type == ValueType::REFERENCE);
@@ -4565,7 +4982,7 @@ void ExecutionEngine::i_instanceof() {
             bool found = false;
             while (!found) {
                 ClassFile *classFile = classRuntime->getClassFile();
-                string currClassName = getFormattedConstant(classFile->constant_pool, classFile->this_class);
+                Symbol currClassName = Utils::getSymbol(classFile->constant_pool, classFile->this_class);
                 
                 if (currClassName == className) {
                     found = true;
@@ -4573,7 +4990,7 @@ void ExecutionEngine::i_instanceof() {
                     if (classFile->super_class == 0) {
                         break;
                     } else {
-                        string superClassName = getFormattedConstant(classFile->constant_pool, classFile->this_class);
+                        Symbol superClassName = Utils::getSymbol(classFile->constant_pool, classFile->super_class);
                         classRuntime = methodArea.loadClassNamed(superClassName);
                     }
                 }
@@ -4581,9 +4998,9 @@ void ExecutionEngine::i_instanceof() {
             
             resultValue.data.intValue = found ? 1 : 0;
         } else if (obj->objectType() == ObjectType::STRING_INSTANCE) {
-            resultValue.data.intValue = (className == "java/lang/String" || className == "java/lang/Object") ? 1 : 0;
+            resultValue.data.intValue = (className == stringClassName || className == objectClassName) ? 1 : 0;
         } else {
-            if (className == "java/lang/Object") {
+            if (className == objectClassName) {
                 resultValue.data.intValue = 1;
             } else {
                 resultValue.data.intValue = 0;
@@ -4599,12 +5016,38 @@ void ExecutionEngine::i_instanceof() {
 void ExecutionEngine::i_monitorenter() {
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
+    
+    Value objectref = topFrame->popTopOfOperandStack();
+    assert(objectref.type == ValueType::REFERENCE);
+    if (objectref.data.object == NULL) {
+        cerr << "NullPointerException" << endl;
+        exit(1);
+    }
+    
+    // o objeto permanece na pilha de operandos (alcançável) enquanto a thread aguarda o lock
+    topFrame->pushIntoOperandStack(objectref);
+    if (!enterMonitor(objectref.data.object->getLockWord())) {
+        // a thread verde foi estacionada: a instrução é repetida quando ela for acordada
+        return;
+    }
+    topFrame->popTopOfOperandStack();
+    
     topFrame->pc += 1;
 }
 
 void ExecutionEngine::i_monitorexit() {
     VMStack &stackFrame = VMStack::getInstance();
     Frame *topFrame = stackFrame.getTopFrame();
+    
+    Value objectref = topFrame->popTopOfOperandStack();
+    assert(objectref.type == ValueType::REFERENCE);
+    if (objectref.data.object == NULL) {
+        cerr << "NullPointerException" << endl;
+        exit(1);
+    }
+    
+    Monitor::exit(objectref.data.object->getLockWord());
+    
     topFrame->pc += 1;
 }
 
@@ -4631,16 +5074,16 @@ void ExecutionEngine::i_multianewarray() {
     assert(classCP.tag == CONSTANT_Class);
     
     CONSTANT_Class_info classInfo = classCP.info.class_info;
-    string className = getFormattedConstant(constantPool, classInfo.name_index);
+    Symbol className = Utils::getSymbol(constantPool, classInfo.name_index);
     
     // obter o tipo dentro de className:
     ValueType valueType;
     int i = 0;
-    while (className[i] == '[') i++;
+    while ((*className)[i] == '[') i++;
     
-    string multiArrayType = className.substr(i+1, className.size()-i-2); // em caso de ser uma referência (e.g. [[[Ljava/lang/String;)
+    string multiArrayType = className->substr(i+1, className->size()-i-2); // em caso de ser uma referência (e.g. [[[Ljava/lang/String;)
     
-    switch (className[i]) {
+    switch ((*className)[i]) {
         case 'L':
             if (multiArrayType != "java/lang/String") {
                 MethodArea &methodArea = MethodArea::getInstance();
@@ -4681,11 +5124,40 @@ void ExecutionEngine::i_multianewarray() {
     for (int i = 0; i < dimensions; i++) {
         Value dimLength = topFrame->popTopOfOperandStack();
         assert(dimLength.type == ValueType::INT);
+        if (dimLength.data.intValue < 0) {
+            cerr << "NegativeArraySizeException" << endl;
+            exit(1);
+        }
         count.push(dimLength.data.intValue);
     }
     
-    ArrayObject *array = new ArrayObject((dimensions > 1) ? ValueType::REFERENCE : valueType);
-    populateMultiarray(array, valueType, count);
+    ArrayObject *array = ArrayObject::create((dimensions > 1) ? ValueType::REFERENCE : valueType, count.top(), true);
+    if (array == NULL || !populateMultiarray(array, valueType, count)) {
+        // a instrução é repetida após a coleta de lixo, com as dimensões de volta na pilha de operandos
+        for (; !count.empty(); count.pop()) {
+            Value dimLength;
+            dimLength.type = ValueType::INT;
+            dimLength.data.intValue = count.top();
+            topFrame->pushIntoOperandStack(dimLength);
+        }
+        retryAllocation();
+        return;
+    }
+    VMStack::getInstance().clearAllocationFailed();
+    
+    if (AllocationProfiler::isEnabled()) {
+        // todos os arrays criados pela instrução são contabilizados no mesmo local
+        size_t bytes = 0;
+        size_t objects = 0;
+        size_t arrays = 1; // a quantidade de arrays de cada nível
+        for (stack<int> levels(count); !levels.empty(); levels.pop()) {
+            ValueType levelType = (levels.size() > 1) ? ValueType::REFERENCE : valueType;
+            bytes += arrays * Heap::allocationSize(ArrayObject::instanceSize(levelType, levels.top()));
+            objects += arrays;
+            arrays *= levels.top();
+        }
+        AllocationProfiler::getInstance().record(topFrame, bytes, objects);
+    }
     
     Value arrayValue;
     arrayValue.type = ValueType::REFERENCE;
@@ -6,33 +6,32 @@
 #include <cstdlib>
 
 #include "utils.h"
-#include "classviewer.h"
 #include "methodarea.h"
+#include "classloader.h"
+#include "symboltable.h"
 
-Frame::Frame(ClassInstance *object, ClassRuntime *classRuntime, string methodName, string methodDescriptor, vector<Value> arguments) : pc(0), _object(object) {
+Frame::Frame(ClassInstance *object, ClassRuntime *classRuntime, Symbol methodName, Symbol methodDescriptor, vector<Value> arguments) : pc(0), _object(object), _monitorPending(false) {
     
     for (int i = 0; i < arguments.size(); i++) {
         _localVariables[i] = arguments[i];
     }
     
-    method_info *method = getMethodNamed(classRuntime, methodName, methodDescriptor);
-    assert(method != NULL);
-    _method = *method;
-    assert((_method.access_flags & 0x0008) == 0); // o método não pode ser estático
+    _method = getMethodNamed(classRuntime, methodName, methodDescriptor);
+    assert(_method != NULL);
+    assert((_method->access_flags & 0x0008) == 0); // o método não pode ser estático
     
     findAttributes();
 }
 
-Frame::Frame(ClassRuntime *classRuntime, string methodName, string methodDescriptor, vector<Value> arguments) : pc(0), _object(NULL) {
+Frame::Frame(ClassRuntime *classRuntime, Symbol methodName, Symbol methodDescriptor, vector<Value> arguments) : pc(0), _object(NULL), _monitorPending(false) {
     
     for (int i = 0; i < arguments.size(); i++) {
         _localVariables[i] = arguments[i];
     }
     
-    method_info *method = getMethodNamed(classRuntime, methodName, methodDescriptor);
-    assert(method != NULL);
-    _method = *method;
-    assert((_method.access_flags & 0x0008) != 0); // o método precisa ser estático
+    _method = getMethodNamed(classRuntime, methodName, methodDescriptor);
+    assert(_method != NULL);
+    assert((_method->access_flags & 0x0008) != 0); // o método precisa ser estático
     
     findAttributes();
 }
@@ -45,6 +44,14 @@ cp_info** Frame::getConstantPool() {
     return &(_classRuntime->getClassFile()->constant_pool);
 }
 
+ClassRuntime* Frame::getClassRuntime() {
+    return _classRuntime;
+}
+
+method_info* Frame::getMethod() {
+    return _method;
+}
+
 Value Frame::getLocalVariableValue(uint32_t index) {
     if (index >= _codeAttribute->max_locals) {
         cerr << "Tentando acessar variavel local inexistente" << endl;
@@ -92,11 +99,32 @@ void Frame::setOperandStackFromBackup(stack<Value> backup) {
     _operandStack = backup;
 }
 
+void Frame::getReferences(vector<Object*> &references) {
+    for (map<uint32_t, Value>::iterator it = _localVariables.begin(); it != _localVariables.end(); it++) {
+        if (it->second.type == ValueType::REFERENCE) {
+            references.push_back(it->second.data.object);
+        }
+    }
+    
+    // stack não permite percorrer os elementos, portanto uma cópia é esvaziada
+    stack<Value> operands(_operandStack);
+    while (!operands.empty()) {
+        if (operands.top().type == ValueType::REFERENCE) {
+            references.push_back(operands.top().data.object);
+        }
+        operands.pop();
+    }
+    
+    if (_object != NULL) {
+        references.push_back(_object);
+    }
+}
+
 u1* Frame::getCode(uint32_t address) {
     return _codeAttribute->code + address;
 }
 
-method_info* Frame::getMethodNamed(ClassRuntime *classRuntime, string name, string descriptor) {
+method_info* Frame::getMethodNamed(ClassRuntime *classRuntime, Symbol name, Symbol descriptor) {
     MethodArea &methodArea = MethodArea::getInstance();
     
     ClassRuntime *currClass = classRuntime;
@@ -107,8 +135,8 @@ method_info* Frame::getMethodNamed(ClassRuntime *classRuntime, string name, stri
         
         for (int i = 0; i < classFile->methods_count; i++) {
             method = &(classFile->methods[i]);
-            string methodName = getFormattedConstant(classFile->constant_pool, method->name_index);
-            string methodDesc = getFormattedConstant(classFile->constant_pool, method->descriptor_index);
+            Symbol methodName = Utils::getSymbol(classFile->constant_pool, method->name_index);
+            Symbol methodDesc = Utils::getSymbol(classFile->constant_pool, method->descriptor_index);
             
             if (methodName == name && methodDesc == descriptor) {
                 _classRuntime = currClass;
@@ -120,7 +148,7 @@ method_info* Frame::getMethodNamed(ClassRuntime *classRuntime, string name, stri
         if (classFile->super_class == 0) {
             currClass = NULL;
         } else {
-            string superClassName = getFormattedConstant(classFile->constant_pool, classFile->super_class);
+            Symbol superClassName = Utils::getSymbol(classFile->constant_pool, classFile->super_class);
             currClass = methodArea.loadClassNamed(superClassName);
         }
     }
@@ -129,23 +157,11 @@ method_info* Frame::getMethodNamed(ClassRuntime *classRuntime, string name, stri
 }
 
 void Frame::findAttributes() {
-    cp_info *constantPool = *getConstantPool();
+    // os atributos do método são processados na primeira chamada
+    ClassLoader::getInstance().parseMethodAttributes(_classRuntime->getClassFile(), _method);
     
-    _codeAttribute = NULL;
-    _exceptionsAttribute = NULL;
-    
-    for (int i = 0; i < _method.attributes_count; i++) {
-        attribute_info *attr = &(_method.attributes[i]);
-        CONSTANT_Utf8_info attrName = constantPool[attr->attribute_name_index-1].info.utf8_info;
-        
-        if (Utils::compareUtf8WithString(attrName, "Code")) {
-            _codeAttribute = &(attr->info.code_info);
-            if (_exceptionsAttribute != NULL) break;
-        } else if (Utils::compareUtf8WithString(attrName, "Exceptions")) {
-            _exceptionsAttribute = &(attr->info.exceptions_info);
-            if (_codeAttribute != NULL) break;
-        }
-    }
+    _codeAttribute = _method->code;
+    _exceptionsAttribute = _method->exceptions;
 }
 
 u2 Frame::sizeLocalVariables() {
@@ -155,3 +171,36 @@ u2 Frame::sizeLocalVariables() {
 u4 Frame::sizeCode() {
 	return _codeAttribute->code_length;
 }
+
+u2 Frame::sizeExceptionTable() {
+    return _codeAttribute->exception_table_length;
+}
+
+ExceptionTable Frame::getExceptionTableEntry(u2 index) {
+    return _codeAttribute->exception_table[index];
+}
+
+bool Frame::isNative() {
+    return (_method->access_flags & 0x0100) != 0;
+}
+
+bool Frame::isClassInitializer() {
+    static Symbol clinitName = SymbolTable::getInstance().intern("<clinit>");
+    return Utils::getSymbol(_classRuntime->getClassFile()->constant_pool, _method->name_index) == clinitName;
+}
+
+bool Frame::isSynchronized() {
+    return (_method->access_flags & 0x0020) != 0;
+}
+
+atomic<uintptr_t>& Frame::getLockWord() {
+    return (_object != NULL) ? _object->getLockWord() : _classRuntime->getLockWord();
+}
+
+bool Frame::isMonitorPending() {
+    return _monitorPending;
+}
+
+void Frame::setMonitorPending(bool monitorPending) {
+    _monitorPending = monitorPending;
+}
@@ -0,0 +1,753 @@
+#include "garbagecollector.h"
+#include "heap.h"
+#include "vmstack.h"
+#include "classinstance.h"
+#include "arrayobject.h"
+#include "classruntime.h"
+#include "methodarea.h"
+#include "threadmanager.h"
+
+#include <cstdio>
+#include <chrono>
+
+atomic<bool> GarbageCollector::_pollRequested(false);
+atomic<bool> GarbageCollector::_marking(false);
+
+GarbageCollector::GarbageCollector() : _runningMutators(0), _unsafeWaiters(0), _collecting(false), _collectionRequested(false), _verbose(false), _concurrent(false), _maxPauseMillis(GC_DEFAULT_MAX_PAUSE_MILLIS), _cycleActive(false), _cycleDeferred(false), _shutdown(false), _hasDeadline(false), _markAborted(false), _scanGlobalRoots(true), _pausesMillis(0), _maxPauseObserved(0), _phase(PHASE_IDLE), _phaseSequence(0), _pendingWorkers(0), _stopping(false), _idleMarkers(0), _nextWork(0), _regionsCount(0), _liveBytes(0), _freedObjects(0) {
+    // os singletons usados durante a coleta são criados antes, para que sejam destruídos depois deste
+    Heap::getInstance();
+    ThreadManager::getInstance();
+    MethodArea::getInstance();
+
+    _threadsCount = thread::hardware_concurrency();
+    if (_threadsCount == 0) {
+        _threadsCount = 1;
+    }
+}
+
+GarbageCollector::~GarbageCollector() {
+    // a coleta concorrente em andamento é abandonada antes que as threads auxiliares terminem
+    _shutdown = true;
+    {
+        lock_guard<mutex> lock(_cycleMutex);
+    }
+    _cycleRequested.notify_all();
+    {
+        lock_guard<mutex> lock(_safepointMutex);
+    }
+    _mutatorStopped.notify_all();
+    if (_concurrentThread.joinable()) {
+        _concurrentThread.join();
+    }
+
+    {
+        lock_guard<mutex> lock(_phaseMutex);
+        _stopping = true;
+    }
+    _phaseStarted.notify_all();
+
+    for (size_t i = 0; i < _workers.size(); i++) {
+        _workers[i].join();
+    }
+    for (size_t i = 0; i < _markStacks.size(); i++) {
+        delete _markStacks[i];
+    }
+}
+
+void GarbageCollector::setParallelThreads(unsigned int threadsCount) {
+    _threadsCount = (threadsCount > 0) ? threadsCount : 1;
+}
+
+void GarbageCollector::setVerbose(bool verbose) {
+    _verbose = verbose;
+}
+
+void GarbageCollector::setConcurrent() {
+    if (!_concurrent) {
+        _concurrent = true;
+        _concurrentThread = thread(&GarbageCollector::concurrentLoop, this);
+    }
+}
+
+void GarbageCollector::setMaxPauseMillis(unsigned int maxPauseMillis) {
+    _maxPauseMillis = maxPauseMillis;
+    setConcurrent();
+}
+
+void GarbageCollector::requestCollection() {
+    if (_concurrent) {
+        {
+            lock_guard<mutex> lock(_cycleMutex);
+            if (_collectionRequested.load(memory_order_relaxed)) {
+                return;
+            }
+            _collectionRequested.store(true, memory_order_relaxed);
+        }
+        _cycleRequested.notify_one();
+        return;
+    }
+
+    _collectionRequested.store(true, memory_order_relaxed);
+    _pollRequested.store(true, memory_order_release);
+}
+
+void GarbageCollector::waitForCollection() {
+    if (!_concurrent) {
+        return;
+    }
+
+    unique_lock<mutex> lock(_cycleMutex);
+    while (_cycleActive || _collectionRequested.load(memory_order_relaxed)) {
+        _cycleFinished.wait(lock);
+    }
+}
+
+void GarbageCollector::waitForCollectionAttempt() {
+    if (!_concurrent) {
+        return;
+    }
+
+    unique_lock<mutex> lock(_cycleMutex);
+    while ((_cycleActive || _collectionRequested.load(memory_order_relaxed)) && !_cycleDeferred) {
+        _cycleFinished.wait(lock);
+    }
+}
+
+void GarbageCollector::enterSafeRegion() {
+    {
+        lock_guard<mutex> lock(_safepointMutex);
+        _runningMutators--;
+    }
+    _mutatorStopped.notify_all();
+}
+
+void GarbageCollector::leaveSafeRegion() {
+    unique_lock<mutex> lock(_safepointMutex);
+    while (_collecting) {
+        _collectionFinished.wait(lock);
+    }
+    _runningMutators++;
+}
+
+void GarbageCollector::enterUnsafeWait() {
+    {
+        lock_guard<mutex> lock(_safepointMutex);
+        _unsafeWaiters++;
+        // a coleta não pode ocorrer até o fim da espera, portanto as threads deixam de verificar a solicitação
+        _pollRequested.store(false, memory_order_relaxed);
+    }
+    _mutatorStopped.notify_all();
+}
+
+void GarbageCollector::leaveUnsafeWait() {
+    lock_guard<mutex> lock(_safepointMutex);
+    if (--_unsafeWaiters == 0 && !_concurrent && _collectionRequested.load(memory_order_relaxed)) {
+        _pollRequested.store(true, memory_order_release);
+    }
+}
+
+void GarbageCollector::registerStack(VMStack *stack) {
+    lock_guard<mutex> lock(_stacksMutex);
+    _stacks.insert(stack);
+}
+
+void GarbageCollector::unregisterStack(VMStack *stack) {
+    lock_guard<mutex> lock(_stacksMutex);
+    _stacks.erase(stack);
+    // as referências registradas pela thread ainda precisam ser marcadas
+    flushSatbBuffer(stack->getSatbBuffer());
+}
+
+void GarbageCollector::safepointSlow() {
+    unique_lock<mutex> lock(_safepointMutex);
+
+    if (_collecting) {
+        // outra thread conduz a coleta: a thread atual somente para até o seu fim
+        _runningMutators--;
+        _mutatorStopped.notify_all();
+        while (_collecting) {
+            _collectionFinished.wait(lock);
+        }
+        _runningMutators++;
+        return;
+    }
+
+    // na coleta concorrente, as pausas são conduzidas pela thread da coleta (ver stopTheWorld)
+    if (_concurrent || _unsafeWaiters > 0 || !_collectionRequested.load(memory_order_relaxed)) {
+        _pollRequested.store(false, memory_order_relaxed);
+        return;
+    }
+
+    // a thread atual conduz a coleta: aguarda até que todas as demais threads estejam paradas
+    _collecting = true;
+    _runningMutators--;
+    while (_runningMutators > _unsafeWaiters) {
+        _mutatorStopped.wait(lock);
+    }
+
+    if (_unsafeWaiters == 0) {
+        _collectionRequested.store(false, memory_order_relaxed);
+        lock.unlock();
+        collect();
+        lock.lock();
+    }
+    // caso contrário, a coleta é retomada quando as esperas terminarem (ver leaveUnsafeWait)
+
+    _pollRequested.store(_collectionRequested.load(memory_order_relaxed) && _unsafeWaiters == 0, memory_order_relaxed);
+    _collecting = false;
+    _runningMutators++;
+    _collectionFinished.notify_all();
+}
+
+void GarbageCollector::collect() {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Heap &heap = Heap::getInstance();
+    size_t usedBefore = heap.getUsedBytes();
+
+    startWorkers();
+    heap.beginMarking(false);
+
+    {
+        // as pilhas não podem ser destruídas (e.g. por uma thread que terminou) durante a marcação
+        lock_guard<mutex> lock(_stacksMutex);
+        _rootStacks.assign(_stacks.begin(), _stacks.end());
+        _rootClasses.clear();
+        MethodArea::getInstance().getLoadedClasses(_rootClasses);
+
+        _idleMarkers = 0;
+        _nextWork = 0;
+        runPhase(PHASE_MARK);
+    }
+
+    _regionsCount = heap.beginSweep();
+    _liveBytes = 0;
+    _freedObjects = 0;
+    _nextWork = 0;
+    runPhase(PHASE_SWEEP);
+
+    double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    heap.finishCollection(_liveBytes, millis);
+
+    if (_verbose) {
+        printf("[GC %zuK->%zuK, %zu objects freed, %u threads, %.3f ms]\n", usedBefore / 1024, (size_t) _liveBytes / 1024, (size_t) _freedObjects, _threadsCount, millis);
+    }
+}
+
+void GarbageCollector::startWorkers() {
+    // as threads auxiliares são criadas na primeira coleta (a thread que conduz a coleta é a thread 0)
+    if (_markStacks.empty()) {
+        for (unsigned int i = 0; i < _threadsCount; i++) {
+            _markStacks.push_back(new MarkStack);
+        }
+        for (unsigned int i = 1; i < _threadsCount; i++) {
+            _workers.push_back(thread(&GarbageCollector::workerLoop, this, i));
+        }
+    }
+}
+
+void GarbageCollector::concurrentLoop() {
+    while (true) {
+        {
+            unique_lock<mutex> lock(_cycleMutex);
+            while (!_shutdown && !_collectionRequested.load(memory_order_relaxed)) {
+                _cycleRequested.wait(lock);
+            }
+            if (_shutdown) {
+                return;
+            }
+            _cycleActive = true;
+        }
+
+        // a pausa inicial é adiada enquanto alguma thread aguarda o <clinit> de outra thread
+        while (!concurrentCycle() && !_shutdown) {
+            deferCycle();
+        }
+
+        {
+            // as solicitações feitas durante a coleta (pelas alocações que a coleta ainda não contabilizou) são descartadas
+            lock_guard<mutex> lock(_cycleMutex);
+            _collectionRequested.store(false, memory_order_relaxed);
+            _cycleActive = false;
+        }
+        _cycleFinished.notify_all();
+    }
+}
+
+void GarbageCollector::deferCycle() {
+    {
+        lock_guard<mutex> lock(_cycleMutex);
+        _cycleDeferred = true;
+    }
+    // as threads que aguardam somente uma tentativa de coleta voltam a executar (ver waitForCollectionAttempt)
+    _cycleFinished.notify_all();
+    this_thread::sleep_for(chrono::milliseconds(1));
+    lock_guard<mutex> lock(_cycleMutex);
+    _cycleDeferred = false;
+}
+
+bool GarbageCollector::concurrentCycle() {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Heap &heap = Heap::getInstance();
+    size_t usedBefore = heap.getUsedBytes();
+
+    startWorkers();
+    _pausesMillis = 0;
+    _maxPauseObserved = 0;
+
+    // pausa inicial: somente as pilhas das threads são percorridas
+    if (!stopTheWorld()) {
+        return false;
+    }
+    heap.beginMarking(true);
+    _marking.store(true, memory_order_relaxed);
+    {
+        lock_guard<mutex> lock(_stacksMutex);
+        vector<Object*> roots;
+        for (set<VMStack*>::iterator it = _stacks.begin(); it != _stacks.end(); it++) {
+            (*it)->getReferences(roots);
+        }
+        for (size_t i = 0; i < roots.size(); i++) {
+            markAndPush(roots[i], _markStacks[i % _threadsCount]);
+        }
+    }
+    resumeTheWorld();
+    reportPause("initial mark", start);
+
+    // marcação concorrente: as demais raízes e os objetos alcançáveis
+    chrono::steady_clock::time_point markStart = chrono::steady_clock::now();
+    _rootStacks.clear();
+    _rootClasses.clear();
+    MethodArea::getInstance().getLoadedClasses(_rootClasses);
+    _scanGlobalRoots = true;
+    concurrentMark();
+    _scanGlobalRoots = false;
+    if (_verbose) {
+        printf("[GC concurrent mark %.3f ms]\n", chrono::duration<double, milli>(chrono::steady_clock::now() - markStart).count());
+    }
+
+    for (unsigned int attempt = 1; !_shutdown; attempt++) {
+        chrono::steady_clock::time_point pauseStart = chrono::steady_clock::now();
+        if (!stopTheWorld()) {
+            deferCycle();
+            concurrentMark();
+            continue;
+        }
+
+        // pausa final: as referências registradas pela barreira de escrita de cada thread são entregues à marcação
+        {
+            lock_guard<mutex> lock(_stacksMutex);
+            for (set<VMStack*>::iterator it = _stacks.begin(); it != _stacks.end(); it++) {
+                flushSatbBuffer((*it)->getSatbBuffer());
+            }
+        }
+        _hasDeadline = attempt < GC_REMARK_ATTEMPTS;
+        _deadline = pauseStart + chrono::milliseconds(_maxPauseMillis);
+        _markAborted = false;
+        _idleMarkers = 0;
+        _nextWork = 0;
+        runPhase(PHASE_MARK);
+        _hasDeadline = false;
+
+        bool finished = !_markAborted;
+        if (finished) {
+            _marking.store(false, memory_order_relaxed);
+            _regionsCount = heap.beginSweep();
+        }
+        resumeTheWorld();
+        reportPause(finished ? "remark" : "remark, incomplete", pauseStart);
+        if (finished) {
+            break;
+        }
+
+        // a marcação continua com as threads Java executando até a próxima pausa
+        concurrentMark();
+    }
+    if (_shutdown) {
+        return true;
+    }
+
+    // varredura concorrente: as threads Java alocam somente em espaços que não são varridos
+    _liveBytes = 0;
+    _freedObjects = 0;
+    _nextWork = 0;
+    runPhase(PHASE_SWEEP);
+    double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    heap.finishCollection(_liveBytes, millis);
+
+    if (_verbose) {
+        printf("[GC concurrent %zuK->%zuK, %zu objects freed, %u threads, pauses %.3f ms (max %.3f ms), %.3f ms]\n", usedBefore / 1024, (size_t) _liveBytes / 1024, (size_t) _freedObjects, _threadsCount, _pausesMillis, _maxPauseObserved, millis);
+    }
+    return true;
+}
+
+void GarbageCollector::concurrentMark() {
+    _markAborted = false;
+    _idleMarkers = 0;
+    _nextWork = 0;
+    runPhase(PHASE_MARK);
+}
+
+bool GarbageCollector::stopTheWorld() {
+    unique_lock<mutex> lock(_safepointMutex);
+
+    _collecting = true;
+    _pollRequested.store(true, memory_order_release);
+    while (_runningMutators > _unsafeWaiters && !_shutdown) {
+        _mutatorStopped.wait(lock);
+    }
+
+    if (_unsafeWaiters > 0 || _shutdown) {
+        _collecting = false;
+        _pollRequested.store(false, memory_order_relaxed);
+        lock.unlock();
+        _collectionFinished.notify_all();
+        return false;
+    }
+    return true;
+}
+
+void GarbageCollector::resumeTheWorld() {
+    {
+        lock_guard<mutex> lock(_safepointMutex);
+        _collecting = false;
+        _pollRequested.store(false, memory_order_relaxed);
+    }
+    _collectionFinished.notify_all();
+}
+
+void GarbageCollector::reportPause(const char *name, chrono::steady_clock::time_point start) {
+    double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    _pausesMillis += millis;
+    if (millis > _maxPauseObserved) {
+        _maxPauseObserved = millis;
+    }
+
+    if (_verbose) {
+        printf("[GC pause (%s) %.3f ms]\n", name, millis);
+    }
+}
+
+void GarbageCollector::logOverwritten(Object *object) {
+    // um objeto já marcado já teve (ou terá) os seus fields percorridos
+    if (Heap::isMarked(object)) {
+        return;
+    }
+
+    vector<Object*> &buffer = VMStack::getInstance().getSatbBuffer();
+    buffer.push_back(object);
+    if (buffer.size() >= GC_SATB_BUFFER_SIZE) {
+        flushSatbBuffer(buffer);
+    }
+}
+
+void GarbageCollector::flushSatbBuffer(vector<Object*> &buffer) {
+    if (buffer.empty()) {
+        return;
+    }
+
+    lock_guard<mutex> lock(_satbMutex);
+    _satbQueue.insert(_satbQueue.end(), buffer.begin(), buffer.end());
+    buffer.clear();
+}
+
+bool GarbageCollector::takeSatbWork(unsigned int index) {
+    vector<Object*> objects;
+    {
+        lock_guard<mutex> lock(_satbMutex);
+        if (_satbQueue.empty()) {
+            return false;
+        }
+        // assim como em steal, a thread deixa de estar ociosa enquanto as referências ainda estão na fila
+        _idleMarkers--;
+        objects.swap(_satbQueue);
+    }
+
+    MarkStack *markStack = _markStacks[index];
+    for (size_t i = 0; i < objects.size(); i++) {
+        markAndPush(objects[i], markStack);
+    }
+    return true;
+}
+
+void GarbageCollector::runPhase(CollectionPhase phase) {
+    if (phase == PHASE_MARK) {
+        // nenhuma thread rouba entre duas fases
+        for (size_t i = 0; i < _markStacks.size(); i++) {
+            _markStacks[i]->releaseRetired();
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(_phaseMutex);
+        _phase = phase;
+        _phaseSequence++;
+        _pendingWorkers = _workers.size();
+    }
+    _phaseStarted.notify_all();
+
+    if (phase == PHASE_MARK) {
+        markWorker(0);
+    } else {
+        sweepWorker();
+    }
+
+    unique_lock<mutex> lock(_phaseMutex);
+    while (_pendingWorkers > 0) {
+        _phaseFinished.wait(lock);
+    }
+    _phase = PHASE_IDLE;
+}
+
+void GarbageCollector::workerLoop(unsigned int index) {
+    unsigned int lastSequence = 0;
+
+    while (true) {
+        CollectionPhase phase;
+        {
+            unique_lock<mutex> lock(_phaseMutex);
+            while (!_stopping && (_phase == PHASE_IDLE || _phaseSequence == lastSequence)) {
+                _phaseStarted.wait(lock);
+            }
+            if (_stopping) {
+                return;
+            }
+            phase = _phase;
+            lastSequence = _phaseSequence;
+        }
+
+        if (phase == PHASE_MARK) {
+            markWorker(index);
+        } else {
+            sweepWorker();
+        }
+
+        {
+            lock_guard<mutex> lock(_phaseMutex);
+            _pendingWorkers--;
+        }
+        _phaseFinished.notify_all();
+    }
+}
+
+void GarbageCollector::markWorker(unsigned int index) {
+    MarkStack *markStack = _markStacks[index];
+    size_t stacksCount = _rootStacks.size();
+    size_t classesCount = _scanGlobalRoots ? _rootClasses.size() : 0;
+    size_t sourcesCount = stacksCount + (_scanGlobalRoots ? classesCount + 2 : 0);
+    unsigned int processed = 0;
+
+    vector<Object*> roots;
+    while (true) {
+        size_t source = _nextWork.fetch_add(1);
+        if (source < sourcesCount) {
+            // obtém as raízes de mais uma fonte
+            roots.clear();
+            if (source < stacksCount) {
+                _rootStacks[source]->getReferences(roots);
+            } else if (source < stacksCount + classesCount) {
+                const map<Symbol, Value> &staticFields = _rootClasses[source - stacksCount]->getStaticFields();
+                for (map<Symbol, Value>::const_iterator it = staticFields.begin(); it != staticFields.end(); it++) {
+                    if (it->second.type == ValueType::REFERENCE) {
+                        roots.push_back(it->second.data.object);
+                    }
+                }
+            } else if (source == stacksCount + classesCount) {
+                Heap::getInstance().collectRoots(roots);
+            } else {
+                ThreadManager::getInstance().collectRoots(roots);
+            }
+
+            for (size_t i = 0; i < roots.size(); i++) {
+                markAndPush(roots[i], markStack);
+            }
+        }
+
+        // marca os objetos alcançáveis a partir da própria pilha
+        while (true) {
+            // a marcação é interrompida ao atingir o limite da pausa, e os objetos restantes continuam nas pilhas
+            if ((++processed % 64) == 0 && ((_hasDeadline && chrono::steady_clock::now() >= _deadline) || (_concurrent && _shutdown))) {
+                _markAborted = true;
+            }
+            if (_markAborted.load(memory_order_relaxed)) {
+                return;
+            }
+
+            Object *object;
+            if (!markStack->pop(object)) {
+                break;
+            }
+
+            if (object->objectType() == CLASS_INSTANCE) {
+                ClassInstance *instance = (ClassInstance *) object;
+                const vector<u4> &referenceOffsets = instance->getClassRuntime()->getReferenceOffsets();
+                for (size_t i = 0; i < referenceOffsets.size(); i++) {
+                    markAndPush(instance->getReferenceAt(referenceOffsets[i]), markStack);
+                }
+            } else if (object->objectType() == ARRAY) {
+                ArrayObject *array = (ArrayObject *) object;
+                if (array->arrayContentType() == ValueType::REFERENCE) {
+                    uint32_t size = array->getSize();
+                    for (uint32_t i = 0; i < size; i++) {
+                        markAndPush(array->getReference(i), markStack);
+                    }
+                }
+            }
+        }
+
+        if (source < sourcesCount) {
+            continue;
+        }
+
+        // sem trabalho: rouba de outra thread até que todas as threads estejam sem trabalho
+        _idleMarkers++;
+        while (!steal(index) && !takeSatbWork(index)) {
+            if (_idleMarkers.load() == _threadsCount || _markAborted.load(memory_order_relaxed)) {
+                return;
+            }
+            this_thread::yield();
+        }
+    }
+}
+
+void GarbageCollector::markAndPush(Object *object, MarkStack *markStack) {
+    if (object == NULL || !Heap::mark(object)) {
+        return;
+    }
+
+    markStack->push(object);
+}
+
+bool GarbageCollector::steal(unsigned int index) {
+    MarkStack *markStack = _markStacks[index];
+
+    for (unsigned int i = 1; i < _threadsCount; i++) {
+        MarkStack *victim = _markStacks[(index + i) % _threadsCount];
+        size_t count = (victim->size() + 1) / 2;
+        if (count == 0) {
+            continue;
+        }
+
+        // a thread deixa de estar ociosa antes de retirar os objetos da vítima (que não está ociosa), portanto todas as
+        // threads estão ociosas somente quando não há mais trabalho em nenhuma pilha
+        _idleMarkers--;
+        // os objetos mais antigos (no início da pilha) tendem a ter mais objetos alcançáveis a partir deles
+        size_t stolen = 0;
+        Object *object;
+        while (stolen < count && victim->steal(object)) {
+            markStack->push(object);
+            stolen++;
+        }
+        if (stolen > 0) {
+            return true;
+        }
+        _idleMarkers++;
+    }
+
+    return false;
+}
+
+void GarbageCollector::sweepWorker() {
+    Heap &heap = Heap::getInstance();
+    size_t liveBytes = 0;
+    size_t freedObjects = 0;
+
+    size_t region;
+    while ((region = _nextWork.fetch_add(1)) < _regionsCount) {
+        liveBytes += heap.sweepRegion(region, freedObjects);
+    }
+
+    _liveBytes += liveBytes;
+    _freedObjects += freedObjects;
+}
+
+GarbageCollector::MarkStack::MarkStack() : _top(0), _bottom(0) {
+    _buffer.store(newBuffer(GC_MARK_STACK_INITIAL_CAPACITY), memory_order_relaxed);
+}
+
+GarbageCollector::MarkStack::~MarkStack() {
+    deleteBuffer(_buffer.load(memory_order_relaxed));
+    releaseRetired();
+}
+
+GarbageCollector::MarkStack::Buffer* GarbageCollector::MarkStack::newBuffer(long capacity) {
+    Buffer *buffer = new Buffer;
+    buffer->capacity = capacity;
+    buffer->objects = new atomic<Object*>[capacity];
+    return buffer;
+}
+
+void GarbageCollector::MarkStack::deleteBuffer(Buffer *buffer) {
+    delete[] buffer->objects;
+    delete buffer;
+}
+
+void GarbageCollector::MarkStack::push(Object *object) {
+    long bottom = _bottom.load(memory_order_relaxed);
+    long top = _top.load(memory_order_acquire);
+    Buffer *buffer = _buffer.load(memory_order_relaxed);
+
+    if (bottom - top > buffer->capacity - 1) {
+        // o buffer anterior é mantido até a próxima marcação, pois uma thread pode estar roubando dele
+        Buffer *grown = newBuffer(buffer->capacity * 2);
+        for (long i = top; i < bottom; i++) {
+            grown->objects[i & (grown->capacity - 1)].store(buffer->objects[i & (buffer->capacity - 1)].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        _retired.push_back(buffer);
+        _buffer.store(grown, memory_order_release);
+        buffer = grown;
+    }
+
+    buffer->objects[bottom & (buffer->capacity - 1)].store(object, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    _bottom.store(bottom + 1, memory_order_relaxed);
+}
+
+bool GarbageCollector::MarkStack::pop(Object *&object) {
+    long bottom = _bottom.load(memory_order_relaxed) - 1;
+    Buffer *buffer = _buffer.load(memory_order_relaxed);
+    _bottom.store(bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = _top.load(memory_order_relaxed);
+
+    if (top > bottom) {
+        _bottom.store(bottom + 1, memory_order_relaxed);
+        return false;
+    }
+
+    object = buffer->objects[bottom & (buffer->capacity - 1)].load(memory_order_relaxed);
+    if (top < bottom) {
+        return true;
+    }
+
+    // o último objeto: a dona compete com as threads que roubam
+    bool taken = _top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+    _bottom.store(bottom + 1, memory_order_relaxed);
+    return taken;
+}
+
+bool GarbageCollector::MarkStack::steal(Object *&object) {
+    long top = _top.load(memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = _bottom.load(memory_order_acquire);
+
+    if (top >= bottom) {
+        return false;
+    }
+
+    Buffer *buffer = _buffer.load(memory_order_acquire);
+    object = buffer->objects[top & (buffer->capacity - 1)].load(memory_order_relaxed);
+    return _top.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+size_t GarbageCollector::MarkStack::size() {
+    long top = _top.load(memory_order_acquire);
+    long bottom = _bottom.load(memory_order_acquire);
+    return (bottom > top) ? bottom - top : 0;
+}
+
+void GarbageCollector::MarkStack::releaseRetired() {
+    for (size_t i = 0; i < _retired.size(); i++) {
+        deleteBuffer(_retired[i]);
+    }
+    _retired.clear();
+}
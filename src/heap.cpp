@@ -2,17 +2,469 @@
 #include <cstdlib>
 
 #include "heap.h"
+#include "classinstance.h"
+#include "arrayobject.h"
+#include "garbagecollector.h"
+
+#include <new>
+#include <sys/mman.h>
 
 using namespace std;
 
-Heap::Heap() {
-    
+thread_local u1 *Heap::_tlabTop = NULL;
+thread_local u1 *Heap::_tlabEnd = NULL;
+thread_local u4 Heap::_tlabEpoch = 0;
+atomic<u4> Heap::_epoch(0);
+atomic<u4> Heap::_markBit(OBJECT_MARK_ODD);
+atomic<u4> Heap::_allocationFlags(0);
+u1 *Heap::_base = NULL;
+
+Heap::Heap() : _largeObjectThreshold(HEAP_LARGE_OBJECT_THRESHOLD), _compressedReferences(true), _reservedTop(NULL), _reservedEnd(NULL), _allocatedSinceCollection(0), _allocatedBeforeSweep(0), _liveBytes(0), _collectionThreshold(HEAP_COLLECTION_THRESHOLD), _initialSize(HEAP_COLLECTION_THRESHOLD), _committedBytes(0), _maxSize(0), _lastCollectionEnd(chrono::steady_clock::now()), _startedCollections(0), _finishedCollections(0) {
+
 }
 
 Heap::~Heap() {
-    
+
+}
+
+void Heap::setCompressedReferences(bool compressedReferences) {
+    _compressedReferences = compressedReferences;
+}
+
+void Heap::setLargeObjectThreshold(size_t threshold) {
+    _largeObjectThreshold = threshold;
+}
+
+void Heap::setInitialSize(size_t size) {
+    _initialSize = (size > TLAB_SIZE) ? size : TLAB_SIZE;
+    _collectionThreshold = _initialSize;
+}
+
+void Heap::setMaxSize(size_t size) {
+    _maxSize = size;
+    // o tamanho inicial padrão é reduzido, para que a primeira coleta ocorra antes que o tamanho máximo seja atingido
+    setInitialSize((_initialSize > size / 2) ? size / 2 : _initialSize);
+}
+
+void Heap::reserve() {
+    if (!_compressedReferences) {
+        return;
+    }
+    _compressedReferences = false;
+
+    // o intervalo somente ocupa memória à medida que as regiões são criadas (ver commit)
+    for (size_t size = HEAP_RESERVED_SIZE; size >= HEAP_MIN_RESERVED_SIZE; size /= 2) {
+        void *base = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base != MAP_FAILED) {
+            _base = (u1 *) base;
+            // o deslocamento 0 representa NULL, portanto a primeira página não é usada
+            _reservedTop = _base + HEAP_PAGE_SIZE;
+            _reservedEnd = _base + size;
+            return;
+        }
+    }
+}
+
+u1* Heap::commit(size_t size) {
+    u1 *start = NULL;
+    for (size_t i = 0; i < _freeRanges.size(); i++) {
+        if ((size_t) (_freeRanges[i].end - _freeRanges[i].start) >= size) {
+            start = _freeRanges[i].start;
+            _freeRanges[i].start += size;
+            if (_freeRanges[i].start == _freeRanges[i].end) {
+                _freeRanges.erase(_freeRanges.begin() + i);
+            }
+            break;
+        }
+    }
+    if (start == NULL) {
+        if ((size_t) (_reservedEnd - _reservedTop) < size) {
+            return NULL;
+        }
+        start = _reservedTop;
+        _reservedTop += size;
+    }
+
+    if (mprotect(start, size, PROT_READ | PROT_WRITE) != 0) {
+        return NULL;
+    }
+    return start;
+}
+
+void Heap::release(u1 *start, u1 *end) {
+    // os intervalos são mantidos ordenados, portanto os vizinhos do intervalo devolvido são os únicos candidatos à junção
+    size_t i = 0;
+    while (i < _freeRanges.size() && _freeRanges[i].start < start) {
+        i++;
+    }
+    if (i > 0 && _freeRanges[i - 1].end == start) {
+        i--;
+        start = _freeRanges[i].start;
+        _freeRanges.erase(_freeRanges.begin() + i);
+    }
+    if (i < _freeRanges.size() && _freeRanges[i].start == end) {
+        end = _freeRanges[i].end;
+        _freeRanges.erase(_freeRanges.begin() + i);
+    }
+
+    // o último intervalo usado volta para a parte ainda não usada da reserva
+    if (end == _reservedTop) {
+        _reservedTop = start;
+        return;
+    }
+    FreeChunk range = { start, end };
+    _freeRanges.insert(_freeRanges.begin() + i, range);
+}
+
+Heap::HeapRegion* Heap::newRegion(size_t size, bool large, bool limited) {
+    size = (size + HEAP_PAGE_SIZE - 1) & ~((size_t) HEAP_PAGE_SIZE - 1);
+    if (limited && _maxSize != 0 && _committedBytes + size > _maxSize) {
+        return NULL;
+    }
+
+    HeapRegion *region = new HeapRegion;
+    if (_base != NULL) {
+        region->start = commit(size);
+    } else if (large) {
+        void *start = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        region->start = (start != MAP_FAILED) ? (u1 *) start : NULL;
+    } else {
+        region->start = new u1[size];
+    }
+    if (region->start == NULL) {
+        if (limited) {
+            delete region;
+            return NULL;
+        }
+        cerr << "OutOfMemoryError" << endl;
+        exit(1);
+    }
+    _committedBytes += size;
+    region->end = region->start + size;
+    region->empty = false;
+    region->large = large;
+    if (large) {
+        _largeRegions.push_back(region);
+    } else {
+        _regions.push_back(region);
+    }
+    return region;
+}
+
+void Heap::deleteRegion(HeapRegion *region) {
+    _committedBytes -= region->end - region->start;
+    if (_base != NULL) {
+        // a memória é devolvida ao sistema, e o intervalo pode ser usado por outra região
+        madvise(region->start, region->end - region->start, MADV_DONTNEED);
+        mprotect(region->start, region->end - region->start, PROT_NONE);
+        release(region->start, region->end);
+    } else if (region->large) {
+        munmap(region->start, region->end - region->start);
+    } else {
+        delete[] region->start;
+    }
+    delete region;
+}
+
+void Heap::countAllocation(size_t size) {
+    _allocatedSinceCollection += size;
+    if (_allocatedSinceCollection >= _collectionThreshold) {
+        GarbageCollector::getInstance().requestCollection();
+    }
+}
+
+void Heap::markFree(u1 *start, u1 *end) {
+    new (start) atomic<uintptr_t>(((uintptr_t) (end - start)) | OBJECT_FREE);
 }
 
-void Heap::addObject(Object *object) {    
-	_objectVector.push_back(object);
+size_t Heap::sizeAt(u1 *position) {
+    uintptr_t word = ((atomic<uintptr_t> *) position)->load(memory_order_relaxed);
+    if ((word & OBJECT_FREE) != 0) {
+        return word & ~((uintptr_t) OBJECT_FREE);
+    }
+    return ((Object *) position)->getHeapSize();
+}
+
+void Heap::destroy(Object *object) {
+    switch (object->objectType()) {
+        case CLASS_INSTANCE:
+            ((ClassInstance *) object)->~ClassInstance();
+            break;
+        case STRING_INSTANCE:
+            ((StringObject *) object)->~StringObject();
+            break;
+        case ARRAY:
+            ((ArrayObject *) object)->~ArrayObject();
+            break;
+    }
+}
+
+Heap::FreeChunk Heap::newTlab(size_t minimumSize, bool limited) {
+    lock_guard<mutex> lock(_regionsMutex);
+
+    FreeChunk chunk;
+    while (!_freeChunks.empty()) {
+        chunk = _freeChunks.back();
+        _freeChunks.pop_back();
+        // espaços menores que o necessário continuam livres, e são encontrados novamente pela próxima varredura
+        if ((size_t) (chunk.end - chunk.start) >= minimumSize) {
+            countAllocation(chunk.end - chunk.start);
+            return chunk;
+        }
+    }
+
+    HeapRegion *region;
+    if (!_freeRegions.empty()) {
+        region = _freeRegions.back();
+        _freeRegions.pop_back();
+        region->empty = false;
+        _regions.push_back(region);
+    } else {
+        region = newRegion(TLAB_SIZE, false, limited);
+        if (region == NULL) {
+            chunk.start = chunk.end = NULL;
+            return chunk;
+        }
+    }
+    markFree(region->start, region->end);
+
+    chunk.start = region->start;
+    chunk.end = region->end;
+    countAllocation(TLAB_SIZE);
+    return chunk;
+}
+
+void* Heap::allocate(size_t size, bool limited) {
+    size_t allocationSize = Heap::allocationSize(size);
+
+    if (allocationSize > _largeObjectThreshold) {
+        // objetos grandes recebem uma região própria, e a TLAB atual continua sendo usada
+        lock_guard<mutex> lock(_regionsMutex);
+        HeapRegion *region = newRegion(allocationSize, true, limited);
+        if (region == NULL) {
+            return NULL;
+        }
+        countAllocation(allocationSize);
+        if (region->start + allocationSize < region->end) {
+            markFree(region->start + allocationSize, region->end); // o arredondamento para páginas
+        }
+        return region->start;
+    }
+
+    if (_tlabTop == NULL || _tlabTop + allocationSize > _tlabEnd || _tlabEpoch != _epoch.load(memory_order_relaxed)) {
+        // o restante da TLAB anterior continua coberto pela sua palavra livre
+        _tlabEpoch = _epoch.load(memory_order_relaxed);
+        FreeChunk chunk = newTlab(allocationSize, limited);
+        _tlabTop = chunk.start;
+        _tlabEnd = chunk.end;
+        if (_tlabTop == NULL) {
+            return NULL;
+        }
+    }
+
+    u1 *object = _tlabTop;
+    _tlabTop += allocationSize;
+    if (_tlabTop < _tlabEnd) {
+        markFree(_tlabTop, _tlabEnd);
+    }
+
+    return object;
+}
+
+StringObject* Heap::internString(const string &s) {
+    lock_guard<mutex> lock(_stringsMutex);
+    map<string, StringObject*>::iterator it = _internedStrings.find(s);
+
+    if (it != _internedStrings.end()) {
+        return it->second;
+    }
+
+    StringObject *stringObject = new StringObject(s);
+    _internedStrings[s] = stringObject;
+    return stringObject;
+}
+
+size_t Heap::removeInstancesOfScope(LoaderScope *scope) {
+    lock_guard<mutex> lock(_regionsMutex);
+
+    vector<HeapRegion*> regions(_regions);
+    regions.insert(regions.end(), _largeRegions.begin(), _largeRegions.end());
+
+    size_t removed = 0;
+    for (size_t i = 0; i < regions.size(); i++) {
+        HeapRegion *region = regions[i];
+
+        for (u1 *position = region->start; position < region->end; ) {
+            size_t size = sizeAt(position);
+            Object *object = (Object *) position;
+            if ((object->getClassWord().load(memory_order_relaxed) & OBJECT_FREE) == 0 && object->objectType() == CLASS_INSTANCE && ((ClassInstance *) object)->getClassRuntime()->getScope() == scope) {
+                destroy(object);
+                markFree(position, position + size);
+                removed++;
+            }
+            position += size;
+        }
+    }
+
+    return removed;
+}
+
+void Heap::collectRoots(vector<Object*> &roots) {
+    lock_guard<mutex> lock(_stringsMutex);
+
+    for (map<string, StringObject*>::iterator it = _internedStrings.begin(); it != _internedStrings.end(); it++) {
+        roots.push_back(it->second);
+    }
+}
+
+size_t Heap::getUsedBytes() {
+    lock_guard<mutex> lock(_regionsMutex);
+    return _liveBytes + _allocatedSinceCollection;
+}
+
+void Heap::beginMarking(bool allocateMarked) {
+    u4 markBit = (_markBit.load(memory_order_relaxed) == OBJECT_MARK_EVEN) ? OBJECT_MARK_ODD : OBJECT_MARK_EVEN;
+    _markBit.store(markBit, memory_order_relaxed);
+    _allocationFlags.store(allocateMarked ? markBit : 0, memory_order_relaxed);
+    _startedCollections.fetch_add(1, memory_order_relaxed);
+}
+
+size_t Heap::beginSweep() {
+    lock_guard<mutex> lock(_regionsMutex);
+    _freeChunks.clear();
+    _sweepRegions = _regions;
+    _sweepRegions.insert(_sweepRegions.end(), _largeRegions.begin(), _largeRegions.end());
+    _allocatedBeforeSweep = _allocatedSinceCollection;
+
+    // as TLABs atuais podem estar entre os espaços reaproveitados pela varredura
+    _epoch.fetch_add(1, memory_order_relaxed);
+    return _sweepRegions.size();
+}
+
+size_t Heap::sweepRegion(size_t index, size_t &freedObjects) {
+    HeapRegion *region = _sweepRegions[index];
+    u4 markBit = _markBit.load(memory_order_relaxed);
+
+    size_t liveBytes = 0;
+    vector<FreeChunk> chunks;
+    u1 *freeStart = NULL;
+    for (u1 *position = region->start; position < region->end; ) {
+        atomic<uintptr_t> &word = *((atomic<uintptr_t> *) position);
+        size_t size = sizeAt(position);
+        uintptr_t flags = word.load(memory_order_relaxed);
+
+        if ((flags & (OBJECT_FREE | markBit)) == markBit) {
+            word.store(flags & ~((uintptr_t) OBJECT_MARKS), memory_order_relaxed);
+            liveBytes += size;
+
+            // o objeto vivo encerra o espaço livre anterior
+            if (freeStart != NULL) {
+                markFree(freeStart, position);
+                if (position - freeStart >= HEAP_MIN_FREE_CHUNK && !region->large) {
+                    FreeChunk chunk = { freeStart, position };
+                    chunks.push_back(chunk);
+                }
+                freeStart = NULL;
+            }
+        } else {
+            if ((flags & OBJECT_FREE) == 0) {
+                // o espaço do objeto é coberto pela palavra livre do espaço livre que o contém
+                destroy((Object *) position);
+                freedObjects++;
+            }
+            if (freeStart == NULL) {
+                freeStart = position;
+            }
+        }
+
+        position += size;
+    }
+
+    region->empty = (liveBytes == 0);
+    if (region->empty) {
+        // a região inteira é reaproveitada em finishCollection
+        return 0;
+    }
+
+    if (freeStart != NULL) {
+        // o espaço após um objeto grande (o arredondamento para páginas) não é usado como TLAB
+        markFree(freeStart, region->end);
+        if (region->end - freeStart >= HEAP_MIN_FREE_CHUNK && !region->large) {
+            FreeChunk chunk = { freeStart, region->end };
+            chunks.push_back(chunk);
+        }
+    }
+    if (!chunks.empty()) {
+        lock_guard<mutex> lock(_regionsMutex);
+        _freeChunks.insert(_freeChunks.end(), chunks.begin(), chunks.end());
+    }
+    return liveBytes;
+}
+
+void Heap::finishCollection(size_t liveBytes, double collectionMillis) {
+    lock_guard<mutex> lock(_regionsMutex);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < _regions.size(); i++) {
+        HeapRegion *region = _regions[i];
+        if (!region->empty) {
+            _regions[kept++] = region;
+        } else {
+            _freeRegions.push_back(region);
+        }
+    }
+    _regions.resize(kept);
+
+    // a memória dos objetos grandes inalcançáveis é devolvida ao sistema
+    kept = 0;
+    for (size_t i = 0; i < _largeRegions.size(); i++) {
+        HeapRegion *region = _largeRegions[i];
+        if (!region->empty) {
+            _largeRegions[kept++] = region;
+        } else {
+            deleteRegion(region);
+        }
+    }
+    _largeRegions.resize(kept);
+    _sweepRegions.clear();
+    _allocationFlags.store(0, memory_order_relaxed);
+
+    _liveBytes = liveBytes;
+    _allocatedSinceCollection -= _allocatedBeforeSweep;
+
+    // a fração do tempo gasta com a coleta desde o fim da coleta anterior define o crescimento da heap
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double elapsedMillis = chrono::duration<double, milli>(now - _lastCollectionEnd).count();
+    _lastCollectionEnd = now;
+    double overhead = (elapsedMillis > 0) ? collectionMillis / elapsedMillis : 1;
+
+    size_t threshold = _collectionThreshold;
+    if (overhead > HEAP_MAX_GC_OVERHEAD) {
+        // o limite em relação aos objetos vivos impede o crescimento, mas nunca reduz a quantidade atual
+        size_t maxThreshold = liveBytes * HEAP_MAX_LIVE_RATIO;
+        if (maxThreshold < threshold) {
+            maxThreshold = threshold;
+        }
+        threshold = (threshold * 2 < maxThreshold) ? threshold * 2 : maxThreshold;
+    } else if (overhead < HEAP_MIN_GC_OVERHEAD) {
+        threshold /= 2;
+    }
+    // a heap comporta ao menos o dobro dos objetos vivos, sem exceder o tamanho máximo
+    if (threshold < _initialSize) {
+        threshold = _initialSize;
+    }
+    if (threshold < liveBytes) {
+        threshold = liveBytes;
+    }
+    if (_maxSize != 0 && threshold + liveBytes > _maxSize) {
+        threshold = (_maxSize > liveBytes + TLAB_SIZE) ? _maxSize - liveBytes : TLAB_SIZE;
+    }
+    _collectionThreshold = threshold;
+
+    // as regiões livres além das necessárias até a próxima coleta são devolvidas ao sistema
+    while (_freeRegions.size() > threshold / TLAB_SIZE) {
+        deleteRegion(_freeRegions.back());
+        _freeRegions.pop_back();
+    }
+    _finishedCollections.fetch_add(1, memory_order_relaxed);
 }
@@ -0,0 +1,293 @@
+#include "inflater.h"
+
+#include <cstring>
+
+Inflater::Inflater(const u1 *source, u4 sourceLength, u1 *dest, u4 destLength) : _source(source), _sourceLength(sourceLength), _sourceOffset(0), _dest(dest), _destLength(destLength), _destOffset(0), _bitBuffer(0), _bitCount(0), _error(false) {
+
+}
+
+bool Inflater::inflate(const u1 *source, u4 sourceLength, u1 *dest, u4 destLength) {
+    Inflater inflater(source, sourceLength, dest, destLength);
+
+    int last;
+    do {
+        last = inflater.bits(1);
+        int type = inflater.bits(2);
+        if (inflater._error) {
+            return false;
+        }
+
+        bool valid;
+        switch (type) {
+            case 0:
+                valid = inflater.stored();
+                break;
+            case 1:
+                valid = inflater.fixed();
+                break;
+            case 2:
+                valid = inflater.dynamic();
+                break;
+            default:
+                valid = false;
+        }
+
+        if (!valid) {
+            return false;
+        }
+    } while (!last);
+
+    return inflater._destOffset == destLength;
+}
+
+int Inflater::bits(int need) {
+    long value = _bitBuffer;
+
+    while (_bitCount < need) {
+        if (_sourceOffset == _sourceLength) {
+            _error = true;
+            return 0;
+        }
+        value |= (long) _source[_sourceOffset++] << _bitCount;
+        _bitCount += 8;
+    }
+
+    _bitBuffer = (int) (value >> need);
+    _bitCount -= need;
+
+    return (int) (value & ((1L << need) - 1));
+}
+
+bool Inflater::stored() {
+    // blocos não comprimidos começam no próximo byte
+    _bitBuffer = 0;
+    _bitCount = 0;
+
+    if (_sourceLength - _sourceOffset < 4) {
+        return false;
+    }
+
+    u4 length = _source[_sourceOffset] | (_source[_sourceOffset + 1] << 8);
+    if (_source[_sourceOffset + 2] != (~length & 0xff) || _source[_sourceOffset + 3] != ((~length >> 8) & 0xff)) {
+        return false;
+    }
+    _sourceOffset += 4;
+
+    if (_sourceLength - _sourceOffset < length || _destLength - _destOffset < length) {
+        return false;
+    }
+
+    memcpy(_dest + _destOffset, _source + _sourceOffset, length);
+    _sourceOffset += length;
+    _destOffset += length;
+
+    return true;
+}
+
+int Inflater::decode(const Huffman *h) {
+    int code = 0; // bits lidos até o momento
+    int first = 0; // primeiro código do tamanho atual
+    int index = 0; // índice do primeiro símbolo do tamanho atual
+
+    for (int length = 1; length <= INFLATER_MAXBITS; length++) {
+        code |= bits(1);
+        if (_error) {
+            return -1;
+        }
+
+        int count = h->count[length];
+        if (code - count < first) {
+            return h->symbol[index + (code - first)];
+        }
+
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    return -1; // código inválido
+}
+
+int Inflater::construct(Huffman *h, const short *length, int n) {
+    for (int len = 0; len <= INFLATER_MAXBITS; len++) {
+        h->count[len] = 0;
+    }
+    for (int symbol = 0; symbol < n; symbol++) {
+        h->count[length[symbol]]++;
+    }
+
+    if (h->count[0] == n) { // nenhum código
+        return 0;
+    }
+
+    // verifica se o conjunto de tamanhos é válido (i.e. não há mais códigos do que o possível)
+    int left = 1;
+    for (int len = 1; len <= INFLATER_MAXBITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) {
+            return left;
+        }
+    }
+
+    short offsets[INFLATER_MAXBITS + 1];
+    offsets[1] = 0;
+    for (int len = 1; len < INFLATER_MAXBITS; len++) {
+        offsets[len + 1] = offsets[len] + h->count[len];
+    }
+
+    for (int symbol = 0; symbol < n; symbol++) {
+        if (length[symbol] != 0) {
+            h->symbol[offsets[length[symbol]]++] = symbol;
+        }
+    }
+
+    return left;
+}
+
+bool Inflater::codes(const Huffman *lencode, const Huffman *distcode) {
+    static const short lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const short lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const short distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const short distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    int symbol;
+    do {
+        symbol = decode(lencode);
+        if (symbol < 0) {
+            return false;
+        }
+
+        if (symbol < 256) { // literal
+            if (_destOffset == _destLength) {
+                return false;
+            }
+            _dest[_destOffset++] = (u1) symbol;
+        } else if (symbol > 256) { // par tamanho/distância
+            symbol -= 257;
+            if (symbol >= 29) {
+                return false;
+            }
+            u4 length = lengthBase[symbol] + bits(lengthExtra[symbol]);
+
+            symbol = decode(distcode);
+            if (symbol < 0 || symbol >= 30) {
+                return false;
+            }
+            u4 distance = distanceBase[symbol] + bits(distanceExtra[symbol]);
+
+            if (_error || distance > _destOffset || _destLength - _destOffset < length) {
+                return false;
+            }
+
+            // a cópia pode sobrepor a própria saída, portanto é feita byte a byte
+            while (length--) {
+                _dest[_destOffset] = _dest[_destOffset - distance];
+                _destOffset++;
+            }
+        }
+    } while (symbol != 256); // fim do bloco
+
+    return true;
+}
+
+bool Inflater::buildFixedCodes(Huffman *lencode, Huffman *distcode) {
+    short lengths[INFLATER_FIXLCODES];
+    int symbol;
+
+    for (symbol = 0; symbol < 144; symbol++) lengths[symbol] = 8;
+    for (; symbol < 256; symbol++) lengths[symbol] = 9;
+    for (; symbol < 280; symbol++) lengths[symbol] = 7;
+    for (; symbol < INFLATER_FIXLCODES; symbol++) lengths[symbol] = 8;
+    construct(lencode, lengths, INFLATER_FIXLCODES);
+
+    for (symbol = 0; symbol < INFLATER_MAXDCODES; symbol++) lengths[symbol] = 5;
+    construct(distcode, lengths, INFLATER_MAXDCODES);
+
+    return true;
+}
+
+bool Inflater::fixed() {
+    static Huffman lencode, distcode;
+    static bool initialized = buildFixedCodes(&lencode, &distcode); // inicialização única, segura entre threads
+    (void) initialized;
+
+    return codes(&lencode, &distcode);
+}
+
+bool Inflater::dynamic() {
+    static const short order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    short lengths[INFLATER_MAXLCODES + INFLATER_MAXDCODES];
+    Huffman lencode, distcode;
+
+    int nlen = bits(5) + 257;
+    int ndist = bits(5) + 1;
+    int ncode = bits(4) + 4;
+    if (_error || nlen > INFLATER_MAXLCODES || ndist > INFLATER_MAXDCODES) {
+        return false;
+    }
+
+    // tamanhos dos códigos que descrevem os tamanhos dos códigos
+    int index;
+    for (index = 0; index < ncode; index++) {
+        lengths[order[index]] = bits(3);
+    }
+    for (; index < 19; index++) {
+        lengths[order[index]] = 0;
+    }
+    if (_error || construct(&lencode, lengths, 19) != 0) {
+        return false;
+    }
+
+    // tamanhos dos códigos de literal/tamanho e de distância
+    index = 0;
+    while (index < nlen + ndist) {
+        int symbol = decode(&lencode);
+        if (symbol < 0) {
+            return false;
+        }
+
+        if (symbol < 16) {
+            lengths[index++] = symbol;
+        } else {
+            short length = 0;
+            if (symbol == 16) { // repete o último tamanho
+                if (index == 0) {
+                    return false;
+                }
+                length = lengths[index - 1];
+                symbol = 3 + bits(2);
+            } else if (symbol == 17) { // repete zero
+                symbol = 3 + bits(3);
+            } else {
+                symbol = 11 + bits(7);
+            }
+
+            if (_error || index + symbol > nlen + ndist) {
+                return false;
+            }
+            while (symbol--) {
+                lengths[index++] = length;
+            }
+        }
+    }
+
+    if (lengths[256] == 0) { // o bloco precisa ter um código de fim
+        return false;
+    }
+
+    // códigos incompletos só são permitidos quando possuem um único símbolo
+    int err = construct(&lencode, lengths, nlen);
+    if (err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) {
+        return false;
+    }
+
+    err = construct(&distcode, lengths + nlen, ndist);
+    if (err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) {
+        return false;
+    }
+
+    return codes(&lencode, &distcode);
+}
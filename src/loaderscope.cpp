@@ -0,0 +1,25 @@
+#include "loaderscope.h"
+
+LoaderScope::LoaderScope(const string &name, bool permanent) : _name(name), _permanent(permanent) {
+
+}
+
+LoaderScope::~LoaderScope() {
+
+}
+
+const string& LoaderScope::getName() {
+    return _name;
+}
+
+bool LoaderScope::isPermanent() {
+    return _permanent;
+}
+
+void LoaderScope::addClass(ClassRuntime *classRuntime) {
+    _classes.push_back(classRuntime);
+}
+
+const vector<ClassRuntime*>& LoaderScope::getClasses() {
+    return _classes;
+}
@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "classloader.h"
 #include "classviewer.h"
@@ -13,19 +14,232 @@
 #include "heap.h"
 #include "classruntime.h"
 #include "executionengine.h"
+#include "classpath.h"
+#include "sharedarchive.h"
+#include "classpreloader.h"
+#include "scheduler.h"
+#include "garbagecollector.h"
+#include "allocationprofiler.h"
 
 using namespace std;
 
+/**
+ * @brief Interpreta um tamanho de memória (e.g. das opções -Xms e -Xmx), em bytes ou com o sufixo k, m ou g.
+ * @param value O tamanho.
+ * @return O tamanho em bytes, ou 0 caso seja inválido.
+ */
+static size_t parseMemorySize(const string &value) {
+    char *end;
+    unsigned long long size = strtoull(value.c_str(), &end, 10);
+    if (end == value.c_str()) {
+        return 0;
+    }
+
+    switch (*end) {
+        case 'g':
+        case 'G':
+            size *= 1024;
+            // fall through
+        case 'm':
+        case 'M':
+            size *= 1024;
+            // fall through
+        case 'k':
+        case 'K':
+            size *= 1024;
+            end++;
+            break;
+    }
+    return (*end == '\0') ? (size_t) size : 0;
+}
+
+/**
+ * @brief Imprime o relatório do profiler de alocação quando a JVM termina (inclusive por \c exit).
+ */
+static void printAllocationReport() {
+    AllocationProfiler::getInstance().printReport();
+}
+
 int main(int argc, char *argv[]) {
-    if (argc < 2 || argc > 3) {
+    // Leitura das opções (antes do nome da classe).
+    int argIndex = 1;
+    string shareMode("off");
+    string sharedArchiveFile(SHARED_ARCHIVE_DEFAULT_FILE);
+    int preloadThreads = 0;
+    bool keepDebugAttributes = false;
+    size_t initialHeapSize = 0;
+    size_t maxHeapSize = 0;
+    bool allocationProfiling = false;
+    size_t allocationSampleInterval = 0;
+    vector<string> jobs;
+    while (argIndex < argc && argv[argIndex][0] == '-') {
+        string option(argv[argIndex]);
+        if ((option == "-cp" || option == "-classpath") && argIndex + 1 < argc) {
+            ClassPath::getInstance().setClassPath(argv[argIndex + 1]);
+            argIndex += 2;
+        } else if (option == "-Xshare:dump" || option == "-Xshare:on" || option == "-Xshare:off") {
+            shareMode = option.substr(8);
+            argIndex++;
+        } else if (option.compare(0, 22, "-XX:SharedArchiveFile=") == 0) {
+            sharedArchiveFile = option.substr(22);
+            argIndex++;
+        } else if (option.compare(0, 19, "-XX:PreloadThreads=") == 0) {
+            preloadThreads = atoi(option.substr(19).c_str());
+            argIndex++;
+        } else if (option.compare(0, 17, "-XX:GreenThreads=") == 0) {
+            Scheduler::getInstance().start(atoi(option.substr(17).c_str()));
+            argIndex++;
+        } else if (option.compare(0, 22, "-XX:ParallelGCThreads=") == 0) {
+            GarbageCollector::getInstance().setParallelThreads(atoi(option.substr(22).c_str()));
+            argIndex++;
+        } else if (option == "-XX:+UseCompressedOops" || option == "-XX:-UseCompressedOops") {
+            Heap::getInstance().setCompressedReferences(option[4] == '+');
+            argIndex++;
+        } else if (option.compare(0, 25, "-XX:LargeObjectThreshold=") == 0) {
+            int threshold = atoi(option.substr(25).c_str());
+            if (threshold < 0 || threshold > TLAB_SIZE) {
+                cerr << "Limite de objetos grandes invalido (maximo: " << TLAB_SIZE << "): " << option << endl;
+                exit(1);
+            }
+            Heap::getInstance().setLargeObjectThreshold(threshold);
+            argIndex++;
+        } else if (option.compare(0, 4, "-Xms") == 0 || option.compare(0, 4, "-Xmx") == 0) {
+            size_t size = parseMemorySize(option.substr(4));
+            if (size == 0) {
+                cerr << "Tamanho de heap invalido: " << option << endl;
+                exit(1);
+            }
+            (option[3] == 's' ? initialHeapSize : maxHeapSize) = size;
+            argIndex++;
+        } else if (option == "-XX:+ConcurrentMarking") {
+            GarbageCollector::getInstance().setConcurrent();
+            argIndex++;
+        } else if (option.compare(0, 19, "-XX:MaxPauseMillis=") == 0) {
+            GarbageCollector::getInstance().setMaxPauseMillis(atoi(option.substr(19).c_str()));
+            argIndex++;
+        } else if (option == "-XX:+AllocationProfiling") {
+            allocationProfiling = true;
+            argIndex++;
+        } else if (option.compare(0, 29, "-XX:AllocationSampleInterval=") == 0) {
+            allocationSampleInterval = atoi(option.substr(29).c_str());
+            allocationProfiling = true;
+            argIndex++;
+        } else if (option == "-XX:+KeepDebugAttributes") {
+            keepDebugAttributes = true;
+            argIndex++;
+        } else if (option == "-job" && argIndex + 1 < argc) {
+            jobs.push_back(argv[argIndex + 1]);
+            argIndex += 2;
+        } else if (option == "-verbose:class") {
+            MethodArea::getInstance().setVerbose(true);
+            argIndex++;
+        } else if (option == "-verbose:gc") {
+            GarbageCollector::getInstance().setVerbose(true);
+            argIndex++;
+        } else if (option == "-Xverify:none" || option == "-Xverify:all") {
+            ClassLoader::getInstance().setVerify(option == "-Xverify:all");
+            argIndex++;
+        } else {
+            break;
+        }
+    }
+    // Fim da leitura das opções.
+    
+    ClassLoader::getInstance().setKeepDebugAttributes(keepDebugAttributes);
+    
+    if (maxHeapSize != 0 && initialHeapSize > maxHeapSize) {
+        cerr << "O tamanho inicial da heap (-Xms) excede o tamanho maximo (-Xmx)." << endl;
+        exit(1);
+    }
+    if (maxHeapSize != 0) {
+        Heap::getInstance().setMaxSize(maxHeapSize);
+    }
+    if (initialHeapSize != 0) {
+        Heap::getInstance().setInitialSize(initialHeapSize);
+    }
+    
+    if (allocationProfiling) {
+        AllocationProfiler::getInstance().enable(allocationSampleInterval * 1024);
+        atexit(printAllocationReport);
+    }
+    
+    // Geração do arquivo de compartilhamento de classes: as classes restantes na linha de comando são arquivadas.
+    if (shareMode == "dump") {
+        if (argIndex == argc) {
+            printf("Uso:\n");
+            printf("\t./JVM -Xshare:dump [-XX:SharedArchiveFile=arquivo.jsa] classe1 [classe2 ...]\n");
+            exit(1);
+        }
+        vector<string> classNames(argv + argIndex, argv + argc);
+        SharedArchive::getInstance().dump(classNames, sharedArchiveFile);
+        return 0;
+    } else if (shareMode == "on") {
+        SharedArchive::getInstance().load(sharedArchiveFile);
+    }
+    
+    // O intervalo de endereços da heap é reservado antes da criação de qualquer objeto.
+    Heap::getInstance().reserve();
+    
+    bool validArguments = jobs.empty() ? (argc - argIndex >= 1 && argc - argIndex <= 2) : (argc == argIndex);
+    if (!validArguments) {
         printf("Uso:\n");
-        printf("\t./JVM arquivo_class.class \t ou,\n");
-        printf("\t./JVM arquivo_class.class arquivo_saida.txt\n");
+        printf("\t./JVM [-cp caminhos] arquivo_class.class \t ou,\n");
+        printf("\t./JVM [-cp caminhos] arquivo_class.class arquivo_saida.txt \t ou,\n");
+        printf("\t./JVM [-cp caminhos] -job classe1 [-job classe2 ...]\n");
+        printf("\nOpções:\n");
+        printf("\t-cp caminhos\t diretórios e arquivos .jar/.zip separados por ':' onde as classes são buscadas\n");
+        printf("\t-Xshare:dump\t grava as classes dadas (e as referenciadas por elas) no arquivo de compartilhamento\n");
+        printf("\t-Xshare:on\t obtém as classes do arquivo de compartilhamento, sem processar os arquivos .class\n");
+        printf("\t-XX:SharedArchiveFile=arquivo\t arquivo de compartilhamento (padrão: %s)\n", SHARED_ARCHIVE_DEFAULT_FILE);
+        printf("\t-XX:PreloadThreads=N\t pré-carrega as classes referenciadas em N threads auxiliares\n");
+        printf("\t-XX:GreenThreads=N\t executa as threads Java como threads verdes sobre N threads trabalhadoras\n");
+        printf("\t-XX:ParallelGCThreads=N\t quantidade de threads usadas pela coleta de lixo (padrão: quantidade de processadores)\n");
+        printf("\t-XX:-UseCompressedOops\t armazena as referências dos arrays com 64 bits, sem reservar um intervalo de endereços para a heap\n");
+        printf("\t-XX:LargeObjectThreshold=N\t aloca os objetos maiores que N bytes no espaço de objetos grandes (padrão: %d, máximo: %d)\n", HEAP_LARGE_OBJECT_THRESHOLD, TLAB_SIZE);
+        printf("\t-Xms<tamanho>\t tamanho inicial da heap, i.e. quantidade mínima de bytes alocados entre duas coletas (e.g. 64m; padrão: 16m)\n");
+        printf("\t-Xmx<tamanho>\t tamanho máximo da heap; ao excedê-lo, as alocações lançam java.lang.OutOfMemoryError (padrão: sem limite)\n");
+        printf("\t-XX:+ConcurrentMarking\t marca os objetos alcançáveis enquanto as threads Java executam, com pausas curtas\n");
+        printf("\t-XX:MaxPauseMillis=N\t duração máxima das pausas da coleta concorrente, em milissegundos (padrão: 10; ativa a coleta concorrente)\n");
+        printf("\t-XX:+AllocationProfiling\t registra as alocações das instruções Java e imprime, ao fim, os locais de alocação e as classes com mais bytes alocados\n");
+        printf("\t-XX:AllocationSampleInterval=N\t registra somente uma alocação a cada N KB alocados por thread (ativa o profiler de alocação)\n");
+        printf("\t-XX:+KeepDebugAttributes\t mantém os atributos de depuração (e.g. LineNumberTable) das classes carregadas\n");
+        printf("\t-job classe\t executa a classe como um job; os jobs são executados em sequência e as classes de cada job são descarregadas quando não são mais alcançáveis\n");
+        printf("\t-verbose:class\t informa o carregamento e o descarregamento das classes\n");
+        printf("\t-verbose:gc\t informa cada coleta de lixo\n");
+        printf("\t-Xverify:none\t não verifica os métodos das classes a partir da versão 50 (padrão: -Xverify:all)\n");
         exit(1);
     }
     
-	const char *file_className = argv[1];
-	const char *file_output = (argc < 3) ? NULL : argv[2];
+    // Execução dos jobs: cada job carrega suas classes em um escopo próprio, que é descarregado após o fim do job
+    // (caso nenhum objeto de suas classes continue alcançável a partir das classes restantes).
+    if (!jobs.empty()) {
+        if (preloadThreads > 0) {
+            ClassPreloader::getInstance().start(preloadThreads);
+        }
+        
+        MethodArea &methodArea = MethodArea::getInstance();
+        ExecutionEngine &executionEngine = ExecutionEngine::getInstance();
+        for (size_t i = 0; i < jobs.size(); i++) {
+            methodArea.beginScope(jobs[i]);
+            ClassRuntime *classRuntime = methodArea.loadClassNamed(jobs[i]);
+            executionEngine.startExecutionEngine(classRuntime);
+            methodArea.endScope();
+            methodArea.unloadUnreachableScopes();
+        }
+        return 0;
+    }
+    
+	const char *file_className = argv[argIndex];
+	const char *file_output = (argc - argIndex < 2) ? NULL : argv[argIndex + 1];
+    
+    // A visualização do .class mostra todos os atributos, inclusive os de depuração.
+    if (file_output) {
+        ClassLoader::getInstance().setKeepDebugAttributes(true);
+    }
+    
+    if (preloadThreads > 0) {
+        ClassPreloader::getInstance().start(preloadThreads);
+    }
     
     // Carregamento da classe de entrada.
     MethodArea &methodArea = MethodArea::getInstance();
@@ -33,7 +247,7 @@ int main(int argc, char *argv[]) {
     // Fim do carregamento.
     
     // Verificação se o nome da classe de entrada é igual ao nome do arquivo.
-    string className = getFormattedConstant(classRuntime->getClassFile()->constant_pool, classRuntime->getClassFile()->this_class);
+    string className = *Utils::getSymbol(classRuntime->getClassFile()->constant_pool, classRuntime->getClassFile()->this_class);
     string fileName(file_className);
     if (fileName.find(".class") != fileName.npos) {
         fileName = fileName.substr(0, fileName.size() - 6);
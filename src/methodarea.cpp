@@ -1,82 +1,411 @@
 
 #include "methodarea.h"
-#include "classviewer.h" // talvez retirar isso e colocar a getFormattedConstant() na Util.
+#include "utils.h"
+#include "symboltable.h"
 
 #include "classloader.h"
+#include "classpath.h"
+#include "sharedarchive.h"
+#include "classpreloader.h"
+#include "heap.h"
+#include "classinstance.h"
+#include "arrayobject.h"
+#include "allocationprofiler.h"
 
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <unordered_set>
+#include <algorithm>
 #include <cstdlib>
+#include <cstdio>
 
 #include "vmstack.h"
 #include "executionengine.h"
+#include "scheduler.h"
+#include "garbagecollector.h"
 
-MethodArea::MethodArea() {
-    
+#define CLASS_TABLE_INITIAL_CAPACITY 64
+
+/**
+ * @brief Calcula o hash de um símbolo a partir do seu endereço (símbolos iguais possuem o mesmo endereço).
+ */
+static inline size_t hashSymbol(Symbol symbol) {
+    uintptr_t value = (uintptr_t) symbol;
+    return (size_t) ((value >> 3) * 0x9E3779B97F4A7C15ULL >> 16);
+}
+
+MethodArea::MethodArea() : _verbose(false) {
+    _table.store(newTable(CLASS_TABLE_INITIAL_CAPACITY));
+    _bootScope = new LoaderScope("boot", true);
+    _currentScope = _bootScope;
 }
 
 MethodArea::~MethodArea() {
+    ClassTable *table = _table.load();
+    delete[] table->slots;
+    delete table;
     
+    for (size_t i = 0; i < _retiredTables.size(); i++) {
+        delete[] _retiredTables[i]->slots;
+        delete _retiredTables[i];
+    }
+    
+    for (size_t i = 0; i < _scopes.size(); i++) {
+        delete _scopes[i];
+    }
+    delete _bootScope;
 }
 
-ClassRuntime* MethodArea::loadClassNamed(const string &className) {
-    // se a classe já tiver sido carregada, retorna-la
-    if (_classes.count(className) > 0) {
-        return getClassNamed(className);
+MethodArea::ClassTable* MethodArea::newTable(size_t capacity) {
+    ClassTable *table = new ClassTable;
+    table->capacity = capacity;
+    table->count = 0;
+    table->slots = new ClassTableSlot[capacity];
+    for (size_t i = 0; i < capacity; i++) {
+        table->slots[i].name.store(NULL, memory_order_relaxed);
+        table->slots[i].classRuntime.store(NULL, memory_order_relaxed);
+    }
+    return table;
+}
+
+ClassRuntime* MethodArea::lookup(Symbol className) {
+    ClassTable *table = _table.load(memory_order_acquire);
+    size_t mask = table->capacity - 1;
+    
+    for (size_t i = hashSymbol(className) & mask; ; i = (i + 1) & mask) {
+        Symbol name = table->slots[i].name.load(memory_order_acquire);
+        if (name == className) {
+            return table->slots[i].classRuntime.load(memory_order_acquire);
+        }
+        if (name == NULL) {
+            return NULL;
+        }
+    }
+}
+
+void MethodArea::insert(Symbol className, ClassRuntime *classRuntime) {
+    ClassTable *table = _table.load(memory_order_relaxed);
+    
+    // mantém a ocupação em no máximo 3/4, para que as sondagens sejam curtas
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        ClassTable *newClassTable = newTable(table->capacity * 2);
+        size_t mask = newClassTable->capacity - 1;
+        
+        for (size_t i = 0; i < table->capacity; i++) {
+            Symbol name = table->slots[i].name.load(memory_order_relaxed);
+            if (name == NULL) {
+                continue;
+            }
+            
+            size_t j = hashSymbol(name) & mask;
+            while (newClassTable->slots[j].name.load(memory_order_relaxed) != NULL) {
+                j = (j + 1) & mask;
+            }
+            newClassTable->slots[j].classRuntime.store(table->slots[i].classRuntime.load(memory_order_relaxed), memory_order_relaxed);
+            newClassTable->slots[j].name.store(name, memory_order_relaxed);
+        }
+        newClassTable->count = table->count;
+        
+        _table.store(newClassTable, memory_order_release);
+        _retiredTables.push_back(table);
+        table = newClassTable;
     }
     
-    string classNameStr(className);
-    string classLocation("");
+    size_t mask = table->capacity - 1;
+    for (size_t i = hashSymbol(className) & mask; ; i = (i + 1) & mask) {
+        Symbol name = table->slots[i].name.load(memory_order_relaxed);
+        if (name == className) {
+            table->slots[i].classRuntime.store(classRuntime, memory_order_release);
+            return;
+        }
+        if (name == NULL) {
+            table->slots[i].classRuntime.store(classRuntime, memory_order_release);
+            table->slots[i].name.store(className, memory_order_release);
+            table->count++;
+            return;
+        }
+    }
+}
+
+ClassRuntime* MethodArea::loadClassNamed(const string &className) {
     string classFormat(".class");
     
-    if (classNameStr.size() < classFormat.size() || classNameStr.compare(classNameStr.size() - classFormat.size(), classFormat.size(), classFormat) != 0) {
-        classNameStr = classLocation + classNameStr + classFormat; // concatena com ".class"
+    if (className.size() >= classFormat.size() && className.compare(className.size() - classFormat.size(), classFormat.size(), classFormat) == 0) {
+        return loadClassNamed(SymbolTable::getInstance().intern(className.substr(0, className.size() - classFormat.size())));
     }
+    
+    return loadClassNamed(SymbolTable::getInstance().intern(className));
+}
 
-    FILE *fp = fopen(classNameStr.c_str(), "rb");
-    if (fp == NULL) {
-        cerr << "NoClassDefFoundError: " << classNameStr << endl;
-        exit(1);
+ClassRuntime* MethodArea::loadClassNamed(Symbol className) {
+    // se a classe já tiver sido carregada, retorna-la
+    ClassRuntime *loadedClass = lookup(className);
+    if (loadedClass != NULL) {
+        if (!loadedClass->isInitialized()) {
+            waitForInitialization(loadedClass);
+        }
+        return loadedClass;
+    }
+    
+    // a classe é carregada por uma única thread; as demais encontram a classe na tabela após obter o lock
+    unique_lock<mutex> loadLock(_loadMutex);
+    loadedClass = lookup(className);
+    if (loadedClass != NULL) {
+        loadLock.unlock();
+        return loadClassNamed(className);
+    }
+    
+    string classNameStr = *className + ".class";
+    
+    // classes presentes no arquivo de compartilhamento (-Xshare:on) já estão processadas
+    ClassFile *classFile = SharedArchive::getInstance().getSharedClass(*className);
+    
+    // classes pré-carregadas (-XX:PreloadThreads) já foram processadas por uma thread auxiliar
+    ClassPreloader &classPreloader = ClassPreloader::getInstance();
+    if (classFile == NULL) {
+        classFile = classPreloader.takeClass(*className);
+    }
+    
+    if (classFile == NULL) {
+        const u1 *bytes;
+        u4 length;
+        AdoptedMemory memory;
+        if (!ClassPath::getInstance().findClass(classNameStr, &bytes, &length, &memory)) {
+            cerr << "NoClassDefFoundError: " << classNameStr << endl;
+            exit(1);
+        }
+        
+        // o arquivo .class é liberado junto com a arena, quando a classe é descarregada
+        ClassLoader &classLoader = ClassLoader::getInstance();
+        classFile = classLoader.readClassFile(bytes, length);
+        classFile->arena->adopt(memory);
     }
     
-    ClassLoader &classLoader = ClassLoader::getInstance();
-    ClassFile *classFile = classLoader.readClassFile(fp);
-    ClassRuntime *classRuntime = new ClassRuntime(classFile);
+    // as classes do pacote java/ são compartilhadas por todos os jobs
+    LoaderScope *scope = (className->compare(0, 5, "java/") == 0) ? _bootScope : _currentScope;
+    ClassRuntime *classRuntime = new ClassRuntime(classFile, scope);
+    classRuntime->setInitializingThread(VMStack::getInstance().getThreadId());
     addClass(classRuntime);
-    fclose(fp);
+    if (_verbose) {
+        printf("[Loaded %s (%s)]\n", className->c_str(), scope->getName().c_str());
+    }
+    classPreloader.scheduleReferences(classFile);
     
     // adicionando <clinit> da classe (se existir) na stack frame.
     ExecutionEngine &executionEngine = ExecutionEngine::getInstance();
-    bool existsClinit = executionEngine.doesMethodExist(classRuntime, "<clinit>", "()V");
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol clinitName = symbolTable.intern("<clinit>");
+    static Symbol clinitDescriptor = symbolTable.intern("()V");
+    bool existsClinit = executionEngine.doesMethodExist(classRuntime, clinitName, clinitDescriptor);
     if (existsClinit) {
         VMStack &stackFrame = VMStack::getInstance();
-        Frame *newFrame = new Frame(classRuntime, "<clinit>", "()V");
+        Frame *newFrame = new Frame(classRuntime, clinitName, clinitDescriptor);
         stackFrame.addFrame(newFrame);
+    } else {
+        finishInitialization(classRuntime);
     }
     
     return classRuntime;
 }
 
-ClassRuntime* MethodArea::getClassNamed(const string &className) {
-    map<string, ClassRuntime*>::iterator it = _classes.find(className);
+void MethodArea::waitForInitialization(ClassRuntime *classRuntime) {
+    unique_lock<mutex> lock(_mutex);
     
-    if (it == _classes.end()) {
-        return NULL;
+    // a própria thread que executa o <clinit> pode usar a classe (e.g. acessos a fields estáticos dentro do <clinit>)
+    uintptr_t self = VMStack::getInstance().getThreadId();
+    if (classRuntime->isInitialized() || classRuntime->getInitializingThread() == self) {
+        return;
     }
     
-    return it->second;
+    // uma thread verde não pode ser suspensa aqui, portanto outra thread trabalhadora assume a sua fila durante a espera
+    bool green = Scheduler::currentGreenThread() != NULL;
+    if (green) {
+        Scheduler::getInstance().enterBlocking();
+    }
+    // a espera ocorre no meio de uma instrução, portanto a coleta de lixo é adiada até o seu fim
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.enterUnsafeWait();
+    _awaitedClasses.push_back(classRuntime);
+    while (!classRuntime->isInitialized()) {
+        _classInitialized.wait(lock);
+    }
+    _awaitedClasses.erase(find(_awaitedClasses.begin(), _awaitedClasses.end(), classRuntime));
+    garbageCollector.leaveUnsafeWait();
+    if (green) {
+        Scheduler::getInstance().leaveBlocking();
+    }
+}
+
+void MethodArea::finishInitialization(ClassRuntime *classRuntime) {
+    {
+        lock_guard<mutex> lock(_mutex);
+        classRuntime->setInitialized(true);
+    }
+    _classInitialized.notify_all();
+}
+
+bool MethodArea::hasInitializationWaiters(uintptr_t threadId) {
+    lock_guard<mutex> lock(_mutex);
+    for (size_t i = 0; i < _awaitedClasses.size(); i++) {
+        if (_awaitedClasses[i]->getInitializingThread() == threadId) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ClassRuntime* MethodArea::getClassNamed(Symbol className) {
+    return lookup(className);
 }
 
 bool MethodArea::addClass(ClassRuntime *classRuntime) {
     ClassFile *classFile = classRuntime->getClassFile();
     
-    const char *key = getFormattedConstant(classFile->constant_pool, classFile->this_class);
+    Symbol key = Utils::getSymbol(classFile->constant_pool, classFile->this_class);
     
-    if (_classes.count(key) > 0) {
+    lock_guard<mutex> lock(_mutex);
+    ClassRuntime *existing = lookup(key);
+    if (existing != NULL) {
         return false;
     }
     
-    _classes[key] = classRuntime;
+    insert(key, classRuntime);
+    classRuntime->getScope()->addClass(classRuntime);
     return true;
 }
+
+LoaderScope* MethodArea::beginScope(const string &name) {
+    lock_guard<mutex> lock(_mutex);
+    LoaderScope *scope = new LoaderScope(name, false);
+    _scopes.push_back(scope);
+    _currentScope = scope;
+    return scope;
+}
+
+void MethodArea::endScope() {
+    lock_guard<mutex> lock(_mutex);
+    _currentScope = _bootScope;
+}
+
+void MethodArea::setVerbose(bool verbose) {
+    _verbose = verbose;
+}
+
+void MethodArea::getLoadedClasses(vector<ClassRuntime*> &classes) {
+    lock_guard<mutex> lock(_mutex);
+    
+    const vector<ClassRuntime*> &bootClasses = _bootScope->getClasses();
+    classes.insert(classes.end(), bootClasses.begin(), bootClasses.end());
+    for (size_t i = 0; i < _scopes.size(); i++) {
+        const vector<ClassRuntime*> &scopeClasses = _scopes[i]->getClasses();
+        classes.insert(classes.end(), scopeClasses.begin(), scopeClasses.end());
+    }
+}
+
+size_t MethodArea::unloadUnreachableScopes() {
+    if (VMStack::getInstance().size() > 0) {
+        return 0; // as referências da pilha não são percorridas
+    }
+    
+    // a heap não pode ser alterada pela coleta concorrente enquanto é percorrida
+    GarbageCollector::getInstance().waitForCollection();
+    
+    lock_guard<mutex> lock(_mutex);
+    
+    unordered_set<LoaderScope*> reachableScopes;
+    vector<LoaderScope*> pendingScopes;
+    reachableScopes.insert(_bootScope);
+    pendingScopes.push_back(_bootScope);
+    if (reachableScopes.insert(_currentScope).second) {
+        pendingScopes.push_back(_currentScope);
+    }
+    
+    unordered_set<Object*> visitedObjects;
+    vector<Object*> pendingObjects;
+    while (!pendingScopes.empty() || !pendingObjects.empty()) {
+        // os fields estáticos das classes de um escopo alcançável são raízes
+        while (!pendingScopes.empty()) {
+            LoaderScope *scope = pendingScopes.back();
+            pendingScopes.pop_back();
+            
+            const vector<ClassRuntime*> &classes = scope->getClasses();
+            for (size_t i = 0; i < classes.size(); i++) {
+                const map<Symbol, Value> &staticFields = classes[i]->getStaticFields();
+                for (map<Symbol, Value>::const_iterator it = staticFields.begin(); it != staticFields.end(); it++) {
+                    if (it->second.type == ValueType::REFERENCE && it->second.data.object != NULL) {
+                        pendingObjects.push_back(it->second.data.object);
+                    }
+                }
+            }
+        }
+        
+        while (!pendingObjects.empty()) {
+            Object *object = pendingObjects.back();
+            pendingObjects.pop_back();
+            if (!visitedObjects.insert(object).second) {
+                continue;
+            }
+            
+            if (object->objectType() == CLASS_INSTANCE) {
+                ClassInstance *instance = (ClassInstance *) object;
+                LoaderScope *scope = instance->getClassRuntime()->getScope();
+                if (reachableScopes.insert(scope).second) {
+                    pendingScopes.push_back(scope);
+                }
+                
+                const vector<u4> &referenceOffsets = instance->getClassRuntime()->getReferenceOffsets();
+                for (size_t i = 0; i < referenceOffsets.size(); i++) {
+                    Object *reference = instance->getReferenceAt(referenceOffsets[i]);
+                    if (reference != NULL) {
+                        pendingObjects.push_back(reference);
+                    }
+                }
+            } else if (object->objectType() == ARRAY) {
+                ArrayObject *array = (ArrayObject *) object;
+                if (array->arrayContentType() == ValueType::REFERENCE) {
+                    for (uint32_t i = 0; i < array->getSize(); i++) {
+                        Object *element = array->getReference(i);
+                        if (element != NULL) {
+                            pendingObjects.push_back(element);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    size_t unloadedClasses = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < _scopes.size(); i++) {
+        LoaderScope *scope = _scopes[i];
+        if (reachableScopes.count(scope) > 0) {
+            _scopes[kept++] = scope;
+            continue;
+        }
+        
+        Heap::getInstance().removeInstancesOfScope(scope);
+        
+        const vector<ClassRuntime*> &classes = scope->getClasses();
+        for (size_t j = 0; j < classes.size(); j++) {
+            ClassFile *classFile = classes[j]->getClassFile();
+            Symbol className = Utils::getSymbol(classFile->constant_pool, classFile->this_class);
+            if (_verbose) {
+                printf("[Unloading class %s (%s)]\n", className->c_str(), scope->getName().c_str());
+            }
+            
+            // o nome continua na tabela, sem classe associada: a classe pode ser carregada novamente
+            insert(className, NULL);
+            if (AllocationProfiler::isEnabled()) {
+                AllocationProfiler::getInstance().unloadClass(classFile);
+            }
+            delete classes[j];
+        }
+        
+        unloadedClasses += classes.size();
+        delete scope;
+    }
+    _scopes.resize(kept);
+    
+    return unloadedClasses;
+}
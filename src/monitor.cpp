@@ -0,0 +1,294 @@
+#include "monitor.h"
+#include "vmstack.h"
+#include "scheduler.h"
+#include "garbagecollector.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+
+#define LOCK_TAG_MASK 0x3
+#define LOCK_THIN 0x1
+#define LOCK_INFLATED 0x2
+
+#define LOCK_RECURSIONS_SHIFT 2
+#define LOCK_RECURSIONS_MAX 0xFF
+#define LOCK_OWNER_SHIFT 10
+
+// tentativas (girando) antes de a thread ceder o processador enquanto aguarda um lock thin de outra thread
+#define LOCK_SPIN_LIMIT 100
+
+uintptr_t Monitor::currentThreadId() {
+    return VMStack::getInstance().getThreadId();
+}
+
+void Monitor::enter(atomic<uintptr_t> &lockWord) {
+    // caso comum: lock livre, adquirido com um único CAS
+    uintptr_t expected = 0;
+    if (lockWord.compare_exchange_strong(expected, (currentThreadId() << LOCK_OWNER_SHIFT) | LOCK_THIN, memory_order_acquire)) {
+        return;
+    }
+
+    // a coleta de lixo pode ocorrer enquanto a thread aguarda o lock
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.enterSafeRegion();
+    enterSlow(lockWord);
+    garbageCollector.leaveSafeRegion();
+}
+
+void Monitor::enterSlow(atomic<uintptr_t> &lockWord) {
+    uintptr_t self = currentThreadId();
+    uintptr_t thinWord = (self << LOCK_OWNER_SHIFT) | LOCK_THIN;
+    bool contended = false;
+
+    for (unsigned int spins = 0; ; spins++) {
+        uintptr_t word = lockWord.load(memory_order_acquire);
+
+        if (word == 0) {
+            uintptr_t expected = 0;
+            if (lockWord.compare_exchange_weak(expected, thinWord, memory_order_acquire)) {
+                if (contended) {
+                    inflate(lockWord, thinWord);
+                }
+                return;
+            }
+            continue;
+        }
+
+        if ((word & LOCK_TAG_MASK) == LOCK_INFLATED) {
+            FatMonitor *monitor = (FatMonitor *) (word & ~((uintptr_t) LOCK_TAG_MASK));
+            unique_lock<mutex> lock(monitor->monitorMutex);
+            if (monitor->owner == self) {
+                monitor->recursions++;
+                return;
+            }
+            while (monitor->owner != 0) {
+                monitor->entryCondition.wait(lock);
+            }
+            monitor->owner = self;
+            monitor->recursions = 1;
+            return;
+        }
+
+        if ((word >> LOCK_OWNER_SHIFT) == self) {
+            // reentrada: somente a thread dona altera a palavra de um lock thin
+            uintptr_t recursions = (word >> LOCK_RECURSIONS_SHIFT) & LOCK_RECURSIONS_MAX;
+            if (recursions < LOCK_RECURSIONS_MAX) {
+                lockWord.store(word + (1 << LOCK_RECURSIONS_SHIFT), memory_order_relaxed);
+            } else {
+                FatMonitor *monitor = inflate(lockWord, word);
+                lock_guard<mutex> lock(monitor->monitorMutex);
+                monitor->recursions++;
+            }
+            return;
+        }
+
+        // o lock thin pertence a outra thread
+        contended = true;
+        if (spins >= LOCK_SPIN_LIMIT) {
+            this_thread::yield();
+        }
+    }
+}
+
+bool Monitor::tryEnter(atomic<uintptr_t> &lockWord) {
+    uintptr_t self = currentThreadId();
+    uintptr_t word = lockWord.load(memory_order_acquire);
+
+    if (word == 0) {
+        return lockWord.compare_exchange_strong(word, (self << LOCK_OWNER_SHIFT) | LOCK_THIN, memory_order_acquire);
+    }
+
+    if ((word & LOCK_TAG_MASK) == LOCK_INFLATED) {
+        FatMonitor *monitor = (FatMonitor *) (word & ~((uintptr_t) LOCK_TAG_MASK));
+        lock_guard<mutex> lock(monitor->monitorMutex);
+        if (monitor->owner == self) {
+            monitor->recursions++;
+            return true;
+        }
+        if (monitor->owner == 0) {
+            monitor->owner = self;
+            monitor->recursions = 1;
+            return true;
+        }
+        return false;
+    }
+
+    if ((word >> LOCK_OWNER_SHIFT) == self) {
+        uintptr_t recursions = (word >> LOCK_RECURSIONS_SHIFT) & LOCK_RECURSIONS_MAX;
+        if (recursions < LOCK_RECURSIONS_MAX) {
+            lockWord.store(word + (1 << LOCK_RECURSIONS_SHIFT), memory_order_relaxed);
+        } else {
+            FatMonitor *monitor = inflate(lockWord, word);
+            lock_guard<mutex> lock(monitor->monitorMutex);
+            monitor->recursions++;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void Monitor::exit(atomic<uintptr_t> &lockWord) {
+    uintptr_t self = currentThreadId();
+    uintptr_t word = lockWord.load(memory_order_acquire);
+
+    if ((word & LOCK_TAG_MASK) == LOCK_THIN && (word >> LOCK_OWNER_SHIFT) == self) {
+        if (((word >> LOCK_RECURSIONS_SHIFT) & LOCK_RECURSIONS_MAX) > 0) {
+            lockWord.store(word - (1 << LOCK_RECURSIONS_SHIFT), memory_order_relaxed);
+        } else {
+            lockWord.store(0, memory_order_release);
+            unparkEntrants(lockWord);
+        }
+        return;
+    }
+
+    if ((word & LOCK_TAG_MASK) == LOCK_INFLATED) {
+        FatMonitor *monitor = (FatMonitor *) (word & ~((uintptr_t) LOCK_TAG_MASK));
+        {
+            lock_guard<mutex> lock(monitor->monitorMutex);
+            if (monitor->owner != self) {
+                illegalMonitorState();
+            }
+            if (--monitor->recursions > 0) {
+                return;
+            }
+            monitor->owner = 0;
+        }
+        monitor->entryCondition.notify_one();
+        unparkEntrants(lockWord);
+        return;
+    }
+
+    illegalMonitorState();
+}
+
+void Monitor::wait(atomic<uintptr_t> &lockWord, int64_t millis) {
+    FatMonitor *monitor = ownedFatMonitor(lockWord);
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.enterSafeRegion();
+    unique_lock<mutex> lock(monitor->monitorMutex);
+
+    // o lock é liberado por completo (inclusive as reentradas) durante a espera
+    uintptr_t self = monitor->owner;
+    uintptr_t recursions = monitor->recursions;
+    monitor->owner = 0;
+    monitor->recursions = 0;
+    monitor->entryCondition.notify_one();
+
+    if (millis > 0) {
+        monitor->waitCondition.wait_for(lock, chrono::milliseconds(millis));
+    } else {
+        monitor->waitCondition.wait(lock);
+    }
+
+    while (monitor->owner != 0) {
+        monitor->entryCondition.wait(lock);
+    }
+    monitor->owner = self;
+    monitor->recursions = recursions;
+    lock.unlock();
+    garbageCollector.leaveSafeRegion();
+}
+
+bool Monitor::waitOrPark(atomic<uintptr_t> &lockWord, int64_t millis) {
+    GreenThread *greenThread = Scheduler::currentGreenThread();
+    Scheduler &scheduler = Scheduler::getInstance();
+
+    if (!greenThread->waiting) {
+        FatMonitor *monitor = ownedFatMonitor(lockWord);
+        {
+            // a thread é estacionada antes de liberar o mutex do monitor, portanto nenhum notify é perdido
+            lock_guard<mutex> lock(monitor->monitorMutex);
+            greenThread->waiting = true;
+            greenThread->savedRecursions = monitor->recursions;
+            monitor->owner = 0;
+            monitor->recursions = 0;
+
+            if (millis > 0) {
+                scheduler.parkUntil(monitor, chrono::steady_clock::now() + chrono::milliseconds(millis));
+            } else {
+                scheduler.park(monitor);
+            }
+        }
+        monitor->entryCondition.notify_one();
+        unparkEntrants(lockWord);
+        return false;
+    }
+
+    // a espera terminou: o lock é readquirido
+    FatMonitor *monitor = (FatMonitor *) (lockWord.load(memory_order_acquire) & ~((uintptr_t) LOCK_TAG_MASK));
+    lock_guard<mutex> lock(monitor->monitorMutex);
+    if (monitor->owner != 0) {
+        scheduler.park(&lockWord);
+        return false;
+    }
+    monitor->owner = currentThreadId();
+    monitor->recursions = greenThread->savedRecursions;
+    greenThread->waiting = false;
+    return true;
+}
+
+void Monitor::notify(atomic<uintptr_t> &lockWord, bool all) {
+    FatMonitor *monitor = ownedFatMonitor(lockWord);
+    lock_guard<mutex> lock(monitor->monitorMutex);
+
+    // as threads verdes aguardam estacionadas no endereço do monitor completo
+    if (all) {
+        monitor->waitCondition.notify_all();
+        if (Scheduler::hasParkedThreads()) {
+            Scheduler::getInstance().unparkAll(monitor);
+        }
+    } else if (!Scheduler::hasParkedThreads() || !Scheduler::getInstance().unparkOne(monitor)) {
+        monitor->waitCondition.notify_one();
+    }
+}
+
+void Monitor::release(atomic<uintptr_t> &lockWord) {
+    uintptr_t word = lockWord.load(memory_order_acquire);
+    if ((word & LOCK_TAG_MASK) == LOCK_INFLATED) {
+        delete (FatMonitor *) (word & ~((uintptr_t) LOCK_TAG_MASK));
+    }
+    lockWord.store(0, memory_order_relaxed);
+}
+
+Monitor::FatMonitor* Monitor::inflate(atomic<uintptr_t> &lockWord, uintptr_t word) {
+    FatMonitor *monitor = new FatMonitor;
+    monitor->owner = word >> LOCK_OWNER_SHIFT;
+    monitor->recursions = ((word >> LOCK_RECURSIONS_SHIFT) & LOCK_RECURSIONS_MAX) + 1;
+
+    lockWord.store((uintptr_t) monitor | LOCK_INFLATED, memory_order_release);
+    return monitor;
+}
+
+Monitor::FatMonitor* Monitor::ownedFatMonitor(atomic<uintptr_t> &lockWord) {
+    uintptr_t self = currentThreadId();
+    uintptr_t word = lockWord.load(memory_order_acquire);
+
+    if ((word & LOCK_TAG_MASK) == LOCK_THIN && (word >> LOCK_OWNER_SHIFT) == self) {
+        return inflate(lockWord, word);
+    }
+
+    if ((word & LOCK_TAG_MASK) == LOCK_INFLATED) {
+        FatMonitor *monitor = (FatMonitor *) (word & ~((uintptr_t) LOCK_TAG_MASK));
+        lock_guard<mutex> lock(monitor->monitorMutex);
+        if (monitor->owner == self) {
+            return monitor;
+        }
+    }
+
+    illegalMonitorState();
+    return NULL;
+}
+
+void Monitor::unparkEntrants(atomic<uintptr_t> &lockWord) {
+    if (Scheduler::hasParkedThreads()) {
+        Scheduler::getInstance().unparkAll(&lockWord);
+    }
+}
+
+void Monitor::illegalMonitorState() {
+    cerr << "IllegalMonitorStateException" << endl;
+    ::exit(1);
+}
@@ -0,0 +1,37 @@
+#include "object.h"
+#include "monitor.h"
+#include "heap.h"
+#include "classinstance.h"
+#include "arrayobject.h"
+#include "stringobject.h"
+
+Object::Object(ObjectType type, uintptr_t payload) : _classWord((((uintptr_t) type) << OBJECT_KIND_SHIFT) | payload | Heap::getAllocationFlags()), _lockWord(0) {
+
+}
+
+Object::~Object() {
+    Monitor::release(_lockWord);
+}
+
+atomic<uintptr_t>& Object::getLockWord() {
+    return _lockWord;
+}
+
+size_t Object::getHeapSize() {
+    switch (objectType()) {
+        case CLASS_INSTANCE:
+            return Heap::allocationSize(((ClassInstance *) this)->getClassRuntime()->getInstanceSize());
+        case ARRAY:
+            return Heap::allocationSize(ArrayObject::instanceSize(((ArrayObject *) this)->arrayContentType(), ((ArrayObject *) this)->getSize()));
+        default:
+            return Heap::allocationSize(sizeof(StringObject));
+    }
+}
+
+void* Object::operator new(size_t size) {
+    return Heap::getInstance().allocate(size);
+}
+
+void Object::operator delete(void *memory, size_t size) {
+    Heap::markFree((u1 *) memory, (u1 *) memory + Heap::allocationSize(size));
+}
@@ -0,0 +1,359 @@
+#include "scheduler.h"
+#include "vmstack.h"
+#include "frame.h"
+#include "executionengine.h"
+#include "threadmanager.h"
+#include "methodarea.h"
+#include "symboltable.h"
+#include "garbagecollector.h"
+
+atomic<int> Scheduler::_parkedCount(0);
+thread_local GreenThread *Scheduler::_currentGreenThread = NULL;
+thread_local int Scheduler::_currentQueue = -1;
+
+Scheduler::Scheduler() : _queuedCount(0), _nextQueue(0), _blockedWorkers(0), _runningExtraWorkers(0), _stopping(false) {
+    // os singletons usados pelas threads trabalhadoras são criados antes, para que sejam destruídos depois deste
+    ExecutionEngine::getInstance();
+    ThreadManager::getInstance();
+    MethodArea::getInstance();
+    SymbolTable::getInstance();
+    GarbageCollector::getInstance();
+}
+
+Scheduler::~Scheduler() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+
+    for (size_t i = 0; i < _workers.size(); i++) {
+        if (_workers[i].get_id() == this_thread::get_id()) {
+            _workers[i].detach(); // o programa foi encerrado por uma thread verde (e.g. por uma exceção)
+        } else {
+            _workers[i].join();
+        }
+    }
+
+    lock_guard<mutex> lock(_mutex);
+    for (size_t i = 0; i < _queues.size(); i++) {
+        delete _queues[i];
+    }
+}
+
+void Scheduler::start(unsigned int workersCount) {
+    for (unsigned int i = 0; i < workersCount; i++) {
+        _queues.push_back(new WorkerQueue);
+    }
+    for (unsigned int i = 0; i < workersCount; i++) {
+        _workers.push_back(thread(&Scheduler::workerLoop, this, i, false));
+    }
+}
+
+bool Scheduler::isEnabled() {
+    return !_workers.empty();
+}
+
+void Scheduler::spawn(ClassInstance *threadObject) {
+    GreenThread *greenThread = new GreenThread;
+    greenThread->threadObject = threadObject;
+    greenThread->stack = new VMStack();
+    greenThread->stack->setThreadObject(threadObject);
+    greenThread->state = GREEN_RUNNABLE;
+    greenThread->yieldRequested = false;
+    greenThread->parkKey = NULL;
+    greenThread->hasDeadline = false;
+    greenThread->sleeping = false;
+    greenThread->waiting = false;
+    greenThread->savedRecursions = 0;
+
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    vector<Value> arguments;
+    Value thisValue;
+    thisValue.type = ValueType::REFERENCE;
+    thisValue.data.object = threadObject;
+    arguments.push_back(thisValue);
+
+    // o frame do run() é criado já na pilha (e na identidade) da nova thread
+    GreenThread *previous = _currentGreenThread;
+    _currentGreenThread = greenThread;
+    VMStack::setCurrent(greenThread->stack);
+    greenThread->stack->addFrame(new Frame(threadObject, threadObject->getClassRuntime(), symbolTable.intern("run"), symbolTable.intern("()V"), arguments));
+    _currentGreenThread = previous;
+    VMStack::setCurrent(previous != NULL ? previous->stack : NULL);
+
+    enqueue(greenThread, chooseQueue());
+}
+
+void Scheduler::workerLoop(unsigned int index, bool extra) {
+    _currentQueue = index;
+
+    while (!_stopping) {
+        if (extra) {
+            lock_guard<mutex> lock(_mutex);
+            if (_runningExtraWorkers > _blockedWorkers) {
+                _runningExtraWorkers--;
+                return;
+            }
+        }
+
+        GreenThread *greenThread = takeWork(index);
+        if (greenThread != NULL) {
+            run(greenThread, index);
+            continue;
+        }
+
+        unique_lock<mutex> lock(_mutex);
+        wakeExpiredLocked();
+        if (_stopping || _queuedCount > 0 || (extra && _runningExtraWorkers > _blockedWorkers)) {
+            continue;
+        }
+        if (_parkedByDeadline.empty()) {
+            _workAvailable.wait(lock);
+        } else {
+            _workAvailable.wait_until(lock, _parkedByDeadline.begin()->first);
+        }
+    }
+
+    if (extra) {
+        lock_guard<mutex> lock(_mutex);
+        _runningExtraWorkers--;
+    }
+}
+
+void Scheduler::run(GreenThread *greenThread, unsigned int index) {
+    greenThread->state = GREEN_RUNNING;
+    _currentGreenThread = greenThread;
+    VMStack::setCurrent(greenThread->stack);
+
+    // a coleta de lixo pode ocorrer enquanto a thread trabalhadora não executa uma thread verde
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.leaveSafeRegion();
+    bool finished = ExecutionEngine::getInstance().executeSlice(GREEN_TIME_SLICE);
+    garbageCollector.enterSafeRegion();
+
+    VMStack::setCurrent(NULL);
+    _currentGreenThread = NULL;
+
+    if (finished) {
+        ThreadManager::getInstance().threadFinished(greenThread->threadObject);
+        delete greenThread->stack;
+        delete greenThread;
+        return;
+    }
+
+    bool parked;
+    {
+        lock_guard<mutex> lock(_mutex);
+        wakeExpiredLocked();
+        parked = greenThread->state == GREEN_PARKING;
+        greenThread->state = parked ? GREEN_PARKED : GREEN_RUNNABLE;
+    }
+    if (!parked) {
+        enqueue(greenThread, index);
+    }
+}
+
+GreenThread* Scheduler::takeWork(unsigned int index) {
+    {
+        WorkerQueue *queue = _queues[index];
+        lock_guard<mutex> lock(queue->queueMutex);
+        if (!queue->threads.empty()) {
+            GreenThread *greenThread = queue->threads.front();
+            queue->threads.pop_front();
+            _queuedCount--;
+            return greenThread;
+        }
+    }
+
+    for (size_t i = 1; i < _queues.size(); i++) {
+        WorkerQueue *victim = _queues[(index + i) % _queues.size()];
+        lock_guard<mutex> lock(victim->queueMutex);
+        if (!victim->threads.empty()) {
+            GreenThread *greenThread = victim->threads.back();
+            victim->threads.pop_back();
+            _queuedCount--;
+            return greenThread;
+        }
+    }
+
+    return NULL;
+}
+
+void Scheduler::enqueue(GreenThread *greenThread, unsigned int index) {
+    {
+        WorkerQueue *queue = _queues[index];
+        lock_guard<mutex> lock(queue->queueMutex);
+        queue->threads.push_back(greenThread);
+    }
+    _queuedCount++;
+
+    // adquirir _mutex garante que uma thread trabalhadora prestes a aguardar veja a thread adicionada
+    {
+        lock_guard<mutex> lock(_mutex);
+    }
+    _workAvailable.notify_one();
+}
+
+void Scheduler::enqueueLocked(GreenThread *greenThread, unsigned int index) {
+    {
+        WorkerQueue *queue = _queues[index];
+        lock_guard<mutex> lock(queue->queueMutex);
+        queue->threads.push_back(greenThread);
+    }
+    _queuedCount++;
+    _workAvailable.notify_one();
+}
+
+unsigned int Scheduler::chooseQueue() {
+    if (_currentQueue >= 0) {
+        return _currentQueue;
+    }
+    return _nextQueue.fetch_add(1) % _queues.size();
+}
+
+void Scheduler::park(const void *key) {
+    lock_guard<mutex> lock(_mutex);
+    parkLocked(key, false, chrono::steady_clock::time_point());
+}
+
+void Scheduler::parkUntil(const void *key, chrono::steady_clock::time_point deadline) {
+    lock_guard<mutex> lock(_mutex);
+    parkLocked(key, true, deadline);
+}
+
+void Scheduler::parkLocked(const void *key, bool hasDeadline, chrono::steady_clock::time_point deadline) {
+    GreenThread *greenThread = _currentGreenThread;
+    greenThread->parkKey = key;
+    greenThread->hasDeadline = hasDeadline;
+    greenThread->deadline = deadline;
+
+    if (key != NULL) {
+        _parkedByKey.insert(make_pair(key, greenThread));
+    }
+    if (hasDeadline) {
+        _parkedByDeadline.insert(make_pair(deadline, greenThread));
+    }
+    _parkedCount++;
+    greenThread->state = GREEN_PARKING;
+}
+
+void Scheduler::cancelPark() {
+    lock_guard<mutex> lock(_mutex);
+
+    GreenThread *greenThread = _currentGreenThread;
+    if (greenThread->state == GREEN_PARKING) {
+        removeParkedLocked(greenThread);
+        greenThread->state = GREEN_RUNNING;
+    }
+}
+
+void Scheduler::removeParkedLocked(GreenThread *greenThread) {
+    if (greenThread->parkKey != NULL) {
+        pair<multimap<const void*, GreenThread*>::iterator, multimap<const void*, GreenThread*>::iterator> range = _parkedByKey.equal_range(greenThread->parkKey);
+        for (multimap<const void*, GreenThread*>::iterator it = range.first; it != range.second; it++) {
+            if (it->second == greenThread) {
+                _parkedByKey.erase(it);
+                break;
+            }
+        }
+    }
+
+    if (greenThread->hasDeadline) {
+        pair<multimap<chrono::steady_clock::time_point, GreenThread*>::iterator, multimap<chrono::steady_clock::time_point, GreenThread*>::iterator> range = _parkedByDeadline.equal_range(greenThread->deadline);
+        for (multimap<chrono::steady_clock::time_point, GreenThread*>::iterator it = range.first; it != range.second; it++) {
+            if (it->second == greenThread) {
+                _parkedByDeadline.erase(it);
+                break;
+            }
+        }
+    }
+
+    greenThread->parkKey = NULL;
+    greenThread->hasDeadline = false;
+    _parkedCount--;
+}
+
+void Scheduler::unparkLocked(GreenThread *greenThread) {
+    removeParkedLocked(greenThread);
+
+    if (greenThread->state == GREEN_PARKING) {
+        // a thread ainda não deixou a thread trabalhadora, que a recolocará na fila
+        greenThread->state = GREEN_RUNNING;
+    } else {
+        greenThread->state = GREEN_RUNNABLE;
+        enqueueLocked(greenThread, chooseQueue());
+    }
+}
+
+bool Scheduler::unparkOne(const void *key) {
+    lock_guard<mutex> lock(_mutex);
+
+    multimap<const void*, GreenThread*>::iterator it = _parkedByKey.find(key);
+    if (it == _parkedByKey.end()) {
+        return false;
+    }
+
+    // as threads com o mesmo endereço ficam na ordem em que estacionaram
+    unparkLocked(it->second);
+    return true;
+}
+
+void Scheduler::unparkAll(const void *key) {
+    lock_guard<mutex> lock(_mutex);
+
+    multimap<const void*, GreenThread*>::iterator it;
+    while ((it = _parkedByKey.find(key)) != _parkedByKey.end()) {
+        unparkLocked(it->second);
+    }
+}
+
+void Scheduler::wakeExpiredLocked() {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    while (!_parkedByDeadline.empty() && _parkedByDeadline.begin()->first <= now) {
+        unparkLocked(_parkedByDeadline.begin()->second);
+    }
+}
+
+bool Scheduler::sleep(int64_t millis) {
+    GreenThread *greenThread = _currentGreenThread;
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    if (!greenThread->sleeping) {
+        greenThread->sleeping = true;
+        greenThread->sleepDeadline = now + chrono::milliseconds(millis);
+    }
+
+    if (now >= greenThread->sleepDeadline) {
+        greenThread->sleeping = false;
+        return true;
+    }
+
+    parkUntil(NULL, greenThread->sleepDeadline);
+    return false;
+}
+
+void Scheduler::yield() {
+    _currentGreenThread->yieldRequested = true;
+}
+
+void Scheduler::enterBlocking() {
+    lock_guard<mutex> lock(_mutex);
+
+    _blockedWorkers++;
+    if (_runningExtraWorkers < _blockedWorkers) {
+        // a thread extra usa a fila da thread bloqueada; ela é desvinculada, pois termina sozinha quando o bloqueio
+        // termina (e é contada em _runningExtraWorkers até lá)
+        _runningExtraWorkers++;
+        thread(&Scheduler::workerLoop, this, (unsigned int) _currentQueue, true).detach();
+    }
+}
+
+void Scheduler::leaveBlocking() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _blockedWorkers--;
+    }
+    _workAvailable.notify_all();
+}
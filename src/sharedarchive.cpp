@@ -0,0 +1,425 @@
+#include "sharedarchive.h"
+#include "classloader.h"
+#include "classpath.h"
+#include "symboltable.h"
+#include "utils.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <queue>
+#include <unordered_set>
+#include <new>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+SharedArchive::SharedArchive() {
+
+}
+
+SharedArchive::~SharedArchive() {
+
+}
+
+u4 SharedArchive::allocate(size_t size) {
+    // alinhamento de 8 bytes para que os ponteiros e as estruturas possam ser acessados diretamente no mapeamento
+    size_t offset = (_image.size() + 7) & ~((size_t) 7);
+    _image.resize(offset + size, 0);
+    return (u4) offset;
+}
+
+u4 SharedArchive::copy(const void *source, size_t size) {
+    u4 offset = allocate(size);
+    if (size > 0) {
+        memcpy(&_image[offset], source, size);
+    }
+    return offset;
+}
+
+void SharedArchive::setPointer(u4 at, u4 target) {
+    uintptr_t value = target;
+    memcpy(&_image[at], &value, sizeof(value));
+    if (target != 0) {
+        _relocations.push_back(at);
+    }
+}
+
+void SharedArchive::setSymbol(u4 at, Symbol symbol) {
+    memset(&_image[at], 0, sizeof(Symbol));
+
+    unordered_map<Symbol, u4>::iterator it = _symbolIndexes.find(symbol);
+    u4 index;
+    if (it == _symbolIndexes.end()) {
+        index = _symbols.size();
+        _symbols.push_back(symbol);
+        _symbolIndexes[symbol] = index;
+    } else {
+        index = it->second;
+    }
+
+    _symbolFixups.push_back(at);
+    _symbolFixups.push_back(index);
+}
+
+u4 SharedArchive::writeAttributes(ClassFile *classFile, attribute_info *attributes, u2 count) {
+    if (count == 0) {
+        return 0;
+    }
+
+    u4 offset = copy(attributes, sizeof(attribute_info) * count);
+    for (u2 i = 0; i < count; i++) {
+        attribute_info *attribute = attributes + i;
+        u4 at = offset + sizeof(attribute_info) * i;
+        const string &name = *Utils::getSymbol(classFile->constant_pool, attribute->attribute_name_index);
+
+        if (name == "Code") {
+            Code_attribute *code = &attribute->info.code_info;
+            setPointer(at + offsetof(attribute_info, info.code_info.code), copy(code->code, code->code_length));
+            setPointer(at + offsetof(attribute_info, info.code_info.exception_table), code->exception_table_length > 0 ? copy(code->exception_table, sizeof(ExceptionTable) * code->exception_table_length) : 0);
+            setPointer(at + offsetof(attribute_info, info.code_info.attributes), writeAttributes(classFile, code->attributes, code->attributes_count));
+        } else if (name == "Exceptions") {
+            Exceptions_attribute *exceptions = &attribute->info.exceptions_info;
+            setPointer(at + offsetof(attribute_info, info.exceptions_info.exception_index_table), exceptions->number_of_exceptions > 0 ? copy(exceptions->exception_index_table, sizeof(u2) * exceptions->number_of_exceptions) : 0);
+        } else if (name == "InnerClasses") {
+            InnerClasses_attribute *innerClasses = &attribute->info.innerClasses_info;
+            setPointer(at + offsetof(attribute_info, info.innerClasses_info.classes), innerClasses->number_of_classes > 0 ? copy(innerClasses->classes, sizeof(Class) * innerClasses->number_of_classes) : 0);
+        } else if (name == "LineNumberTable") {
+            LineNumberTable_attribute *lineNumbers = &attribute->info.lineNumberTable_info;
+            setPointer(at + offsetof(attribute_info, info.lineNumberTable_info.line_number_table), lineNumbers->line_number_table_length > 0 ? copy(lineNumbers->line_number_table, sizeof(LineNumberTable) * lineNumbers->line_number_table_length) : 0);
+        } else if (name == "LocalVariableTable") {
+            LocalVariableTable_attribute *localVariables = &attribute->info.localVariableTable_info;
+            setPointer(at + offsetof(attribute_info, info.localVariableTable_info.localVariableTable), localVariables->local_variable_table_length > 0 ? copy(localVariables->localVariableTable, sizeof(LocalVariableTable) * localVariables->local_variable_table_length) : 0);
+        } else if (name == "StackMapTable") {
+            StackMapTable_attribute *stackMapTable = &attribute->info.stackMapTable_info;
+            u4 entriesOffset = stackMapTable->number_of_entries > 0 ? copy(stackMapTable->entries, sizeof(stack_map_frame) * stackMapTable->number_of_entries) : 0;
+            setPointer(at + offsetof(attribute_info, info.stackMapTable_info.entries), entriesOffset);
+            for (u2 j = 0; j < stackMapTable->number_of_entries; j++) {
+                stack_map_frame *frame = stackMapTable->entries + j;
+                u4 frameAt = entriesOffset + sizeof(stack_map_frame) * j;
+                setPointer(frameAt + offsetof(stack_map_frame, locals), frame->locals != NULL ? copy(frame->locals, sizeof(verification_type_info) * frame->number_of_locals) : 0);
+                setPointer(frameAt + offsetof(stack_map_frame, stack), frame->stack != NULL ? copy(frame->stack, sizeof(verification_type_info) * frame->number_of_stack_items) : 0);
+            }
+        }
+    }
+
+    return offset;
+}
+
+u4 SharedArchive::writeClassFile(ClassFile *classFile) {
+    u4 offset = copy(classFile, sizeof(ClassFile));
+    setPointer(offset + offsetof(ClassFile, arena), 0); // a memória da classe passa a ser o próprio mapeamento
+
+    // pool de constantes
+    u2 poolSize = classFile->constant_pool_count - 1;
+    u4 poolOffset = copy(classFile->constant_pool, sizeof(cp_info) * poolSize);
+    setPointer(offset + offsetof(ClassFile, constant_pool), poolOffset);
+    for (u2 i = 0; i < poolSize; i++) {
+        cp_info *constant = classFile->constant_pool + i;
+        if (constant->tag == CONSTANT_Utf8) {
+            u4 at = poolOffset + sizeof(cp_info) * i;
+            CONSTANT_Utf8_info *utf8 = &constant->info.utf8_info;
+            setPointer(at + offsetof(cp_info, info.utf8_info.bytes), copy(utf8->bytes, utf8->length));
+            setSymbol(at + offsetof(cp_info, info.utf8_info.symbol), utf8->symbol);
+        }
+    }
+
+    // interfaces
+    setPointer(offset + offsetof(ClassFile, interfaces), classFile->interfaces_count > 0 ? copy(classFile->interfaces, sizeof(u2) * classFile->interfaces_count) : 0);
+
+    // fields
+    u4 fieldsOffset = classFile->fields_count > 0 ? copy(classFile->fields, sizeof(field_info) * classFile->fields_count) : 0;
+    setPointer(offset + offsetof(ClassFile, fields), fieldsOffset);
+    for (u2 i = 0; i < classFile->fields_count; i++) {
+        field_info *field = classFile->fields + i;
+        setPointer(fieldsOffset + sizeof(field_info) * i + offsetof(field_info, attributes), writeAttributes(classFile, field->attributes, field->attributes_count));
+    }
+
+    // methods
+    u4 methodsOffset = classFile->methods_count > 0 ? copy(classFile->methods, sizeof(method_info) * classFile->methods_count) : 0;
+    setPointer(offset + offsetof(ClassFile, methods), methodsOffset);
+    for (u2 i = 0; i < classFile->methods_count; i++) {
+        method_info *method = classFile->methods + i;
+        u4 at = methodsOffset + sizeof(method_info) * i;
+        u4 attributesOffset = writeAttributes(classFile, method->attributes, method->attributes_count);
+        setPointer(at + offsetof(method_info, attributes), attributesOffset);
+        
+        // code e exceptions apontam para dentro do vetor de atributos
+        setPointer(at + offsetof(method_info, code), method->code != NULL ? attributesOffset + ((u1 *) method->code - (u1 *) method->attributes) : 0);
+        setPointer(at + offsetof(method_info, exceptions), method->exceptions != NULL ? attributesOffset + ((u1 *) method->exceptions - (u1 *) method->attributes) : 0);
+        
+        // os métodos já foram verificados na geração do arquivo, portanto o StackMapTable não precisa ser localizado
+        setPointer(at + offsetof(method_info, stackMapTable), 0);
+    }
+
+    // attributes
+    setPointer(offset + offsetof(ClassFile, attributes), writeAttributes(classFile, classFile->attributes, classFile->attributes_count));
+
+    return offset;
+}
+
+void SharedArchive::dump(const vector<string> &classNames, const string &path) {
+    ClassPath &classPath = ClassPath::getInstance();
+    ClassLoader &classLoader = ClassLoader::getInstance();
+
+    _image.clear();
+    _relocations.clear();
+    _symbols.clear();
+    _symbolIndexes.clear();
+    _symbolFixups.clear();
+
+    // as classes pedidas são obrigatórias; as classes referenciadas por elas são arquivadas quando encontradas
+    queue<string> pending;
+    unordered_set<string> visited;
+    for (size_t i = 0; i < classNames.size(); i++) {
+        string className = classNames[i];
+        if (className.size() > 6 && className.compare(className.size() - 6, 6, ".class") == 0) {
+            className = className.substr(0, className.size() - 6);
+        }
+
+        ClassFileStamp stamp;
+        if (!classPath.getClassStamp(className + ".class", &stamp)) {
+            cerr << "NoClassDefFoundError: " << className << endl;
+            exit(1);
+        }
+
+        if (visited.insert(className).second) {
+            pending.push(className);
+        }
+    }
+
+    vector<ClassFile*> classFiles;
+    vector<ClassFileStamp> stamps;
+    while (!pending.empty()) {
+        string className = pending.front();
+        pending.pop();
+
+        const u1 *bytes;
+        u4 length;
+        AdoptedMemory memory;
+        ClassFileStamp stamp;
+        if (!classPath.findClass(className + ".class", &bytes, &length, &memory) || !classPath.getClassStamp(className + ".class", &stamp)) {
+            continue;
+        }
+        stamps.push_back(stamp);
+
+        // o arquivo guarda os métodos já processados
+        ClassFile *classFile = classLoader.readClassFile(bytes, length);
+        classFile->arena->adopt(memory);
+        classLoader.parseAllMethodAttributes(classFile);
+        classFiles.push_back(classFile);
+
+        for (u2 i = 1; i < classFile->constant_pool_count; i++) {
+            if (classFile->constant_pool[i-1].tag == CONSTANT_Class) {
+                const string &referencedName = *Utils::getSymbol(classFile->constant_pool, i);
+                if (referencedName[0] != '[' && visited.insert(referencedName).second) {
+                    pending.push(referencedName);
+                }
+            }
+        }
+    }
+
+    u4 headerOffset = allocate(sizeof(SharedArchiveHeader));
+    u4 classesOffset = allocate(sizeof(ClassFile*) * classFiles.size());
+    for (size_t i = 0; i < classFiles.size(); i++) {
+        setPointer(classesOffset + sizeof(ClassFile*) * i, writeClassFile(classFiles[i]));
+    }
+    u4 stampsOffset = copy(stamps.data(), sizeof(ClassFileStamp) * stamps.size());
+    const string &classPathString = classPath.getClassPath();
+    u4 classPathOffset = copy(classPathString.data(), classPathString.size());
+
+    u4 symbolsOffset = allocate(0);
+    for (size_t i = 0; i < _symbols.size(); i++) {
+        u4 symbolLength = _symbols[i]->size();
+        memcpy(&_image[allocate(sizeof(u4))], &symbolLength, sizeof(u4));
+        copy(_symbols[i]->data(), symbolLength);
+    }
+
+    u4 symbolFixupsOffset = copy(_symbolFixups.data(), sizeof(u4) * _symbolFixups.size());
+    u4 relocationsOffset = copy(_relocations.data(), sizeof(u4) * _relocations.size());
+
+    SharedArchiveHeader header;
+    header.magic = SHARED_ARCHIVE_MAGIC;
+    header.version = SHARED_ARCHIVE_VERSION;
+    header.pointerSize = sizeof(void*);
+    header.archiveLength = _image.size();
+    header.classesCount = classFiles.size();
+    header.classesOffset = classesOffset;
+    header.stampsOffset = stampsOffset;
+    header.classPathLength = classPathString.size();
+    header.classPathOffset = classPathOffset;
+    header.relocationsCount = _relocations.size();
+    header.relocationsOffset = relocationsOffset;
+    header.symbolsCount = _symbols.size();
+    header.symbolsOffset = symbolsOffset;
+    header.symbolFixupsCount = _symbolFixups.size() / 2;
+    header.symbolFixupsOffset = symbolFixupsOffset;
+    memcpy(&_image[headerOffset], &header, sizeof(header));
+
+    FILE *output = fopen(path.c_str(), "wb");
+    if (output == NULL || fwrite(_image.data(), 1, _image.size(), output) != _image.size()) {
+        cerr << "Erro ao gravar o arquivo " << path << "." << endl;
+        exit(2);
+    }
+    fclose(output);
+
+    printf("%zu classes arquivadas em %s (%zu bytes).\n", classFiles.size(), path.c_str(), _image.size());
+
+    _image.clear();
+    _relocations.clear();
+    _symbols.clear();
+    _symbolIndexes.clear();
+    _symbolFixups.clear();
+}
+
+bool SharedArchive::isValid(const u1 *base, const SharedArchiveHeader *header) {
+    // as contas são feitas em 64 bits, portanto posições e quantidades corrompidas não transbordam
+    uint64_t length = header->archiveLength;
+    if ((uint64_t) header->classesOffset + (uint64_t) header->classesCount * sizeof(ClassFile*) > length ||
+        (uint64_t) header->stampsOffset + (uint64_t) header->classesCount * sizeof(ClassFileStamp) > length ||
+        (uint64_t) header->classPathOffset + header->classPathLength > length ||
+        (uint64_t) header->relocationsOffset + (uint64_t) header->relocationsCount * sizeof(u4) > length ||
+        (uint64_t) header->symbolFixupsOffset + (uint64_t) header->symbolFixupsCount * 2 * sizeof(u4) > length ||
+        (uint64_t) header->symbolsOffset > length) {
+        return false;
+    }
+
+    // cada ponteiro relocado (inclusive os das classes) precisa estar no arquivo e apontar para dentro dele
+    const u4 *relocations = (const u4 *) (base + header->relocationsOffset);
+    for (u4 i = 0; i < header->relocationsCount; i++) {
+        if ((uint64_t) relocations[i] + sizeof(uintptr_t) > length) {
+            return false;
+        }
+        uintptr_t target;
+        memcpy(&target, base + relocations[i], sizeof(target));
+        if (target > length) {
+            return false;
+        }
+    }
+
+    const uintptr_t *classes = (const uintptr_t *) (base + header->classesOffset);
+    for (u4 i = 0; i < header->classesCount; i++) {
+        if (classes[i] == 0 || (uint64_t) classes[i] + sizeof(ClassFile) > length) {
+            return false;
+        }
+    }
+
+    uint64_t offset = header->symbolsOffset;
+    for (u4 i = 0; i < header->symbolsCount; i++) {
+        offset = (offset + 7) & ~7;
+        if (offset + sizeof(u4) > length) {
+            return false;
+        }
+        u4 symbolLength;
+        memcpy(&symbolLength, base + offset, sizeof(u4));
+        offset = ((offset + sizeof(u4) + 7) & ~7) + symbolLength;
+        if (offset > length) {
+            return false;
+        }
+    }
+
+    const u4 *symbolFixups = (const u4 *) (base + header->symbolFixupsOffset);
+    for (u4 i = 0; i < header->symbolFixupsCount; i++) {
+        if ((uint64_t) symbolFixups[2*i] + sizeof(Symbol) > length || symbolFixups[2*i + 1] >= header->symbolsCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SharedArchive::load(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Arquivo de compartilhamento " << path << " não encontrado." << endl;
+        exit(1);
+    }
+
+    // o mapeamento é privado (copy-on-write): somente as páginas que recebem relocação deixam de ser compartilhadas
+    struct stat fileStat;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && (size_t) fileStat.st_size >= sizeof(SharedArchiveHeader)) {
+        mapping = mmap(NULL, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    u1 *base = (u1 *) mapping;
+    SharedArchiveHeader *header = (SharedArchiveHeader *) base;
+    if (mapping == MAP_FAILED || header->magic != SHARED_ARCHIVE_MAGIC || header->version != SHARED_ARCHIVE_VERSION || header->pointerSize != sizeof(void*) || header->archiveLength != (u4) fileStat.st_size || !isValid(base, header)) {
+        cerr << "Arquivo de compartilhamento " << path << " inválido ou incompatível." << endl;
+        exit(3);
+    }
+
+    // as classes arquivadas só são usadas com o mesmo class path
+    ClassPath &classPath = ClassPath::getInstance();
+    if (string((const char *) base + header->classPathOffset, header->classPathLength) != classPath.getClassPath()) {
+        cerr << "Aviso: arquivo de compartilhamento " << path << " gerado com outro class path; as classes serão lidas do class path." << endl;
+        munmap(mapping, fileStat.st_size);
+        return;
+    }
+
+    // relocação dos ponteiros
+    const u4 *relocations = (const u4 *) (base + header->relocationsOffset);
+    for (u4 i = 0; i < header->relocationsCount; i++) {
+        uintptr_t *pointer = (uintptr_t *) (base + relocations[i]);
+        *pointer += (uintptr_t) base;
+    }
+
+    // símbolos
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    vector<Symbol> symbols;
+    symbols.reserve(header->symbolsCount);
+    u4 offset = header->symbolsOffset;
+    for (u4 i = 0; i < header->symbolsCount; i++) {
+        offset = (offset + 7) & ~7;
+        u4 symbolLength;
+        memcpy(&symbolLength, base + offset, sizeof(u4));
+        offset = ((offset + sizeof(u4) + 7) & ~7);
+        symbols.push_back(symbolTable.intern(string((const char *) base + offset, symbolLength)));
+        offset += symbolLength;
+    }
+
+    const u4 *symbolFixups = (const u4 *) (base + header->symbolFixupsOffset);
+    for (u4 i = 0; i < header->symbolFixupsCount; i++) {
+        Symbol *field = (Symbol *) (base + symbolFixups[2*i]);
+        *field = symbols[symbolFixups[2*i + 1]];
+    }
+
+    // registro das classes, exceto as que foram alteradas (ou passaram a ser encontradas em outra entrada do class path)
+    ClassFile **classes = (ClassFile **) (base + header->classesOffset);
+    const ClassFileStamp *stamps = (const ClassFileStamp *) (base + header->stampsOffset);
+    u4 staleClasses = 0;
+    for (u4 i = 0; i < header->classesCount; i++) {
+        ClassFile *classFile = classes[i];
+        const string &className = *Utils::getSymbol(classFile->constant_pool, classFile->this_class);
+
+        ClassFileStamp stamp;
+        if (!classPath.getClassStamp(className + ".class", &stamp) || stamp.entryIndex != stamps[i].entryIndex || stamp.length != stamps[i].length || stamp.modificationTime != stamps[i].modificationTime) {
+            staleClasses++;
+            continue;
+        }
+
+        // os métodos foram arquivados já processados; o flag é construído sobre os bytes do mapeamento
+        for (u2 j = 0; j < classFile->methods_count; j++) {
+            new (&classFile->methods[j].attributes_parsed) atomic<bool>(true);
+        }
+        _sharedClasses[className] = classFile;
+    }
+
+    if (staleClasses > 0) {
+        cerr << "Aviso: " << staleClasses << " classes do arquivo de compartilhamento " << path << " foram alteradas e serão lidas do class path." << endl;
+    }
+}
+
+ClassFile* SharedArchive::getSharedClass(const string &className) {
+    unordered_map<string, ClassFile*>::iterator it = _sharedClasses.find(className);
+
+    if (it == _sharedClasses.end()) {
+        return NULL;
+    }
+
+    return it->second;
+}
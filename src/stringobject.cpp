@@ -1,7 +1,7 @@
 #include "stringobject.h"
 #include <cstdlib>
 
-StringObject::StringObject(string s) : _internalString(s) {
+StringObject::StringObject(string s) : Object(STRING_INSTANCE, 0), _internalString(s) {
     
 }
 
@@ -9,10 +9,6 @@ StringObject::~StringObject() {
     
 }
 
-ObjectType StringObject::objectType() {
-    return ObjectType::STRING_INSTANCE;
-}
-
 string StringObject::getString() {
     return _internalString;
 }
@@ -0,0 +1,18 @@
+#include "symboltable.h"
+
+SymbolTable::SymbolTable() {
+    
+}
+
+SymbolTable::~SymbolTable() {
+    
+}
+
+Symbol SymbolTable::intern(const string &s) {
+    lock_guard<mutex> lock(_mutex);
+    return &(*_symbols.insert(s).first);
+}
+
+Symbol SymbolTable::intern(const u1 *bytes, u2 length) {
+    return intern(string((const char *) bytes, length));
+}
@@ -0,0 +1,171 @@
+#include "threadmanager.h"
+#include "executionengine.h"
+#include "methodarea.h"
+#include "vmstack.h"
+#include "frame.h"
+#include "symboltable.h"
+#include "scheduler.h"
+#include "garbagecollector.h"
+
+#include <iostream>
+#include <cstdlib>
+
+ThreadManager::ThreadManager() {
+    // os singletons usados pelas threads Java são criados antes, para que sejam destruídos depois deste
+    ExecutionEngine::getInstance();
+    MethodArea::getInstance();
+    SymbolTable::getInstance();
+}
+
+ThreadManager::~ThreadManager() {
+    // threads ainda em execução (o programa foi encerrado com exit, e.g. por uma exceção) não são aguardadas
+    for (map<ClassInstance*, JavaThread*>::iterator it = _threads.begin(); it != _threads.end(); it++) {
+        if (it->second->osThread.joinable()) {
+            it->second->osThread.detach();
+        }
+        delete it->second;
+    }
+}
+
+void ThreadManager::startThread(ClassInstance *threadObject) {
+    Scheduler &scheduler = Scheduler::getInstance();
+    
+    {
+        lock_guard<mutex> lock(_mutex);
+
+        if (_threads.count(threadObject) > 0) {
+            cerr << "IllegalThreadStateException" << endl;
+            exit(1);
+        }
+
+        JavaThread *javaThread = new JavaThread;
+        javaThread->finished = false;
+        _threads[threadObject] = javaThread;
+        if (!scheduler.isEnabled()) {
+            javaThread->osThread = thread(&ThreadManager::runThread, this, threadObject);
+            return;
+        }
+    }
+
+    scheduler.spawn(threadObject);
+}
+
+void ThreadManager::runThread(ClassInstance *threadObject) {
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.leaveSafeRegion();
+    VMStack::getInstance().setThreadObject(threadObject);
+
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    vector<Value> arguments;
+    Value thisValue;
+    thisValue.type = ValueType::REFERENCE;
+    thisValue.data.object = threadObject;
+    arguments.push_back(thisValue);
+
+    // o método run() é buscado a partir da classe do objeto (a subclasse de Thread, caso exista)
+    VMStack &stackFrame = VMStack::getInstance();
+    stackFrame.addFrame(new Frame(threadObject, threadObject->getClassRuntime(), symbolTable.intern("run"), symbolTable.intern("()V"), arguments));
+    ExecutionEngine::getInstance().executeFrames();
+
+    garbageCollector.enterSafeRegion();
+    threadFinished(threadObject);
+}
+
+void ThreadManager::threadFinished(ClassInstance *threadObject) {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _threads[threadObject]->finished = true;
+    }
+    _threadFinished.notify_all();
+    
+    if (Scheduler::hasParkedThreads()) {
+        Scheduler::getInstance().unparkAll(threadObject);
+    }
+}
+
+bool ThreadManager::joinThread(ClassInstance *threadObject) {
+    if (Scheduler::currentGreenThread() != NULL) {
+        if (!isAlive(threadObject)) {
+            return true;
+        }
+        
+        Scheduler &scheduler = Scheduler::getInstance();
+        scheduler.park(threadObject);
+        if (!isAlive(threadObject)) {
+            scheduler.cancelPark();
+            return true;
+        }
+        return false;
+    }
+    
+    // a coleta de lixo pode ocorrer durante a espera, que termina após liberar _mutex (usado pela coleta)
+    GarbageCollector &garbageCollector = GarbageCollector::getInstance();
+    garbageCollector.enterSafeRegion();
+    {
+        unique_lock<mutex> lock(_mutex);
+
+        map<ClassInstance*, JavaThread*>::iterator it = _threads.find(threadObject);
+        if (it != _threads.end()) {
+            JavaThread *javaThread = it->second;
+            while (!javaThread->finished) {
+                _threadFinished.wait(lock);
+            }
+        }
+    }
+    garbageCollector.leaveSafeRegion();
+    return true;
+}
+
+bool ThreadManager::isAlive(ClassInstance *threadObject) {
+    lock_guard<mutex> lock(_mutex);
+
+    map<ClassInstance*, JavaThread*>::iterator it = _threads.find(threadObject);
+    return it != _threads.end() && !it->second->finished;
+}
+
+ClassInstance* ThreadManager::currentThread() {
+    VMStack &stackFrame = VMStack::getInstance();
+    
+    if (stackFrame.getThreadObject() == NULL) {
+        ClassRuntime *threadClass = MethodArea::getInstance().loadClassNamed(SymbolTable::getInstance().intern("java/lang/Thread"));
+        stackFrame.setThreadObject(ClassInstance::create(threadClass));
+    }
+
+    return stackFrame.getThreadObject();
+}
+
+void ThreadManager::joinAllThreads() {
+    unique_lock<mutex> lock(_mutex);
+
+    // threads em execução podem iniciar outras threads, portanto a busca é refeita a cada sinalização
+    bool running = true;
+    while (running) {
+        running = false;
+        for (map<ClassInstance*, JavaThread*>::iterator it = _threads.begin(); it != _threads.end(); it++) {
+            if (!it->second->finished) {
+                running = true;
+                break;
+            }
+        }
+        if (running) {
+            _threadFinished.wait(lock);
+        }
+    }
+
+    // todas as threads terminaram, portanto nenhuma outra pode ser iniciada enquanto elas são liberadas
+    for (map<ClassInstance*, JavaThread*>::iterator it = _threads.begin(); it != _threads.end(); it++) {
+        if (it->second->osThread.joinable()) {
+            it->second->osThread.join();
+        }
+        delete it->second;
+    }
+    _threads.clear();
+}
+
+void ThreadManager::collectRoots(vector<Object*> &roots) {
+    lock_guard<mutex> lock(_mutex);
+
+    for (map<ClassInstance*, JavaThread*>::iterator it = _threads.begin(); it != _threads.end(); it++) {
+        roots.push_back(it->first);
+    }
+}
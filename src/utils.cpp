@@ -1,6 +1,7 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <cassert>
 
 #include "utils.h"
 
@@ -30,6 +31,19 @@ bool Utils::compareUtf8WithString(CONSTANT_Utf8_info constant, const char *str)
     return true;
 }
 
+Symbol Utils::getSymbol(cp_info *constantPool, u2 index) {
+    cp_info constant = constantPool[index-1];
+    
+    if (constant.tag == CONSTANT_Class) {
+        constant = constantPool[constant.info.class_info.name_index-1];
+    } else if (constant.tag == CONSTANT_String) {
+        constant = constantPool[constant.info.string_info.string_index-1];
+    }
+    
+    assert(constant.tag == CONSTANT_Utf8);
+    return constant.info.utf8_info.symbol;
+}
+
 void Utils::printTabs(FILE *out, uint8_t n) {
     for (uint8_t i = 0; i < n; i++) fprintf(out, "\t");
 }
@@ -0,0 +1,1026 @@
+#include "verifier.h"
+#include "utils.h"
+#include "symboltable.h"
+#include "methodarea.h"
+#include "classruntime.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#define ACC_STATIC 0x0008
+#define ACC_INTERFACE 0x0200
+
+Verifier::Verifier(ClassFile *classFile, method_info *method) : _classFile(classFile), _method(method), _code(method->code) {
+    _thisClass = Utils::getSymbol(classFile->constant_pool, classFile->this_class);
+    _methodName = Utils::getSymbol(classFile->constant_pool, method->name_index);
+    _methodDescriptor = Utils::getSymbol(classFile->constant_pool, method->descriptor_index);
+}
+
+void Verifier::verifyMethod(ClassFile *classFile, method_info *method) {
+    if (method->code == NULL) {
+        return;
+    }
+
+    // na versão 50, métodos sem StackMapTable deveriam ser verificados por inferência de tipos, que não é implementada
+    if (classFile->major_version == 50 && method->stackMapTable == NULL) {
+        return;
+    }
+
+    Verifier verifier(classFile, method);
+    verifier.verify();
+}
+
+void Verifier::fail(u4 pc, const string &message) {
+    cerr << "VerifyError: " << *_thisClass << "." << *_methodName << *_methodDescriptor << " (pc " << pc << "): " << message << endl;
+    exit(1);
+}
+
+Verifier::Type Verifier::makeType(u1 tag) {
+    Type type;
+    type.tag = tag;
+    type.className = NULL;
+    type.offset = 0;
+    return type;
+}
+
+Verifier::Type Verifier::makeObjectType(Symbol className) {
+    Type type = makeType(ITEM_Object);
+    type.className = className;
+    return type;
+}
+
+Verifier::Type Verifier::makeUninitializedType(u2 offset) {
+    Type type = makeType(ITEM_Uninitialized);
+    type.offset = offset;
+    return type;
+}
+
+bool Verifier::isCategory2(const Type &type) {
+    return type.tag == ITEM_Long || type.tag == ITEM_Double;
+}
+
+bool Verifier::isReference(const Type &type) {
+    return type.tag == ITEM_Object || type.tag == ITEM_Null || type.tag == ITEM_UninitializedThis || type.tag == ITEM_Uninitialized;
+}
+
+u1 Verifier::readU1(u4 pc, u4 position) {
+    if (position >= _code->code_length) {
+        fail(pc, "instrução truncada");
+    }
+    return _code->code[position];
+}
+
+u2 Verifier::readU2(u4 pc, u4 position) {
+    return (readU1(pc, position) << 8) | readU1(pc, position + 1);
+}
+
+int32_t Verifier::readS4(u4 pc, u4 position) {
+    return (int32_t) (((u4) readU2(pc, position) << 16) | readU2(pc, position + 2));
+}
+
+Verifier::Type Verifier::typeFromDescriptor(u4 pc, const string &descriptor, size_t *position) {
+    size_t start = *position;
+    if (start >= descriptor.size()) {
+        fail(pc, "descritor inválido: " + descriptor);
+    }
+
+    switch (descriptor[start]) {
+        case 'B':
+        case 'C':
+        case 'I':
+        case 'S':
+        case 'Z':
+            (*position)++;
+            return makeType(ITEM_Integer);
+        case 'F':
+            (*position)++;
+            return makeType(ITEM_Float);
+        case 'J':
+            (*position)++;
+            return makeType(ITEM_Long);
+        case 'D':
+            (*position)++;
+            return makeType(ITEM_Double);
+        case 'L': {
+            size_t end = descriptor.find(';', start);
+            if (end == string::npos) {
+                fail(pc, "descritor inválido: " + descriptor);
+            }
+            *position = end + 1;
+            return makeObjectType(SymbolTable::getInstance().intern(descriptor.substr(start + 1, end - start - 1)));
+        }
+        case '[': {
+            size_t end = start;
+            while (end < descriptor.size() && descriptor[end] == '[') {
+                end++;
+            }
+            *position = end;
+            typeFromDescriptor(pc, descriptor, position); // valida o tipo dos elementos
+            return makeObjectType(SymbolTable::getInstance().intern(descriptor.substr(start, *position - start)));
+        }
+        default:
+            fail(pc, "descritor inválido: " + descriptor);
+    }
+
+    return makeType(ITEM_Top);
+}
+
+Verifier::Type Verifier::typeFromVerificationInfo(u4 pc, const verification_type_info &info) {
+    if (info.tag == ITEM_Object) {
+        return makeObjectType(getClassName(pc, info.cpool_index));
+    }
+    if (info.tag == ITEM_Uninitialized) {
+        if (info.offset >= _code->code_length || _code->code[info.offset] != 0xbb) {
+            fail(pc, "tipo não inicializado não corresponde a uma instrução new");
+        }
+        return makeUninitializedType(info.offset);
+    }
+    return makeType(info.tag);
+}
+
+Verifier::Type Verifier::componentType(u4 pc, const Type &arrayType) {
+    if (arrayType.tag == ITEM_Null) {
+        return arrayType;
+    }
+    if (arrayType.tag != ITEM_Object || (*arrayType.className)[0] != '[') {
+        fail(pc, "era esperado um array");
+    }
+
+    size_t position = 1;
+    return typeFromDescriptor(pc, *arrayType.className, &position);
+}
+
+void Verifier::checkArrayType(u4 pc, const Type &arrayType, char element) {
+    if (arrayType.tag == ITEM_Null) {
+        return;
+    }
+    if (arrayType.tag != ITEM_Object || (*arrayType.className)[0] != '[' || arrayType.className->size() < 2) {
+        fail(pc, "era esperado um array");
+    }
+
+    char actual = (*arrayType.className)[1];
+    bool valid;
+    if (element == 'L') {
+        valid = actual == 'L' || actual == '[';
+    } else if (element == 'B') {
+        valid = actual == 'B' || actual == 'Z';
+    } else {
+        valid = actual == element;
+    }
+
+    if (!valid) {
+        fail(pc, "tipo de array incompatível com a instrução: " + *arrayType.className);
+    }
+}
+
+bool Verifier::isSubclass(Symbol from, Symbol to) {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol objectName = symbolTable.intern("java/lang/Object");
+    static Symbol cloneableName = symbolTable.intern("java/lang/Cloneable");
+    static Symbol serializableName = symbolTable.intern("java/io/Serializable");
+
+    if (from == to || to == objectName) {
+        return true;
+    }
+
+    const string &fromName = *from;
+    const string &toName = *to;
+
+    // arrays: somente arrays de referências são covariantes
+    if (toName[0] == '[') {
+        if (fromName[0] != '[') {
+            return false;
+        }
+        size_t position = 1;
+        Type fromComponent = typeFromDescriptor(0, fromName, &position);
+        position = 1;
+        Type toComponent = typeFromDescriptor(0, toName, &position);
+        if (fromComponent.tag != ITEM_Object || toComponent.tag != ITEM_Object) {
+            return false;
+        }
+        return isSubclass(fromComponent.className, toComponent.className);
+    }
+    if (fromName[0] == '[') {
+        return to == cloneableName || to == serializableName;
+    }
+
+    // classes: percorre as superclasses já carregadas
+    MethodArea &methodArea = MethodArea::getInstance();
+    ClassRuntime *toClass = methodArea.getClassNamed(to);
+    if (toClass == NULL || (toClass->getClassFile()->access_flags & ACC_INTERFACE)) {
+        return true;
+    }
+
+    Symbol current = from;
+    while (current != to) {
+        ClassRuntime *currentClass = methodArea.getClassNamed(current);
+        if (currentClass == NULL) {
+            return true;
+        }
+        ClassFile *classFile = currentClass->getClassFile();
+        if (classFile->super_class == 0) {
+            return false;
+        }
+        current = Utils::getSymbol(classFile->constant_pool, classFile->super_class);
+    }
+
+    return true;
+}
+
+bool Verifier::isAssignable(const Type &from, const Type &to) {
+    if (from == to || to.tag == ITEM_Top) {
+        return true;
+    }
+
+    if (to.tag == ITEM_Object) {
+        if (from.tag == ITEM_Null) {
+            return true;
+        }
+        if (from.tag == ITEM_Object) {
+            return isSubclass(from.className, to.className);
+        }
+    }
+
+    return false;
+}
+
+Symbol Verifier::getClassName(u4 pc, u2 index) {
+    if (index == 0 || index >= _classFile->constant_pool_count || _classFile->constant_pool[index-1].tag != CONSTANT_Class) {
+        fail(pc, "índice do pool de constantes não é uma classe");
+    }
+    return Utils::getSymbol(_classFile->constant_pool, index);
+}
+
+void Verifier::getMemberReference(u4 pc, u2 index, u4 acceptedTags, Symbol *className, Symbol *name, Symbol *descriptor) {
+    if (index == 0 || index >= _classFile->constant_pool_count || (acceptedTags & (1 << _classFile->constant_pool[index-1].tag)) == 0) {
+        fail(pc, "índice do pool de constantes com tipo incompatível com a instrução");
+    }
+
+    cp_info &constant = _classFile->constant_pool[index-1];
+    u2 nameAndTypeIndex;
+    *className = NULL;
+    if (constant.tag == CONSTANT_InvokeDynamic) {
+        nameAndTypeIndex = constant.info.invokeDynamic_info.name_and_type_index;
+    } else {
+        // Fieldref, Methodref e InterfaceMethodref possuem a mesma estrutura
+        *className = getClassName(pc, constant.info.fieldref_info.class_index);
+        nameAndTypeIndex = constant.info.fieldref_info.name_and_type_index;
+    }
+
+    CONSTANT_NameAndType_info nameAndType = _classFile->constant_pool[nameAndTypeIndex-1].info.nameAndType_info;
+    *name = Utils::getSymbol(_classFile->constant_pool, nameAndType.name_index);
+    *descriptor = Utils::getSymbol(_classFile->constant_pool, nameAndType.descriptor_index);
+}
+
+vector<Verifier::Type> Verifier::expandLocals(u4 pc, const vector<Type> &declared) {
+    vector<Type> locals;
+    for (size_t i = 0; i < declared.size(); i++) {
+        locals.push_back(declared[i]);
+        if (isCategory2(declared[i])) {
+            locals.push_back(makeType(ITEM_Top));
+        }
+    }
+
+    if (locals.size() > _code->max_locals) {
+        fail(pc, "frame com mais variáveis locais do que max_locals");
+    }
+    locals.resize(_code->max_locals, makeType(ITEM_Top));
+
+    return locals;
+}
+
+void Verifier::buildStackMapStates(const vector<Type> &initialLocals) {
+    _stateAt.assign(_code->code_length, -1);
+
+    StackMapTable_attribute *stackMapTable = _method->stackMapTable;
+    if (stackMapTable == NULL) {
+        return;
+    }
+
+    vector<Type> locals = initialLocals;
+    u4 offset = 0;
+    for (u2 i = 0; i < stackMapTable->number_of_entries; i++) {
+        stack_map_frame *frame = &stackMapTable->entries[i];
+        offset = (i == 0) ? frame->offset_delta : offset + frame->offset_delta + 1;
+        if (offset >= _code->code_length) {
+            fail(offset, "frame do StackMapTable fora do código");
+        }
+
+        u1 frameType = frame->frame_type;
+        if (frameType >= 248 && frameType <= 250) { // chop_frame
+            if (locals.size() < frame->number_of_locals) {
+                fail(offset, "chop_frame remove mais variáveis locais do que existem");
+            }
+            locals.resize(locals.size() - frame->number_of_locals);
+        } else if (frameType >= 252 && frameType <= 254) { // append_frame
+            for (u2 j = 0; j < frame->number_of_locals; j++) {
+                locals.push_back(typeFromVerificationInfo(offset, frame->locals[j]));
+            }
+        } else if (frameType == 255) { // full_frame
+            locals.clear();
+            for (u2 j = 0; j < frame->number_of_locals; j++) {
+                locals.push_back(typeFromVerificationInfo(offset, frame->locals[j]));
+            }
+        }
+
+        StackMapState state;
+        state.offset = offset;
+        state.locals = expandLocals(offset, locals);
+        for (u2 j = 0; j < frame->number_of_stack_items; j++) {
+            Type type = typeFromVerificationInfo(offset, frame->stack[j]);
+            state.stack.push_back(type);
+            if (isCategory2(type)) {
+                state.stack.push_back(makeType(ITEM_Top));
+            }
+        }
+        if (state.stack.size() > _code->max_stack) {
+            fail(offset, "frame com mais itens na pilha do que max_stack");
+        }
+
+        _stateAt[offset] = _states.size();
+        _states.push_back(state);
+    }
+}
+
+void Verifier::checkTarget(u4 pc, u4 target, const vector<Type> &stack) {
+    if (target >= _code->code_length || _stateAt[target] < 0) {
+        fail(pc, "destino de desvio sem frame no StackMapTable");
+    }
+
+    StackMapState &state = _states[_stateAt[target]];
+    for (size_t i = 0; i < _locals.size(); i++) {
+        if (!isAssignable(_locals[i], state.locals[i])) {
+            fail(pc, "variáveis locais incompatíveis com o frame do StackMapTable");
+        }
+    }
+
+    if (stack.size() != state.stack.size()) {
+        fail(pc, "altura da pilha incompatível com o frame do StackMapTable");
+    }
+    for (size_t i = 0; i < stack.size(); i++) {
+        if (!isAssignable(stack[i], state.stack[i])) {
+            fail(pc, "pilha de operandos incompatível com o frame do StackMapTable");
+        }
+    }
+}
+
+void Verifier::checkHandlers(u4 pc) {
+    static Symbol throwableName = SymbolTable::getInstance().intern("java/lang/Throwable");
+
+    for (u2 i = 0; i < _code->exception_table_length; i++) {
+        ExceptionTable &handler = _code->exception_table[i];
+        if (pc < handler.start_pc || pc >= handler.end_pc) {
+            continue;
+        }
+
+        vector<Type> stack(1, makeObjectType(handler.catch_type == 0 ? throwableName : getClassName(pc, handler.catch_type)));
+        checkTarget(pc, handler.handler_pc, stack);
+    }
+}
+
+Verifier::Type Verifier::pop(u4 pc) {
+    if (_stack.empty()) {
+        fail(pc, "pilha de operandos vazia");
+    }
+    Type type = _stack.back();
+    _stack.pop_back();
+    return type;
+}
+
+Verifier::Type Verifier::pop(u4 pc, const Type &expected) {
+    if (isCategory2(expected)) {
+        Type top = pop(pc);
+        Type value = pop(pc);
+        if (top.tag != ITEM_Top || value.tag != expected.tag) {
+            fail(pc, "tipo incompatível na pilha de operandos");
+        }
+        return value;
+    }
+
+    Type value = pop(pc);
+    if (!isAssignable(value, expected)) {
+        fail(pc, "tipo incompatível na pilha de operandos");
+    }
+    return value;
+}
+
+Verifier::Type Verifier::popReference(u4 pc) {
+    Type value = pop(pc);
+    if (!isReference(value)) {
+        fail(pc, "era esperada uma referência na pilha de operandos");
+    }
+    return value;
+}
+
+void Verifier::push(u4 pc, const Type &type) {
+    _stack.push_back(type);
+    if (isCategory2(type)) {
+        _stack.push_back(makeType(ITEM_Top));
+    }
+    if (_stack.size() > _code->max_stack) {
+        fail(pc, "estouro da pilha de operandos (max_stack)");
+    }
+}
+
+Verifier::Type Verifier::getLocal(u4 pc, u4 index, const Type &expected) {
+    u4 size = isCategory2(expected) ? 2 : 1;
+    if (index + size > _locals.size()) {
+        fail(pc, "índice de variável local maior que max_locals");
+    }
+
+    Type value = _locals[index];
+    if (isCategory2(expected)) {
+        if (value.tag != expected.tag || _locals[index + 1].tag != ITEM_Top) {
+            fail(pc, "tipo incompatível na variável local");
+        }
+    } else if (!isAssignable(value, expected)) {
+        fail(pc, "tipo incompatível na variável local");
+    }
+
+    return value;
+}
+
+void Verifier::setLocal(u4 pc, u4 index, const Type &type) {
+    u4 size = isCategory2(type) ? 2 : 1;
+    if (index + size > _locals.size()) {
+        fail(pc, "índice de variável local maior que max_locals");
+    }
+
+    // sobrescrever a segunda metade de um long/double invalida a primeira
+    if (index > 0 && isCategory2(_locals[index - 1])) {
+        _locals[index - 1] = makeType(ITEM_Top);
+    }
+
+    _locals[index] = type;
+    if (size == 2) {
+        _locals[index + 1] = makeType(ITEM_Top);
+    }
+}
+
+void Verifier::checkStackBoundary(u4 pc, size_t index) {
+    if (index < _stack.size() && _stack[index].tag == ITEM_Top) {
+        fail(pc, "instrução separa as metades de um long/double na pilha");
+    }
+}
+
+void Verifier::initializeObject(const Type &uninitialized, const Type &initialized) {
+    for (size_t i = 0; i < _locals.size(); i++) {
+        if (_locals[i] == uninitialized) {
+            _locals[i] = initialized;
+        }
+    }
+    for (size_t i = 0; i < _stack.size(); i++) {
+        if (_stack[i] == uninitialized) {
+            _stack[i] = initialized;
+        }
+    }
+}
+
+void Verifier::verifyFieldAccess(u4 pc, u1 opcode, u2 index) {
+    static Symbol initName = SymbolTable::getInstance().intern("<init>");
+
+    Symbol className, name, descriptor;
+    getMemberReference(pc, index, 1 << CONSTANT_Fieldref, &className, &name, &descriptor);
+
+    size_t position = 0;
+    Type fieldType = typeFromDescriptor(pc, *descriptor, &position);
+
+    switch (opcode) {
+        case 0xb2: // getstatic
+            push(pc, fieldType);
+            break;
+        case 0xb3: // putstatic
+            pop(pc, fieldType);
+            break;
+        case 0xb4: // getfield
+            pop(pc, makeObjectType(className));
+            push(pc, fieldType);
+            break;
+        case 0xb5: { // putfield
+            pop(pc, fieldType);
+            Type receiver = pop(pc);
+            // o construtor pode inicializar os campos da própria classe antes de chamar o construtor da superclasse
+            bool initializingThis = receiver.tag == ITEM_UninitializedThis && _methodName == initName && className == _thisClass;
+            if (!initializingThis && !isAssignable(receiver, makeObjectType(className))) {
+                fail(pc, "objeto incompatível com o campo");
+            }
+            break;
+        }
+    }
+}
+
+void Verifier::verifyInvoke(u4 pc, u1 opcode, u2 index) {
+    static Symbol initName = SymbolTable::getInstance().intern("<init>");
+
+    u4 acceptedTags;
+    if (opcode == 0xb6) { // invokevirtual
+        acceptedTags = 1 << CONSTANT_Methodref;
+    } else if (opcode == 0xb9) { // invokeinterface
+        acceptedTags = 1 << CONSTANT_InterfaceMethodref;
+    } else if (opcode == 0xba) { // invokedynamic
+        acceptedTags = 1 << CONSTANT_InvokeDynamic;
+    } else { // invokespecial e invokestatic (a partir da versão 52, podem referenciar métodos de interfaces)
+        acceptedTags = (1 << CONSTANT_Methodref) | (1 << CONSTANT_InterfaceMethodref);
+    }
+
+    Symbol className, name, descriptor;
+    getMemberReference(pc, index, acceptedTags, &className, &name, &descriptor);
+
+    const string &methodDescriptor = *descriptor;
+    if (methodDescriptor.empty() || methodDescriptor[0] != '(') {
+        fail(pc, "descritor de método inválido: " + methodDescriptor);
+    }
+
+    vector<Type> arguments;
+    size_t position = 1;
+    while (position < methodDescriptor.size() && methodDescriptor[position] != ')') {
+        arguments.push_back(typeFromDescriptor(pc, methodDescriptor, &position));
+    }
+    if (position >= methodDescriptor.size()) {
+        fail(pc, "descritor de método inválido: " + methodDescriptor);
+    }
+    position++;
+
+    for (size_t i = arguments.size(); i > 0; i--) {
+        pop(pc, arguments[i - 1]);
+    }
+
+    if (name == initName) {
+        if (opcode != 0xb7) {
+            fail(pc, "<init> só pode ser chamado com invokespecial");
+        }
+
+        Type receiver = pop(pc);
+        Type initialized = makeType(ITEM_Top);
+        if (receiver.tag == ITEM_Uninitialized) {
+            Symbol createdClass = getClassName(pc, readU2(pc, receiver.offset + 1));
+            if (createdClass != className) {
+                fail(pc, "<init> de uma classe diferente da criada pela instrução new");
+            }
+            initialized = makeObjectType(createdClass);
+        } else if (receiver.tag == ITEM_UninitializedThis) {
+            initialized = makeObjectType(_thisClass);
+        } else {
+            fail(pc, "<init> chamado para um objeto já inicializado");
+        }
+        initializeObject(receiver, initialized);
+    } else if ((*name)[0] == '<') {
+        fail(pc, "chamada inválida ao método " + *name);
+    } else if (opcode != 0xb8 && opcode != 0xba) {
+        pop(pc, makeObjectType(className));
+    }
+
+    if (methodDescriptor[position] != 'V') {
+        push(pc, typeFromDescriptor(pc, methodDescriptor, &position));
+    }
+}
+
+void Verifier::verifyReturn(u4 pc, u1 opcode) {
+    static Symbol initName = SymbolTable::getInstance().intern("<init>");
+
+    const string &methodDescriptor = *_methodDescriptor;
+    size_t position = methodDescriptor.find(')') + 1;
+
+    if (opcode == 0xb1) { // return
+        if (methodDescriptor[position] != 'V') {
+            fail(pc, "return em um método que retorna um valor");
+        }
+        if (_methodName == initName) {
+            for (size_t i = 0; i < _locals.size(); i++) {
+                if (_locals[i].tag == ITEM_UninitializedThis) {
+                    fail(pc, "o construtor retorna sem chamar o construtor da superclasse");
+                }
+            }
+        }
+        return;
+    }
+
+    if (methodDescriptor[position] == 'V') {
+        fail(pc, "retorno de valor em um método void");
+    }
+
+    Type returnType = typeFromDescriptor(pc, methodDescriptor, &position);
+    static const u1 returnTags[] = {ITEM_Integer, ITEM_Long, ITEM_Float, ITEM_Double, ITEM_Object};
+    if (returnType.tag != returnTags[opcode - 0xac]) {
+        fail(pc, "instrução de retorno incompatível com o tipo de retorno do método");
+    }
+    pop(pc, returnType);
+}
+
+void Verifier::verify() {
+    SymbolTable &symbolTable = SymbolTable::getInstance();
+    static Symbol objectName = symbolTable.intern("java/lang/Object");
+    static Symbol stringName = symbolTable.intern("java/lang/String");
+    static Symbol className = symbolTable.intern("java/lang/Class");
+    static Symbol throwableName = symbolTable.intern("java/lang/Throwable");
+    static Symbol methodTypeName = symbolTable.intern("java/lang/invoke/MethodType");
+    static Symbol methodHandleName = symbolTable.intern("java/lang/invoke/MethodHandle");
+    static Symbol initName = symbolTable.intern("<init>");
+
+    // tipos usados pelas instruções, na ordem i, l, f, d
+    static const u1 kindTags[] = {ITEM_Integer, ITEM_Long, ITEM_Float, ITEM_Double};
+
+    u4 codeLength = _code->code_length;
+    u1 *code = _code->code;
+
+    for (u2 i = 0; i < _code->exception_table_length; i++) {
+        ExceptionTable &handler = _code->exception_table[i];
+        if (handler.start_pc >= handler.end_pc || handler.end_pc > codeLength || handler.handler_pc >= codeLength) {
+            fail(handler.start_pc, "intervalo inválido na tabela de exceções");
+        }
+    }
+
+    // estado inicial: this (se o método não for estático) e os parâmetros do descritor
+    vector<Type> initialLocals;
+    if ((_method->access_flags & ACC_STATIC) == 0) {
+        if (_methodName == initName && _thisClass != objectName) {
+            initialLocals.push_back(makeType(ITEM_UninitializedThis));
+        } else {
+            initialLocals.push_back(makeObjectType(_thisClass));
+        }
+    }
+    const string &methodDescriptor = *_methodDescriptor;
+    size_t position = 1;
+    while (position < methodDescriptor.size() && methodDescriptor[position] != ')') {
+        initialLocals.push_back(typeFromDescriptor(0, methodDescriptor, &position));
+    }
+
+    _locals = expandLocals(0, initialLocals);
+    _stack.clear();
+    buildStackMapStates(initialLocals);
+
+    size_t visitedStates = 0;
+    bool reachable = true; // a instrução anterior pode continuar na próxima
+    u4 pc = 0;
+    while (pc < codeLength) {
+        int stateIndex = _stateAt[pc];
+        if (stateIndex >= 0) {
+            if (reachable) {
+                checkTarget(pc, pc, _stack);
+            }
+            _locals = _states[stateIndex].locals;
+            _stack = _states[stateIndex].stack;
+            visitedStates++;
+        } else if (!reachable) {
+            fail(pc, "esperado um frame do StackMapTable após um desvio incondicional");
+        }
+        reachable = true;
+
+        checkHandlers(pc);
+
+        u1 opcode = code[pc];
+        u4 operand = pc + 1;
+        bool wide = false;
+        if (opcode == 0xc4) { // wide
+            wide = true;
+            opcode = readU1(pc, pc + 1);
+            operand = pc + 2;
+            if (!((opcode >= 0x15 && opcode <= 0x19) || (opcode >= 0x36 && opcode <= 0x3a) || opcode == 0x84 || opcode == 0xa9)) {
+                fail(pc, "instrução inválida após wide");
+            }
+        }
+        u4 next = operand;
+
+        if (opcode == 0x00) { // nop
+        } else if (opcode == 0x01) { // aconst_null
+            push(pc, makeType(ITEM_Null));
+        } else if (opcode <= 0x08) { // iconst_<i>
+            push(pc, makeType(ITEM_Integer));
+        } else if (opcode <= 0x0a) { // lconst_<l>
+            push(pc, makeType(ITEM_Long));
+        } else if (opcode <= 0x0d) { // fconst_<f>
+            push(pc, makeType(ITEM_Float));
+        } else if (opcode <= 0x0f) { // dconst_<d>
+            push(pc, makeType(ITEM_Double));
+        } else if (opcode == 0x10) { // bipush
+            readU1(pc, operand);
+            push(pc, makeType(ITEM_Integer));
+            next = operand + 1;
+        } else if (opcode == 0x11) { // sipush
+            readU2(pc, operand);
+            push(pc, makeType(ITEM_Integer));
+            next = operand + 2;
+        } else if (opcode <= 0x14) { // ldc, ldc_w, ldc2_w
+            u2 index = (opcode == 0x12) ? readU1(pc, operand) : readU2(pc, operand);
+            next = operand + ((opcode == 0x12) ? 1 : 2);
+            if (index == 0 || index >= _classFile->constant_pool_count) {
+                fail(pc, "índice inválido do pool de constantes");
+            }
+
+            u1 tag = _classFile->constant_pool[index-1].tag;
+            if (opcode == 0x14) {
+                if (tag == CONSTANT_Long) {
+                    push(pc, makeType(ITEM_Long));
+                } else if (tag == CONSTANT_Double) {
+                    push(pc, makeType(ITEM_Double));
+                } else {
+                    fail(pc, "ldc2_w de uma constante que não é long/double");
+                }
+            } else if (tag == CONSTANT_Integer) {
+                push(pc, makeType(ITEM_Integer));
+            } else if (tag == CONSTANT_Float) {
+                push(pc, makeType(ITEM_Float));
+            } else if (tag == CONSTANT_String) {
+                push(pc, makeObjectType(stringName));
+            } else if (tag == CONSTANT_Class) {
+                push(pc, makeObjectType(className));
+            } else if (tag == CONSTANT_MethodType) {
+                push(pc, makeObjectType(methodTypeName));
+            } else if (tag == CONSTANT_MethodHandle) {
+                push(pc, makeObjectType(methodHandleName));
+            } else {
+                fail(pc, "ldc de uma constante inválida");
+            }
+        } else if (opcode <= 0x2d) { // <t>load e <t>load_<n>
+            u4 kind, index;
+            if (opcode <= 0x19) {
+                kind = opcode - 0x15;
+                index = wide ? readU2(pc, operand) : readU1(pc, operand);
+                next = operand + (wide ? 2 : 1);
+            } else {
+                kind = (opcode - 0x1a) / 4;
+                index = (opcode - 0x1a) % 4;
+            }
+
+            if (kind == 4) { // aload
+                if (index >= _locals.size() || !isReference(_locals[index])) {
+                    fail(pc, "aload de uma variável local que não é uma referência");
+                }
+                push(pc, _locals[index]);
+            } else {
+                push(pc, getLocal(pc, index, makeType(kindTags[kind])));
+            }
+        } else if (opcode <= 0x35) { // <t>aload
+            pop(pc, makeType(ITEM_Integer));
+            Type arrayType = popReference(pc);
+            static const char elements[] = {'I', 'J', 'F', 'D', 'L', 'B', 'C', 'S'};
+            checkArrayType(pc, arrayType, elements[opcode - 0x2e]);
+
+            if (opcode == 0x32) { // aaload
+                push(pc, componentType(pc, arrayType));
+            } else if (opcode <= 0x31) {
+                push(pc, makeType(kindTags[opcode - 0x2e]));
+            } else {
+                push(pc, makeType(ITEM_Integer));
+            }
+        } else if (opcode <= 0x4e) { // <t>store e <t>store_<n>
+            u4 kind, index;
+            if (opcode <= 0x3a) {
+                kind = opcode - 0x36;
+                index = wide ? readU2(pc, operand) : readU1(pc, operand);
+                next = operand + (wide ? 2 : 1);
+            } else {
+                kind = (opcode - 0x3b) / 4;
+                index = (opcode - 0x3b) % 4;
+            }
+
+            if (kind == 4) { // astore
+                setLocal(pc, index, popReference(pc));
+            } else {
+                setLocal(pc, index, pop(pc, makeType(kindTags[kind])));
+            }
+        } else if (opcode <= 0x56) { // <t>astore
+            static const char elements[] = {'I', 'J', 'F', 'D', 'L', 'B', 'C', 'S'};
+            if (opcode == 0x53) { // aastore
+                popReference(pc);
+            } else if (opcode <= 0x52) {
+                pop(pc, makeType(kindTags[opcode - 0x4f]));
+            } else {
+                pop(pc, makeType(ITEM_Integer));
+            }
+            pop(pc, makeType(ITEM_Integer));
+            checkArrayType(pc, popReference(pc), elements[opcode - 0x4f]);
+        } else if (opcode == 0x57) { // pop
+            if (pop(pc).tag == ITEM_Top) {
+                fail(pc, "pop de um long/double");
+            }
+        } else if (opcode == 0x58) { // pop2
+            if (_stack.size() < 2) {
+                fail(pc, "pilha de operandos vazia");
+            }
+            checkStackBoundary(pc, _stack.size() - 2);
+            _stack.resize(_stack.size() - 2);
+        } else if (opcode <= 0x5f) { // dup, dup_x1, dup_x2, dup2, dup2_x1, dup2_x2, swap
+            // quantidade de posições copiadas e de posições abaixo delas que são saltadas
+            static const size_t copied[] = {1, 1, 1, 2, 2, 2};
+            static const size_t skipped[] = {0, 1, 2, 0, 1, 2};
+            size_t size = _stack.size();
+
+            if (opcode == 0x5f) { // swap
+                if (size < 2 || _stack[size - 1].tag == ITEM_Top || _stack[size - 2].tag == ITEM_Top) {
+                    fail(pc, "swap requer dois valores de categoria 1");
+                }
+                swap(_stack[size - 1], _stack[size - 2]);
+            } else {
+                size_t count = copied[opcode - 0x59];
+                size_t depth = count + skipped[opcode - 0x59];
+                if (size < depth) {
+                    fail(pc, "pilha de operandos vazia");
+                }
+                checkStackBoundary(pc, size - count);
+                checkStackBoundary(pc, size - depth);
+
+                vector<Type> values(_stack.end() - count, _stack.end());
+                _stack.insert(_stack.end() - depth, values.begin(), values.end());
+                if (_stack.size() > _code->max_stack) {
+                    fail(pc, "estouro da pilha de operandos (max_stack)");
+                }
+            }
+        } else if (opcode <= 0x73) { // <t>add, <t>sub, <t>mul, <t>div, <t>rem
+            Type type = makeType(kindTags[(opcode - 0x60) % 4]);
+            pop(pc, type);
+            pop(pc, type);
+            push(pc, type);
+        } else if (opcode <= 0x77) { // <t>neg
+            Type type = makeType(kindTags[opcode - 0x74]);
+            pop(pc, type);
+            push(pc, type);
+        } else if (opcode <= 0x83) { // shifts e operações lógicas (opcodes pares são de int, ímpares de long)
+            Type type = makeType((opcode % 2 == 0) ? ITEM_Integer : ITEM_Long);
+            pop(pc, opcode <= 0x7d ? makeType(ITEM_Integer) : type);
+            pop(pc, type);
+            push(pc, type);
+        } else if (opcode == 0x84) { // iinc
+            u4 index = wide ? readU2(pc, operand) : readU1(pc, operand);
+            next = operand + (wide ? 4 : 2);
+            readU1(pc, next - 1);
+            getLocal(pc, index, makeType(ITEM_Integer));
+        } else if (opcode <= 0x90) { // conversões entre int, long, float e double
+            u4 conversion = opcode - 0x85;
+            u4 from = conversion / 3;
+            u4 to = conversion % 3;
+            if (to >= from) {
+                to++;
+            }
+            pop(pc, makeType(kindTags[from]));
+            push(pc, makeType(kindTags[to]));
+        } else if (opcode <= 0x93) { // i2b, i2c, i2s
+            pop(pc, makeType(ITEM_Integer));
+            push(pc, makeType(ITEM_Integer));
+        } else if (opcode <= 0x98) { // lcmp, fcmpl, fcmpg, dcmpl, dcmpg
+            Type type = makeType(opcode == 0x94 ? ITEM_Long : (opcode <= 0x96 ? ITEM_Float : ITEM_Double));
+            pop(pc, type);
+            pop(pc, type);
+            push(pc, makeType(ITEM_Integer));
+        } else if (opcode <= 0xa7 || opcode == 0xc6 || opcode == 0xc7) { // desvios de 2 bytes
+            int32_t target = (int32_t) pc + (int16_t) readU2(pc, operand);
+            next = operand + 2;
+
+            if (opcode <= 0x9e) { // if<cond>
+                pop(pc, makeType(ITEM_Integer));
+            } else if (opcode <= 0xa4) { // if_icmp<cond>
+                pop(pc, makeType(ITEM_Integer));
+                pop(pc, makeType(ITEM_Integer));
+            } else if (opcode <= 0xa6) { // if_acmp<cond>
+                popReference(pc);
+                popReference(pc);
+            } else if (opcode == 0xa7) { // goto
+                reachable = false;
+            } else { // ifnull, ifnonnull
+                popReference(pc);
+            }
+
+            if (target < 0) {
+                fail(pc, "destino de desvio fora do código");
+            }
+            checkTarget(pc, target, _stack);
+        } else if (opcode == 0xa8 || opcode == 0xa9 || opcode == 0xc9) { // jsr, ret, jsr_w
+            fail(pc, "jsr/ret não são permitidos em classes verificadas pelo StackMapTable");
+        } else if (opcode == 0xaa || opcode == 0xab) { // tableswitch, lookupswitch
+            pop(pc, makeType(ITEM_Integer));
+
+            u4 base = pc + 1 + (3 - pc % 4); // os operandos são alinhados em 4 bytes
+            vector<int32_t> offsets(1, readS4(pc, base));
+            if (opcode == 0xaa) {
+                int32_t low = readS4(pc, base + 4);
+                int32_t high = readS4(pc, base + 8);
+                if (low > high) {
+                    fail(pc, "tableswitch com low maior que high");
+                }
+                u4 count = (u4) ((int64_t) high - low + 1);
+                for (u4 i = 0; i < count; i++) {
+                    offsets.push_back(readS4(pc, base + 12 + 4 * i));
+                }
+                next = base + 12 + 4 * count;
+            } else {
+                int32_t pairs = readS4(pc, base + 4);
+                if (pairs < 0) {
+                    fail(pc, "lookupswitch com quantidade negativa de pares");
+                }
+                for (int32_t i = 0; i < pairs; i++) {
+                    offsets.push_back(readS4(pc, base + 8 + 8 * i + 4));
+                }
+                next = base + 8 + 8 * pairs;
+            }
+
+            for (size_t i = 0; i < offsets.size(); i++) {
+                int64_t target = (int64_t) pc + offsets[i];
+                if (target < 0 || target >= codeLength) {
+                    fail(pc, "destino de desvio fora do código");
+                }
+                checkTarget(pc, (u4) target, _stack);
+            }
+            reachable = false;
+        } else if (opcode <= 0xb1) { // <t>return, return
+            verifyReturn(pc, opcode);
+            reachable = false;
+        } else if (opcode <= 0xb5) { // getstatic, putstatic, getfield, putfield
+            verifyFieldAccess(pc, opcode, readU2(pc, operand));
+            next = operand + 2;
+        } else if (opcode <= 0xba) { // invokevirtual, invokespecial, invokestatic, invokeinterface, invokedynamic
+            u2 index = readU2(pc, operand);
+            next = operand + 2;
+            if (opcode == 0xb9) {
+                if (readU1(pc, operand + 2) == 0 || readU1(pc, operand + 3) != 0) {
+                    fail(pc, "operandos inválidos em invokeinterface");
+                }
+                next = operand + 4;
+            } else if (opcode == 0xba) {
+                if (readU1(pc, operand + 2) != 0 || readU1(pc, operand + 3) != 0) {
+                    fail(pc, "operandos inválidos em invokedynamic");
+                }
+                next = operand + 4;
+            }
+            verifyInvoke(pc, opcode, index);
+        } else if (opcode == 0xbb) { // new
+            Symbol createdClass = getClassName(pc, readU2(pc, operand));
+            next = operand + 2;
+            if ((*createdClass)[0] == '[') {
+                fail(pc, "new de um array");
+            }
+
+            Type uninitialized = makeUninitializedType(pc);
+            for (size_t i = 0; i < _stack.size(); i++) {
+                if (_stack[i] == uninitialized) {
+                    fail(pc, "objeto criado pela instrução new ainda está na pilha");
+                }
+            }
+            initializeObject(uninitialized, makeType(ITEM_Top));
+            push(pc, uninitialized);
+        } else if (opcode == 0xbc) { // newarray
+            static const char *descriptors[] = {"[Z", "[C", "[F", "[D", "[B", "[S", "[I", "[J"};
+            u1 arrayType = readU1(pc, operand);
+            next = operand + 1;
+            if (arrayType < 4 || arrayType > 11) {
+                fail(pc, "tipo inválido em newarray");
+            }
+            pop(pc, makeType(ITEM_Integer));
+            push(pc, makeObjectType(symbolTable.intern(descriptors[arrayType - 4])));
+        } else if (opcode == 0xbd) { // anewarray
+            const string &elementName = *getClassName(pc, readU2(pc, operand));
+            next = operand + 2;
+            pop(pc, makeType(ITEM_Integer));
+            push(pc, makeObjectType(symbolTable.intern(elementName[0] == '[' ? "[" + elementName : "[L" + elementName + ";")));
+        } else if (opcode == 0xbe) { // arraylength
+            Type arrayType = popReference(pc);
+            if (arrayType.tag != ITEM_Null && (arrayType.tag != ITEM_Object || (*arrayType.className)[0] != '[')) {
+                fail(pc, "arraylength de um valor que não é array");
+            }
+            push(pc, makeType(ITEM_Integer));
+        } else if (opcode == 0xbf) { // athrow
+            pop(pc, makeObjectType(throwableName));
+            reachable = false;
+        } else if (opcode == 0xc0 || opcode == 0xc1) { // checkcast, instanceof
+            Symbol targetClass = getClassName(pc, readU2(pc, operand));
+            next = operand + 2;
+            Type value = popReference(pc);
+            if (value.tag == ITEM_Uninitialized || value.tag == ITEM_UninitializedThis) {
+                fail(pc, "uso de objeto não inicializado");
+            }
+            push(pc, opcode == 0xc0 ? makeObjectType(targetClass) : makeType(ITEM_Integer));
+        } else if (opcode == 0xc2 || opcode == 0xc3) { // monitorenter, monitorexit
+            pop(pc, makeObjectType(objectName));
+        } else if (opcode == 0xc5) { // multianewarray
+            Symbol arrayClass = getClassName(pc, readU2(pc, operand));
+            u1 dimensions = readU1(pc, operand + 2);
+            next = operand + 3;
+            if (dimensions == 0 || arrayClass->find_first_not_of('[') < dimensions) {
+                fail(pc, "dimensões inválidas em multianewarray");
+            }
+            for (u1 i = 0; i < dimensions; i++) {
+                pop(pc, makeType(ITEM_Integer));
+            }
+            push(pc, makeObjectType(arrayClass));
+        } else if (opcode == 0xc8) { // goto_w
+            int64_t target = (int64_t) pc + readS4(pc, operand);
+            next = operand + 4;
+            if (target < 0 || target >= codeLength) {
+                fail(pc, "destino de desvio fora do código");
+            }
+            checkTarget(pc, (u4) target, _stack);
+            reachable = false;
+        } else {
+            fail(pc, "opcode inválido");
+        }
+
+        pc = next;
+    }
+
+    if (reachable) {
+        fail(codeLength, "a execução pode passar do final do código");
+    }
+    if (visitedStates != _states.size()) {
+        fail(0, "frame do StackMapTable no meio de uma instrução");
+    }
+}
@@ -1,14 +1,27 @@
 #include "vmstack.h"
+#include "methodarea.h"
+#include "monitor.h"
+#include "scheduler.h"
+#include "garbagecollector.h"
 
 #include <iostream>
 #include <cstdlib>
+#include <atomic>
 
-VMStack::VMStack() {
-    
+thread_local VMStack *VMStack::_current = NULL;
+
+VMStack::VMStack() : _threadObject(NULL), _nativeArguments(NULL), _allocationFailed(false), _allocationFailedCollections(0) {
+    static atomic<uintptr_t> nextThreadId(1);
+    _threadId = nextThreadId.fetch_add(1);
+    GarbageCollector::getInstance().registerStack(this);
+}
+
+void VMStack::setCurrent(VMStack *stack) {
+    _current = stack;
 }
 
 VMStack::~VMStack() {
-    
+    GarbageCollector::getInstance().unregisterStack(this);
 }
 
 void VMStack::addFrame(Frame *frame) {
@@ -18,7 +31,17 @@ void VMStack::addFrame(Frame *frame) {
 //        exit(1);
 //    }
     
-    _frameStack.push(frame);
+    // o frame é empilhado antes de adquirir o lock, para que os argumentos continuem alcançáveis durante a espera
+    _frameStack.push_back(frame);
+    
+    if (frame->isSynchronized()) {
+        if (Scheduler::currentGreenThread() != NULL) {
+            // uma thread verde não pode bloquear aqui: o lock é adquirido antes da primeira instrução do frame
+            frame->setMonitorPending(true);
+        } else {
+            Monitor::enter(frame->getLockWord());
+        }
+    }
 }
 
 Frame* VMStack::getTopFrame() {
@@ -26,7 +49,7 @@ Frame* VMStack::getTopFrame() {
         return NULL;
     }
     
-    return _frameStack.top();
+    return _frameStack.back();
 }
 
 bool VMStack::destroyTopFrame() {
@@ -34,8 +57,17 @@ bool VMStack::destroyTopFrame() {
         return false;
     }
     
-    Frame *frame = _frameStack.top();
-    _frameStack.pop();
+    Frame *frame = _frameStack.back();
+    _frameStack.pop_back();
+    
+    if (frame->isSynchronized() && !frame->isMonitorPending()) {
+        Monitor::exit(frame->getLockWord());
+    }
+    
+    ClassRuntime *classRuntime = frame->getClassRuntime();
+    if (!classRuntime->isInitialized() && frame->isClassInitializer()) {
+        MethodArea::getInstance().finishInitialization(classRuntime);
+    }
     delete frame;
     
     return true;
@@ -43,4 +75,58 @@ bool VMStack::destroyTopFrame() {
 
 uint32_t VMStack::size() {
     return _frameStack.size();
-}
\ No newline at end of file
+}
+
+uintptr_t VMStack::getThreadId() {
+    return _threadId;
+}
+
+ClassInstance* VMStack::getThreadObject() {
+    return _threadObject;
+}
+
+void VMStack::setThreadObject(ClassInstance *threadObject) {
+    _threadObject = threadObject;
+}
+void VMStack::setNativeArguments(vector<Value> *arguments) {
+    _nativeArguments = arguments;
+}
+
+void VMStack::getReferences(vector<Object*> &references) {
+    for (size_t i = 0; i < _frameStack.size(); i++) {
+        _frameStack[i]->getReferences(references);
+    }
+    
+    if (_threadObject != NULL) {
+        references.push_back(_threadObject);
+    }
+    
+    if (_nativeArguments != NULL) {
+        for (size_t i = 0; i < _nativeArguments->size(); i++) {
+            if ((*_nativeArguments)[i].type == ValueType::REFERENCE) {
+                references.push_back((*_nativeArguments)[i].data.object);
+            }
+        }
+    }
+}
+
+vector<Object*>& VMStack::getSatbBuffer() {
+    return _satbBuffer;
+}
+
+bool VMStack::hasAllocationFailed() {
+    return _allocationFailed;
+}
+
+u4 VMStack::getAllocationFailedCollections() {
+    return _allocationFailedCollections;
+}
+
+void VMStack::setAllocationFailed(u4 startedCollections) {
+    _allocationFailed = true;
+    _allocationFailedCollections = startedCollections;
+}
+
+void VMStack::clearAllocationFailed() {
+    _allocationFailed = false;
+}
@@ -0,0 +1,185 @@
+#include "ziparchive.h"
+#include "inflater.h"
+
+#include <iostream>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014b50
+#define ZIP_END_SIGNATURE 0x06054b50
+
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_END_SIZE 22
+#define ZIP_MAX_COMMENT_SIZE 0xffff
+
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATED 8
+
+/**
+ * @brief Lê um inteiro de 16 bits little endian (a ordem de bytes do formato ZIP).
+ */
+static u2 readLittleU2(const u1 *bytes) {
+    return bytes[0] | (bytes[1] << 8);
+}
+
+/**
+ * @brief Lê um inteiro de 32 bits little endian (a ordem de bytes do formato ZIP).
+ */
+static u4 readLittleU4(const u1 *bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((u4) bytes[3] << 24);
+}
+
+ZipArchive::ZipArchive(const string &path) : _path(path), _bytes(NULL), _length(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat fileStat;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size >= ZIP_END_SIZE) {
+        mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+
+    _bytes = (const u1 *) mapping;
+    _length = fileStat.st_size;
+
+    if (!readCentralDirectory()) {
+        munmap((void *) _bytes, _length);
+        _bytes = NULL;
+        _length = 0;
+        _entries.clear();
+    }
+}
+
+ZipArchive::~ZipArchive() {
+    // as entradas armazenadas sem compressão apontam para o mapeamento e podem estar em uso por classes carregadas,
+    // portanto o mapeamento não é desfeito.
+}
+
+bool ZipArchive::isOpen() {
+    return _bytes != NULL;
+}
+
+bool ZipArchive::readCentralDirectory() {
+    // o registro de fim do diretório central fica no final do arquivo, seguido de um comentário opcional
+    size_t minOffset = (_length > ZIP_END_SIZE + ZIP_MAX_COMMENT_SIZE) ? _length - ZIP_END_SIZE - ZIP_MAX_COMMENT_SIZE : 0;
+    size_t endOffset = _length - ZIP_END_SIZE;
+    while (readLittleU4(_bytes + endOffset) != ZIP_END_SIGNATURE) {
+        if (endOffset == minOffset) {
+            return false;
+        }
+        endOffset--;
+    }
+
+    const u1 *end = _bytes + endOffset;
+    u2 entriesCount = readLittleU2(end + 10);
+    u4 directorySize = readLittleU4(end + 12);
+    u4 directoryOffset = readLittleU4(end + 16);
+    if ((size_t) directoryOffset + directorySize > endOffset) {
+        return false;
+    }
+
+    _entries.reserve(entriesCount);
+
+    size_t offset = directoryOffset;
+    size_t directoryEnd = (size_t) directoryOffset + directorySize;
+    for (u2 i = 0; i < entriesCount; i++) {
+        if (offset + ZIP_CENTRAL_HEADER_SIZE > directoryEnd) {
+            return false;
+        }
+
+        const u1 *header = _bytes + offset;
+        if (readLittleU4(header) != ZIP_CENTRAL_HEADER_SIGNATURE) {
+            return false;
+        }
+
+        u2 nameLength = readLittleU2(header + 28);
+        u2 extraLength = readLittleU2(header + 30);
+        u2 commentLength = readLittleU2(header + 32);
+        size_t headerSize = ZIP_CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+        if (offset + headerSize > directoryEnd) {
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.method = readLittleU2(header + 10);
+        entry.compressedSize = readLittleU4(header + 20);
+        entry.uncompressedSize = readLittleU4(header + 24);
+        entry.localHeaderOffset = readLittleU4(header + 42);
+        entry.modificationTime = readLittleU4(header + 12); // hora (2 bytes) seguida da data (2 bytes)
+
+        _entries[string((const char *) header + ZIP_CENTRAL_HEADER_SIZE, nameLength)] = entry;
+        offset += headerSize;
+    }
+
+    return true;
+}
+
+bool ZipArchive::readEntry(const string &name, const u1 **bytes, u4 *length, AdoptedMemory *memory) {
+    if (_bytes == NULL) {
+        return false;
+    }
+
+    unordered_map<string, ZipEntry>::iterator it = _entries.find(name);
+    if (it == _entries.end()) {
+        return false;
+    }
+
+    const ZipEntry &entry = it->second;
+
+    // o tamanho do nome e do campo extra do cabeçalho local podem diferir dos do diretório central
+    const u1 *header = _bytes + entry.localHeaderOffset;
+    bool valid = (size_t) entry.localHeaderOffset + ZIP_LOCAL_HEADER_SIZE <= _length && readLittleU4(header) == ZIP_LOCAL_HEADER_SIGNATURE;
+
+    size_t dataOffset = 0;
+    if (valid) {
+        dataOffset = (size_t) entry.localHeaderOffset + ZIP_LOCAL_HEADER_SIZE + readLittleU2(header + 26) + readLittleU2(header + 28);
+        valid = dataOffset + entry.compressedSize <= _length;
+    }
+
+    if (valid && entry.method == ZIP_METHOD_STORED && entry.compressedSize == entry.uncompressedSize) {
+        *bytes = _bytes + dataOffset;
+        *length = entry.uncompressedSize;
+        memory->address = NULL;
+        return true;
+    }
+
+    if (valid && entry.method == ZIP_METHOD_DEFLATED) {
+        u1 *data = (u1 *) malloc(entry.uncompressedSize > 0 ? entry.uncompressedSize : 1);
+        if (Inflater::inflate(_bytes + dataOffset, entry.compressedSize, data, entry.uncompressedSize)) {
+            *bytes = data;
+            *length = entry.uncompressedSize;
+            memory->address = data;
+            memory->length = entry.uncompressedSize;
+            memory->mapped = false;
+            return true;
+        }
+        free(data);
+    }
+
+    cerr << "ClassFormatError: entrada " << name << " corrompida ou não suportada em " << _path << endl;
+    exit(3);
+}
+
+bool ZipArchive::getEntryStamp(const string &name, u4 *length, u4 *modificationTime) {
+    unordered_map<string, ZipEntry>::iterator it = _entries.find(name);
+    if (it == _entries.end()) {
+        return false;
+    }
+
+    *length = it->second.uncompressedSize;
+    *modificationTime = it->second.modificationTime;
+    return true;
+}